@@ -0,0 +1,132 @@
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <vector>
+
+#include "bench/synthetic_session.h"
+#include "benchmark/benchmark.h"
+#include "src/tracking.h"
+
+namespace bench {
+namespace {
+
+constexpr std::size_t FRAME_COUNT = 10;
+
+const std::vector<cv::Mat>& frames() {
+  static const std::vector<cv::Mat> frames = []() {
+    const SyntheticSession session =
+      make_synthetic_session({.frame_count = FRAME_COUNT});
+    std::vector<cv::Mat> frames;
+    for (const std::vector<Person>& people : session.keypoints[0]) {
+      frames.push_back(render_keypoints(people, session.options.image_size));
+    }
+    return frames;
+  }();
+  return frames;
+}
+
+std::vector<int> encode_parameters(const std::string& extension, int level) {
+  if (extension == ".png") return {cv::IMWRITE_PNG_COMPRESSION, level};
+  return {cv::IMWRITE_JPEG_QUALITY, level};
+}
+
+std::vector<std::vector<unsigned char>> encode_frames(
+  const std::string& extension,
+  int level
+) {
+  std::vector<std::vector<unsigned char>> buffers;
+  for (const cv::Mat& frame : frames()) {
+    cv::imencode(
+      extension,
+      frame,
+      buffers.emplace_back(),
+      encode_parameters(extension, level)
+    );
+  }
+  return buffers;
+}
+
+void set_counters(benchmark::State& state, double bytes) {
+  const double frame_count =
+    static_cast<double>(state.iterations()) * FRAME_COUNT;
+  state.counters["fps"] =
+    benchmark::Counter(frame_count, benchmark::Counter::kIsRate);
+  state.counters["bytes_per_frame"] = bytes / frame_count;
+}
+
+void encode(benchmark::State& state, const std::string& extension) {
+  const int level = static_cast<int>(state.range(0));
+  const std::vector<int> parameters = encode_parameters(extension, level);
+  std::vector<unsigned char> buffer;
+  double bytes = 0;
+  for (auto _ : state) {
+    for (const cv::Mat& frame : frames()) {
+      cv::imencode(extension, frame, buffer, parameters);
+      bytes += buffer.size();
+    }
+  }
+  set_counters(state, bytes);
+}
+
+void decode(benchmark::State& state, const std::string& extension) {
+  const std::vector<std::vector<unsigned char>> buffers =
+    encode_frames(extension, static_cast<int>(state.range(0)));
+  double bytes = 0;
+  for (auto _ : state) {
+    for (const std::vector<unsigned char>& buffer : buffers) {
+      cv::Mat image = cv::imdecode(buffer, cv::IMREAD_COLOR);
+      benchmark::DoNotOptimize(image.data);
+      bytes += buffer.size();
+    }
+  }
+  set_counters(state, bytes);
+}
+
+/**
+ * The recorder's PNG frames, by compression level.
+ */
+void BM_EncodePng(benchmark::State& state) {
+  encode(state, ".png");
+}
+BENCHMARK(BM_EncodePng)
+  ->ArgName("compression")
+  ->Arg(1)
+  ->Arg(3)
+  ->Unit(benchmark::kMillisecond);
+
+/**
+ * The extractor reading those frames back.
+ */
+void BM_DecodePng(benchmark::State& state) {
+  decode(state, ".png");
+}
+BENCHMARK(BM_DecodePng)
+  ->ArgName("compression")
+  ->Arg(1)
+  ->Arg(3)
+  ->Unit(benchmark::kMillisecond);
+
+/**
+ * MJPEG cameras' frames, by quality.
+ */
+void BM_EncodeJpeg(benchmark::State& state) {
+  encode(state, ".jpg");
+}
+BENCHMARK(BM_EncodeJpeg)
+  ->ArgName("quality")
+  ->Arg(80)
+  ->Arg(95)
+  ->Unit(benchmark::kMillisecond);
+
+void BM_DecodeJpeg(benchmark::State& state) {
+  decode(state, ".jpg");
+}
+BENCHMARK(BM_DecodeJpeg)
+  ->ArgName("quality")
+  ->Arg(80)
+  ->Arg(95)
+  ->Unit(benchmark::kMillisecond);
+
+}
+}
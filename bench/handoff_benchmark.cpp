@@ -0,0 +1,93 @@
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "bench/synthetic_session.h"
+#include "benchmark/benchmark.h"
+#include "lf/queue.h"
+#include "src/tracking.h"
+
+namespace bench {
+namespace {
+
+constexpr std::size_t FRAME_COUNT = 30;
+
+const SyntheticSession& session() {
+  static const SyntheticSession session =
+    make_synthetic_session({.frame_count = FRAME_COUNT});
+  return session;
+}
+
+const std::vector<cv::Mat>& frames() {
+  static const std::vector<cv::Mat> frames = []() {
+    std::vector<cv::Mat> frames;
+    for (const std::vector<Person>& people : session().keypoints[0]) {
+      frames.push_back(
+        render_keypoints(people, session().options.image_size)
+      );
+    }
+    return frames;
+  }();
+  return frames;
+}
+
+/**
+ * Passes every item from a producer thread to the benchmark thread through a
+ * queue of `state.range(0)` slots. The producer spins while the queue is
+ * full, the way the recorder's scheduler checks before handing off.
+ */
+template <typename T>
+void handoff(benchmark::State& state, const std::vector<T>& items) {
+  const std::size_t capacity = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    lf::Queue<T> queue{capacity};
+    std::thread producer{[&queue, &items]() {
+      for (const T& item : items) {
+        while (queue.size() >= queue.max_size()) std::this_thread::yield();
+        queue.push(item);
+      }
+    }};
+    for (std::size_t received = 0; received < items.size();) {
+      std::optional<T> item = queue.pop();
+      if (!item) {
+        std::this_thread::yield();
+        continue;
+      }
+      benchmark::DoNotOptimize(*item);
+      ++received;
+    }
+    producer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+/**
+ * Frames from capture to encode, which only moves the image headers.
+ */
+void BM_FrameHandoff(benchmark::State& state) {
+  handoff(state, frames());
+}
+BENCHMARK(BM_FrameHandoff)
+  ->ArgName("capacity")
+  ->Arg(1)
+  ->Arg(4)
+  ->Arg(16)
+  ->UseRealTime();
+
+/**
+ * Detected people to a saver, which copies every keypoint.
+ */
+void BM_KeypointHandoff(benchmark::State& state) {
+  handoff(state, session().keypoints[0]);
+}
+BENCHMARK(BM_KeypointHandoff)
+  ->ArgName("capacity")
+  ->Arg(1)
+  ->Arg(4)
+  ->Arg(16)
+  ->UseRealTime();
+
+}
+}
@@ -0,0 +1,103 @@
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bench/synthetic_session.h"
+#include "benchmark/benchmark.h"
+#include "episode/project.h"
+#include "src/tracking.h"
+
+namespace bench {
+namespace {
+
+using ::std::filesystem::path;
+
+const path BENCHMARK_DIR = "/tmp/benchmark/ar/bench/keypoints";
+
+const SyntheticSession& session() {
+  static const SyntheticSession session =
+    make_synthetic_session({.frame_count = 100, .people_count = 3});
+  return session;
+}
+
+/**
+ * The session, written once and shared by every benchmark in the run.
+ */
+const episode::Project& project() {
+  static const episode::Project project = []() {
+    episode::Project::destroy(BENCHMARK_DIR);
+    episode::Project project = episode::Project::open(BENCHMARK_DIR);
+    write_synthetic_session(session(), project);
+    return project;
+  }();
+  return project;
+}
+
+path keypoints_file(const std::string& camera, std::size_t frame) {
+  return project().camera(camera).left_recording /
+    (std::to_string(frame) + ".yml");
+}
+
+path output_path(const std::string& name) {
+  std::filesystem::create_directories(BENCHMARK_DIR);
+  return BENCHMARK_DIR / name;
+}
+
+void set_counters(benchmark::State& state, std::size_t files) {
+  state.counters["files"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * files),
+    benchmark::Counter::kIsRate
+  );
+}
+
+void BM_SavePeople(benchmark::State& state) {
+  const std::vector<std::vector<Person>>& frames = session().keypoints[0];
+  const path file = output_path("save.yml");
+  for (auto _ : state) {
+    for (const std::vector<Person>& people : frames) save_people(people, file);
+  }
+  set_counters(state, frames.size());
+}
+BENCHMARK(BM_SavePeople)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_LoadPeople(benchmark::State& state) {
+  const std::string& camera = session().cameras[0].name;
+  const std::size_t frame_count = session().keypoints[0].size();
+  for (auto _ : state) {
+    for (std::size_t f = 0; f < frame_count; ++f) {
+      std::vector<Person> people = load_people(keypoints_file(camera, f));
+      benchmark::DoNotOptimize(people.data());
+    }
+  }
+  set_counters(state, frame_count);
+}
+BENCHMARK(BM_LoadPeople)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_SaveGroundTruth(benchmark::State& state) {
+  const path file = output_path("save_3d.yml");
+  for (auto _ : state) {
+    for (const std::vector<Person3d>& people : session().ground_truth) {
+      save_people_3d(people, file);
+    }
+  }
+  set_counters(state, session().ground_truth.size());
+}
+BENCHMARK(BM_SaveGroundTruth)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_LoadGroundTruth(benchmark::State& state) {
+  const path directory = ground_truth_directory(project());
+  const std::size_t frame_count = session().ground_truth.size();
+  for (auto _ : state) {
+    for (std::size_t f = 0; f < frame_count; ++f) {
+      std::vector<Person3d> people =
+        load_people_3d(directory / (std::to_string(f) + ".yml"));
+      benchmark::DoNotOptimize(people.data());
+    }
+  }
+  set_counters(state, frame_count);
+}
+BENCHMARK(BM_LoadGroundTruth)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}
+}
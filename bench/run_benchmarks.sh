@@ -0,0 +1,35 @@
+#!/bin/bash
+# Runs every benchmark in //bench, writing Google Benchmark's JSON results
+# one file per benchmark so runs can be compared across releases:
+#
+#   bazel run -c opt //bench:run_benchmarks -- results/v1.2
+#
+# Further arguments go to every benchmark, such as --benchmark_repetitions=5.
+# Two result directories compare with benchmark's tools/compare.py.
+set -euo pipefail
+
+if [[ $# -lt 1 ]]; then
+  echo "Usage: run_benchmarks OUTPUT_DIRECTORY [BENCHMARK_FLAG...]" >&2
+  exit 1
+fi
+output_dir="$1"
+shift
+if [[ "$output_dir" != /* ]]; then
+  output_dir="${BUILD_WORKING_DIRECTORY:-$PWD}/$output_dir"
+fi
+mkdir -p "$output_dir"
+
+bench_dir="${RUNFILES_DIR:-$0.runfiles}/cooking_ar/bench"
+commit="$(
+  git -C "${BUILD_WORKSPACE_DIRECTORY:-.}" rev-parse HEAD 2>/dev/null ||
+    echo unknown
+)"
+
+for benchmark in frame_codec handoff keypoints triangulation; do
+  echo "Running ${benchmark}_benchmark"
+  "$bench_dir/${benchmark}_benchmark" \
+    --benchmark_out="$output_dir/$benchmark.json" \
+    --benchmark_out_format=json \
+    --benchmark_context=commit="$commit" \
+    "$@"
+done
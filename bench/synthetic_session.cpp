@@ -0,0 +1,359 @@
+#include "bench/synthetic_session.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <numbers>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "episode/project.h"
+#include "src/cameras.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace bench {
+namespace {
+
+using ::std::filesystem::path;
+using ::std::numbers::pi;
+
+const path GROUND_TRUTH_DIR = "ground_truth";
+
+constexpr double FPS = 30.0;
+
+// Cameras stand on a ring around the stage, looking at its middle.
+constexpr double CAMERA_RING_RADIUS = 4.0;
+constexpr double CAMERA_HEIGHT = 2.2;
+const cv::Vec3d CAMERA_TARGET{0.0, 0.0, 1.0};
+
+// People walk a ring of their own, inside the cameras'.
+constexpr double WALK_RADIUS = 0.8;
+constexpr double WALK_SPEED = 0.3; // Radians per second.
+constexpr double STRIDE_RATE = 1.5; // Strides per second.
+constexpr double STRIDE_LENGTH = 0.15;
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+constexpr double C920_FX = 1.4611308193324010e+03;
+constexpr double C920_CX = 9.6725501506486341e+02;
+constexpr double C920_CY = 5.5545825804372771e+02;
+const cv::Size C920_SIZE{1920, 1080};
+constexpr std::array<double, 5> C920_DISTORTION = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+/**
+ * BODY_25 joints of a person standing at the origin facing +y, with z up.
+ */
+constexpr std::array<std::array<double, 3>, BODY_25_POINT_COUNT>
+STANDING_POSE = {{
+  {0.00, 0.08, 1.60},   // Nose
+  {0.00, 0.00, 1.50},   // Neck
+  {-0.20, 0.00, 1.45},  // RShoulder
+  {-0.25, 0.00, 1.15},  // RElbow
+  {-0.27, 0.05, 0.90},  // RWrist
+  {0.20, 0.00, 1.45},   // LShoulder
+  {0.25, 0.00, 1.15},   // LElbow
+  {0.27, 0.05, 0.90},   // LWrist
+  {0.00, 0.00, 0.95},   // MidHip
+  {-0.10, 0.00, 0.95},  // RHip
+  {-0.11, 0.02, 0.50},  // RKnee
+  {-0.12, 0.00, 0.08},  // RAnkle
+  {0.10, 0.00, 0.95},   // LHip
+  {0.11, 0.02, 0.50},   // LKnee
+  {0.12, 0.00, 0.08},   // LAnkle
+  {-0.04, 0.10, 1.65},  // REye
+  {0.04, 0.10, 1.65},   // LEye
+  {-0.08, 0.02, 1.63},  // REar
+  {0.08, 0.02, 1.63},   // LEar
+  {0.13, 0.18, 0.02},   // LBigToe
+  {0.17, 0.15, 0.02},   // LSmallToe
+  {0.12, -0.05, 0.03},  // LHeel
+  {-0.13, 0.18, 0.02},  // RBigToe
+  {-0.17, 0.15, 0.02},  // RSmallToe
+  {-0.12, -0.05, 0.03}  // RHeel
+}};
+
+/**
+ * How far forward each joint swings with a stride, right side leading.
+ */
+constexpr std::array<double, BODY_25_POINT_COUNT> STRIDE_SWING = {
+  0.0, 0.0, 0.0, -0.5, -1.0, 0.0, 0.5, 1.0, 0.0, 0.0, 0.5, 1.0, 0.0, -0.5,
+  -1.0, 0.0, 0.0, 0.0, 0.0, -1.0, -1.0, -1.0, 1.0, 1.0, 1.0
+};
+
+CameraParameters make_camera_parameters(
+  int camera_id,
+  int camera_count,
+  cv::Size image_size
+) {
+  const double x_scale = static_cast<double>(image_size.width) /
+    C920_SIZE.width;
+  const double y_scale = static_cast<double>(image_size.height) /
+    C920_SIZE.height;
+  const cv::Matx33d matrix{
+    C920_FX * x_scale, 0.0, C920_CX * x_scale,
+    0.0, C920_FX * y_scale, C920_CY * y_scale,
+    0.0, 0.0, 1.0
+  };
+
+  // Looks at the target with OpenCV's axes: x right, y down, z forward.
+  const double angle = 2.0 * pi * (camera_id + 0.5) / camera_count;
+  const cv::Vec3d center{
+    CAMERA_RING_RADIUS * std::cos(angle),
+    CAMERA_RING_RADIUS * std::sin(angle),
+    CAMERA_HEIGHT
+  };
+  const cv::Vec3d forward = cv::normalize(CAMERA_TARGET - center);
+  const cv::Vec3d right = cv::normalize(forward.cross(cv::Vec3d{0, 0, 1}));
+  const cv::Vec3d down = forward.cross(right);
+  const cv::Matx33d rotation{
+    right[0], right[1], right[2],
+    down[0], down[1], down[2],
+    forward[0], forward[1], forward[2]
+  };
+  const cv::Vec3d translation = -(rotation * center);
+  cv::Vec3d rotation_vector;
+  cv::Rodrigues(rotation, rotation_vector);
+
+  return CameraParameters{
+    .device = {
+      .camera_id = camera_id,
+      .name = "synthetic " + std::to_string(camera_id)
+    },
+    .matrix = cv::Mat{matrix}.clone(),
+    .distortion = cv::Mat{
+      1,
+      static_cast<int>(C920_DISTORTION.size()),
+      CV_64F,
+      const_cast<double*>(C920_DISTORTION.data())
+    }.clone(),
+    .rotation = cv::Mat{rotation_vector}.clone(),
+    .translation = cv::Mat{translation}.clone()
+  };
+}
+
+Person3d make_person(int person_id, std::size_t people_count, double time) {
+  const double angle =
+    2.0 * pi * person_id / people_count + WALK_SPEED * time;
+  const cv::Vec3d position{
+    WALK_RADIUS * std::cos(angle),
+    WALK_RADIUS * std::sin(angle),
+    0.0
+  };
+  // Facing along the ring, which is the standing pose turned by the angle.
+  const double c = std::cos(angle);
+  const double s = std::sin(angle);
+  const double stride =
+    STRIDE_LENGTH * std::sin(2.0 * pi * STRIDE_RATE * time);
+
+  Person3d person{.person_id = person_id};
+  person.body.reserve(BODY_25_POINT_COUNT);
+  for (std::size_t i = 0; i < BODY_25_POINT_COUNT; ++i) {
+    const std::array<double, 3>& joint = STANDING_POSE[i];
+    const double x = joint[0];
+    const double y = joint[1] + STRIDE_SWING[i] * stride;
+    person.body.push_back(Point3d{
+      .point_id = static_cast<int>(i),
+      .x = position[0] + c * x - s * y,
+      .y = position[1] + s * x + c * y,
+      .z = joint[2],
+      .confidence = 1.0
+    });
+  }
+  return person;
+}
+
+Person render_person(
+  const Person3d& person,
+  const CameraParameters& parameters,
+  cv::Size image_size,
+  double pixel_noise,
+  std::mt19937& rng
+) {
+  std::vector<cv::Point3d> world;
+  world.reserve(person.body.size());
+  for (const Point3d& point : person.body) {
+    world.emplace_back(point.x, point.y, point.z);
+  }
+  std::vector<cv::Point2d> pixels;
+  cv::projectPoints(
+    world,
+    parameters.rotation,
+    parameters.translation,
+    parameters.matrix,
+    parameters.distortion,
+    pixels
+  );
+
+  cv::Matx33d rotation;
+  cv::Rodrigues(parameters.rotation, rotation);
+  const cv::Vec3d translation{
+    parameters.translation.at<double>(0),
+    parameters.translation.at<double>(1),
+    parameters.translation.at<double>(2)
+  };
+  const cv::Rect2d bounds{
+    0.0,
+    0.0,
+    static_cast<double>(image_size.width),
+    static_cast<double>(image_size.height)
+  };
+
+  std::normal_distribution<double> noise{
+    0.0,
+    pixel_noise > 0.0 ? pixel_noise : 1.0
+  };
+  const auto jitter = [&]() { return pixel_noise > 0.0 ? noise(rng) : 0.0; };
+
+  Person rendered{.person_id = person.person_id};
+  rendered.body.reserve(pixels.size());
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    const cv::Vec3d camera_point =
+      rotation * cv::Vec3d{world[i].x, world[i].y, world[i].z} + translation;
+    const int point_id = person.body[i].point_id;
+    if (camera_point[2] <= 0.0 || !bounds.contains(pixels[i])) {
+      rendered.body.push_back(Point{.point_id = point_id});
+      continue;
+    }
+    rendered.body.push_back(Point{
+      .point_id = point_id,
+      .x = pixels[i].x + jitter(),
+      .y = pixels[i].y + jitter(),
+      .confidence = 0.9
+    });
+  }
+  return rendered;
+}
+
+path frame_file(const path& directory, std::size_t frame, const char* ext) {
+  return directory / (std::to_string(frame) + ext);
+}
+
+}
+
+SyntheticSession make_synthetic_session(
+  const SyntheticSessionOptions& options
+) {
+  if (options.camera_count < 1) {
+    throw std::invalid_argument("Synthetic sessions need at least one camera.");
+  }
+
+  SyntheticSession session{.options = options};
+  for (int i = 0; i < options.camera_count; ++i) {
+    session.cameras.push_back(SyntheticCamera{
+      .name = "camera_" + std::to_string(i),
+      .parameters =
+        make_camera_parameters(i, options.camera_count, options.image_size)
+    });
+  }
+
+  session.ground_truth.reserve(options.frame_count);
+  for (std::size_t f = 0; f < options.frame_count; ++f) {
+    std::vector<Person3d>& people = session.ground_truth.emplace_back();
+    for (std::size_t p = 0; p < options.people_count; ++p) {
+      people.push_back(
+        make_person(static_cast<int>(p), options.people_count, f / FPS)
+      );
+    }
+  }
+
+  std::mt19937 rng{options.seed};
+  session.keypoints.resize(session.cameras.size());
+  for (std::size_t c = 0; c < session.cameras.size(); ++c) {
+    std::vector<std::vector<Person>>& frames = session.keypoints[c];
+    frames.reserve(options.frame_count);
+    for (const std::vector<Person3d>& people : session.ground_truth) {
+      std::vector<Person>& rendered = frames.emplace_back();
+      for (const Person3d& person : people) {
+        rendered.push_back(render_person(
+          person,
+          session.cameras[c].parameters,
+          options.image_size,
+          options.pixel_noise,
+          rng
+        ));
+      }
+    }
+  }
+  return session;
+}
+
+void write_synthetic_session(
+  const SyntheticSession& session,
+  episode::Project& project,
+  bool render_images
+) {
+  for (std::size_t c = 0; c < session.cameras.size(); ++c) {
+    const SyntheticCamera& camera = session.cameras[c];
+    const episode::CameraDirectory directory = project.add_camera(camera.name);
+    save_camera_parameters(camera.parameters, directory.calibration_file);
+    for (std::size_t f = 0; f < session.keypoints[c].size(); ++f) {
+      const std::vector<Person>& people = session.keypoints[c][f];
+      save_people(people, frame_file(directory.left_recording, f, ".yml"));
+      if (!render_images) continue;
+      const path image_file = frame_file(directory.left_recording, f, ".png");
+      const cv::Mat image =
+        render_keypoints(people, session.options.image_size);
+      if (!cv::imwrite(image_file.string(), image)) {
+        throw std::runtime_error("Failed to save frame " + image_file.string());
+      }
+    }
+  }
+
+  const path truth_directory = ground_truth_directory(project);
+  std::filesystem::create_directories(truth_directory);
+  for (std::size_t f = 0; f < session.ground_truth.size(); ++f) {
+    save_people_3d(
+      session.ground_truth[f],
+      frame_file(truth_directory, f, ".yml")
+    );
+  }
+}
+
+path ground_truth_directory(const episode::Project& project) {
+  return project.session_directory() / GROUND_TRUTH_DIR;
+}
+
+cv::Mat render_keypoints(
+  const std::vector<Person>& people,
+  cv::Size image_size
+) {
+  cv::Mat image{image_size, CV_8UC3};
+  cv::RNG rng{static_cast<std::uint64_t>(people.size()) + 1};
+  rng.fill(image, cv::RNG::NORMAL, cv::Scalar::all(96), cv::Scalar::all(12));
+
+  const cv::Scalar color{0, 255, 0};
+  for (const Person& person : people) {
+    for (const Bone& bone : BODY_25_BONES) {
+      if (static_cast<std::size_t>(bone.child) >= person.body.size()) continue;
+      const Point& parent = person.body[bone.parent];
+      const Point& child = person.body[bone.child];
+      if (parent.confidence <= 0.0 || child.confidence <= 0.0) continue;
+      cv::line(
+        image,
+        cv::Point2d{parent.x, parent.y},
+        cv::Point2d{child.x, child.y},
+        color,
+        4,
+        cv::LINE_AA
+      );
+    }
+    for (const Point& point : person.body) {
+      if (point.confidence <= 0.0) continue;
+      cv::circle(image, cv::Point2d{point.x, point.y}, 6, color, cv::FILLED);
+    }
+  }
+  return image;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "episode/project.h"
+#include "src/cameras.h"
+#include "src/tracking.h"
+
+namespace bench {
+
+struct SyntheticSessionOptions {
+  int camera_count = 4;
+  std::size_t frame_count = 300;
+  std::size_t people_count = 2;
+  cv::Size image_size{1920, 1080};
+
+  // Standard deviation, in pixels, of the noise added to rendered keypoints.
+  double pixel_noise = 0.5;
+
+  // Seeds the noise so every run of a benchmark sees the same session.
+  unsigned seed = 1;
+};
+
+struct SyntheticCamera {
+  std::string name;
+  CameraParameters parameters;
+};
+
+/**
+ * A recording session with known answers: calibrated cameras in a ring
+ * looking at people walking in its middle, the people's BODY_25 joints in
+ * world space and those joints as each camera would report them.
+ */
+struct SyntheticSession {
+  SyntheticSessionOptions options;
+  std::vector<SyntheticCamera> cameras;
+
+  // People in world space, in meters, one entry per frame.
+  std::vector<std::vector<Person3d>> ground_truth;
+
+  // Keypoints in distorted pixels, indexed by camera and then by frame.
+  // Joints out of a camera's view have zero confidence, as from OpenPose.
+  std::vector<std::vector<std::vector<Person>>> keypoints;
+};
+
+/**
+ * Generates a session in memory.
+ */
+SyntheticSession make_synthetic_session(
+  const SyntheticSessionOptions& options = {}
+);
+
+/**
+ * Writes the session into `project`. Each camera gets its calibration and a
+ * keypoint file per frame in its left recording, named like the extractor
+ * names them. With `render_images` the recording also gets the frames the
+ * keypoints were "detected" in. Ground truth goes to
+ * `ground_truth_directory()`.
+ */
+void write_synthetic_session(
+  const SyntheticSession& session,
+  episode::Project& project,
+  bool render_images = false
+);
+
+std::filesystem::path ground_truth_directory(const episode::Project& project);
+
+/**
+ * Draws the people's skeletons over sensor-like noise. Stands in for camera
+ * footage where the content doesn't matter but how well it compresses does.
+ */
+cv::Mat render_keypoints(
+  const std::vector<Person>& people,
+  cv::Size image_size
+);
+
+}
@@ -0,0 +1,172 @@
+#include "bench/synthetic_session.h"
+
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "episode/project.h"
+#include "gtest/gtest.h"
+#include "src/camera_model.h"
+#include "src/cameras.h"
+#include "src/tracking.h"
+#include "src/undistort.h"
+
+namespace bench {
+namespace {
+
+using ::std::filesystem::exists;
+using ::std::filesystem::path;
+
+const path PROJECTS_DIR = "/tmp/testing/ar/bench/synthetic_session";
+
+/**
+ * Distance from a world point to the ray through a keypoint.
+ */
+double ray_distance(
+  const CameraParameters& parameters,
+  const Point& pixel,
+  const Point3d& world
+) {
+  const CameraModel camera{parameters};
+  std::vector<cv::Point2f> normalized;
+  PointUndistorter{parameters}.undistort(
+    {cv::Point2f{static_cast<float>(pixel.x), static_cast<float>(pixel.y)}},
+    normalized
+  );
+  const cv::Vec3d to_point =
+    cv::Vec3d{world.x, world.y, world.z} - camera.world_center();
+  return cv::norm(to_point.cross(camera.ray(normalized[0])));
+}
+
+TEST(SyntheticSession, MakesEveryCameraAndFrame) {
+  const SyntheticSession session = make_synthetic_session({
+    .camera_count = 3,
+    .frame_count = 20,
+    .people_count = 2
+  });
+  ASSERT_EQ(session.cameras.size(), 3u);
+  ASSERT_EQ(session.ground_truth.size(), 20u);
+  ASSERT_EQ(session.keypoints.size(), 3u);
+  for (const std::vector<std::vector<Person>>& frames : session.keypoints) {
+    ASSERT_EQ(frames.size(), 20u);
+    for (const std::vector<Person>& people : frames) {
+      ASSERT_EQ(people.size(), 2u);
+      EXPECT_EQ(people[0].body.size(), 25u);
+    }
+  }
+  EXPECT_NE(session.cameras[0].name, session.cameras[1].name);
+}
+
+TEST(SyntheticSession, KeypointsLieOnRaysToGroundTruth) {
+  const SyntheticSession session = make_synthetic_session({
+    .camera_count = 4,
+    .frame_count = 10,
+    .pixel_noise = 0.0
+  });
+  std::size_t visible = 0;
+  for (std::size_t c = 0; c < session.cameras.size(); ++c) {
+    const CameraParameters& parameters = session.cameras[c].parameters;
+    for (std::size_t f = 0; f < session.ground_truth.size(); ++f) {
+      const std::vector<Person>& people = session.keypoints[c][f];
+      for (std::size_t p = 0; p < people.size(); ++p) {
+        for (std::size_t j = 0; j < people[p].body.size(); ++j) {
+          const Point& pixel = people[p].body[j];
+          if (pixel.confidence == 0.0) continue;
+          ++visible;
+          const Point3d& joint = session.ground_truth[f][p].body[j];
+          EXPECT_LT(ray_distance(parameters, pixel, joint), 1e-3);
+        }
+      }
+    }
+  }
+  // Everyone stays in view of every camera.
+  EXPECT_EQ(visible, 4u * 10u * 2u * 25u);
+}
+
+TEST(SyntheticSession, SameSeedSameSession) {
+  const SyntheticSession a = make_synthetic_session({.frame_count = 5});
+  const SyntheticSession b = make_synthetic_session({.frame_count = 5});
+  const SyntheticSession c =
+    make_synthetic_session({.frame_count = 5, .seed = 2});
+  const Point& point_a = a.keypoints[1][4][0].body[7];
+  const Point& point_b = b.keypoints[1][4][0].body[7];
+  const Point& point_c = c.keypoints[1][4][0].body[7];
+  EXPECT_EQ(point_a.x, point_b.x);
+  EXPECT_EQ(point_a.y, point_b.y);
+  EXPECT_NE(point_a.x, point_c.x);
+}
+
+TEST(SyntheticSession, RequiresCamera) {
+  EXPECT_THROW(
+    make_synthetic_session({.camera_count = 0}),
+    std::invalid_argument
+  );
+}
+
+TEST(SyntheticSession, WritesProjectLayout) {
+  episode::Project::destroy(PROJECTS_DIR);
+  episode::Project project = episode::Project::open(PROJECTS_DIR);
+  const SyntheticSession session = make_synthetic_session({
+    .camera_count = 2,
+    .frame_count = 3,
+    .image_size = {320, 180}
+  });
+  write_synthetic_session(session, project, /*render_images=*/true);
+
+  for (std::size_t c = 0; c < session.cameras.size(); ++c) {
+    const SyntheticCamera& camera = session.cameras[c];
+    ASSERT_TRUE(project.has_camera(camera.name));
+    const episode::CameraDirectory directory = project.camera(camera.name);
+
+    const CameraParameters parameters =
+      load_camera_parameters(directory.calibration_file);
+    EXPECT_EQ(parameters.device.camera_id, camera.parameters.device.camera_id);
+    EXPECT_EQ(
+      cv::norm(parameters.translation, camera.parameters.translation),
+      0.0
+    );
+
+    for (std::size_t f = 0; f < 3; ++f) {
+      const std::string frame = std::to_string(f);
+      EXPECT_TRUE(exists(directory.left_recording / (frame + ".png")));
+      const std::vector<Person> people =
+        load_people(directory.left_recording / (frame + ".yml"));
+      ASSERT_EQ(people.size(), session.keypoints[c][f].size());
+      EXPECT_NEAR(
+        people[0].body[1].x,
+        session.keypoints[c][f][0].body[1].x,
+        1e-6
+      );
+    }
+  }
+  const std::vector<Person3d> truth =
+    load_people_3d(ground_truth_directory(project) / "2.yml");
+  ASSERT_EQ(truth.size(), session.ground_truth[2].size());
+  EXPECT_NEAR(truth[0].body[1].z, session.ground_truth[2][0].body[1].z, 1e-6);
+}
+
+TEST(RenderKeypoints, DrawsOnFrameOfGivenSize) {
+  const SyntheticSession session = make_synthetic_session({
+    .camera_count = 1,
+    .frame_count = 1,
+    .image_size = {640, 360}
+  });
+  const cv::Mat image =
+    render_keypoints(session.keypoints[0][0], session.options.image_size);
+  EXPECT_EQ(image.size(), cv::Size(640, 360));
+  EXPECT_EQ(image.type(), CV_8UC3);
+
+  const Point& neck = session.keypoints[0][0][0].body[1];
+  const cv::Vec3b pixel = image.at<cv::Vec3b>(
+    static_cast<int>(std::round(neck.y)),
+    static_cast<int>(std::round(neck.x))
+  );
+  EXPECT_EQ(pixel, cv::Vec3b(0, 255, 0));
+}
+
+}
+}
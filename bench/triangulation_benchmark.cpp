@@ -0,0 +1,140 @@
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "bench/synthetic_session.h"
+#include "benchmark/benchmark.h"
+#include "src/camera_model.h"
+#include "src/tracking.h"
+#include "src/triangulation.h"
+#include "src/undistort.h"
+
+namespace bench {
+namespace {
+
+const SyntheticSession& session() {
+  static const SyntheticSession session =
+    make_synthetic_session({.frame_count = 100, .people_count = 3});
+  return session;
+}
+
+std::vector<Person> undistort_people(
+  const std::vector<Person>& people,
+  const PointUndistorter& undistorter
+) {
+  std::vector<Person> normalized;
+  normalized.reserve(people.size());
+  for (const Person& person : people) {
+    normalized.push_back(undistort_person(person, undistorter));
+  }
+  return normalized;
+}
+
+/**
+ * Undistorting one camera's keypoints, exactly or through a lookup grid with
+ * the given step.
+ */
+void BM_Undistort(benchmark::State& state) {
+  const SyntheticCamera& camera = session().cameras[0];
+  const PointUndistorter undistorter = state.range(0) == 0
+    ? PointUndistorter{camera.parameters}
+    : PointUndistorter{
+      camera.parameters,
+      session().options.image_size,
+      static_cast<int>(state.range(0))
+    };
+  const std::vector<std::vector<Person>>& frames = session().keypoints[0];
+  for (auto _ : state) {
+    for (const std::vector<Person>& people : frames) {
+      std::vector<Person> normalized = undistort_people(people, undistorter);
+      benchmark::DoNotOptimize(normalized.data());
+    }
+  }
+  state.counters["frames"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * frames.size()),
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_Undistort)
+  ->ArgName("grid_step")
+  ->Arg(0)
+  ->Arg(8)
+  ->Unit(benchmark::kMillisecond);
+
+/**
+ * Pairing and triangulating the people seen by the first two cameras, as the
+ * projector does, optionally measuring each joint's quality on the way. Also
+ * reports how far the result lands from the ground truth, so accuracy
+ * regressions show up next to speed ones.
+ */
+void BM_TriangulatePeople(benchmark::State& state) {
+  const SyntheticCamera& camera_1 = session().cameras[0];
+  const SyntheticCamera& camera_2 = session().cameras[1];
+  const CameraModel model_1{camera_1.parameters};
+  const CameraModel model_2{camera_2.parameters};
+  const PointUndistorter undistorter_1{camera_1.parameters};
+  const PointUndistorter undistorter_2{camera_2.parameters};
+
+  const std::size_t frame_count = session().ground_truth.size();
+  std::vector<std::vector<Person>> normalized_1;
+  std::vector<std::vector<Person>> normalized_2;
+  for (std::size_t f = 0; f < frame_count; ++f) {
+    normalized_1.push_back(
+      undistort_people(session().keypoints[0][f], undistorter_1)
+    );
+    normalized_2.push_back(
+      undistort_people(session().keypoints[1][f], undistorter_2)
+    );
+  }
+
+  const bool measure_quality = state.range(0) != 0;
+  TriangulationQuality quality;
+  ErrorSummary reprojection_error;
+  double error = 0.0;
+  std::size_t joints = 0;
+  for (auto _ : state) {
+    reprojection_error = {};
+    error = 0.0;
+    joints = 0;
+    for (std::size_t f = 0; f < frame_count; ++f) {
+      const std::vector<Person3d> people = triangulate_people(
+        model_1,
+        normalized_1[f],
+        model_2,
+        normalized_2[f],
+        {},
+        measure_quality ? &quality : nullptr
+      );
+      if (measure_quality) {
+        reprojection_error.merge(quality.reprojection_error);
+      }
+      for (const Person3d& person : people) {
+        const std::size_t p = static_cast<std::size_t>(person.person_id);
+        const Person3d& truth = session().ground_truth[f][p];
+        for (std::size_t j = 0; j < person.body.size(); ++j) {
+          const Point3d& a = person.body[j];
+          const Point3d& b = truth.body[j];
+          if (a.confidence <= 0.0) continue;
+          error += std::hypot(a.x - b.x, a.y - b.y, a.z - b.z);
+          ++joints;
+        }
+      }
+    }
+  }
+  state.counters["frames"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * frame_count),
+    benchmark::Counter::kIsRate
+  );
+  if (joints > 0) state.counters["error_mm"] = 1000.0 * error / joints;
+  if (reprojection_error.count() > 0) {
+    state.counters["reprojection_px"] = reprojection_error.rms();
+  }
+}
+BENCHMARK(BM_TriangulatePeople)
+  ->ArgName("quality")
+  ->Arg(0)
+  ->Arg(1)
+  ->Unit(benchmark::kMillisecond);
+
+}
+}
@@ -2,9 +2,11 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
 
 #include <depthai/depthai.hpp>
@@ -12,6 +14,7 @@
 #include "episode/project.h"
 #include "lf/queue.h"
 #include "recording/oakd_camera.h"
+#include "src/video_writer.h"
 
 namespace {
 
@@ -37,18 +40,27 @@ std::string frame_file(std::size_t id) {
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " [PROJECT_PATH]" << std::endl;
+  std::optional<VideoCodec> codec;
+  if (argc == 3 && std::string_view{argv[1]} == "--h264") {
+    codec = VideoCodec::H264;
+  } else if (argc == 3 && std::string_view{argv[1]} == "--ffv1") {
+    codec = VideoCodec::FFV1;
+  } else if (argc != 2) {
+    std::cerr
+      << "Usage: " << argv[0] << " [--h264|--ffv1] [PROJECT_PATH]"
+      << std::endl;
     return -1;
   }
 
-  Project project = Project::open(argv[1]);
+  Project project = Project::open(argv[argc - 1]);
   std::atomic_bool run = true;
   std::size_t counter = 0;
   lf::Queue<OakDFrames> frames{FRAME_BUFFER};
 
   std::thread frame_saver{[&]() {
     const CameraDirectory& cam = project.add_camera("oakd-lite");
+    std::unique_ptr<VideoWriter> right_video;
+    std::unique_ptr<VideoWriter> left_video;
     std::string last_message;
     while (run || !frames.empty()) {
       std::optional<OakDFrames> frame = frames.pop();
@@ -57,9 +69,29 @@ int main(int argc, char* argv[]) {
       cv::Mat right = frame->right->getCvFrame();
       cv::Mat left = frame->left->getCvFrame();
 
-      std::string filename = frame_file(++counter);
-      cv::imwrite(cam.right_recording / filename, right);
-      cv::imwrite(cam.left_recording / filename, left);
+      ++counter;
+      if (codec) {
+        // One video per camera, sized by the first frames.
+        if (!right_video) {
+          const std::string filename = "video" + video_extension(*codec);
+          right_video = std::make_unique<VideoWriter>(
+            cam.right_recording / filename,
+            right.size(),
+            VideoWriterOptions{.codec = *codec}
+          );
+          left_video = std::make_unique<VideoWriter>(
+            cam.left_recording / filename,
+            left.size(),
+            VideoWriterOptions{.codec = *codec}
+          );
+        }
+        right_video->write(right);
+        left_video->write(left);
+      } else {
+        std::string filename = frame_file(counter);
+        cv::imwrite(cam.right_recording / filename, right);
+        cv::imwrite(cam.left_recording / filename, left);
+      }
 
       cv::imshow("right", right);
       cv::imshow("left", left);
@@ -74,6 +106,8 @@ int main(int argc, char* argv[]) {
       last_message = out_buffer.str();
       std::cout << last_message << std::flush;
     }
+    if (right_video) right_video->close();
+    if (left_video) left_video->close();
   }};
 
   OakDCamera cam = OakDCamera::make();
@@ -0,0 +1,361 @@
+#include "src/animation_file.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+namespace fs = std::filesystem;
+
+static_assert(
+  std::endian::native == std::endian::little,
+  "Animation files are written straight from memory as little endian."
+);
+
+// Version 1.0, whose NUL would otherwise end the literal.
+constexpr std::string_view NPY_MAGIC{"\x93NUMPY\x01\x00", 8};
+constexpr std::string_view FOOTER_MAGIC = "CARANIM1";
+
+// The whole .npy header, with room for any frame count so it can be
+// rewritten in place once the count is known.
+constexpr std::size_t HEADER_SIZE = 128;
+
+// x, y, z and confidence.
+constexpr std::size_t JOINT_VALUES = 4;
+constexpr std::size_t PERSON_VALUES = BODY_25_POINT_COUNT * JOINT_VALUES;
+constexpr std::size_t PERSON_BYTES = PERSON_VALUES * sizeof(float);
+
+constexpr float NOT_SEEN = std::numeric_limits<float>::quiet_NaN();
+
+/**
+ * Marks `count` people's joints starting at `values` as not seen.
+ */
+void clear_people(float* values, std::size_t count) {
+  for (std::size_t i = 0; i < count * PERSON_VALUES; i += JOINT_VALUES) {
+    values[i] = NOT_SEEN;
+    values[i + 1] = NOT_SEEN;
+    values[i + 2] = NOT_SEEN;
+    values[i + 3] = 0.0f;
+  }
+}
+
+std::string npy_header(std::size_t frame_count, std::size_t person_count) {
+  std::string dict =
+    "{'descr': '<f4', 'fortran_order': False, 'shape': (" +
+    std::to_string(frame_count) + ", " + std::to_string(person_count) +
+    ", " + std::to_string(BODY_25_POINT_COUNT) + ", " +
+    std::to_string(JOINT_VALUES) + "), }";
+  const std::size_t dict_size = HEADER_SIZE - NPY_MAGIC.size() - 2;
+  dict.resize(dict_size - 1, ' ');
+  dict.push_back('\n');
+
+  std::string header{NPY_MAGIC};
+  header.push_back(static_cast<char>(dict_size & 0xff));
+  header.push_back(static_cast<char>(dict_size >> 8));
+  return header + dict;
+}
+
+template <typename Range>
+void write_json_array(std::ostream& out, const Range& values) {
+  out << '[';
+  bool first = true;
+  for (const auto& value : values) {
+    if (!first) out << ", ";
+    out << value;
+    first = false;
+  }
+  out << ']';
+}
+
+std::string make_footer(
+  double fps,
+  const std::vector<int>& person_ids,
+  const std::vector<int>& frame_ids
+) {
+  std::stringstream footer;
+  footer << "{\"version\": 1, \"fps\": " << fps << ", \"joint_names\": [";
+  for (std::size_t i = 0; i < BODY_25_JOINT_NAMES.size(); ++i) {
+    footer << (i == 0 ? "\"" : ", \"") << BODY_25_JOINT_NAMES[i] << '"';
+  }
+  footer << "], \"bones\": [";
+  for (std::size_t i = 0; i < BODY_25_BONES.size(); ++i) {
+    footer
+      << (i == 0 ? "[" : ", [") << BODY_25_BONES[i].parent << ", "
+      << BODY_25_BONES[i].child << ']';
+  }
+  footer << "], \"root\": " << BODY_25_ROOT << ", \"person_ids\": ";
+  write_json_array(footer, person_ids);
+  footer << ", \"frame_ids\": ";
+  write_json_array(footer, frame_ids);
+  footer << '}';
+  return footer.str();
+}
+
+std::vector<std::size_t> parse_shape(std::string_view header) {
+  constexpr std::string_view SHAPE_KEY = "'shape': (";
+  const std::size_t start = header.find(SHAPE_KEY);
+  if (start == header.npos) return {};
+  std::vector<std::size_t> shape;
+  const char* itr = header.data() + start + SHAPE_KEY.size();
+  const char* end = header.data() + header.size();
+  while (itr < end && *itr != ')') {
+    if (*itr == ' ' || *itr == ',') {
+      ++itr;
+      continue;
+    }
+    std::size_t size = 0;
+    const auto [next, error] = std::from_chars(itr, end, size);
+    if (error != std::errc{}) return {};
+    shape.push_back(size);
+    itr = next;
+  }
+  return shape;
+}
+
+std::vector<int> parse_int_array(std::string_view json, std::string_view key) {
+  const std::string quoted_key = "\"" + std::string{key} + "\": [";
+  const std::size_t start = json.find(quoted_key);
+  if (start == json.npos) {
+    throw std::runtime_error("Animation footer has no " + std::string{key});
+  }
+  std::vector<int> values;
+  const char* itr = json.data() + start + quoted_key.size();
+  const char* end = json.data() + json.size();
+  while (itr < end && *itr != ']') {
+    if (*itr == ' ' || *itr == ',') {
+      ++itr;
+      continue;
+    }
+    int value = 0;
+    const auto [next, error] = std::from_chars(itr, end, value);
+    if (error != std::errc{}) {
+      throw std::runtime_error("Malformed " + std::string{key});
+    }
+    values.push_back(value);
+    itr = next;
+  }
+  return values;
+}
+
+}
+
+AnimationWriter::AnimationWriter(
+  const fs::path& path,
+  AnimationWriterOptions options
+):
+  _path{path},
+  _options{options},
+  _out{
+    path,
+    std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc
+  },
+  _capacity{std::max<std::size_t>(_options.reserved_people, 1)},
+  _frame(_capacity * PERSON_VALUES)
+{
+  if (!_out) throw std::runtime_error("Failed to open " + _path.string());
+  _write_header();
+}
+
+AnimationWriter::~AnimationWriter() {
+  try {
+    close();
+  } catch (...) {
+    // Nowhere to report it, close() should have been called.
+  }
+}
+
+void AnimationWriter::write(int frame_id, const std::vector<Person3d>& people) {
+  if (!_out.is_open()) {
+    throw std::runtime_error("Animation " + _path.string() + " is closed.");
+  }
+
+  clear_people(_frame.data(), _capacity);
+  for (const Person3d& person : people) {
+    auto [itr, inserted] =
+      _person_indices.try_emplace(person.person_id, _person_ids.size());
+    if (inserted) {
+      if (_person_ids.size() == _capacity) _grow(_capacity * 2);
+      _person_ids.push_back(person.person_id);
+    }
+    float* values = _frame.data() + (itr->second * PERSON_VALUES);
+    for (const Point3d& point : person.body) {
+      if (
+        point.point_id < 0 ||
+        static_cast<std::size_t>(point.point_id) >= BODY_25_POINT_COUNT
+      ) {
+        continue;
+      }
+      float* joint = values + (point.point_id * JOINT_VALUES);
+      joint[0] = static_cast<float>(point.x);
+      joint[1] = static_cast<float>(point.y);
+      joint[2] = static_cast<float>(point.z);
+      joint[3] = static_cast<float>(point.confidence);
+    }
+  }
+
+  _out.write(
+    reinterpret_cast<const char*>(_frame.data()),
+    static_cast<std::streamsize>(_frame.size() * sizeof(float))
+  );
+  if (!_out) throw std::runtime_error("Failed to write " + _path.string());
+  _frame_ids.push_back(frame_id);
+}
+
+void AnimationWriter::close() {
+  if (!_out.is_open()) return;
+
+  // Frames were written with room for every possible person. Those that never
+  // showed up are squeezed out, each frame moving towards the front.
+  const std::size_t person_count = _person_ids.size();
+  const std::size_t written_bytes = _capacity * PERSON_BYTES;
+  const std::size_t frame_bytes = person_count * PERSON_BYTES;
+  if (frame_bytes < written_bytes) {
+    std::vector<char> buffer(frame_bytes);
+    for (std::size_t f = 1; f < _frame_ids.size(); ++f) {
+      _out.seekg(static_cast<std::streamoff>(HEADER_SIZE + f * written_bytes));
+      _out.read(buffer.data(), static_cast<std::streamsize>(frame_bytes));
+      _out.seekp(static_cast<std::streamoff>(HEADER_SIZE + f * frame_bytes));
+      _out.write(buffer.data(), static_cast<std::streamsize>(frame_bytes));
+    }
+  }
+
+  const std::string footer =
+    make_footer(_options.fps, _person_ids, _frame_ids);
+  const std::uint64_t footer_size = footer.size();
+  const std::size_t data_end = HEADER_SIZE + _frame_ids.size() * frame_bytes;
+  _out.seekp(static_cast<std::streamoff>(data_end));
+  _out << footer << FOOTER_MAGIC;
+  _out.write(reinterpret_cast<const char*>(&footer_size), sizeof(footer_size));
+  _write_header();
+  _out.close();
+  if (_out.fail()) {
+    throw std::runtime_error("Failed to write " + _path.string());
+  }
+
+  fs::resize_file(
+    _path,
+    data_end + footer.size() + FOOTER_MAGIC.size() + sizeof(footer_size)
+  );
+}
+
+void AnimationWriter::_write_header() {
+  const std::streampos position = _out.tellp();
+  _out.seekp(0);
+  _out << npy_header(_frame_ids.size(), _person_ids.size());
+  if (position > 0) _out.seekp(position);
+}
+
+void AnimationWriter::_grow(std::size_t capacity) {
+  const std::size_t written_bytes = _capacity * PERSON_BYTES;
+  const std::size_t frame_bytes = capacity * PERSON_BYTES;
+  const std::size_t kept_values = _capacity * PERSON_VALUES;
+  const std::size_t added = capacity - _capacity;
+
+  // Frames move towards the back, so the last one goes first to keep every
+  // frame from being overwritten before it has moved. The new room in each
+  // is filled with people not seen.
+  std::vector<float> buffer(capacity * PERSON_VALUES);
+  clear_people(buffer.data() + kept_values, added);
+  char* bytes = reinterpret_cast<char*>(buffer.data());
+  for (std::size_t f = _frame_ids.size(); f-- > 0;) {
+    _out.seekg(static_cast<std::streamoff>(HEADER_SIZE + f * written_bytes));
+    _out.read(bytes, static_cast<std::streamsize>(written_bytes));
+    _out.seekp(static_cast<std::streamoff>(HEADER_SIZE + f * frame_bytes));
+    _out.write(bytes, static_cast<std::streamsize>(frame_bytes));
+  }
+  _out.seekp(
+    static_cast<std::streamoff>(HEADER_SIZE + _frame_ids.size() * frame_bytes)
+  );
+  if (!_out) throw std::runtime_error("Failed to write " + _path.string());
+
+  // The frame being written keeps the people already placed in it.
+  _frame.resize(capacity * PERSON_VALUES);
+  clear_people(_frame.data() + kept_values, added);
+  _capacity = capacity;
+}
+
+Animation read_animation(const fs::path& path) {
+  std::ifstream in{path, std::ios::binary};
+  if (!in) throw std::runtime_error("Failed to open " + path.string());
+  const std::string contents{
+    std::istreambuf_iterator<char>{in},
+    std::istreambuf_iterator<char>{}
+  };
+  const std::string_view file = contents;
+  const auto malformed = [&path]() {
+    return std::runtime_error(path.string() + " is not an animation file.");
+  };
+
+  constexpr std::size_t TRAILER_SIZE =
+    FOOTER_MAGIC.size() + sizeof(std::uint64_t);
+  if (
+    file.size() < HEADER_SIZE + TRAILER_SIZE ||
+    !file.starts_with(NPY_MAGIC) ||
+    file.substr(file.size() - TRAILER_SIZE, FOOTER_MAGIC.size()) !=
+      FOOTER_MAGIC
+  ) {
+    throw malformed();
+  }
+  std::uint64_t footer_size = 0;
+  std::memcpy(
+    &footer_size,
+    file.data() + file.size() - sizeof(footer_size),
+    sizeof(footer_size)
+  );
+  if (footer_size > file.size() - HEADER_SIZE - TRAILER_SIZE) {
+    throw malformed();
+  }
+  const std::string_view footer =
+    file.substr(file.size() - TRAILER_SIZE - footer_size, footer_size);
+
+  const std::vector<std::size_t> shape =
+    parse_shape(file.substr(0, HEADER_SIZE));
+  if (shape.size() != 4 || shape[3] != JOINT_VALUES) throw malformed();
+  Animation animation{
+    .frame_ids = parse_int_array(footer, "frame_ids"),
+    .person_ids = parse_int_array(footer, "person_ids"),
+    .joint_count = shape[2]
+  };
+  const std::size_t joint_count = shape[0] * shape[1] * shape[2];
+  if (
+    animation.frame_ids.size() != shape[0] ||
+    animation.person_ids.size() != shape[1] ||
+    HEADER_SIZE + joint_count * JOINT_VALUES * sizeof(float) >
+      file.size() - TRAILER_SIZE - footer_size
+  ) {
+    throw malformed();
+  }
+
+  animation.joints.reserve(joint_count);
+  const char* data = file.data() + HEADER_SIZE;
+  for (std::size_t i = 0; i < joint_count; ++i) {
+    std::array<float, JOINT_VALUES> values;
+    std::memcpy(values.data(), data, sizeof(values));
+    data += sizeof(values);
+    animation.joints.push_back(Point3d{
+      .point_id = static_cast<int>(i % animation.joint_count),
+      .x = values[0],
+      .y = values[1],
+      .z = values[2],
+      .confidence = values[3]
+    });
+  }
+  return animation;
+}
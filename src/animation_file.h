@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "src/files.h"
+#include "src/tracking.h"
+
+struct AnimationWriterOptions {
+  // People each frame has room for at first, so frames can be written as
+  // they come. The room doubles whenever someone new would not fit, at the
+  // cost of spreading out the frames already written. Room nobody used is
+  // squeezed out on close.
+  std::size_t reserved_people = 16;
+
+  // Frame rate of the recording, for the importer's timeline.
+  double fps = RECORDING_FPS;
+};
+
+/**
+ * A whole session's body joints in one file, written a frame at a time.
+ *
+ * The file is a NumPy `.npy` array of float32 shaped (frames, people, joints,
+ * 4), each joint being x, y, z and confidence in world space, so `np.load`
+ * reads the whole clip at once. People missing from a frame are NaN with zero
+ * confidence. Past the array is a JSON footer with the joint names, bones and
+ * which person ID and frame ID each index belongs to, followed by 16 bytes:
+ * the magic "CARANIM1" and the footer's length as a little endian uint64.
+ */
+class AnimationWriter {
+public:
+  explicit AnimationWriter(
+    const std::filesystem::path& path,
+    AnimationWriterOptions options = {}
+  );
+  ~AnimationWriter();
+  AnimationWriter(const AnimationWriter&) = delete;
+  AnimationWriter(AnimationWriter&&) = delete;
+  AnimationWriter& operator=(const AnimationWriter&) = delete;
+  AnimationWriter& operator=(AnimationWriter&&) = delete;
+
+  /**
+   * Appends a frame.
+   */
+  void write(int frame_id, const std::vector<Person3d>& people);
+
+  /**
+   * Writes the footer and fills in the frame count. Called by the destructor
+   * if not before, though errors are only reported from here.
+   */
+  void close();
+
+  std::size_t frame_count() const { return _frame_ids.size(); }
+
+private:
+  void _write_header();
+
+  /**
+   * Makes room for `capacity` people in every frame, including those already
+   * written.
+   */
+  void _grow(std::size_t capacity);
+
+  std::filesystem::path _path;
+  AnimationWriterOptions _options;
+  std::fstream _out;
+
+  // Index in the file of each person ID seen so far.
+  std::map<int, std::size_t> _person_indices;
+  std::vector<int> _person_ids;
+  std::vector<int> _frame_ids;
+
+  // People each frame in the file currently has room for.
+  std::size_t _capacity;
+
+  // One frame's values, reused for every frame.
+  std::vector<float> _frame;
+};
+
+struct Animation {
+  std::vector<int> frame_ids;
+  std::vector<int> person_ids;
+  std::size_t joint_count = 0;
+
+  // Indexed as `((frame * person_ids.size()) + person) * joint_count + joint`.
+  std::vector<Point3d> joints;
+
+  const Point3d& joint(
+    std::size_t frame,
+    std::size_t person,
+    std::size_t joint
+  ) const {
+    return joints[
+      (((frame * person_ids.size()) + person) * joint_count) + joint
+    ];
+  }
+};
+
+/**
+ * Reads a file written by `AnimationWriter`.
+ */
+Animation read_animation(const std::filesystem::path& path);
@@ -0,0 +1,136 @@
+#include "src/animation_file.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/animation_file";
+
+/**
+ * A path in an empty directory for a single test.
+ */
+path make_path(const std::string& name) {
+  const path directory = TEST_DIR / name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory / "animation.npy";
+}
+
+Person3d make_person(int person_id, double offset) {
+  Person3d person{.person_id = person_id};
+  for (int i = 0; i < static_cast<int>(BODY_25_POINT_COUNT); ++i) {
+    person.body.push_back(Point3d{
+      .point_id = i,
+      .x = offset + i,
+      .y = offset - i,
+      .z = offset * i,
+      .confidence = 0.5
+    });
+  }
+  return person;
+}
+
+TEST(AnimationFile, RoundTrip) {
+  const path file = make_path("round_trip");
+  {
+    AnimationWriter writer{file};
+    writer.write(4, {make_person(7, 1.0), make_person(3, 2.0)});
+    writer.write(5, {make_person(3, 3.0), make_person(7, 4.0)});
+    EXPECT_EQ(writer.frame_count(), 2);
+  }
+
+  const Animation animation = read_animation(file);
+  EXPECT_EQ(animation.frame_ids, (std::vector<int>{4, 5}));
+  EXPECT_EQ(animation.person_ids, (std::vector<int>{7, 3}));
+  ASSERT_EQ(animation.joint_count, BODY_25_POINT_COUNT);
+  ASSERT_EQ(animation.joints.size(), 2 * 2 * BODY_25_POINT_COUNT);
+
+  const Point3d& joint = animation.joint(1, 0, 10);
+  EXPECT_EQ(joint.point_id, 10);
+  EXPECT_DOUBLE_EQ(joint.x, 14.0);
+  EXPECT_DOUBLE_EQ(joint.y, -6.0);
+  EXPECT_DOUBLE_EQ(joint.z, 40.0);
+  EXPECT_DOUBLE_EQ(joint.confidence, 0.5);
+  EXPECT_DOUBLE_EQ(animation.joint(0, 1, 2).x, 4.0);
+}
+
+TEST(AnimationFile, MissingPeopleAreNan) {
+  const path file = make_path("missing_people");
+  {
+    AnimationWriter writer{file};
+    writer.write(0, {make_person(1, 1.0)});
+    writer.write(1, {make_person(2, 1.0)});
+    writer.close();
+  }
+
+  const Animation animation = read_animation(file);
+  ASSERT_EQ(animation.person_ids, (std::vector<int>{1, 2}));
+  EXPECT_TRUE(std::isnan(animation.joint(0, 1, 0).x));
+  EXPECT_EQ(animation.joint(0, 1, 0).confidence, 0.0);
+  EXPECT_TRUE(std::isnan(animation.joint(1, 0, 0).z));
+  EXPECT_DOUBLE_EQ(animation.joint(1, 1, 0).x, 1.0);
+}
+
+TEST(AnimationFile, IsANumpyArray) {
+  const path file = make_path("numpy");
+  {
+    AnimationWriter writer{file, {.reserved_people = 4}};
+    writer.write(0, {make_person(1, 1.0)});
+  }
+
+  std::ifstream in{file, std::ios::binary};
+  std::string header(128, '\0');
+  in.read(header.data(), header.size());
+  EXPECT_EQ(header.substr(0, 8), std::string("\x93NUMPY\x01\x00", 8));
+  EXPECT_NE(header.find("'shape': (1, 1, 25, 4)"), std::string::npos);
+  EXPECT_EQ(header.back(), '\n');
+}
+
+TEST(AnimationFile, MakesRoomForMorePeople) {
+  const path file = make_path("more_people");
+  {
+    AnimationWriter writer{file};
+    writer.write(0, {make_person(100, 0.0)});
+    for (int frame = 1; frame < 40; ++frame) {
+      writer.write(frame, {make_person(frame, frame), make_person(100, 0.0)});
+    }
+  }
+
+  const Animation animation = read_animation(file);
+  ASSERT_EQ(animation.frame_ids.size(), 40);
+  ASSERT_EQ(animation.person_ids.size(), 40);
+  EXPECT_EQ(animation.person_ids[0], 100);
+  for (std::size_t frame = 0; frame < 40; ++frame) {
+    EXPECT_DOUBLE_EQ(animation.joint(frame, 0, 3).x, 3.0);
+    for (std::size_t person = 1; person < 40; ++person) {
+      const Point3d& joint = animation.joint(frame, person, 3);
+      EXPECT_EQ(animation.person_ids[person], static_cast<int>(person));
+      if (person == frame) {
+        EXPECT_DOUBLE_EQ(joint.x, frame + 3.0);
+        EXPECT_DOUBLE_EQ(joint.confidence, 0.5);
+      } else {
+        EXPECT_TRUE(std::isnan(joint.x)) << frame << ", " << person;
+        EXPECT_EQ(joint.confidence, 0.0);
+      }
+    }
+  }
+}
+
+TEST(AnimationFile, RejectsOtherFiles) {
+  const path file = make_path("other_file");
+  std::ofstream{file} << "not an animation";
+  EXPECT_THROW(read_animation(file), std::runtime_error);
+}
+
+}
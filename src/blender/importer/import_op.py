@@ -2,11 +2,50 @@
 From a blank scene, imports all data recorded as well as camera positions.
 """
 import bpy
-import yaml
+import io
+import json
+import numpy
+import struct
 
-from os import listdir, path
+from os import path
 from . property_group import CookingImporterSettings
 
+FOOTER_MAGIC = b"CARANIM1"
+TRAILER_SIZE = len(FOOTER_MAGIC) + 8
+
+
+def load_animation(file_path):
+  """
+  Reads an animation written by the projector in one go. Returns the joints as
+  an array shaped (frames, people, joints, 4) and the footer describing them.
+  """
+  with open(file_path, "rb") as stream:
+    data = stream.read()
+
+  if data[-TRAILER_SIZE:-8] != FOOTER_MAGIC:
+    raise ValueError(file_path + " is not an animation file.")
+  (footer_size,) = struct.unpack("<Q", data[-8:])
+  footer = json.loads(data[-TRAILER_SIZE - footer_size:-TRAILER_SIZE])
+  joints = numpy.load(io.BytesIO(data))
+  return joints, footer
+
+
+def keyframe_locations(obj, frames, locations):
+  """
+  Keys `obj` at each of `frames` with the matching row of `locations`, setting
+  every key of a curve at once rather than one insert at a time.
+  """
+  obj.animation_data_create()
+  obj.animation_data.action = bpy.data.actions.new(obj.name + "_action")
+  for axis in range(3):
+    fcurve = obj.animation_data.action.fcurves.new("location", index=axis)
+    fcurve.keyframe_points.add(len(frames))
+    keys = numpy.empty((len(frames), 2), dtype=numpy.float32)
+    keys[:, 0] = frames
+    keys[:, 1] = locations[:, axis]
+    fcurve.keyframe_points.foreach_set("co", keys.ravel())
+    fcurve.update()
+
 
 class CookingImportOperator(bpy.types.Operator):
   bl_idname = "cooking_ar.import_recording"
@@ -14,17 +53,30 @@ class CookingImportOperator(bpy.types.Operator):
   bl_description = "Import all extracted animation data and camera positions."
 
   def execute(self, context):
-    anim_dir = path.join(context.scene.cooking_ar.recording_path, "animation")
-
-    frame_files = [f for f in listdir(anim_dir) if f.endswith(".yml")]
-
-    test_frame = frame_files[0]
-    with open(path.join(anim_dir, test_frame), "r") as stream:
-      frame = yaml.safe_load(stream)
-      for person in frame.people:
-        person_name = "cooking_ar_person_" + person.person_id
-        for point in person.body:
-          point_name =  person_name + "_point_" + point.point_id
-          bpy.data.objects.new(point_name, None)
+    anim_file = path.join(
+      context.scene.cooking_ar.recording_path, "animation", "animation.npy"
+    )
+    joints, footer = load_animation(anim_file)
+
+    frame_ids = numpy.asarray(footer["frame_ids"], dtype=numpy.float32)
+    context.scene.render.fps = round(footer["fps"])
+    if len(frame_ids):
+      context.scene.frame_start = int(frame_ids.min())
+      context.scene.frame_end = int(frame_ids.max())
+
+    for person, person_id in enumerate(footer["person_ids"]):
+      person_name = "cooking_ar_person_" + str(person_id)
+      root = bpy.data.objects.new(person_name, None)
+      context.collection.objects.link(root)
+      for joint, joint_name in enumerate(footer["joint_names"]):
+        point = bpy.data.objects.new(person_name + "_" + joint_name, None)
+        point.parent = root
+        context.collection.objects.link(point)
+
+        # Frames the person was not seen in are left for Blender to fill.
+        trajectory = joints[:, person, joint, :]
+        seen = trajectory[:, 3] > 0
+        if seen.any():
+          keyframe_locations(point, frame_ids[seen], trajectory[seen, :3])
 
     return {"FINISHED"}
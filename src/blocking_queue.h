@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+/**
+ * Bounded first in, first out queue whose ends sleep until the other end
+ * makes progress: pushing waits for room and popping waits for a value.
+ *
+ * Closing wakes everyone waiting. Pushes are refused from then on, while pops
+ * keep draining whatever was queued before.
+ */
+template <typename T>
+class BlockingQueue {
+public:
+  explicit BlockingQueue(std::size_t max_size): _max_size{max_size} {}
+
+  BlockingQueue(const BlockingQueue&) = delete;
+  BlockingQueue(BlockingQueue&&) = delete;
+  BlockingQueue& operator=(const BlockingQueue&) = delete;
+  BlockingQueue& operator=(BlockingQueue&&) = delete;
+
+  /**
+   * Waits for room and queues `value`. Returns false without queueing it if
+   * the queue is closed.
+   */
+  bool push(T value) {
+    std::unique_lock<std::mutex> lock{_mutex};
+    _not_full.wait(lock, [&]() {
+      return _closed || _values.size() < _max_size;
+    });
+    if (_closed) return false;
+    _values.push_back(std::move(value));
+    lock.unlock();
+    _not_empty.notify_one();
+    return true;
+  }
+
+  /**
+   * Queues `value` only if there is room and the queue is open.
+   */
+  bool try_push(T value) {
+    std::unique_lock<std::mutex> lock{_mutex};
+    if (_closed || _values.size() >= _max_size) return false;
+    _values.push_back(std::move(value));
+    lock.unlock();
+    _not_empty.notify_one();
+    return true;
+  }
+
+  /**
+   * Waits for the next value. Returns nothing once the queue is closed and
+   * drained.
+   */
+  std::optional<T> pop() {
+    std::unique_lock<std::mutex> lock{_mutex};
+    _not_empty.wait(lock, [&]() { return _closed || !_values.empty(); });
+    if (_values.empty()) return std::nullopt;
+    T value = std::move(_values.front());
+    _values.pop_front();
+    lock.unlock();
+    _not_full.notify_one();
+    return value;
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _closed = true;
+    }
+    _not_empty.notify_all();
+    _not_full.notify_all();
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _values.size();
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+  std::size_t max_size() const { return _max_size; }
+
+private:
+  const std::size_t _max_size;
+  mutable std::mutex _mutex;
+  std::condition_variable _not_empty;
+  std::condition_variable _not_full;
+  std::deque<T> _values;
+  bool _closed = false;
+};
@@ -0,0 +1,81 @@
+#include "src/blocking_queue.h"
+
+#include <chrono>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+TEST(BlockingQueue, PopsInOrder) {
+  BlockingQueue<int> queue{3};
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_TRUE(queue.push(2));
+  EXPECT_EQ(queue.size(), 2);
+  EXPECT_EQ(queue.pop(), 1);
+  EXPECT_EQ(queue.pop(), 2);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(BlockingQueue, TryPushRefusesWhenFull) {
+  BlockingQueue<int> queue{1};
+  EXPECT_TRUE(queue.try_push(1));
+  EXPECT_FALSE(queue.try_push(2));
+  EXPECT_EQ(queue.pop(), 1);
+  EXPECT_TRUE(queue.try_push(3));
+}
+
+TEST(BlockingQueue, PushWaitsForRoom) {
+  BlockingQueue<int> queue{1};
+  queue.push(1);
+  std::thread consumer{[&]() {
+    std::this_thread::sleep_for(10ms);
+    queue.pop();
+  }};
+  EXPECT_TRUE(queue.push(2));
+  consumer.join();
+  EXPECT_EQ(queue.pop(), 2);
+}
+
+TEST(BlockingQueue, PopWaitsForValue) {
+  BlockingQueue<int> queue{1};
+  std::thread producer{[&]() {
+    std::this_thread::sleep_for(10ms);
+    queue.push(7);
+  }};
+  EXPECT_EQ(queue.pop(), 7);
+  producer.join();
+}
+
+TEST(BlockingQueue, CloseDrainsThenWakesWaiters) {
+  BlockingQueue<int> queue{2};
+  queue.push(1);
+  queue.close();
+  EXPECT_FALSE(queue.push(2));
+  EXPECT_FALSE(queue.try_push(2));
+  EXPECT_EQ(queue.pop(), 1);
+  EXPECT_EQ(queue.pop(), std::nullopt);
+}
+
+TEST(BlockingQueue, CloseWakesBlockedPushAndPop) {
+  BlockingQueue<int> full{1};
+  full.push(1);
+  BlockingQueue<int> empty{1};
+  std::optional<bool> pushed;
+  std::optional<int> popped = 0;
+  std::vector<std::thread> threads;
+  threads.emplace_back([&]() { pushed = full.push(2); });
+  threads.emplace_back([&]() { popped = empty.pop(); });
+  std::this_thread::sleep_for(10ms);
+  full.close();
+  empty.close();
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(pushed, false);
+  EXPECT_EQ(popped, std::nullopt);
+}
+
+}
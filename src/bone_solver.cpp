@@ -0,0 +1,144 @@
+#include "src/bone_solver.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+// Keeps fully confident joints from becoming completely immovable.
+constexpr double CONFIDENCE_FLOOR = 0.05;
+
+double distance(const Point3d& a, const Point3d& b) {
+  return std::sqrt(
+    ((a.x - b.x) * (a.x - b.x)) +
+    ((a.y - b.y) * (a.y - b.y)) +
+    ((a.z - b.z) * (a.z - b.z))
+  );
+}
+
+}
+
+void BoneLengthSolver::solve(std::vector<Person3d>& people) {
+  for (auto& [person_id, state] : _people) ++state.missed_frames;
+
+  for (Person3d& person : people) {
+    PersonState& state = _people[person.person_id];
+    state.missed_frames = 0;
+    _sample(person, state);
+    _project(person, state);
+  }
+
+  std::erase_if(_people, [&](const auto& entry) {
+    return entry.second.missed_frames > _options.max_missed_frames;
+  });
+}
+
+double BoneLengthSolver::bone_length(
+  int person_id,
+  std::size_t bone_idx
+) const {
+  auto itr = _people.find(person_id);
+  if (itr == _people.end()) return 0.0;
+  return itr->second.lengths.at(bone_idx);
+}
+
+void BoneLengthSolver::_sample(const Person3d& person, PersonState& state) {
+  for (std::size_t b = 0; b < BODY_25_BONES.size(); ++b) {
+    const Bone& bone = BODY_25_BONES[b];
+    std::vector<double>& samples = state.samples[b];
+    if (samples.size() >= _options.max_samples) continue;
+    const auto last =
+      static_cast<std::size_t>(std::max(bone.parent, bone.child));
+    if (last >= person.body.size()) continue;
+
+    const Point3d& parent = person.body[bone.parent];
+    const Point3d& child = person.body[bone.child];
+    if (
+      parent.confidence < _options.min_confidence ||
+      child.confidence < _options.min_confidence
+    ) {
+      continue;
+    }
+
+    samples.push_back(distance(parent, child));
+    if (samples.size() < _options.min_samples) continue;
+
+    auto middle = samples.begin() + (samples.size() / 2);
+    std::nth_element(samples.begin(), middle, samples.end());
+    state.lengths[b] = *middle;
+  }
+}
+
+void BoneLengthSolver::_project(Person3d& person, PersonState& state) {
+  const std::size_t count = std::min(person.body.size(), BODY_25_POINT_COUNT);
+  std::array<Position, BODY_25_POINT_COUNT> positions;
+  std::array<double, BODY_25_POINT_COUNT> inverse_mass{};
+  std::array<bool, BODY_25_POINT_COUNT> known{};
+
+  // Every observed joint starts where it was seen, however unsure, and its
+  // confidence decides how far it moves. Only joints with no observation at
+  // all start from where the previous frame's solution left them.
+  for (std::size_t i = 0; i < count; ++i) {
+    const Point3d& point = person.body[i];
+    const bool observed = point.confidence > 0.0;
+    if (observed || !state.has_previous[i]) {
+      positions[i] = {point.x, point.y, point.z};
+    } else {
+      positions[i] = state.previous[i];
+    }
+    known[i] = point.confidence > 0.0 || state.has_previous[i];
+    inverse_mass[i] =
+      1.0 / (CONFIDENCE_FLOOR + std::clamp(point.confidence, 0.0, 1.0));
+  }
+
+  for (std::size_t iter = 0; iter < _options.max_iterations; ++iter) {
+    double max_error = 0.0;
+    for (std::size_t b = 0; b < BODY_25_BONES.size(); ++b) {
+      const double length = state.lengths[b];
+      const Bone& bone = BODY_25_BONES[b];
+      const auto last =
+        static_cast<std::size_t>(std::max(bone.parent, bone.child));
+      if (length <= 0.0 || last >= count) continue;
+      if (!known[bone.parent] || !known[bone.child]) continue;
+
+      Position& parent = positions[bone.parent];
+      Position& child = positions[bone.child];
+      const double dx = child[0] - parent[0];
+      const double dy = child[1] - parent[1];
+      const double dz = child[2] - parent[2];
+      const double dist = std::sqrt((dx * dx) + (dy * dy) + (dz * dz));
+      if (dist <= 0.0) continue;
+
+      max_error = std::max(max_error, std::abs(dist - length) / length);
+
+      // Split the correction between the joints by their inverse masses so
+      // the less confident joint does most of the moving.
+      const double w_parent = inverse_mass[bone.parent];
+      const double w_child = inverse_mass[bone.child];
+      const double scale = ((dist - length) / dist) / (w_parent + w_child);
+      parent[0] += w_parent * scale * dx;
+      parent[1] += w_parent * scale * dy;
+      parent[2] += w_parent * scale * dz;
+      child[0] -= w_child * scale * dx;
+      child[1] -= w_child * scale * dy;
+      child[2] -= w_child * scale * dz;
+    }
+    if (max_error < _options.tolerance) break;
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    if (!known[i]) continue;
+    Point3d& point = person.body[i];
+    point.x = positions[i][0];
+    point.y = positions[i][1];
+    point.z = positions[i][2];
+    state.previous[i] = positions[i];
+    state.has_previous[i] = true;
+  }
+}
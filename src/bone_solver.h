@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+struct BoneSolverOptions {
+  // Both ends of a bone must be at least this confident for its length to be
+  // sampled.
+  double min_confidence = 0.5;
+
+  // A bone is only constrained once this many samples of it have been seen.
+  std::size_t min_samples = 10;
+
+  // Bone lengths are the median of at most this many samples, after which the
+  // estimate is frozen.
+  std::size_t max_samples = 240;
+
+  // Upper bound on constraint projection sweeps per frame. Solving stops
+  // early once every bone is within `tolerance` of its length.
+  std::size_t max_iterations = 16;
+  double tolerance = 1e-3;
+
+  // People unseen for this many frames have their estimates discarded.
+  std::size_t max_missed_frames = 120;
+};
+
+/**
+ * Holds each tracked person's BODY_25 bones at consistent lengths.
+ *
+ * Bone lengths are estimated per `person_id` from frames where both joints
+ * are confident. Each frame's joints are then projected onto those lengths
+ * with confidence-weighted Gauss-Seidel sweeps, starting from the previous
+ * frame's solution for any joint that was not observed at all.
+ */
+class BoneLengthSolver {
+public:
+  BoneLengthSolver() = default;
+  explicit BoneLengthSolver(BoneSolverOptions options): _options{options} {}
+
+  /**
+   * Adjusts the body joints of everyone in the frame in place.
+   */
+  void solve(std::vector<Person3d>& people);
+
+  /**
+   * Current length estimate for the given person's bone, or 0 if the bone is
+   * not yet constrained.
+   */
+  double bone_length(int person_id, std::size_t bone_idx) const;
+
+private:
+  using Position = std::array<double, 3>;
+
+  struct PersonState {
+    std::array<std::vector<double>, BODY_25_BONES.size()> samples;
+    std::array<double, BODY_25_BONES.size()> lengths{};
+    std::array<Position, BODY_25_POINT_COUNT> previous{};
+    std::array<bool, BODY_25_POINT_COUNT> has_previous{};
+    std::size_t missed_frames = 0;
+  };
+
+  void _sample(const Person3d& person, PersonState& state);
+  void _project(Person3d& person, PersonState& state);
+
+  BoneSolverOptions _options;
+  std::unordered_map<int, PersonState> _people;
+};
@@ -0,0 +1,76 @@
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/bone_solver.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+constexpr std::size_t FRAME_COUNT = 3'600; // One minute at 60 fps.
+
+/**
+ * Generates a clip of people whose joints jitter by a few centimeters, so
+ * every frame needs several sweeps to bring the bones back into line.
+ */
+std::vector<std::vector<Person3d>> make_clip(std::size_t people_count) {
+  std::mt19937 rng{42};
+  std::normal_distribution<double> noise{0.0, 0.02};
+  std::uniform_real_distribution<double> confidence{0.0, 1.0};
+
+  std::vector<std::vector<Person3d>> clip(FRAME_COUNT);
+  for (std::vector<Person3d>& frame : clip) {
+    for (std::size_t p = 0; p < people_count; ++p) {
+      Person3d& person = frame.emplace_back(
+        Person3d{.person_id = static_cast<int>(p)}
+      );
+      person.body.resize(BODY_25_POINT_COUNT);
+      person.body[BODY_25_ROOT] = Point3d{
+        .point_id = BODY_25_ROOT,
+        .x = static_cast<double>(p),
+        .z = 2.0,
+        .confidence = 1.0
+      };
+      for (const Bone& bone : BODY_25_BONES) {
+        const Point3d& parent = person.body[bone.parent];
+        person.body[bone.child] = Point3d{
+          .point_id = bone.child,
+          .x = parent.x + noise(rng),
+          .y = parent.y + 0.2 + noise(rng),
+          .z = parent.z + noise(rng),
+          .confidence = confidence(rng)
+        };
+      }
+    }
+  }
+  return clip;
+}
+
+void BM_BoneLengthSolver(benchmark::State& state) {
+  const std::vector<std::vector<Person3d>> clip = make_clip(state.range(0));
+
+  std::vector<Person3d> frame;
+  for (auto _ : state) {
+    BoneLengthSolver solver;
+    for (const std::vector<Person3d>& source : clip) {
+      frame = source;
+      solver.solve(frame);
+      benchmark::DoNotOptimize(frame.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * clip.size());
+  state.counters["realtime_factor"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * clip.size()) / 60.0,
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_BoneLengthSolver)
+  ->Arg(1)
+  ->Arg(2)
+  ->Arg(4)
+  ->Arg(8)
+  ->Unit(benchmark::kMillisecond);
+
+}
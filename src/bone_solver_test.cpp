@@ -0,0 +1,180 @@
+#include "src/bone_solver.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+constexpr double BONE_LENGTH = 0.2;
+
+/**
+ * Builds a person whose bones all point along +y from their parents.
+ */
+Person3d make_person(int person_id, double bone_length = BONE_LENGTH) {
+  Person3d person{.person_id = person_id};
+  person.body.resize(BODY_25_POINT_COUNT);
+  for (std::size_t i = 0; i < BODY_25_POINT_COUNT; ++i) {
+    person.body[i] = Point3d{.point_id = static_cast<int>(i), .z = 2.0};
+  }
+  person.body[BODY_25_ROOT].confidence = 0.9;
+  for (std::size_t b = 0; b < BODY_25_BONES.size(); ++b) {
+    const Bone& bone = BODY_25_BONES[b];
+    Point3d& child = person.body[bone.child];
+    child = person.body[bone.parent];
+    child.point_id = bone.child;
+    const double offset = (b % 5) * 0.01;
+    child.x += offset;
+    child.y += std::sqrt((bone_length * bone_length) - (offset * offset));
+  }
+  return person;
+}
+
+double bone_length(const Person3d& person, const Bone& bone) {
+  const Point3d& a = person.body[bone.parent];
+  const Point3d& b = person.body[bone.child];
+  return std::sqrt(
+    ((a.x - b.x) * (a.x - b.x)) +
+    ((a.y - b.y) * (a.y - b.y)) +
+    ((a.z - b.z) * (a.z - b.z))
+  );
+}
+
+void warm_up(BoneLengthSolver& solver, int person_id, std::size_t frames) {
+  std::mt19937 rng{3};
+  std::normal_distribution<double> noise{0.0, 0.002};
+  for (std::size_t i = 0; i < frames; ++i) {
+    Person3d person = make_person(person_id);
+    for (Point3d& point : person.body) point.x += noise(rng);
+    std::vector<Person3d> frame = {person};
+    solver.solve(frame);
+  }
+}
+
+TEST(BoneLengthSolver, UnconstrainedUntilEnoughSamples) {
+  BoneLengthSolver solver{BoneSolverOptions{.min_samples = 5}};
+  warm_up(solver, 0, 4);
+  EXPECT_EQ(solver.bone_length(0, 0), 0.0);
+
+  warm_up(solver, 0, 1);
+  EXPECT_NEAR(solver.bone_length(0, 0), BONE_LENGTH, 0.01);
+}
+
+TEST(BoneLengthSolver, EstimateIgnoresOutliers) {
+  BoneLengthSolver solver;
+  warm_up(solver, 0, 30);
+
+  // A few wildly stretched frames should not drag the median.
+  for (int i = 0; i < 5; ++i) {
+    std::vector<Person3d> frame = {make_person(0, 1.0)};
+    solver.solve(frame);
+  }
+  for (std::size_t b = 0; b < BODY_25_BONES.size(); ++b) {
+    EXPECT_NEAR(solver.bone_length(0, b), BONE_LENGTH, 0.01) << "Bone " << b;
+  }
+}
+
+TEST(BoneLengthSolver, RestoresStretchedBones) {
+  BoneLengthSolver solver;
+  warm_up(solver, 0, 30);
+
+  Person3d stretched = make_person(0);
+  stretched.body[4].y += 0.1; // RWrist pulled away from RElbow.
+  stretched.body[4].confidence = 0.2;
+  std::vector<Person3d> frame = {stretched};
+  solver.solve(frame);
+
+  for (const Bone& bone : BODY_25_BONES) {
+    EXPECT_NEAR(bone_length(frame[0], bone), BONE_LENGTH, 0.005)
+      << bone.parent << " -> " << bone.child;
+  }
+}
+
+TEST(BoneLengthSolver, LowConfidenceJointsMoveMore) {
+  BoneLengthSolver solver{BoneSolverOptions{.min_confidence = 0.1}};
+  warm_up(solver, 0, 30);
+
+  Person3d stretched = make_person(0);
+  const Point3d elbow = stretched.body[3];
+  stretched.body[3].confidence = 1.0;
+  stretched.body[4].y += 0.1;
+  stretched.body[4].confidence = 0.15;
+  const Point3d wrist = stretched.body[4];
+  std::vector<Person3d> frame = {stretched};
+  solver.solve(frame);
+
+  const double elbow_moved = std::abs(frame[0].body[3].y - elbow.y);
+  const double wrist_moved = std::abs(frame[0].body[4].y - wrist.y);
+  EXPECT_GT(wrist_moved, elbow_moved * 4);
+}
+
+TEST(BoneLengthSolver, WarmStartsMissingJoints) {
+  BoneLengthSolver solver;
+  warm_up(solver, 0, 30);
+
+  Person3d missing = make_person(0);
+  missing.body[7] = Point3d{.point_id = 7};
+  std::vector<Person3d> frame = {missing};
+  solver.solve(frame);
+
+  // The lost wrist is carried over from the previous frame.
+  EXPECT_NEAR(bone_length(frame[0], BODY_25_BONES[13]), BONE_LENGTH, 0.005);
+  EXPECT_NEAR(frame[0].body[7].z, 2.0, 0.01);
+}
+
+TEST(BoneLengthSolver, FollowsUnsureObservations) {
+  BoneLengthSolver solver;
+  warm_up(solver, 0, 30);
+
+  // Joints below the sampling confidence, such as those the smoothing filter
+  // fills in, are still where the person is now.
+  Person3d moved = make_person(0);
+  for (Point3d& point : moved.body) {
+    point.x += 0.5;
+    point.confidence = 0.3;
+  }
+  std::vector<Person3d> frame = {moved};
+  solver.solve(frame);
+
+  for (std::size_t i = 0; i < BODY_25_POINT_COUNT; ++i) {
+    EXPECT_NEAR(frame[0].body[i].x, moved.body[i].x, 0.005) << "Joint " << i;
+  }
+}
+
+TEST(BoneLengthSolver, HandlesPartialBodies) {
+  BoneLengthSolver solver{BoneSolverOptions{.min_samples = 1}};
+
+  // Only the nose, whose bone hangs off the neck at a higher index.
+  Person3d person = make_person(0);
+  person.body.resize(1);
+  std::vector<Person3d> frame = {person};
+  solver.solve(frame);
+  ASSERT_EQ(frame[0].body.size(), 1);
+  EXPECT_EQ(solver.bone_length(0, 0), 0.0);
+}
+
+TEST(BoneLengthSolver, KeepsPeopleSeparate) {
+  BoneLengthSolver solver;
+  for (int i = 0; i < 30; ++i) {
+    std::vector<Person3d> frame = {make_person(0), make_person(1, 0.3)};
+    solver.solve(frame);
+  }
+  EXPECT_NEAR(solver.bone_length(0, 0), BONE_LENGTH, 0.01);
+  EXPECT_NEAR(solver.bone_length(1, 0), 0.3, 0.01);
+}
+
+TEST(BoneLengthSolver, ForgetsStalePeople) {
+  BoneLengthSolver solver{BoneSolverOptions{.max_missed_frames = 2}};
+  warm_up(solver, 0, 30);
+  for (int i = 0; i < 3; ++i) {
+    std::vector<Person3d> empty;
+    solver.solve(empty);
+  }
+  EXPECT_EQ(solver.bone_length(0, 0), 0.0);
+}
+
+}
@@ -0,0 +1,540 @@
+#include "src/bvh_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+namespace fs = std::filesystem;
+
+using Position = std::array<double, 3>;
+using Rotation = std::array<double, 9>;
+
+constexpr std::size_t N = BODY_25_POINT_COUNT;
+constexpr double EPSILON = 1e-9;
+
+// Neighbours closer to parallel than this give a frame too noisy to trust.
+constexpr double MIN_SINE = 0.05;
+constexpr Rotation IDENTITY = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+// Digits reserved for the frame count so it can be rewritten in place.
+constexpr int FRAME_COUNT_WIDTH = 12;
+
+/**
+ * BODY_25 joints of an adult in a T-pose, in meters, Y up and facing +Z.
+ * Elbows and knees are slightly bent so every joint's frame is defined at
+ * rest. Only the directions matter unless a bone is never seen.
+ */
+constexpr std::array<Position, N> REST_POSE = {{
+  {0.00, 1.62, 0.08},    // Nose
+  {0.00, 1.50, 0.00},    // Neck
+  {-0.18, 1.48, 0.00},   // RShoulder
+  {-0.46, 1.48, 0.00},   // RElbow
+  {-0.72, 1.48, 0.05},   // RWrist
+  {0.18, 1.48, 0.00},    // LShoulder
+  {0.46, 1.48, 0.00},    // LElbow
+  {0.72, 1.48, 0.05},    // LWrist
+  {0.00, 1.00, 0.00},    // MidHip
+  {-0.09, 1.00, 0.00},   // RHip
+  {-0.09, 0.55, 0.03},   // RKnee
+  {-0.09, 0.10, 0.00},   // RAnkle
+  {0.09, 1.00, 0.00},    // LHip
+  {0.09, 0.55, 0.03},    // LKnee
+  {0.09, 0.10, 0.00},    // LAnkle
+  {-0.03, 1.66, 0.07},   // REye
+  {0.03, 1.66, 0.07},    // LEye
+  {-0.07, 1.64, 0.00},   // REar
+  {0.07, 1.64, 0.00},    // LEar
+  {0.11, 0.00, 0.15},    // LBigToe
+  {0.14, 0.00, 0.13},    // LSmallToe
+  {0.09, 0.00, -0.05},   // LHeel
+  {-0.11, 0.00, 0.15},   // RBigToe
+  {-0.14, 0.00, 0.13},   // RSmallToe
+  {-0.09, 0.00, -0.05}   // RHeel
+}};
+
+Position subtract(const Position& a, const Position& b) {
+  return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+double norm(const Position& a) {
+  return std::sqrt((a[0] * a[0]) + (a[1] * a[1]) + (a[2] * a[2]));
+}
+
+Position cross(const Position& a, const Position& b) {
+  return {
+    (a[1] * b[2]) - (a[2] * b[1]),
+    (a[2] * b[0]) - (a[0] * b[2]),
+    (a[0] * b[1]) - (a[1] * b[0])
+  };
+}
+
+/**
+ * Orthonormal frame with its first axis along `a` and its second in the plane
+ * of `a` and `b`, as the rows of a rotation.
+ */
+Rotation triad(const Position& a, const Position& b) {
+  const double a_norm = norm(a);
+  const Position e1 = {a[0] / a_norm, a[1] / a_norm, a[2] / a_norm};
+  const double d = (b[0] * e1[0]) + (b[1] * e1[1]) + (b[2] * e1[2]);
+  Position e2 = {b[0] - (d * e1[0]), b[1] - (d * e1[1]), b[2] - (d * e1[2])};
+  const double e2_norm = norm(e2);
+  e2 = {e2[0] / e2_norm, e2[1] / e2_norm, e2[2] / e2_norm};
+  const Position e3 = cross(e1, e2);
+  return {
+    e1[0], e1[1], e1[2],
+    e2[0], e2[1], e2[2],
+    e3[0], e3[1], e3[2]
+  };
+}
+
+Rotation multiply_transposed(const Rotation& a, const Rotation& b) {
+  // aᵀ * b
+  Rotation out;
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) {
+      out[(r * 3) + c] =
+        (a[r] * b[c]) + (a[3 + r] * b[3 + c]) + (a[6 + r] * b[6 + c]);
+    }
+  }
+  return out;
+}
+
+/**
+ * The smallest rotation taking unit vector `u` onto unit vector `v`.
+ */
+Rotation arc(const Position& u, const Position& v) {
+  const double c = (u[0] * v[0]) + (u[1] * v[1]) + (u[2] * v[2]);
+  Position k = cross(u, v);
+  if (c < -1.0 + EPSILON) {
+    // Opposite directions, turn half way around any perpendicular axis.
+    k = cross(u, std::abs(u[0]) < 0.9 ? Position{1, 0, 0} : Position{0, 1, 0});
+    const double k_norm = norm(k);
+    k = {k[0] / k_norm, k[1] / k_norm, k[2] / k_norm};
+    return {
+      (2 * k[0] * k[0]) - 1, 2 * k[0] * k[1], 2 * k[0] * k[2],
+      2 * k[1] * k[0], (2 * k[1] * k[1]) - 1, 2 * k[1] * k[2],
+      2 * k[2] * k[0], 2 * k[2] * k[1], (2 * k[2] * k[2]) - 1
+    };
+  }
+  // Rodrigues' formula with the sine folded into k: I + [k] + [k]² / (1 + c).
+  const double s = 1.0 / (1.0 + c);
+  return {
+    1 - (s * ((k[1] * k[1]) + (k[2] * k[2]))),
+    (s * k[0] * k[1]) - k[2],
+    (s * k[0] * k[2]) + k[1],
+    (s * k[0] * k[1]) + k[2],
+    1 - (s * ((k[0] * k[0]) + (k[2] * k[2]))),
+    (s * k[1] * k[2]) - k[0],
+    (s * k[0] * k[2]) - k[1],
+    (s * k[1] * k[2]) + k[0],
+    1 - (s * ((k[0] * k[0]) + (k[1] * k[1])))
+  };
+}
+
+/**
+ * BVH's ZXY Euler angles, in degrees, of `r = Rz * Rx * Ry`.
+ */
+Position to_euler_zxy(const Rotation& r) {
+  constexpr double DEGREES = 180.0 / std::numbers::pi;
+  const double x = std::asin(std::clamp(r[7], -1.0, 1.0));
+  if (std::abs(r[7]) > 1.0 - EPSILON) {
+    // Gimbal lock, put all the turn on Z.
+    return {std::atan2(r[3], r[0]) * DEGREES, x * DEGREES, 0.0};
+  }
+  return {
+    std::atan2(-r[1], r[4]) * DEGREES,
+    x * DEGREES,
+    std::atan2(-r[6], r[8]) * DEGREES
+  };
+}
+
+/**
+ * The BVH hierarchy of BODY_25 and how each joint's rotation is solved.
+ *
+ * Only joints with children carry rotations; the rest end the chain. Each of
+ * those joints is framed by the vector to its longest child and whichever
+ * other neighbour, child or parent, is furthest from parallel to it.
+ */
+struct Topology {
+  std::array<int, N> parents;
+  std::array<std::vector<int>, N> children;
+
+  // Joints with rotation channels, in the hierarchy's depth-first order.
+  std::vector<int> animated;
+
+  // Per animated joint, indexed as `animated`.
+  std::vector<int> primary;
+  std::vector<int> secondary;
+  std::vector<Rotation> rest_frames;
+};
+
+const Topology& topology() {
+  static const Topology topology = []() {
+    Topology t;
+    t.parents.fill(-1);
+    for (const Bone& bone : BODY_25_BONES) {
+      t.parents[bone.child] = bone.parent;
+      t.children[bone.parent].push_back(bone.child);
+    }
+
+    const std::function<void(int)> visit = [&](int joint) {
+      if (t.children[joint].empty()) return;
+      t.animated.push_back(joint);
+      for (int child : t.children[joint]) visit(child);
+    };
+    visit(BODY_25_ROOT);
+
+    for (int joint : t.animated) {
+      const Position& origin = REST_POSE[joint];
+      int primary = t.children[joint].front();
+      for (int child : t.children[joint]) {
+        if (
+          norm(subtract(REST_POSE[child], origin)) >
+          norm(subtract(REST_POSE[primary], origin))
+        ) {
+          primary = child;
+        }
+      }
+      std::vector<int> neighbours = t.children[joint];
+      if (t.parents[joint] >= 0) neighbours.push_back(t.parents[joint]);
+
+      const Position a = subtract(REST_POSE[primary], origin);
+      int secondary = -1;
+      double best = 0.0;
+      for (int neighbour : neighbours) {
+        if (neighbour == primary) continue;
+        const Position b = subtract(REST_POSE[neighbour], origin);
+        const double sine = norm(cross(a, b)) / (norm(a) * norm(b));
+        if (sine > best) {
+          best = sine;
+          secondary = neighbour;
+        }
+      }
+      if (secondary < 0) {
+        throw std::logic_error("REST_POSE leaves a joint's frame undefined.");
+      }
+      t.primary.push_back(primary);
+      t.secondary.push_back(secondary);
+      t.rest_frames.push_back(
+        triad(a, subtract(REST_POSE[secondary], origin))
+      );
+    }
+    return t;
+  }();
+  return topology;
+}
+
+bool is_seen(const Person3d& person, int joint, double min_confidence) {
+  if (static_cast<std::size_t>(joint) >= person.body.size()) return false;
+  const Point3d& point = person.body[joint];
+  return (
+    point.confidence >= min_confidence &&
+    std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z)
+  );
+}
+
+Position position(const Person3d& person, int joint) {
+  const Point3d& point = person.body[joint];
+  return {point.x, point.y, point.z};
+}
+
+void append(std::string& line, double value) {
+  std::array<char, 32> buffer;
+  const auto [end, error] = std::to_chars(
+    buffer.data(),
+    buffer.data() + buffer.size(),
+    value,
+    std::chars_format::fixed,
+    5
+  );
+  if (!line.empty()) line.push_back(' ');
+  line.append(buffer.data(), end);
+}
+
+}
+
+BvhWriter::BvhWriter(
+  const fs::path& path,
+  int person_id,
+  BvhWriterOptions options
+):
+  _path{path},
+  _person_id{person_id},
+  _options{options},
+  _out{
+    path,
+    std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc
+  }
+{
+  if (!_out) throw std::runtime_error("Failed to open " + _path.string());
+  _world.fill(IDENTITY);
+}
+
+BvhWriter::~BvhWriter() {
+  try {
+    close();
+  } catch (...) {
+    // Nowhere to report it, close() should have been called.
+  }
+}
+
+void BvhWriter::write(const std::vector<Person3d>& people) {
+  if (!_out.is_open()) {
+    throw std::runtime_error("Animation " + _path.string() + " is closed.");
+  }
+
+  auto person = std::find_if(
+    people.begin(),
+    people.end(),
+    [&](const Person3d& person) { return person.person_id == _person_id; }
+  );
+  if (person == people.end()) {
+    // Until the skeleton is known, unseen frames are filled in once it is.
+    if (!_has_header) {
+      ++_options.leading_frames;
+      return;
+    }
+  } else {
+    if (!_has_header) _write_header(*person);
+    _solve(*person);
+  }
+
+  if (_frame_count == 0) {
+    for (std::size_t i = 0; i < _options.leading_frames; ++i) _write_frame();
+  }
+  _write_frame();
+  if (!_out) throw std::runtime_error("Failed to write " + _path.string());
+}
+
+void BvhWriter::close() {
+  if (!_out.is_open()) return;
+
+  if (!_has_header) {
+    // Never seen, so the rest pose stands in for every frame.
+    _write_header(Person3d{.person_id = _person_id});
+    _solve(Person3d{.person_id = _person_id});
+    for (std::size_t i = 0; i < _options.leading_frames; ++i) _write_frame();
+  }
+  _out.seekp(_frame_count_position);
+  _out
+    << std::left << std::setw(FRAME_COUNT_WIDTH) << _frame_count;
+  _out.close();
+  if (_out.fail()) {
+    throw std::runtime_error("Failed to write " + _path.string());
+  }
+}
+
+void BvhWriter::_write_header(const Person3d& person) {
+  const Topology& t = topology();
+
+  // Bones never seen in this frame keep their rest length, scaled by how the
+  // seen bones compare to theirs so the units agree.
+  std::array<double, N> lengths{};
+  std::array<bool, N> measured{};
+  std::vector<double> ratios;
+  for (const Bone& bone : BODY_25_BONES) {
+    const double rest =
+      norm(subtract(REST_POSE[bone.child], REST_POSE[bone.parent]));
+    lengths[bone.child] = rest;
+    if (
+      !is_seen(person, bone.parent, _options.min_confidence) ||
+      !is_seen(person, bone.child, _options.min_confidence)
+    ) {
+      continue;
+    }
+    lengths[bone.child] = norm(
+      subtract(position(person, bone.child), position(person, bone.parent))
+    );
+    measured[bone.child] = true;
+    ratios.push_back(lengths[bone.child] / rest);
+  }
+  if (!ratios.empty()) {
+    auto middle = ratios.begin() + (ratios.size() / 2);
+    std::nth_element(ratios.begin(), middle, ratios.end());
+    for (std::size_t i = 0; i < N; ++i) {
+      if (!measured[i]) lengths[i] *= *middle;
+    }
+  }
+
+  _out << std::fixed << std::setprecision(5) << "HIERARCHY\n";
+  const auto write_offset = [&](int joint, const std::string& indent) {
+    Position offset{};
+    if (t.parents[joint] >= 0) {
+      offset = subtract(REST_POSE[joint], REST_POSE[t.parents[joint]]);
+      const double scale = lengths[joint] / norm(offset);
+      offset = {offset[0] * scale, offset[1] * scale, offset[2] * scale};
+    }
+    _out
+      << indent << "OFFSET " << offset[0] << ' ' << offset[1] << ' '
+      << offset[2] << '\n';
+  };
+  const std::function<void(int, const std::string&)> write_joint =
+    [&](int joint, const std::string& indent) {
+      if (t.children[joint].empty()) {
+        _out << indent << "End Site\n" << indent << "{\n";
+        write_offset(joint, indent + "  ");
+        _out << indent << "}\n";
+        return;
+      }
+      _out
+        << indent << (joint == BODY_25_ROOT ? "ROOT " : "JOINT ")
+        << BODY_25_JOINT_NAMES[joint] << '\n' << indent << "{\n";
+      write_offset(joint, indent + "  ");
+      _out << indent << "  CHANNELS ";
+      if (joint == BODY_25_ROOT) {
+        _out << "6 Xposition Yposition Zposition ";
+      } else {
+        _out << "3 ";
+      }
+      _out << "Zrotation Xrotation Yrotation\n";
+      for (int child : t.children[joint]) write_joint(child, indent + "  ");
+      _out << indent << "}\n";
+    };
+  write_joint(BODY_25_ROOT, "");
+
+  _out << "MOTION\nFrames: ";
+  _frame_count_position = _out.tellp();
+  _out
+    << std::left << std::setw(FRAME_COUNT_WIDTH) << 0 << '\n'
+    << "Frame Time: " << std::setprecision(7) << (1.0 / _options.fps) << '\n';
+  _has_header = true;
+}
+
+void BvhWriter::_solve(const Person3d& person) {
+  const Topology& t = topology();
+  const std::size_t count = t.animated.size();
+  const double min_confidence = _options.min_confidence;
+
+  if (is_seen(person, BODY_25_ROOT, min_confidence)) {
+    _root = position(person, BODY_25_ROOT);
+  }
+
+  // Gathered as structures of arrays so each pass below is a straight run over
+  // every joint at once.
+  std::array<double, N> ax{}, ay{}, az{}, bx{}, by{}, bz{};
+  std::array<bool, N> seen{};
+  for (std::size_t k = 0; k < count; ++k) {
+    const int joint = t.animated[k];
+    seen[k] = is_seen(person, joint, min_confidence) &&
+      is_seen(person, t.primary[k], min_confidence) &&
+      is_seen(person, t.secondary[k], min_confidence);
+    if (!seen[k]) continue;
+    const Point3d& origin = person.body[joint];
+    const Point3d& a = person.body[t.primary[k]];
+    const Point3d& b = person.body[t.secondary[k]];
+    ax[k] = a.x - origin.x;
+    ay[k] = a.y - origin.y;
+    az[k] = a.z - origin.z;
+    bx[k] = b.x - origin.x;
+    by[k] = b.y - origin.y;
+    bz[k] = b.z - origin.z;
+  }
+
+  // First axis along the primary neighbour.
+  std::array<double, N> a_norm, e1x, e1y, e1z;
+  for (std::size_t k = 0; k < count; ++k) {
+    a_norm[k] = std::sqrt((ax[k] * ax[k]) + (ay[k] * ay[k]) + (az[k] * az[k]));
+    const double inverse = 1.0 / std::max(a_norm[k], EPSILON);
+    e1x[k] = ax[k] * inverse;
+    e1y[k] = ay[k] * inverse;
+    e1z[k] = az[k] * inverse;
+  }
+
+  // Second axis towards the secondary neighbour, square to the first.
+  std::array<double, N> b_norm, e2_norm, e2x, e2y, e2z;
+  for (std::size_t k = 0; k < count; ++k) {
+    const double d = (bx[k] * e1x[k]) + (by[k] * e1y[k]) + (bz[k] * e1z[k]);
+    e2x[k] = bx[k] - (d * e1x[k]);
+    e2y[k] = by[k] - (d * e1y[k]);
+    e2z[k] = bz[k] - (d * e1z[k]);
+    b_norm[k] = std::sqrt((bx[k] * bx[k]) + (by[k] * by[k]) + (bz[k] * bz[k]));
+    e2_norm[k] =
+      std::sqrt((e2x[k] * e2x[k]) + (e2y[k] * e2y[k]) + (e2z[k] * e2z[k]));
+    const double inverse = 1.0 / std::max(e2_norm[k], EPSILON);
+    e2x[k] *= inverse;
+    e2y[k] *= inverse;
+    e2z[k] *= inverse;
+  }
+
+  // Third axis completing the frame, then the world rotation taking the rest
+  // frame onto it: [e1 e2 e3] * rest.
+  std::array<Rotation, N> world;
+  for (std::size_t k = 0; k < count; ++k) {
+    const double e3x = (e1y[k] * e2z[k]) - (e1z[k] * e2y[k]);
+    const double e3y = (e1z[k] * e2x[k]) - (e1x[k] * e2z[k]);
+    const double e3z = (e1x[k] * e2y[k]) - (e1y[k] * e2x[k]);
+    const Rotation& rest = t.rest_frames[k];
+    for (int c = 0; c < 3; ++c) {
+      world[k][c] = (e1x[k] * rest[c]) + (e2x[k] * rest[3 + c]) +
+        (e3x * rest[6 + c]);
+      world[k][3 + c] = (e1y[k] * rest[c]) + (e2y[k] * rest[3 + c]) +
+        (e3y * rest[6 + c]);
+      world[k][6 + c] = (e1z[k] * rest[c]) + (e2z[k] * rest[3 + c]) +
+        (e3z * rest[6 + c]);
+    }
+  }
+
+  // Joints whose frame could not be built swing the primary bone into place,
+  // or hold their last rotation when even that was not seen.
+  for (std::size_t k = 0; k < count; ++k) {
+    const int joint = t.animated[k];
+    if (
+      seen[k] && a_norm[k] > EPSILON && e2_norm[k] > MIN_SINE * b_norm[k]
+    ) {
+      _world[joint] = world[k];
+      continue;
+    }
+    const int primary = t.primary[k];
+    if (
+      !is_seen(person, joint, min_confidence) ||
+      !is_seen(person, primary, min_confidence)
+    ) {
+      continue;
+    }
+    const Position current =
+      subtract(position(person, primary), position(person, joint));
+    const double current_norm = norm(current);
+    if (current_norm <= EPSILON) continue;
+    const Position rest = subtract(REST_POSE[primary], REST_POSE[joint]);
+    const double rest_norm = norm(rest);
+    _world[joint] = arc(
+      {rest[0] / rest_norm, rest[1] / rest_norm, rest[2] / rest_norm},
+      {
+        current[0] / current_norm,
+        current[1] / current_norm,
+        current[2] / current_norm
+      }
+    );
+  }
+
+  _line.clear();
+  for (double value : _root) append(_line, value);
+  for (int joint : t.animated) {
+    const int parent = t.parents[joint];
+    const Rotation local = parent < 0 ?
+      _world[joint] :
+      multiply_transposed(_world[parent], _world[joint]);
+    for (double angle : to_euler_zxy(local)) append(_line, angle);
+  }
+  _line.push_back('\n');
+}
+
+void BvhWriter::_write_frame() {
+  _out << _line;
+  ++_frame_count;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/files.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+struct BvhWriterOptions {
+  // Frame rate of the recording, written as the BVH frame time.
+  double fps = RECORDING_FPS;
+
+  // Joints less confident than this are treated as unseen.
+  double min_confidence = 0.1;
+
+  // Frames of the session that passed before the person was first seen. They
+  // are filled with the first pose so every person's file shares a timeline.
+  std::size_t leading_frames = 0;
+};
+
+/**
+ * Streams one person's BODY_25 joints to a BVH file as a skinned animation.
+ *
+ * The hierarchy is rooted at the neck with each bone's offset fixed at the
+ * length first seen, laid out along a T-pose. Every frame, each joint's
+ * rotation is solved from its own position and those of its neighbours, the
+ * root also carrying its position. Frames are written as they come, so memory
+ * does not grow with the length of the session. Frames missing the person
+ * repeat the previous pose, as do joints that were not seen.
+ */
+class BvhWriter {
+public:
+  BvhWriter(
+    const std::filesystem::path& path,
+    int person_id,
+    BvhWriterOptions options = {}
+  );
+  ~BvhWriter();
+  BvhWriter(const BvhWriter&) = delete;
+  BvhWriter(BvhWriter&&) = delete;
+  BvhWriter& operator=(const BvhWriter&) = delete;
+  BvhWriter& operator=(BvhWriter&&) = delete;
+
+  /**
+   * Appends a frame from the people seen in it.
+   */
+  void write(const std::vector<Person3d>& people);
+
+  /**
+   * Fills in the frame count. Called by the destructor if not before, though
+   * errors are only reported from here.
+   */
+  void close();
+
+  std::size_t frame_count() const { return _frame_count; }
+
+private:
+  // Row-major 3x3 rotation.
+  using Rotation = std::array<double, 9>;
+  using Position = std::array<double, 3>;
+
+  void _write_header(const Person3d& person);
+  void _write_frame();
+  void _solve(const Person3d& person);
+
+  std::filesystem::path _path;
+  int _person_id;
+  BvhWriterOptions _options;
+  std::fstream _out;
+  bool _has_header = false;
+  std::size_t _frame_count = 0;
+
+  // Where the frame count's digits start, to be rewritten on close.
+  std::streampos _frame_count_position;
+
+  // World rotations and root position of the last solved pose, held for
+  // anything unseen in later frames.
+  std::array<Rotation, BODY_25_POINT_COUNT> _world{};
+  Position _root{};
+
+  // The motion line last written, repeated for frames without the person.
+  std::string _line;
+};
@@ -0,0 +1,101 @@
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/bvh_writer.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+using std::filesystem::path;
+
+constexpr std::size_t FRAME_COUNT = 1'800; // One minute at 30 fps.
+
+const path BENCHMARK_DIR = "/tmp/benchmark/ar/bvh_writer";
+
+/**
+ * One person turning on the spot while their joints jitter by a centimeter,
+ * so every frame solves different rotations.
+ */
+const std::vector<std::vector<Person3d>>& clip() {
+  static const std::vector<std::vector<Person3d>> clip = []() {
+    std::mt19937 rng{42};
+    std::normal_distribution<double> noise{0.0, 0.01};
+    std::vector<std::vector<Person3d>> clip(FRAME_COUNT);
+    for (std::size_t f = 0; f < FRAME_COUNT; ++f) {
+      const double turn = 0.01 * f;
+      Person3d& person = clip[f].emplace_back(Person3d{.person_id = 0});
+      person.body.resize(BODY_25_POINT_COUNT);
+      person.body[BODY_25_ROOT] =
+        Point3d{.point_id = BODY_25_ROOT, .y = 1.5, .confidence = 1.0};
+      for (const Bone& bone : BODY_25_BONES) {
+        const Point3d& parent = person.body[bone.parent];
+        const double angle = turn + bone.child;
+        person.body[bone.child] = Point3d{
+          .point_id = bone.child,
+          .x = parent.x + (0.2 * std::cos(angle)) + noise(rng),
+          .y = parent.y - 0.1 + noise(rng),
+          .z = parent.z + (0.2 * std::sin(angle)) + noise(rng),
+          .confidence = 0.9
+        };
+      }
+    }
+    return clip;
+  }();
+  return clip;
+}
+
+path output_path(const std::string& name) {
+  std::filesystem::create_directories(BENCHMARK_DIR);
+  return BENCHMARK_DIR / name;
+}
+
+void set_counters(benchmark::State& state) {
+  state.SetItemsProcessed(state.iterations() * FRAME_COUNT);
+  state.counters["realtime_factor"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * FRAME_COUNT) / 60.0,
+    benchmark::Counter::kIsRate
+  );
+}
+
+void BM_BvhWriter(benchmark::State& state) {
+  const path file = output_path("person.bvh");
+  for (auto _ : state) {
+    BvhWriter writer{file, 0};
+    for (const std::vector<Person3d>& frame : clip()) writer.write(frame);
+    writer.close();
+  }
+  set_counters(state);
+}
+BENCHMARK(BM_BvhWriter)->Unit(benchmark::kMillisecond);
+
+/**
+ * Baseline: the projector's export as it used to be, an OBJ point cloud per
+ * frame.
+ */
+void BM_SaveObj(benchmark::State& state) {
+  const path directory = output_path("obj");
+  std::filesystem::create_directories(directory);
+  for (auto _ : state) {
+    for (std::size_t f = 0; f < FRAME_COUNT; ++f) {
+      const Person3d& person = clip()[f].front();
+      std::ofstream out{directory / (std::to_string(f) + ".obj")};
+      for (const Point3d& point : person.body) {
+        out << "v " << point.x << ' ' << point.y << ' ' << point.z << '\n';
+      }
+      for (const Bone& bone : BODY_25_BONES) {
+        out << "l " << (bone.parent + 1) << ' ' << (bone.child + 1) << '\n';
+      }
+    }
+  }
+  set_counters(state);
+}
+BENCHMARK(BM_SaveObj)->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,311 @@
+#include "src/bvh_writer.h"
+
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numbers>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+using std::filesystem::path;
+
+using Position = std::array<double, 3>;
+using Rotation = std::array<double, 9>;
+
+const path TEST_DIR = "/tmp/testing/ar/src/bvh_writer";
+
+// Joints of an upright person, in meters.
+constexpr std::array<Position, BODY_25_POINT_COUNT> STANDING = {{
+  {0.00, 1.60, 0.10}, {0.00, 1.45, 0.00}, {-0.20, 1.42, 0.00},
+  {-0.30, 1.15, 0.05}, {-0.32, 0.90, 0.15}, {0.20, 1.42, 0.00},
+  {0.30, 1.15, 0.05}, {0.32, 0.90, 0.15}, {0.00, 0.95, 0.00},
+  {-0.10, 0.93, 0.00}, {-0.12, 0.50, 0.05}, {-0.12, 0.08, 0.00},
+  {0.10, 0.93, 0.00}, {0.12, 0.50, 0.05}, {0.12, 0.08, 0.00},
+  {-0.04, 1.64, 0.08}, {0.04, 1.64, 0.08}, {-0.08, 1.62, 0.00},
+  {0.08, 1.62, 0.00}, {0.12, 0.00, 0.16}, {0.16, 0.00, 0.14},
+  {0.11, 0.00, -0.06}, {-0.12, 0.00, 0.16}, {-0.16, 0.00, 0.14},
+  {-0.11, 0.00, -0.06}
+}};
+
+path make_path(const std::string& name) {
+  const path directory = TEST_DIR / name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory / "person.bvh";
+}
+
+Rotation multiply(const Rotation& a, const Rotation& b) {
+  Rotation out{};
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) {
+      for (int i = 0; i < 3; ++i) {
+        out[(r * 3) + c] += a[(r * 3) + i] * b[(i * 3) + c];
+      }
+    }
+  }
+  return out;
+}
+
+Position transform(const Rotation& r, const Position& p) {
+  return {
+    (r[0] * p[0]) + (r[1] * p[1]) + (r[2] * p[2]),
+    (r[3] * p[0]) + (r[4] * p[1]) + (r[5] * p[2]),
+    (r[6] * p[0]) + (r[7] * p[1]) + (r[8] * p[2])
+  };
+}
+
+Rotation rotate_x(double radians) {
+  const double c = std::cos(radians);
+  const double s = std::sin(radians);
+  return {1, 0, 0, 0, c, -s, 0, s, c};
+}
+
+Rotation rotate_y(double radians) {
+  const double c = std::cos(radians);
+  const double s = std::sin(radians);
+  return {c, 0, s, 0, 1, 0, -s, 0, c};
+}
+
+Rotation rotate_z(double radians) {
+  const double c = std::cos(radians);
+  const double s = std::sin(radians);
+  return {c, -s, 0, s, c, 0, 0, 0, 1};
+}
+
+/**
+ * The standing pose turned by `turn` about the vertical, with the right arm
+ * raised by `raise` about the shoulder and the whole body moved by `shift`.
+ */
+Person3d make_person(double turn, double raise, const Position& shift) {
+  std::array<Position, BODY_25_POINT_COUNT> joints = STANDING;
+  const Position shoulder = joints[2];
+  for (int joint : {3, 4}) {
+    const Position offset = transform(rotate_z(-raise), {
+      joints[joint][0] - shoulder[0],
+      joints[joint][1] - shoulder[1],
+      joints[joint][2] - shoulder[2]
+    });
+    joints[joint] = {
+      shoulder[0] + offset[0],
+      shoulder[1] + offset[1],
+      shoulder[2] + offset[2]
+    };
+  }
+
+  Person3d person{.person_id = 3};
+  for (int i = 0; i < static_cast<int>(BODY_25_POINT_COUNT); ++i) {
+    const Position p = transform(rotate_y(turn), joints[i]);
+    person.body.push_back(Point3d{
+      .point_id = i,
+      .x = p[0] + shift[0],
+      .y = p[1] + shift[1],
+      .z = p[2] + shift[2],
+      .confidence = 0.9
+    });
+  }
+  return person;
+}
+
+/**
+ * A BVH file read back and posed by forward kinematics.
+ */
+struct Bvh {
+  struct Joint {
+    std::string name;
+    int parent;
+    Position offset;
+  };
+
+  std::vector<Joint> joints;
+  int frame_count = 0;
+  std::vector<std::vector<double>> frames;
+
+  explicit Bvh(const path& file) {
+    std::ifstream in{file};
+    std::vector<int> stack;
+    std::string token;
+    bool in_end_site = false;
+    while (in >> token && token != "MOTION") {
+      if (token == "ROOT" || token == "JOINT") {
+        Joint& joint = joints.emplace_back();
+        in >> joint.name;
+        joint.parent = stack.empty() ? -1 : stack.back();
+        stack.push_back(joints.size() - 1);
+      } else if (token == "End") {
+        in >> token;
+        in_end_site = true;
+      } else if (token == "OFFSET") {
+        Position offset;
+        in >> offset[0] >> offset[1] >> offset[2];
+        if (!in_end_site) joints[stack.back()].offset = offset;
+      } else if (token == "}") {
+        if (in_end_site) {
+          in_end_site = false;
+        } else {
+          stack.pop_back();
+        }
+      }
+    }
+    in >> token >> frame_count >> token >> token >> token;
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+      std::stringstream values{line};
+      std::vector<double>& frame = frames.emplace_back();
+      for (double value; values >> value;) frame.push_back(value);
+    }
+  }
+
+  std::map<std::string, Position> pose(std::size_t frame) const {
+    constexpr double RADIANS = std::numbers::pi / 180.0;
+    const std::vector<double>& values = frames.at(frame);
+    std::vector<Rotation> world(joints.size());
+    std::vector<Position> positions(joints.size());
+    std::map<std::string, Position> named;
+    std::size_t v = 3;
+    for (std::size_t i = 0; i < joints.size(); ++i) {
+      const Rotation local = multiply(
+        multiply(
+          rotate_z(values[v] * RADIANS),
+          rotate_x(values[v + 1] * RADIANS)
+        ),
+        rotate_y(values[v + 2] * RADIANS)
+      );
+      v += 3;
+      const int parent = joints[i].parent;
+      if (parent < 0) {
+        world[i] = local;
+        positions[i] = {values[0], values[1], values[2]};
+      } else {
+        world[i] = multiply(world[parent], local);
+        const Position offset = transform(world[parent], joints[i].offset);
+        positions[i] = {
+          positions[parent][0] + offset[0],
+          positions[parent][1] + offset[1],
+          positions[parent][2] + offset[2]
+        };
+      }
+      named[joints[i].name] = positions[i];
+    }
+    return named;
+  }
+};
+
+void expect_near(const Position& actual, const Point3d& expected) {
+  EXPECT_NEAR(actual[0], expected.x, 1e-4);
+  EXPECT_NEAR(actual[1], expected.y, 1e-4);
+  EXPECT_NEAR(actual[2], expected.z, 1e-4);
+}
+
+TEST(BvhWriter, WritesHierarchyAndFrameCount) {
+  const path file = make_path("hierarchy");
+  {
+    BvhWriter writer{file, 3};
+    for (int i = 0; i < 5; ++i) {
+      writer.write({make_person(0.1 * i, 0.0, {0, 0, 0})});
+    }
+    EXPECT_EQ(writer.frame_count(), 5);
+  }
+
+  const Bvh bvh{file};
+  ASSERT_FALSE(bvh.joints.empty());
+  EXPECT_EQ(bvh.joints.front().name, "Neck");
+  EXPECT_EQ(bvh.frame_count, 5);
+  ASSERT_EQ(bvh.frames.size(), 5);
+  for (const std::vector<double>& frame : bvh.frames) {
+    EXPECT_EQ(frame.size(), 3 + (bvh.joints.size() * 3));
+  }
+}
+
+TEST(BvhWriter, ReproducesBoneDirections) {
+  const path file = make_path("directions");
+  const std::vector<Person3d> people = {
+    make_person(0.0, 0.0, {0.0, 0.0, 2.0}),
+    make_person(0.7, 0.8, {0.5, 0.1, 2.0}),
+    make_person(-2.0, 1.5, {-1.0, 0.0, 3.0})
+  };
+  {
+    BvhWriter writer{file, 3};
+    for (const Person3d& person : people) writer.write({person});
+  }
+
+  // The root is placed exactly, and a joint with one child points its bone
+  // exactly at it. Elsewhere the fixed offsets can only fit the pose.
+  const Bvh bvh{file};
+  const std::vector<Bone> bones = {
+    {1, 8}, {2, 3}, {5, 6}, {9, 10}, {10, 11}, {12, 13}, {13, 14}
+  };
+  for (std::size_t f = 0; f < people.size(); ++f) {
+    SCOPED_TRACE("frame " + std::to_string(f));
+    const Person3d& person = people[f];
+    const std::map<std::string, Position> pose = bvh.pose(f);
+    const Position& root = pose.at("Neck");
+    EXPECT_NEAR(root[0], person.body[1].x, 1e-4);
+    EXPECT_NEAR(root[1], person.body[1].y, 1e-4);
+    EXPECT_NEAR(root[2], person.body[1].z, 1e-4);
+
+    for (const Bone& bone : bones) {
+      const std::string parent_name{BODY_25_JOINT_NAMES[bone.parent]};
+      const std::string child_name{BODY_25_JOINT_NAMES[bone.child]};
+      SCOPED_TRACE(parent_name + " -> " + child_name);
+      const Position& parent = pose.at(parent_name);
+      const Position& child = pose.at(child_name);
+      const Point3d& expected_parent = person.body[bone.parent];
+      const Point3d& expected_child = person.body[bone.child];
+      expect_near(
+        {
+          child[0] - parent[0],
+          child[1] - parent[1],
+          child[2] - parent[2]
+        },
+        Point3d{
+          .x = expected_child.x - expected_parent.x,
+          .y = expected_child.y - expected_parent.y,
+          .z = expected_child.z - expected_parent.z
+        }
+      );
+    }
+  }
+}
+
+TEST(BvhWriter, HoldsPoseWhenPersonIsMissing) {
+  const path file = make_path("missing");
+  {
+    BvhWriter writer{file, 3};
+    writer.write({});
+    writer.write({make_person(0.5, 0.5, {0, 0, 0})});
+    writer.write({});
+    writer.write({make_person(0.0, 0.0, {0, 0, 0})});
+    EXPECT_EQ(writer.frame_count(), 4);
+  }
+
+  const Bvh bvh{file};
+  ASSERT_EQ(bvh.frames.size(), 4);
+  EXPECT_EQ(bvh.frames[0], bvh.frames[1]);
+  EXPECT_EQ(bvh.frames[1], bvh.frames[2]);
+  EXPECT_NE(bvh.frames[2], bvh.frames[3]);
+}
+
+TEST(BvhWriter, NeverSeenIsRestPose) {
+  const path file = make_path("never_seen");
+  {
+    BvhWriter writer{file, 3, {.leading_frames = 2}};
+    writer.write({});
+  }
+
+  const Bvh bvh{file};
+  EXPECT_EQ(bvh.frame_count, 3);
+  ASSERT_EQ(bvh.frames.size(), 3);
+  for (double value : bvh.frames[0]) EXPECT_EQ(value, 0.0);
+}
+
+}
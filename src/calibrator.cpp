@@ -1,51 +1,94 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <opencv2/aruco.hpp>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
-#include <opencv2/videoio.hpp>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include "src/camera_devices.h"
+#include "src/camera_model.h"
 #include "src/cameras.h"
+#include "src/charuco.h"
+#include "src/extrinsics.h"
 #include "src/files.h"
+#include "src/frame_source.h"
 #include "src/keys.h"
+#include "src/timing.h"
+#include "src/tracing.h"
+#include "src/video_reader.h"
 
 using namespace std::chrono_literals;
 
-constexpr std::size_t MIN_CALIBRATION_FRAMES = 5;
+const cv::Size IMAGE_SIZE{1920, 1080};
 
-cv::Ptr<cv::aruco::CharucoBoard> get_board() {
-  static cv::Ptr<cv::aruco::CharucoBoard> board =
-    cv::aruco::CharucoBoard::create(
-      5, 7,
-      0.0303f, 0.01515f,
-      cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250)
-    );
-  return board;
-}
+/**
+ * What a camera's orientation worker made of one frame.
+ */
+struct OrientationFrame {
+  // Counts up with every frame the worker finished.
+  std::uint64_t sequence = 0;
+  steady_clock::time_point captured_at;
 
-cv::VideoCapture open_camera(int camera_id) {
-  cv::VideoCapture camera;
-  camera.open(camera_id);
-  camera.set(cv::CAP_PROP_FRAME_WIDTH, 1920);
-  camera.set(cv::CAP_PROP_FRAME_HEIGHT, 1080);
-  return camera;
-}
+  // The frame with the board drawn over it, and the text to show with it.
+  cv::Mat image;
+  std::string debug_text;
+
+  // The calibration target, if it was seen.
+  std::optional<TargetView> view;
+};
 
 class CharucoCalibrator {
 public:
   explicit CharucoCalibrator(CameraDevice device):
     _parameters{.device = std::move(device)},
-    _camera{open_camera(_parameters.device.camera_id)}
+    _calibration_path{get_calibration_path(_parameters.device.camera_id)},
+    _camera{std::make_unique<CameraSource>(_parameters.device, IMAGE_SIZE)}
+  {}
+
+  /**
+   * Calibrates from a recorded video, looping it. The calibration is saved
+   * under the name of the camera directory the video is in.
+   */
+  explicit CharucoCalibrator(const std::filesystem::path& video_path):
+    _parameters{.device = {
+      .device_path = video_path,
+      .camera_id = -1,
+      .name = video_path.parent_path().filename().string()
+    }},
+    _calibration_path{get_calibration_path(_parameters.device.name)},
+    _camera{std::make_unique<VideoFileSource>(
+      video_path,
+      VideoFileOptions{.loop = true}
+    )}
   {}
 
+  // Must not be moved while its orientation worker runs.
+  ~CharucoCalibrator() { stop_worker(); }
+  CharucoCalibrator(const CharucoCalibrator&) = delete;
+  CharucoCalibrator(CharucoCalibrator&&) = default;
+  CharucoCalibrator& operator=(const CharucoCalibrator&) = delete;
+  CharucoCalibrator& operator=(CharucoCalibrator&&) = default;
+
   const CameraParameters& parameters() const { return _parameters; }
   const CameraDevice& device() const { return _parameters.device; }
+  const std::filesystem::path& calibration_path() const {
+    return _calibration_path;
+  }
   const std::string& debug_text() const { return _debug_text; }
   const cv::Mat& frame() const { return _display_frame; }
   const cv::Mat& last_corners() const { return _last_charuco_corners; }
@@ -56,6 +99,16 @@ public:
     return !_parameters.matrix.empty() && !_parameters.distortion.empty();
   }
 
+  /**
+   * Takes intrinsics calibrated elsewhere, such as from a recorded video.
+   */
+  void set_intrinsics(const IntrinsicCalibration& intrinsics) {
+    _parameters.matrix = intrinsics.matrix.clone();
+    _parameters.distortion = intrinsics.distortion.clone();
+    _error_rate = intrinsics.error;
+    _rectifier.reset();
+  }
+
   void save_frame() {
     if (_last_charuco_corners.empty()) return;
 
@@ -63,9 +116,9 @@ public:
     _last_charuco_ids.copyTo(_saved_charuco_ids.emplace_back());
     std::cout << "Saving frame state " << _saved_charuco_ids.size();
 
-    if (_saved_charuco_corners.size() >= MIN_CALIBRATION_FRAMES) {
+    if (_saved_charuco_corners.size() >= MIN_CALIBRATION_VIEWS) {
       _calibrate();
-      std::cout << "; calibrated with " << _error_rate << " average error";
+      std::cout << "; recalibrating";
     }
     std::cout << '.' << std::endl;
   }
@@ -77,101 +130,200 @@ public:
     _saved_charuco_corners.pop_back();
     _saved_charuco_ids.pop_back();
 
-    if (_saved_charuco_corners.size() >= MIN_CALIBRATION_FRAMES) {
+    if (_saved_charuco_corners.size() >= MIN_CALIBRATION_VIEWS) {
       _calibrate();
-      std::cout << "; calibrated with " << _error_rate << " average error";
+      std::cout << "; recalibrating";
     }
     std::cout << '.' << std::endl;
   }
 
+  /**
+   * Takes the newest result from the background solver, if there is one.
+   */
+  void update_calibration() {
+    if (!_solver) return;
+    std::shared_ptr<const CalibrationUpdate> update;
+    try {
+      update = _solver->latest();
+    } catch (const std::exception& error) {
+      std::cout << "Calibration failed: " << error.what() << std::endl;
+      return;
+    }
+    if (!update || update->revision <= _applied_revision) return;
+
+    _applied_revision = update->revision;
+    _parameters.matrix = update->intrinsics.matrix;
+    _parameters.distortion = update->intrinsics.distortion;
+    _error_rate = update->intrinsics.error;
+    _rectifier.reset();
+    std::cout
+      << "Calibrated from " << update->view_count << " frames with "
+      << _error_rate << " average error." << std::endl;
+  }
+
+  /**
+   * Waits for the solver to finish with the views saved so far.
+   */
+  void finish_calibration() {
+    if (_solver) _solver->wait();
+    update_calibration();
+  }
+
   void undistort_frame() {
     _last_charuco_ids = cv::Mat{};
     _last_charuco_corners = cv::Mat{};
 
-    _camera >> _frame;
-
-    cv::Mat undistorted_map_1;
-    cv::Mat undistorted_map_2;
-    cv::Mat optimal_matrix = cv::getOptimalNewCameraMatrix(
-      _parameters.matrix,
-      _parameters.distortion,
-      _frame.size(),
-      0.0,
-      _frame.size()
-    );
-    cv::initUndistortRectifyMap(
-      _parameters.matrix,
-      _parameters.distortion,
-      cv::noArray(),
-      optimal_matrix,
-      _frame.size(),
-      CV_16SC2,
-      undistorted_map_1,
-      undistorted_map_2
-    );
-
-    cv::remap(
-      _frame,
-      _display_frame,
-      undistorted_map_1,
-      undistorted_map_2,
-      cv::INTER_CUBIC
-    );
+    // The maps only change when the calibration does.
+    const TraceSpan span{"undistort"};
+    if (!_rectifier) _rectifier.emplace(_parameters, _frame.size());
+    _rectifier->rectify(_frame, _display_frame);
   }
 
   void detect_board() {
-    _display_frame = _detect_charuco();
+    // Nothing to redo if the camera had no new frame.
+    if (!_new_frame && !_display_frame.empty()) return;
+    _new_frame = false;
+    const TraceSpan span{"detect"};
+
+    // Drawn over a copy of the frame, in a buffer reused every frame.
+    _frame.copyTo(_display_frame);
+    _detect_charuco(_display_frame);
   }
 
   void grab_frame() {
-    _camera >> _frame;
+    _read_frame();
+  }
+
+  /**
+   * Starts capturing and detecting on a thread of its own, looking for the
+   * board and `target` in every frame. Until the worker is stopped, results
+   * only come from `latest_frame` and nothing else may touch the camera.
+   */
+  void start_worker(const CalibrationTarget& target) {
+    stop_worker();
+    _worker = std::make_unique<Worker>();
+    _worker->thread = std::thread{[this, target]() { _worker_loop(target); }};
+  }
+
+  void stop_worker() {
+    if (!_worker) return;
+    _worker->stopping = true;
+    if (_worker->thread.joinable()) _worker->thread.join();
+    _worker.reset();
+  }
+
+  /**
+   * The worker's most recent frame, if it has finished any. Never waits on
+   * the worker. Rethrows, once, the error that stopped it.
+   */
+  std::shared_ptr<const OrientationFrame> latest_frame() {
+    if (!_worker) return nullptr;
+    if (_worker->failed.exchange(false)) {
+      std::rethrow_exception(std::move(_worker->error));
+    }
+    return _worker->latest.load();
   }
 
 private:
-  void _calibrate() {
-    _error_rate = cv::aruco::calibrateCameraCharuco(
-      _saved_charuco_corners, _saved_charuco_ids, get_board(), _frame.size(),
-      _parameters.matrix, _parameters.distortion,
-      _parameters.rotation, _parameters.translation,
-      cv::noArray(),  // std deviation intrinsics
-      cv::noArray(),  // std deviation extrinsics
-      cv::noArray()   // per view errors
+  struct Worker {
+    std::atomic<std::shared_ptr<const OrientationFrame>> latest;
+    std::atomic_bool stopping = false;
+    std::atomic_bool failed = false;
+    std::exception_ptr error;
+    std::thread thread;
+  };
+
+  void _read_frame() {
+    // Keep showing the last frame if the camera has nothing new.
+    if (std::optional<Frame> frame = _camera->read()) {
+      _frame = std::move(frame->image);
+      _new_frame = true;
+    }
+  }
+
+  void _worker_loop(const CalibrationTarget& target) {
+    // The flat board is already found by the detector, no need to look again.
+    const bool board_target =
+      target.faces().size() == 1 &&
+      target.faces().front().board == get_charuco_board();
+    std::uint64_t sequence = 0;
+    Tracer::global().name_thread(
+      "orient " + _parameters.device.device_path.string()
     );
+    try {
+      while (!_worker->stopping) {
+        std::optional<Frame> frame;
+        {
+          const TraceSpan span{"read"};
+          frame = _camera->read();
+        }
+        if (!frame) break;
+        const TraceSpan span{"detect"};
+        _frame = std::move(frame->image);
+
+        // Every frame gets fresh buffers, the UI may still be showing the
+        // last ones.
+        auto result = std::make_shared<OrientationFrame>();
+        result->sequence = ++sequence;
+        result->captured_at = frame->captured_at;
+        _frame.copyTo(result->image);
+        _detect_charuco(result->image);
+        result->debug_text = _debug_text;
+        if (!board_target) {
+          result->view = target.detect(_frame);
+        } else if (!_last_charuco_ids.empty()) {
+          TargetView& view = result->view.emplace();
+          view.point_ids.assign(
+            _last_charuco_ids.begin<int>(),
+            _last_charuco_ids.end<int>()
+          );
+          view.pixels.assign(
+            _last_charuco_corners.begin<cv::Point2f>(),
+            _last_charuco_corners.end<cv::Point2f>()
+          );
+        }
+        _worker->latest.store(std::move(result));
+      }
+    } catch (...) {
+      _worker->error = std::current_exception();
+      _worker->failed = true;
+    }
+  }
+
+  void _calibrate() {
+    const TraceSpan span{"calibrate"};
+    // Solved on its own thread, the result shows up in update_calibration().
+    if (!_solver) {
+      _solver = std::make_unique<BackgroundCalibration>(_frame.size());
+    }
+    std::vector<CharucoDetection> views;
+    for (std::size_t i = 0; i < _saved_charuco_corners.size(); ++i) {
+      views.push_back(CharucoDetection{
+        .frame_index = i,
+        .corners = _saved_charuco_corners[i],
+        .ids = _saved_charuco_ids[i]
+      });
+    }
+    _solver->update(std::move(views));
   }
 
-  cv::Mat _detect_charuco() {
-    cv::Mat display_image;
-    _frame.copyTo(display_image);
+  void _detect_charuco(cv::Mat& display_image) {
     _debug_text = _parameters.device.device_path.string() + '\n';
     _debug_text += "RMS: " + std::to_string(_error_rate) + '\n';
 
-    auto board = get_board();
-    cv::Ptr<cv::aruco::DetectorParameters> params =
-      cv::aruco::DetectorParameters::create();
-    params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_CONTOUR;
-
-    std::vector<int> marker_ids;
-    std::vector<std::vector<cv::Point2f>> marker_corners;
-    cv::aruco::detectMarkers(
-      _frame,
-      board->dictionary,
-      marker_corners,
-      marker_ids,
-      params
-    );
-
-    if (marker_ids.empty()) return display_image;
-    cv::aruco::drawDetectedMarkers(display_image, marker_corners, marker_ids);
-    cv::aruco::interpolateCornersCharuco(
-      marker_corners,
-      marker_ids,
-      _frame,
-      board,
-      _last_charuco_corners,
-      _last_charuco_ids
+    _last_charuco_ids = cv::Mat{};
+    _last_charuco_corners = cv::Mat{};
+    std::optional<CharucoDetection> detection = _detector.detect(_frame);
+    if (_detector.marker_ids().empty()) return;
+    cv::aruco::drawDetectedMarkers(
+      display_image,
+      _detector.marker_corners(),
+      _detector.marker_ids()
     );
 
-    if (_last_charuco_ids.empty()) return display_image;
+    if (!detection) return;
+    _last_charuco_corners = detection->corners;
+    _last_charuco_ids = detection->ids;
     cv::aruco::drawDetectedCornersCharuco(
       display_image,
       _last_charuco_corners,
@@ -179,27 +331,28 @@ private:
       cv::Scalar{255, 0, 0}
     );
 
-    if (!calibrated()) return display_image;
+    if (!calibrated()) return;
 
-    if (!_estimate_pose()) return display_image;
+    if (!_estimate_pose()) return;
     cv::aruco::drawAxis(
       display_image,
       _parameters.matrix,
       _parameters.distortion,
       _parameters.rotation,
       _parameters.translation,
-      board->getSquareLength()
+      get_charuco_board()->getSquareLength()
     );
     _debug_text += "tvec: " + _dump(_parameters.translation) + '\n';
     _debug_text += "rvec: " + _dump(_parameters.rotation) + '\n';
-    return display_image;
+    const CameraModel model{_parameters};
+    _debug_text += "center: " + _dump(cv::Mat{model.world_center()}) + '\n';
   }
 
   bool _estimate_pose() {
     return cv::aruco::estimatePoseCharucoBoard(
       _last_charuco_corners,
       _last_charuco_ids,
-      get_board(),
+      get_charuco_board(),
       _parameters.matrix,
       _parameters.distortion,
       _parameters.rotation,
@@ -214,20 +367,34 @@ private:
   }
 
   CameraParameters _parameters;
-  cv::VideoCapture _camera;
+  std::filesystem::path _calibration_path;
+  std::unique_ptr<FrameSource> _camera;
+  CharucoDetector _detector;
+  std::optional<Rectifier> _rectifier;
   cv::Mat _frame;
+  bool _new_frame = false;
   cv::Mat _display_frame;
   cv::Mat _last_charuco_ids;
   cv::Mat _last_charuco_corners;
   std::vector<cv::Mat> _saved_charuco_ids;
   std::vector<cv::Mat> _saved_charuco_corners;
+  std::unique_ptr<BackgroundCalibration> _solver;
+  std::uint64_t _applied_revision = 0;
   double _error_rate = 420.69;
   std::string _debug_text;
+  std::unique_ptr<Worker> _worker;
 };
 
-std::vector<CharucoCalibrator> get_calibrators() {
-  std::vector<CameraDevice> devices = get_camera_devices();
+std::vector<CharucoCalibrator> get_calibrators(
+  const std::vector<std::filesystem::path>& video_paths
+) {
   std::vector<CharucoCalibrator> calibrators;
+  for (const std::filesystem::path& video_path : video_paths) {
+    calibrators.emplace_back(video_path);
+  }
+  if (!calibrators.empty()) return calibrators;
+
+  std::vector<CameraDevice> devices = get_camera_devices();
   for (CameraDevice& device : devices) {
     calibrators.emplace_back(std::move(device));
   }
@@ -302,7 +469,7 @@ void run_camera_calibration(std::vector<CharucoCalibrator>& calibrators) {
           render_undistorted = false;
         }
         std::cout
-          << "Switched to camera " << calibrator->device().camera_id
+          << "Switched to camera " << calibrator->device().device_path
           << std::endl;
         break;
       }
@@ -333,6 +500,9 @@ void run_camera_calibration(std::vector<CharucoCalibrator>& calibrators) {
       }
     }
 
+    // Pick up calibrations finished in the background since the last tick.
+    for (CharucoCalibrator& camera : calibrators) camera.update_calibration();
+
     calibrator->grab_frame();
     if (render_undistorted) {
       calibrator->undistort_frame();
@@ -362,20 +532,91 @@ void run_camera_calibration(std::vector<CharucoCalibrator>& calibrators) {
     cv::imshow("Visualization", visualizer);
   }
   cv::destroyAllWindows();
+
+  for (CharucoCalibrator& calibrator : calibrators) {
+    calibrator.finish_calibration();
+  }
 }
 
-void run_camera_orientation(std::vector<CharucoCalibrator>& calibrators) {
+std::vector<CameraParameters> get_parameters(
+  const std::vector<CharucoCalibrator>& calibrators
+) {
+  std::vector<CameraParameters> parameters;
+  for (const CharucoCalibrator& calibrator : calibrators) {
+    parameters.push_back(calibrator.parameters());
+  }
+  return parameters;
+}
+
+/**
+ * Solves for every camera's pose from the views collected and saves them.
+ * Returns false if they could not be solved.
+ */
+bool solve_orientation(
+  const ExtrinsicCalibration& calibration,
+  const std::vector<CharucoCalibrator>& calibrators
+) {
+  const auto start = steady_clock::now();
+  ExtrinsicResult result;
+  try {
+    result = calibration.solve();
+  } catch (const std::exception& error) {
+    std::cout << "Orientation failed: " << error.what() << std::endl;
+    return false;
+  }
+
+  std::cout
+    << "Oriented from " << result.frames << " frames with "
+    << result.error << " average error after " << result.iterations
+    << " iterations in " << to_hms(steady_clock::now() - start) << '.'
+    << std::endl;
+  const std::vector<CameraParameters> parameters = calibration.apply(result);
+  for (std::size_t i = 0; i < calibrators.size(); ++i) {
+    std::cout
+      << calibrators[i].device().device_path << ": "
+      << result.camera_errors[i] << " average error." << std::endl;
+    save_camera_parameters(parameters[i], calibrators[i].calibration_path());
+  }
+  return true;
+}
+
+/**
+ * Collects views of the target from every camera at once while it is moved
+ * around, then solves for the cameras' poses together when SPACE is pressed.
+ *
+ * Each camera captures and detects on its own worker, this thread only
+ * gathers their latest results and shows them. Detection rates and how far
+ * apart the cameras' latest frames were captured are reported as it runs.
+ */
+void run_camera_orientation(
+  std::vector<CharucoCalibrator>& calibrators,
+  const CalibrationTarget& target
+) {
+  // Frames captured further apart than this are not taken as simultaneous,
+  // half a frame at 30fps.
+  constexpr auto MAX_GRAB_SKEW = 16ms;
+  constexpr auto REPORT_INTERVAL = 2s;
+
+  ExtrinsicCalibration calibration{get_parameters(calibrators), target};
+  for (CharucoCalibrator& calibrator : calibrators) {
+    calibrator.start_worker(target);
+  }
+
+  const std::size_t camera_count = calibrators.size();
+  std::vector<std::shared_ptr<const OrientationFrame>> frames(camera_count);
+  std::vector<std::uint64_t> added_sequences(camera_count, 0);
+  std::vector<std::uint64_t> report_sequences(camera_count, 0);
+  std::vector<double> fps(camera_count, 0.0);
+  steady_clock::time_point report_start = steady_clock::now();
+  steady_clock::duration skew{0};
+  std::uint64_t tick = 0;
   Key key;
-  while (key = static_cast<Key>(cv::waitKey(50)), key != Key::ESC) {
+  while (key = wait_key(10ms), key != Key::ESC) {
     switch (key) {
       case Key::SPACE: {
-        for (CharucoCalibrator& calibrator : calibrators) {
-          save_camera_parameters(
-            calibrator.parameters(),
-            get_calibration_path(calibrator.device().camera_id)
-          );
+        if (solve_orientation(calibration, calibrators)) {
+          std::cout << "Camera parameters saved." << std::endl;
         }
-        std::cout << "Camera parameters saved." << std::endl;
         break;
       }
 
@@ -387,25 +628,172 @@ void run_camera_orientation(std::vector<CharucoCalibrator>& calibrators) {
       }
     }
 
-    // Grab a frame from every camera as fast as possible.
-    for (CharucoCalibrator& calibrator : calibrators) {
-      calibrator.grab_frame();
+    std::optional<steady_clock::time_point> earliest;
+    std::optional<steady_clock::time_point> latest;
+    bool all_new = true;
+    for (std::size_t i = 0; i < camera_count; ++i) {
+      try {
+        if (auto frame = calibrators[i].latest_frame()) frames[i] = frame;
+      } catch (const std::exception& error) {
+        std::cout
+          << calibrators[i].device().device_path << " stopped: "
+          << error.what() << std::endl;
+      }
+      if (!frames[i]) {
+        all_new = false;
+        continue;
+      }
+      all_new = all_new && frames[i]->sequence != added_sequences[i];
+      const steady_clock::time_point captured_at = frames[i]->captured_at;
+      if (!earliest || captured_at < *earliest) earliest = captured_at;
+      if (!latest || captured_at > *latest) latest = captured_at;
+    }
+    if (earliest) skew = *latest - *earliest;
+    const double skew_ms =
+      std::chrono::duration<double, std::milli>{skew}.count();
+
+    // Views only count as seen together once every camera has moved on to a
+    // frame captured close enough to the others'.
+    if (all_new && skew <= MAX_GRAB_SKEW) {
+      ++tick;
+      for (std::size_t i = 0; i < camera_count; ++i) {
+        added_sequences[i] = frames[i]->sequence;
+        if (frames[i]->view) calibration.add_view(i, tick, *frames[i]->view);
+      }
     }
 
-    // Detect charuco board and calculate pose, then display.
-    for (CharucoCalibrator& calibrator : calibrators) {
-      calibrator.detect_board();
+    const steady_clock::time_point now = steady_clock::now();
+    if (now - report_start >= REPORT_INTERVAL) {
+      std::cout << "Detection:";
+      for (std::size_t i = 0; i < camera_count; ++i) {
+        const std::uint64_t sequence = frames[i] ? frames[i]->sequence : 0;
+        fps[i] = to_fps(sequence - report_sequences[i], now - report_start);
+        report_sequences[i] = sequence;
+        std::cout
+          << ' ' << calibrators[i].device().device_path << ' ' << fps[i]
+          << "fps";
+      }
+      std::cout
+        << "; grab skew " << skew_ms << "ms; "
+        << calibration.view_count() << " views." << std::endl;
+      report_start = now;
+    }
+
+    for (std::size_t i = 0; i < camera_count; ++i) {
+      if (!frames[i]) continue;
       cv::Mat image;
-      calibrator.frame().copyTo(image);
-      put_text(image, {10, 10}, calibrator.debug_text());
-      cv::imshow(calibrator.device().device_path, image);
+      frames[i]->image.copyTo(image);
+      put_text(
+        image,
+        {10, 10},
+        frames[i]->debug_text +
+          "fps: " + std::to_string(fps[i]) + '\n' +
+          "skew: " + std::to_string(skew_ms) + "ms\n" +
+          "views: " + std::to_string(calibration.view_count()) + '\n'
+      );
+      cv::imshow(calibrators[i].device().device_path, image);
+    }
+  }
+
+  for (CharucoCalibrator& calibrator : calibrators) calibrator.stop_worker();
+}
+
+/**
+ * Orients the cameras from their recorded videos, which must have been
+ * recorded together so the same frame of each was seen at the same time.
+ */
+bool run_video_orientation(
+  const std::vector<CharucoCalibrator>& calibrators,
+  const CalibrationTarget& target
+) {
+  // Looking for the target in every frame mostly adds time, neighbouring
+  // frames hardly differ.
+  constexpr double SAMPLE_FPS = 10.0;
+
+  ExtrinsicCalibration calibration{get_parameters(calibrators), target};
+  for (std::size_t i = 0; i < calibrators.size(); ++i) {
+    const std::filesystem::path& video_path =
+      calibrators[i].device().device_path;
+    VideoReader reader{video_path};
+    const std::size_t step = std::max<std::size_t>(
+      1,
+      std::lround(reader.fps() / SAMPLE_FPS)
+    );
+    for (std::size_t frame = 0; ; ++frame) {
+      std::optional<cv::Mat> image = reader.read();
+      if (!image) break;
+      if (frame % step != 0) continue;
+      if (std::optional<TargetView> view = target.detect(*image)) {
+        calibration.add_view(i, frame, *view);
+      }
     }
   }
+  std::cout
+    << "Target found in " << calibration.view_count() << " views."
+    << std::endl;
+  return solve_orientation(calibration, calibrators);
 }
 
-int main() {
-  std::vector<CharucoCalibrator> calibrators = get_calibrators();
-  run_camera_calibration(calibrators);
+/**
+ * Calibrates the intrinsics of every camera from its recorded video in one
+ * pass, saving them as they are found. Returns false if any camera failed.
+ */
+bool run_video_calibration(std::vector<CharucoCalibrator>& calibrators) {
+  bool all_calibrated = true;
+  for (CharucoCalibrator& calibrator : calibrators) {
+    const std::filesystem::path& video_path = calibrator.device().device_path;
+    const auto start = steady_clock::now();
+    try {
+      const VideoCalibration calibration = calibrate_from_video(video_path);
+      calibrator.set_intrinsics(calibration.intrinsics);
+      save_camera_parameters(
+        calibrator.parameters(),
+        calibrator.calibration_path()
+      );
+      std::cout
+        << video_path << ": board found in " << calibration.detections
+        << " of " << calibration.frames_scanned << " frames checked, "
+        << calibration.views.size() << " views calibrated with "
+        << calibration.intrinsics.error << " average error in "
+        << to_hms(steady_clock::now() - start) << '.' << std::endl;
+    } catch (const std::exception& error) {
+      std::cout << video_path << ": " << error.what() << std::endl;
+      all_calibrated = false;
+    }
+  }
+  return all_calibrated;
+}
+
+int main(int argc, char* argv[]) {
+  // Calibrates from the given videos, or else from every plugged in camera.
+  // With --auto the videos are calibrated without any interaction. With
+  // --cube the cameras are oriented with the charuco cube instead of the
+  // board.
+  bool automatic = false;
+  bool cube = false;
+  std::vector<std::filesystem::path> video_paths;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string_view{argv[i]} == "--auto") {
+      automatic = true;
+    } else if (std::string_view{argv[i]} == "--cube") {
+      cube = true;
+    } else {
+      video_paths.emplace_back(argv[i]);
+    }
+  }
+  if (automatic && video_paths.empty()) {
+    std::cout << "Usage: calibrator --auto [--cube] VIDEO..." << std::endl;
+    return 1;
+  }
+
+  const std::unique_ptr<TracingSession> tracing =
+    TracingSession::from_environment();
+  std::vector<CharucoCalibrator> calibrators = get_calibrators(video_paths);
+  if (automatic) {
+    if (!run_video_calibration(calibrators)) return 1;
+  } else {
+    run_camera_calibration(calibrators);
+  }
 
   for (const CharucoCalibrator& calibrator : calibrators) {
     if (!calibrator.calibrated()) {
@@ -414,6 +802,13 @@ int main() {
     }
   }
 
+  const CalibrationTarget target =
+    cube ? CalibrationTarget::cube() : CalibrationTarget::board();
+  if (automatic) {
+    std::cout << "Orienting cameras from video." << std::endl;
+    return run_video_orientation(calibrators, target) ? 0 : 1;
+  }
+
   std::cout << "Running camera orientation." << std::endl;
-  run_camera_orientation(calibrators);
+  run_camera_orientation(calibrators, target);
 }
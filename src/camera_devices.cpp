@@ -0,0 +1,310 @@
+#include "src/camera_devices.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/videodev2.h>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/ioctl.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+namespace fs = std::filesystem;
+
+constexpr std::string_view NODE_PREFIX = "video";
+
+int xioctl(int fd, unsigned long request, void* arg) {
+  int res;
+  do {
+    res = ::ioctl(fd, request, arg);
+  } while (res == -1 && errno == EINTR);
+  return res;
+}
+
+/**
+ * A device opened just long enough to query it.
+ */
+class DeviceFile {
+public:
+  explicit DeviceFile(const fs::path& path):
+    _fd{::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC)}
+  {}
+  ~DeviceFile() {
+    if (_fd >= 0) ::close(_fd);
+  }
+  DeviceFile(const DeviceFile&) = delete;
+  DeviceFile(DeviceFile&&) = delete;
+  DeviceFile& operator=(const DeviceFile&) = delete;
+  DeviceFile& operator=(DeviceFile&&) = delete;
+
+  int fd() const { return _fd; }
+
+private:
+  int _fd;
+};
+
+/**
+ * Camera ID of a node named like "video3".
+ */
+std::optional<int> parse_camera_id(std::string_view name) {
+  if (!name.starts_with(NODE_PREFIX)) return std::nullopt;
+  name.remove_prefix(NODE_PREFIX.size());
+  int camera_id = 0;
+  const auto [end, error] =
+    std::from_chars(name.data(), name.data() + name.size(), camera_id);
+  if (error != std::errc{} || end != name.data() + name.size()) {
+    return std::nullopt;
+  }
+  return camera_id;
+}
+
+/**
+ * Sysfs device a video4linux node belongs to, or empty if it has none.
+ */
+fs::path bus_location(const fs::path& node) {
+  std::error_code error;
+  fs::path location = fs::canonical(node / "device", error);
+  if (error) return {};
+  return location;
+}
+
+double max_fps(int fd, std::uint32_t fourcc, cv::Size image_size) {
+  ::v4l2_frmivalenum interval{};
+  interval.pixel_format = fourcc;
+  interval.width = static_cast<std::uint32_t>(image_size.width);
+  interval.height = static_cast<std::uint32_t>(image_size.height);
+  double fps = 0.0;
+  for (
+    ;
+    xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0;
+    ++interval.index
+  ) {
+    // Stepwise ranges are listed once, by their shortest interval.
+    const bool discrete = interval.type == V4L2_FRMIVAL_TYPE_DISCRETE;
+    const ::v4l2_fract& frame_time =
+      discrete ? interval.discrete : interval.stepwise.min;
+    if (frame_time.numerator > 0) {
+      fps = std::max(
+        fps,
+        static_cast<double>(frame_time.denominator) / frame_time.numerator
+      );
+    }
+    if (!discrete) break;
+  }
+  return fps;
+}
+
+std::vector<CameraMode> query_modes(int fd) {
+  std::vector<CameraMode> modes;
+  ::v4l2_fmtdesc description{};
+  description.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  for (
+    ;
+    xioctl(fd, VIDIOC_ENUM_FMT, &description) == 0;
+    ++description.index
+  ) {
+    ::v4l2_frmsizeenum frame_size{};
+    frame_size.pixel_format = description.pixelformat;
+    for (
+      ;
+      xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frame_size) == 0;
+      ++frame_size.index
+    ) {
+      // Stepwise ranges are listed once, by their largest size.
+      const bool discrete = frame_size.type == V4L2_FRMSIZE_TYPE_DISCRETE;
+      const cv::Size image_size = discrete
+        ? cv::Size{
+          static_cast<int>(frame_size.discrete.width),
+          static_cast<int>(frame_size.discrete.height)
+        }
+        : cv::Size{
+          static_cast<int>(frame_size.stepwise.max_width),
+          static_cast<int>(frame_size.stepwise.max_height)
+        };
+      modes.push_back(CameraMode{
+        .fourcc = description.pixelformat,
+        .image_size = image_size,
+        .fps = max_fps(fd, description.pixelformat, image_size)
+      });
+      if (!discrete) break;
+    }
+  }
+  return modes;
+}
+
+struct Probe {
+  // The node was opened and queried, so the answer is worth keeping.
+  bool answered = false;
+
+  // Empty for nodes that don't capture video, such as metadata nodes.
+  std::optional<CameraInfo> camera;
+};
+
+Probe probe(const fs::path& device_path, int camera_id) {
+  const DeviceFile file{device_path};
+  if (file.fd() == -1) return {};
+  ::v4l2_capability capability{};
+  if (xioctl(file.fd(), VIDIOC_QUERYCAP, &capability) == -1) return {};
+
+  const std::uint32_t caps =
+    (capability.capabilities & V4L2_CAP_DEVICE_CAPS)
+      ? capability.device_caps
+      : capability.capabilities;
+  if ((caps & V4L2_CAP_VIDEO_CAPTURE) == 0) return {.answered = true};
+  return {
+    .answered = true,
+    .camera = CameraInfo{
+      .device = {
+        .device_path = device_path,
+        .camera_id = camera_id,
+        .name{reinterpret_cast<const char*>(capability.card)}
+      },
+      .driver{reinterpret_cast<const char*>(capability.driver)},
+      .bus_info{reinterpret_cast<const char*>(capability.bus_info)},
+      .modes = query_modes(file.fd())
+    }
+  };
+}
+
+}
+
+CameraEnumerator::CameraEnumerator(CameraEnumeratorOptions options):
+  _options{std::move(options)}
+{}
+
+CameraEnumerator& CameraEnumerator::global() {
+  static CameraEnumerator enumerator;
+  return enumerator;
+}
+
+std::vector<CameraInfo> CameraEnumerator::cameras() {
+  struct Node {
+    fs::path device_path;
+    fs::path bus_location;
+    int camera_id;
+  };
+  std::vector<Node> nodes;
+  std::error_code error;
+  for (
+    const fs::directory_entry& entry :
+      fs::directory_iterator{_options.sysfs_directory, error}
+  ) {
+    const std::string name = entry.path().filename().string();
+    const std::optional<int> camera_id = parse_camera_id(name);
+    if (!camera_id) continue;
+    nodes.push_back(Node{
+      .device_path = _options.device_directory / name,
+      .bus_location = bus_location(entry.path()),
+      .camera_id = *camera_id
+    });
+  }
+
+  // Held throughout so callers racing at startup share one round of probes.
+  std::lock_guard<std::mutex> lock{_mutex};
+  const auto is_cached = [this](const Node& node) {
+    auto itr = _entries.find(node.device_path);
+    return itr != _entries.end() &&
+      itr->second.bus_location == node.bus_location;
+  };
+  std::vector<const Node*> stale;
+  for (const Node& node : nodes) {
+    if (!is_cached(node)) stale.push_back(&node);
+  }
+
+  std::vector<Probe> probes(stale.size());
+  std::vector<std::thread> threads;
+  threads.reserve(stale.size());
+  for (std::size_t i = 0; i < stale.size(); ++i) {
+    threads.emplace_back([&probes, &stale, i]() {
+      probes[i] = probe(stale[i]->device_path, stale[i]->camera_id);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  // Unplugged nodes are forgotten along with any that didn't answer.
+  std::map<fs::path, Entry> entries;
+  for (const Node& node : nodes) {
+    if (is_cached(node)) {
+      entries.insert(_entries.extract(node.device_path));
+    }
+  }
+  for (std::size_t i = 0; i < stale.size(); ++i) {
+    if (!probes[i].answered) continue;
+    entries[stale[i]->device_path] = Entry{
+      .bus_location = stale[i]->bus_location,
+      .camera = std::move(probes[i].camera)
+    };
+  }
+  _entries = std::move(entries);
+
+  std::vector<CameraInfo> cameras;
+  for (const auto& [device_path, entry] : _entries) {
+    if (entry.camera) cameras.push_back(*entry.camera);
+  }
+  std::sort(
+    cameras.begin(),
+    cameras.end(),
+    [](const CameraInfo& a, const CameraInfo& b) {
+      return a.device.camera_id < b.device.camera_id;
+    }
+  );
+  return cameras;
+}
+
+void CameraEnumerator::clear() {
+  std::lock_guard<std::mutex> lock{_mutex};
+  _entries.clear();
+}
+
+std::vector<CameraDevice> get_camera_devices() {
+  std::vector<CameraDevice> devices;
+  for (CameraInfo& camera : CameraEnumerator::global().cameras()) {
+    devices.push_back(std::move(camera.device));
+  }
+  return devices;
+}
+
+std::string fourcc_name(std::uint32_t fourcc) {
+  std::string name;
+  for (int shift = 0; shift < 32; shift += 8) {
+    name.push_back(static_cast<char>((fourcc >> shift) & 0xff));
+  }
+  return name;
+}
+
+V4L2CameraOptions negotiate_mode(
+  const CameraInfo& camera,
+  V4L2CameraOptions options
+) {
+  std::optional<PixelFormat> best_format;
+  double best_fps = 0.0;
+  for (PixelFormat format : options.formats) {
+    for (const CameraMode& mode : camera.modes) {
+      if (mode.fourcc != to_fourcc(format)) continue;
+      if (mode.image_size != options.image_size) continue;
+      const double fps = std::min(mode.fps, options.fps);
+      if (!best_format || fps > best_fps) {
+        best_format = format;
+        best_fps = fps;
+      }
+    }
+  }
+  if (!best_format) return options;
+
+  options.formats = {*best_format};
+  // Drivers that don't list their frame rates are asked for the requested
+  // one.
+  if (best_fps > 0.0) options.fps = best_fps;
+  return options;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/cameras.h"
+#include "src/v4l2_camera.h"
+
+/**
+ * An image size a camera can capture in a pixel format.
+ */
+struct CameraMode {
+  // V4L2 fourcc of the pixel format, such as `V4L2_PIX_FMT_MJPEG`.
+  std::uint32_t fourcc = 0;
+  cv::Size image_size;
+
+  // Highest frame rate offered at this size, or 0 if the driver won't say.
+  double fps = 0.0;
+};
+
+struct CameraInfo {
+  CameraDevice device;
+  std::string driver;
+
+  // Where the camera is plugged in, such as "usb-0000:00:14.0-2".
+  std::string bus_info;
+
+  std::vector<CameraMode> modes;
+};
+
+struct CameraEnumeratorOptions {
+  std::filesystem::path sysfs_directory = "/sys/class/video4linux";
+  std::filesystem::path device_directory = "/dev";
+};
+
+/**
+ * Lists the video capture devices on the machine.
+ *
+ * Nodes are found through sysfs rather than by scanning `/dev`. Each new node
+ * is opened once, on its own thread alongside the others, to query its
+ * capabilities and modes, then closed again. Results are kept for as long as
+ * the node's path and the bus location sysfs reports for it stay the same,
+ * so listing again only opens nodes that have appeared or moved.
+ *
+ * Nodes that cannot be opened or queried, such as one held exclusively by
+ * another process, are left out of the list and tried again next time.
+ */
+class CameraEnumerator {
+public:
+  explicit CameraEnumerator(CameraEnumeratorOptions options = {});
+  ~CameraEnumerator() = default;
+  CameraEnumerator(const CameraEnumerator&) = delete;
+  CameraEnumerator(CameraEnumerator&&) = delete;
+  CameraEnumerator& operator=(const CameraEnumerator&) = delete;
+  CameraEnumerator& operator=(CameraEnumerator&&) = delete;
+
+  /**
+   * The enumerator shared by the whole process.
+   */
+  static CameraEnumerator& global();
+
+  /**
+   * Capture devices currently plugged in, ordered by camera id.
+   */
+  std::vector<CameraInfo> cameras();
+
+  /**
+   * Forgets every device, so the next listing queries them all again.
+   */
+  void clear();
+
+private:
+  struct Entry {
+    // Resolved sysfs device the node belongs to, which moves with the port
+    // the camera is plugged into.
+    std::filesystem::path bus_location;
+
+    // Empty for nodes that don't capture video, such as metadata nodes.
+    std::optional<CameraInfo> camera;
+  };
+
+  CameraEnumeratorOptions _options;
+  std::mutex _mutex;
+  std::map<std::filesystem::path, Entry> _entries;
+};
+
+/**
+ * Fetches the ID and paths of webcams plugged into the machine.
+ */
+std::vector<CameraDevice> get_camera_devices();
+
+/**
+ * Name of a fourcc, such as "MJPG".
+ */
+std::string fourcc_name(std::uint32_t fourcc);
+
+/**
+ * Narrows `options` to the camera's fastest mode at the requested image size.
+ *
+ * Of the requested formats, the one reaching the highest frame rate up to
+ * the requested one is kept, earlier formats winning ties, and the frame
+ * rate is lowered to what it can reach. Options are returned unchanged when
+ * the camera lists none of the formats at that size.
+ */
+V4L2CameraOptions negotiate_mode(
+  const CameraInfo& camera,
+  V4L2CameraOptions options
+);
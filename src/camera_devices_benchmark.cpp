@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/videodev2.h>
+#include <regex>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/camera_devices.h"
+#include "src/cameras.h"
+
+namespace {
+
+/**
+ * Baseline: enumeration as it used to be, matching every entry in /dev
+ * against a regex and opening each video node. The node is closed here so
+ * repeated runs don't run out of file descriptors.
+ */
+void BM_ScanDev(benchmark::State& state) {
+  for (auto _ : state) {
+    std::vector<CameraDevice> cameras;
+    const std::regex video_pattern{"/dev/video(\\d+)"};
+    for (const auto& device : std::filesystem::directory_iterator{"/dev"}) {
+      const std::string path = device.path().string();
+      std::smatch m;
+      if (!std::regex_match(path, m, video_pattern)) continue;
+      const int fd = ::open(path.c_str(), O_RDWR);
+      if (fd < 0) continue;
+      ::v4l2_capability capability;
+      const bool is_capture =
+        ::ioctl(fd, VIDIOC_QUERYCAP, &capability) == 0 &&
+        (capability.device_caps & V4L2_CAP_VIDEO_CAPTURE);
+      ::close(fd);
+      if (!is_capture) continue;
+      cameras.push_back(CameraDevice{
+        .device_path = device.path(),
+        .camera_id = std::stoi(m[1].str()),
+        .name{reinterpret_cast<const char*>(capability.card)}
+      });
+    }
+    benchmark::DoNotOptimize(cameras.data());
+  }
+}
+BENCHMARK(BM_ScanDev)->Unit(benchmark::kMicrosecond);
+
+/**
+ * A fresh enumerator per iteration, as at tool startup. Also lists every
+ * camera's modes.
+ */
+void BM_ListCameras(benchmark::State& state) {
+  std::size_t camera_count = 0;
+  for (auto _ : state) {
+    CameraEnumerator enumerator;
+    const std::vector<CameraInfo> cameras = enumerator.cameras();
+    camera_count = cameras.size();
+    benchmark::DoNotOptimize(cameras.data());
+  }
+  state.counters["cameras"] = static_cast<double>(camera_count);
+}
+BENCHMARK(BM_ListCameras)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/**
+ * Listing again with nothing plugged in or out since the last time.
+ */
+void BM_ListCamerasCached(benchmark::State& state) {
+  CameraEnumerator enumerator;
+  enumerator.cameras();
+  for (auto _ : state) {
+    const std::vector<CameraInfo> cameras = enumerator.cameras();
+    benchmark::DoNotOptimize(cameras.data());
+  }
+}
+BENCHMARK(BM_ListCamerasCached)->Unit(benchmark::kMicrosecond);
+
+}
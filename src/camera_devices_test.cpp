@@ -0,0 +1,171 @@
+#include "src/camera_devices.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <linux/videodev2.h>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/v4l2_camera.h"
+
+namespace {
+
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/camera_devices";
+const cv::Size IMAGE_SIZE{1920, 1080};
+
+/**
+ * Sysfs and /dev look-alikes holding the named nodes. The device files are
+ * plain files, which open fine but answer no V4L2 queries.
+ */
+CameraEnumeratorOptions make_fake_nodes(
+  const std::string& test_name,
+  const std::vector<std::string>& names
+) {
+  const path directory = TEST_DIR / test_name;
+  std::filesystem::remove_all(directory);
+  const CameraEnumeratorOptions options{
+    .sysfs_directory = directory / "sys",
+    .device_directory = directory / "dev"
+  };
+  std::filesystem::create_directories(options.device_directory);
+  for (const std::string& name : names) {
+    std::filesystem::create_directories(options.sysfs_directory / name);
+    std::ofstream{options.device_directory / name} << name;
+  }
+  return options;
+}
+
+std::ptrdiff_t open_fd_count() {
+  return std::distance(
+    std::filesystem::directory_iterator{"/proc/self/fd"},
+    std::filesystem::directory_iterator{}
+  );
+}
+
+CameraInfo make_camera(const std::vector<CameraMode>& modes) {
+  return CameraInfo{
+    .device = {.device_path = "/dev/video0", .camera_id = 0, .name = "test"},
+    .modes = modes
+  };
+}
+
+TEST(CameraEnumerator, ListsNothingWithoutVideo4Linux) {
+  CameraEnumerator enumerator{{.sysfs_directory = TEST_DIR / "missing"}};
+  EXPECT_TRUE(enumerator.cameras().empty());
+}
+
+TEST(CameraEnumerator, SkipsNodesThatAreNotDevices) {
+  CameraEnumerator enumerator{
+    make_fake_nodes("not_devices", {"video0", "video1", "v4l-subdev0"})
+  };
+  EXPECT_TRUE(enumerator.cameras().empty());
+}
+
+TEST(CameraEnumerator, ClosesNodesAfterQuerying) {
+  CameraEnumerator enumerator{
+    make_fake_nodes("closes", {"video0", "video1", "video2", "video3"})
+  };
+  const std::ptrdiff_t before = open_fd_count();
+  for (int i = 0; i < 10; ++i) enumerator.cameras();
+  EXPECT_EQ(open_fd_count(), before);
+}
+
+TEST(CameraEnumerator, ListsVividCameras) {
+  CameraEnumerator enumerator;
+  std::vector<CameraInfo> cameras = enumerator.cameras();
+  auto vivid = std::find_if(
+    cameras.begin(),
+    cameras.end(),
+    [](const CameraInfo& camera) { return camera.driver == "vivid"; }
+  );
+  if (vivid == cameras.end()) GTEST_SKIP() << "vivid driver is not loaded.";
+
+  EXPECT_FALSE(vivid->bus_info.empty());
+  EXPECT_TRUE(std::any_of(
+    vivid->modes.begin(),
+    vivid->modes.end(),
+    [](const CameraMode& mode) {
+      return mode.fourcc == V4L2_PIX_FMT_YUYV &&
+        mode.image_size == cv::Size(640, 480) &&
+        mode.fps > 0.0;
+    }
+  ));
+
+  // Listed again from the cache.
+  const std::vector<CameraInfo> again = enumerator.cameras();
+  ASSERT_EQ(again.size(), cameras.size());
+  for (std::size_t i = 0; i < again.size(); ++i) {
+    EXPECT_EQ(again[i].device.device_path, cameras[i].device.device_path);
+    EXPECT_EQ(again[i].modes.size(), cameras[i].modes.size());
+  }
+}
+
+TEST(NegotiateMode, PicksFastestFormat) {
+  const CameraInfo camera = make_camera({
+    {.fourcc = V4L2_PIX_FMT_YUYV, .image_size = IMAGE_SIZE, .fps = 5.0},
+    {.fourcc = V4L2_PIX_FMT_MJPEG, .image_size = IMAGE_SIZE, .fps = 30.0}
+  });
+  const V4L2CameraOptions options = negotiate_mode(
+    camera,
+    {
+      .image_size = IMAGE_SIZE,
+      .formats = {PixelFormat::YUYV, PixelFormat::MJPEG}
+    }
+  );
+  ASSERT_EQ(options.formats.size(), 1u);
+  EXPECT_EQ(options.formats[0], PixelFormat::MJPEG);
+  EXPECT_EQ(options.fps, 30.0);
+}
+
+TEST(NegotiateMode, PrefersEarlierFormatsWhenFastEnough) {
+  const CameraInfo camera = make_camera({
+    {.fourcc = V4L2_PIX_FMT_MJPEG, .image_size = IMAGE_SIZE, .fps = 30.0},
+    {.fourcc = V4L2_PIX_FMT_YUYV, .image_size = IMAGE_SIZE, .fps = 60.0}
+  });
+  const V4L2CameraOptions options = negotiate_mode(
+    camera,
+    {
+      .image_size = IMAGE_SIZE,
+      .formats = {PixelFormat::MJPEG, PixelFormat::YUYV},
+      .fps = 30.0
+    }
+  );
+  ASSERT_EQ(options.formats.size(), 1u);
+  EXPECT_EQ(options.formats[0], PixelFormat::MJPEG);
+  EXPECT_EQ(options.fps, 30.0);
+}
+
+TEST(NegotiateMode, LowersFrameRateToMode) {
+  const CameraInfo camera = make_camera({
+    {.fourcc = V4L2_PIX_FMT_YUYV, .image_size = IMAGE_SIZE, .fps = 5.0}
+  });
+  const V4L2CameraOptions options =
+    negotiate_mode(camera, {.image_size = IMAGE_SIZE});
+  ASSERT_EQ(options.formats.size(), 1u);
+  EXPECT_EQ(options.formats[0], PixelFormat::YUYV);
+  EXPECT_EQ(options.fps, 5.0);
+}
+
+TEST(NegotiateMode, KeepsOptionsWithoutMatchingMode) {
+  const CameraInfo camera = make_camera({
+    {.fourcc = V4L2_PIX_FMT_MJPEG, .image_size = {1280, 720}, .fps = 30.0}
+  });
+  const V4L2CameraOptions options =
+    negotiate_mode(camera, {.image_size = IMAGE_SIZE});
+  EXPECT_EQ(options.formats.size(), 2u);
+  EXPECT_EQ(options.fps, 30.0);
+}
+
+TEST(FourccName, SpellsOutCode) {
+  EXPECT_EQ(fourcc_name(V4L2_PIX_FMT_MJPEG), "MJPG");
+  EXPECT_EQ(fourcc_name(V4L2_PIX_FMT_YUYV), "YUYV");
+}
+
+}
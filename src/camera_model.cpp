@@ -0,0 +1,64 @@
+#include "src/camera_model.h"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+
+#include "src/cameras.h"
+
+namespace {
+
+/**
+ * Reads a 3-vector stored as 3x1 or 1x3 of either float or double. Missing
+ * vectors, such as the pose of an intrinsics-only calibration, are zero.
+ */
+cv::Vec3d to_vec3d(const cv::Mat& source) {
+  if (source.empty()) return {};
+  cv::Mat values;
+  source.reshape(1, 1).convertTo(values, CV_64F);
+  return {values.at<double>(0), values.at<double>(1), values.at<double>(2)};
+}
+
+}
+
+CameraModel::CameraModel(const CameraParameters& parameters):
+  _distortion{parameters.distortion.clone()},
+  _rotation_vector{to_vec3d(parameters.rotation)},
+  _translation{to_vec3d(parameters.translation)}
+{
+  if (!parameters.matrix.empty()) _matrix = parameters.matrix;
+  _derive();
+}
+
+CameraModel CameraModel::undistorted(const cv::Matx33d& matrix) const {
+  CameraModel model = *this;
+  model._matrix = matrix;
+  model._distortion = cv::Mat{};
+  model._derive();
+  return model;
+}
+
+void CameraModel::_derive() {
+  _inverse_matrix = _matrix.inv();
+  cv::Rodrigues(_rotation_vector, _rotation);
+  _world_center = -(_rotation.t() * _translation);
+
+  cv::Matx34d extrinsics;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      extrinsics(row, col) = _rotation(row, col);
+    }
+    extrinsics(row, 3) = _translation[row];
+  }
+  _projection = _matrix * extrinsics;
+}
+
+cv::Vec3d CameraModel::ray(const cv::Point2f& normalized) const {
+  const cv::Vec3d camera_ray{normalized.x, normalized.y, 1.0};
+  return cv::normalize(_rotation.t() * camera_ray);
+}
+
+cv::Point2d CameraModel::project(const cv::Vec3d& world) const {
+  const cv::Vec4d homogeneous{world[0], world[1], world[2], 1.0};
+  const cv::Vec3d pixel = _projection * homogeneous;
+  return {pixel[0] / pixel[2], pixel[1] / pixel[2]};
+}
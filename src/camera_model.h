@@ -0,0 +1,69 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include "src/cameras.h"
+
+/**
+ * Immutable camera geometry derived once from calibrated `CameraParameters`.
+ *
+ * Rotation and translation map world points into the camera's frame, the
+ * same convention as `cv::projectPoints` and `cv::aruco::estimatePose*`.
+ */
+class CameraModel {
+public:
+  CameraModel() = default;
+  ~CameraModel() = default;
+  CameraModel(const CameraModel&) = default;
+  CameraModel(CameraModel&&) = default;
+  CameraModel& operator=(const CameraModel&) = default;
+  CameraModel& operator=(CameraModel&&) = default;
+
+  explicit CameraModel(const CameraParameters& parameters);
+
+  const cv::Matx33d& matrix() const { return _matrix; }
+  const cv::Matx33d& inverse_matrix() const { return _inverse_matrix; }
+  const cv::Mat& distortion() const { return _distortion; }
+  const cv::Vec3d& rotation_vector() const { return _rotation_vector; }
+  const cv::Matx33d& rotation() const { return _rotation; }
+  const cv::Vec3d& translation() const { return _translation; }
+
+  /**
+   * Full projection `K * [R | t]` from world space to undistorted pixels.
+   */
+  const cv::Matx34d& projection() const { return _projection; }
+
+  /**
+   * Position of the camera's optical center in world space.
+   */
+  const cv::Vec3d& world_center() const { return _world_center; }
+
+  /**
+   * Unit vector in world space pointing from the camera through the given
+   * undistorted point on the normalized image plane.
+   */
+  cv::Vec3d ray(const cv::Point2f& normalized) const;
+
+  /**
+   * Projects a world point into undistorted pixel coordinates.
+   */
+  cv::Point2d project(const cv::Vec3d& world) const;
+
+  /**
+   * Same pose with a new camera matrix and no distortion, for drawing on
+   * images rectified with that matrix.
+   */
+  CameraModel undistorted(const cv::Matx33d& matrix) const;
+
+private:
+  void _derive();
+
+  cv::Matx33d _matrix = cv::Matx33d::eye();
+  cv::Matx33d _inverse_matrix = cv::Matx33d::eye();
+  cv::Mat _distortion;
+  cv::Vec3d _rotation_vector;
+  cv::Matx33d _rotation = cv::Matx33d::eye();
+  cv::Vec3d _translation;
+  cv::Matx34d _projection;
+  cv::Vec3d _world_center;
+};
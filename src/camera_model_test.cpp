@@ -0,0 +1,177 @@
+#include "src/camera_model.h"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/cameras.h"
+
+namespace {
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+double pose_rotation[] = {0.3, -1.1, 0.25};
+double pose_translation[] = {120.0, -45.0, 900.0};
+
+CameraParameters make_parameters() {
+  return CameraParameters{
+    .matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone(),
+    .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone(),
+    .rotation = cv::Mat{3, 1, CV_64F, pose_rotation}.clone(),
+    .translation = cv::Mat{3, 1, CV_64F, pose_translation}.clone()
+  };
+}
+
+/**
+ * Camera position as the projector used to compute it before `CameraModel`:
+ * the translation row vector multiplied by the rotation matrix.
+ */
+cv::Vec3d legacy_world_center(const CameraParameters& params) {
+  cv::Mat rotation;
+  cv::Rodrigues(params.rotation, rotation);
+  cv::Mat translation = params.translation.reshape(1, 1) * rotation;
+  return -cv::Vec3d{
+    translation.at<double>(0, 0),
+    translation.at<double>(0, 1),
+    translation.at<double>(0, 2)
+  };
+}
+
+/**
+ * Ray as the projector used to compute it before `CameraModel`: the
+ * normalized camera ray as a row vector multiplied by the rotation matrix.
+ */
+cv::Vec3d legacy_ray(const CameraParameters& params, cv::Point2f point) {
+  cv::Mat rotation;
+  cv::Rodrigues(params.rotation, rotation);
+  cv::Mat cam_ray = (cv::Mat_<double>(1, 3) << point.x, point.y, 1.0);
+  cv::Mat origin_ray = cam_ray * rotation;
+  return cv::normalize(cv::Vec3d{
+    origin_ray.at<double>(0, 0),
+    origin_ray.at<double>(0, 1),
+    origin_ray.at<double>(0, 2)
+  });
+}
+
+void expect_near(const cv::Vec3d& actual, const cv::Vec3d& expected) {
+  for (int i = 0; i < 3; ++i) EXPECT_NEAR(actual[i], expected[i], 1e-9) << i;
+}
+
+TEST(CameraModel, WorldCenterMatchesLegacy) {
+  const CameraParameters parameters = make_parameters();
+  const CameraModel model{parameters};
+  expect_near(model.world_center(), legacy_world_center(parameters));
+}
+
+TEST(CameraModel, WorldCenterProjectsToCameraOrigin) {
+  const CameraModel model{make_parameters()};
+  const cv::Vec3d camera_space =
+    (model.rotation() * model.world_center()) + model.translation();
+  expect_near(camera_space, {0.0, 0.0, 0.0});
+}
+
+TEST(CameraModel, RayMatchesLegacy) {
+  const CameraParameters parameters = make_parameters();
+  const CameraModel model{parameters};
+  for (const cv::Point2f& point : std::vector<cv::Point2f>{
+    {0.0f, 0.0f}, {0.25f, -0.1f}, {-0.6f, 0.4f}
+  }) {
+    const cv::Vec3d ray = model.ray(point);
+    expect_near(ray, legacy_ray(parameters, point));
+    EXPECT_NEAR(cv::norm(ray), 1.0, 1e-12);
+  }
+}
+
+TEST(CameraModel, RayPassesThroughProjectedPoint) {
+  const CameraModel model{make_parameters()};
+  const cv::Vec3d world{30.0, 80.0, -20.0};
+  const cv::Point2d pixel = model.project(world);
+  const cv::Vec3d normalized =
+    model.inverse_matrix() * cv::Vec3d{pixel.x, pixel.y, 1.0};
+
+  const cv::Vec3d ray = model.ray({
+    static_cast<float>(normalized[0]),
+    static_cast<float>(normalized[1])
+  });
+  const cv::Vec3d expected = cv::normalize(world - model.world_center());
+  for (int i = 0; i < 3; ++i) EXPECT_NEAR(ray[i], expected[i], 1e-6) << i;
+}
+
+TEST(CameraModel, ProjectMatchesProjectPoints) {
+  const CameraParameters parameters = make_parameters();
+  const CameraModel model{parameters};
+  const std::vector<cv::Point3d> world = {
+    {0.0, 0.0, 0.0}, {30.0, 80.0, -20.0}, {-100.0, 15.0, 60.0}
+  };
+  std::vector<cv::Point2d> expected;
+  cv::projectPoints(
+    world,
+    parameters.rotation,
+    parameters.translation,
+    parameters.matrix,
+    cv::Mat{},
+    expected
+  );
+  for (std::size_t i = 0; i < world.size(); ++i) {
+    const cv::Point2d actual = model.project(world[i]);
+    EXPECT_NEAR(actual.x, expected[i].x, 1e-6);
+    EXPECT_NEAR(actual.y, expected[i].y, 1e-6);
+  }
+}
+
+TEST(CameraModel, InverseMatrix) {
+  const CameraModel model{make_parameters()};
+  const cv::Matx33d identity = model.matrix() * model.inverse_matrix();
+  EXPECT_LT(cv::norm(identity - cv::Matx33d::eye()), 1e-12);
+}
+
+TEST(CameraModel, AcceptsFloatRowVectors) {
+  CameraParameters parameters = make_parameters();
+  const CameraModel expected{parameters};
+  parameters.rotation.reshape(1, 1).convertTo(parameters.rotation, CV_32F);
+  parameters.translation.reshape(1, 1).convertTo(
+    parameters.translation,
+    CV_32F
+  );
+  const CameraModel model{parameters};
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(model.world_center()[i], expected.world_center()[i], 1e-3);
+  }
+}
+
+TEST(CameraModel, MissingPoseIsIdentity) {
+  CameraParameters parameters = make_parameters();
+  parameters.rotation = cv::Mat{};
+  parameters.translation = cv::Mat{};
+  const CameraModel model{parameters};
+  expect_near(model.world_center(), {0.0, 0.0, 0.0});
+  expect_near(model.ray({0.0f, 0.0f}), {0.0, 0.0, 1.0});
+}
+
+TEST(CameraModel, Undistorted) {
+  const CameraModel model{make_parameters()};
+  const cv::Matx33d matrix{
+    1000.0, 0.0, 960.0,
+    0.0, 1000.0, 540.0,
+    0.0, 0.0, 1.0
+  };
+  const CameraModel undistorted = model.undistorted(matrix);
+  EXPECT_TRUE(undistorted.distortion().empty());
+  EXPECT_EQ(undistorted.matrix(), matrix);
+  expect_near(undistorted.world_center(), model.world_center());
+  EXPECT_LT(
+    cv::norm(undistorted.inverse_matrix() - matrix.inv()),
+    1e-12
+  );
+}
+
+}
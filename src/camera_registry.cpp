@@ -0,0 +1,280 @@
+#include "src/camera_registry.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "src/camera_model.h"
+#include "src/cameras.h"
+#include "src/files.h"
+
+namespace {
+namespace fs = std::filesystem;
+
+// Bumped whenever the sidecar layout changes so older files get rebuilt.
+constexpr std::uint32_t SIDECAR_VERSION = 1;
+constexpr char SIDECAR_MAGIC[8] = "CARMAPS";
+
+/**
+ * Start of a sidecar, followed by the integer map and then the fractions map
+ * if there is one, each as raw rows.
+ */
+struct SidecarHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t interpolation;
+  std::uint64_t calibration_hash;
+  std::int32_t width;
+  std::int32_t height;
+  std::int32_t has_fractions;
+  std::int32_t reserved;
+  double optimal_matrix[9];
+};
+
+/**
+ * 64-bit FNV-1a. Only meant to notice a file has changed.
+ */
+std::uint64_t hash_bytes(std::string_view bytes) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char byte : bytes) {
+    hash ^= static_cast<unsigned char>(byte);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+std::string read_file(const fs::path& path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error("Failed to read calibration " + path.string());
+  }
+  return {
+    std::istreambuf_iterator<char>{file},
+    std::istreambuf_iterator<char>{}
+  };
+}
+
+std::string_view interpolation_name(Interpolation interpolation) {
+  switch (interpolation) {
+    case Interpolation::NEAREST: return "nearest";
+    case Interpolation::BILINEAR: return "bilinear";
+    case Interpolation::CUBIC: return "cubic";
+  }
+  throw std::invalid_argument("Unknown interpolation.");
+}
+
+bool read_data(std::istream& file, cv::Mat& mat) {
+  return static_cast<bool>(file.read(
+    reinterpret_cast<char*>(mat.data),
+    static_cast<std::streamsize>(mat.total() * mat.elemSize())
+  ));
+}
+
+void write_data(std::ostream& file, const cv::Mat& mat) {
+  const cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+  file.write(
+    reinterpret_cast<const char*>(continuous.data),
+    static_cast<std::streamsize>(continuous.total() * continuous.elemSize())
+  );
+}
+
+}
+
+struct CameraRegistry::Camera {
+  std::once_flag loaded;
+  CameraParameters parameters;
+  CameraModel model;
+  std::uint64_t calibration_hash = 0;
+};
+
+struct CameraRegistry::Rectification {
+  std::once_flag built;
+  Rectifier rectifier;
+};
+
+CameraRegistry::CameraRegistry(CameraRegistryOptions options):
+  _options{std::move(options)}
+{}
+
+CameraRegistry::~CameraRegistry() = default;
+
+CameraRegistry& CameraRegistry::global() {
+  static CameraRegistry registry{{
+    .cache_directory = get_calibration_directory_path() / "cache"
+  }};
+  return registry;
+}
+
+const CameraParameters& CameraRegistry::parameters(
+  const fs::path& calibration_file
+) {
+  return _camera(fs::weakly_canonical(calibration_file)).parameters;
+}
+
+const CameraModel& CameraRegistry::model(const fs::path& calibration_file) {
+  return _camera(fs::weakly_canonical(calibration_file)).model;
+}
+
+const Rectifier& CameraRegistry::rectifier(
+  const fs::path& calibration_file,
+  cv::Size image_size
+) {
+  const fs::path key = fs::weakly_canonical(calibration_file);
+  const Camera& camera = _camera(key);
+  Rectification* rectification = nullptr;
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    std::unique_ptr<Rectification>& entry =
+      _rectifications[{key, image_size.width, image_size.height}];
+    if (!entry) entry = std::make_unique<Rectification>();
+    rectification = entry.get();
+  }
+  std::call_once(rectification->built, [&]() {
+    rectification->rectifier = _load_rectifier(camera, key, image_size);
+  });
+  return rectification->rectifier;
+}
+
+fs::path CameraRegistry::sidecar_path(
+  const fs::path& calibration_file,
+  cv::Size image_size
+) const {
+  // Calibrations in different directories may share a name, such as each
+  // episode camera's calibration.json, so the full path is hashed in too.
+  const fs::path key = fs::weakly_canonical(calibration_file);
+  std::stringstream name;
+  name << key.stem().string() << '-'
+    << std::hex << std::setw(16) << std::setfill('0')
+    << hash_bytes(key.string()) << std::dec << '-'
+    << image_size.width << 'x' << image_size.height << '-'
+    << interpolation_name(_options.rectifier.interpolation) << ".maps";
+  return _options.cache_directory / name.str();
+}
+
+CameraRegistry::Camera& CameraRegistry::_camera(const fs::path& key) {
+  Camera* camera = nullptr;
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    std::unique_ptr<Camera>& entry = _cameras[key];
+    if (!entry) entry = std::make_unique<Camera>();
+    camera = entry.get();
+  }
+  // A camera that fails to load is tried again on the next lookup.
+  std::call_once(camera->loaded, [&]() {
+    camera->calibration_hash = hash_bytes(read_file(key));
+    camera->parameters = load_camera_parameters(key);
+    camera->model = CameraModel{camera->parameters};
+  });
+  return *camera;
+}
+
+Rectifier CameraRegistry::_load_rectifier(
+  const Camera& camera,
+  const fs::path& key,
+  cv::Size image_size
+) const {
+  if (_options.cache_directory.empty()) {
+    return Rectifier{camera.parameters, image_size, _options.rectifier};
+  }
+
+  const fs::path sidecar = sidecar_path(key, image_size);
+  std::optional<Rectifier> cached = _read_sidecar(camera, sidecar, image_size);
+  if (cached) return std::move(*cached);
+  Rectifier rectifier{camera.parameters, image_size, _options.rectifier};
+  _write_sidecar(camera, sidecar, rectifier);
+  return rectifier;
+}
+
+std::optional<Rectifier> CameraRegistry::_read_sidecar(
+  const Camera& camera,
+  const fs::path& sidecar,
+  cv::Size image_size
+) const {
+  std::ifstream file{sidecar, std::ios::binary};
+  SidecarHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    return std::nullopt;
+  }
+  const bool matches =
+    std::memcmp(header.magic, SIDECAR_MAGIC, sizeof(header.magic)) == 0 &&
+    header.version == SIDECAR_VERSION &&
+    header.calibration_hash == camera.calibration_hash &&
+    header.interpolation ==
+      static_cast<std::uint32_t>(_options.rectifier.interpolation) &&
+    header.width == image_size.width &&
+    header.height == image_size.height;
+  if (!matches) return std::nullopt;
+
+  Rectifier rectifier;
+  rectifier._parameters = camera.parameters;
+  rectifier._options = _options.rectifier;
+  rectifier._optimal_matrix =
+    cv::Mat{3, 3, CV_64F, header.optimal_matrix}.clone();
+  rectifier._undistorted_map_1.create(image_size, CV_16SC2);
+  if (!read_data(file, rectifier._undistorted_map_1)) return std::nullopt;
+  if (header.has_fractions != 0) {
+    rectifier._undistorted_map_2.create(image_size, CV_16UC1);
+    if (!read_data(file, rectifier._undistorted_map_2)) return std::nullopt;
+  }
+  return rectifier;
+}
+
+void CameraRegistry::_write_sidecar(
+  const Camera& camera,
+  const fs::path& sidecar,
+  const Rectifier& rectifier
+) const {
+  // The maps are already built, so a cache that cannot be written only
+  // makes the next start slower.
+  std::error_code error;
+  fs::create_directories(sidecar.parent_path(), error);
+  if (error) return;
+
+  SidecarHeader header{};
+  std::memcpy(header.magic, SIDECAR_MAGIC, sizeof(header.magic));
+  header.version = SIDECAR_VERSION;
+  header.interpolation =
+    static_cast<std::uint32_t>(rectifier._options.interpolation);
+  header.calibration_hash = camera.calibration_hash;
+  header.width = rectifier._undistorted_map_1.cols;
+  header.height = rectifier._undistorted_map_1.rows;
+  header.has_fractions = rectifier._undistorted_map_2.empty() ? 0 : 1;
+  cv::Mat optimal_matrix;
+  rectifier._optimal_matrix.convertTo(optimal_matrix, CV_64F);
+  std::memcpy(
+    header.optimal_matrix,
+    optimal_matrix.ptr<double>(),
+    sizeof(header.optimal_matrix)
+  );
+
+  // Written aside and renamed into place so a reader never sees half a file.
+  fs::path partial = sidecar;
+  partial += ".partial";
+  {
+    std::ofstream file{partial, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_data(file, rectifier._undistorted_map_1);
+    if (header.has_fractions != 0) {
+      write_data(file, rectifier._undistorted_map_2);
+    }
+    if (!file) {
+      file.close();
+      fs::remove(partial, error);
+      return;
+    }
+  }
+  fs::rename(partial, sidecar, error);
+}
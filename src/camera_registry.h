@@ -0,0 +1,115 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <tuple>
+
+#include "src/camera_model.h"
+#include "src/cameras.h"
+
+struct CameraRegistryOptions {
+  // Where rectification maps are kept between runs. Empty to only keep them
+  // in memory.
+  std::filesystem::path cache_directory;
+
+  RectifierOptions rectifier;
+};
+
+/**
+ * Loads each camera's calibration once per process and memoizes what is
+ * derived from it.
+ *
+ * Cameras are identified by their calibration file. Models are derived once
+ * per camera and rectifiers once per camera and image size. With a cache
+ * directory the rectification maps are also written to a binary sidecar
+ * alongside a hash of the calibration file they came from, and read back
+ * instead of being rebuilt as long as the calibration has not changed.
+ *
+ * Everything handed out lives as long as the registry and is safe to share
+ * between threads. Cameras being loaded at the same time on different
+ * threads do not wait on each other.
+ */
+class CameraRegistry {
+public:
+  explicit CameraRegistry(CameraRegistryOptions options = {});
+  ~CameraRegistry();
+  CameraRegistry(const CameraRegistry&) = delete;
+  CameraRegistry(CameraRegistry&&) = delete;
+  CameraRegistry& operator=(const CameraRegistry&) = delete;
+  CameraRegistry& operator=(CameraRegistry&&) = delete;
+
+  /**
+   * The registry shared by the whole process, caching maps next to the
+   * calibrations.
+   */
+  static CameraRegistry& global();
+
+  const CameraParameters& parameters(
+    const std::filesystem::path& calibration_file
+  );
+  const CameraModel& model(const std::filesystem::path& calibration_file);
+
+  /**
+   * Rectifier for images of the given size, with the registry's options.
+   */
+  const Rectifier& rectifier(
+    const std::filesystem::path& calibration_file,
+    cv::Size image_size
+  );
+
+  /**
+   * Camera matrix of the images rectified for the given size.
+   */
+  const cv::Mat& optimal_matrix(
+    const std::filesystem::path& calibration_file,
+    cv::Size image_size
+  ) {
+    return rectifier(calibration_file, image_size).optimal_matrix();
+  }
+
+  const CameraRegistryOptions& options() const { return _options; }
+
+  /**
+   * Path of the sidecar holding the maps for a camera and image size.
+   */
+  std::filesystem::path sidecar_path(
+    const std::filesystem::path& calibration_file,
+    cv::Size image_size
+  ) const;
+
+private:
+  struct Camera;
+  struct Rectification;
+
+  Camera& _camera(const std::filesystem::path& key);
+  Rectifier _load_rectifier(
+    const Camera& camera,
+    const std::filesystem::path& key,
+    cv::Size image_size
+  ) const;
+  std::optional<Rectifier> _read_sidecar(
+    const Camera& camera,
+    const std::filesystem::path& sidecar,
+    cv::Size image_size
+  ) const;
+  void _write_sidecar(
+    const Camera& camera,
+    const std::filesystem::path& sidecar,
+    const Rectifier& rectifier
+  ) const;
+
+  CameraRegistryOptions _options;
+
+  // Guards the maps, not their entries. Each entry is loaded under its own
+  // once flag so slow cameras don't hold up the rest.
+  std::mutex _mutex;
+  std::map<std::filesystem::path, std::unique_ptr<Camera>> _cameras;
+  std::map<
+    std::tuple<std::filesystem::path, int, int>,
+    std::unique_ptr<Rectification>
+  > _rectifications;
+};
@@ -0,0 +1,142 @@
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/camera_registry.h"
+#include "src/cameras.h"
+
+namespace {
+
+const std::filesystem::path BENCHMARK_DIR =
+  "/tmp/benchmark/ar/camera_registry";
+const std::filesystem::path CACHE_DIR = BENCHMARK_DIR / "cache";
+const cv::Size IMAGE_SIZE{1920, 1080};
+constexpr int CAMERA_COUNT = 8;
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+/**
+ * Calibration files for 8 cameras, written once.
+ */
+const std::vector<std::filesystem::path>& calibrations() {
+  static const std::vector<std::filesystem::path> files = []() {
+    std::filesystem::create_directories(BENCHMARK_DIR);
+    std::vector<std::filesystem::path> files;
+    for (int i = 0; i < CAMERA_COUNT; ++i) {
+      const std::filesystem::path file =
+        BENCHMARK_DIR / (std::to_string(i) + ".yml");
+      save_camera_parameters(
+        CameraParameters{
+          .device = {.device_path = "/dev/video" + std::to_string(i)},
+          .matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone(),
+          .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone(),
+          .rotation = cv::Mat::zeros(3, 1, CV_64F),
+          .translation = cv::Mat::zeros(3, 1, CV_64F)
+        },
+        file
+      );
+      files.push_back(file);
+    }
+    return files;
+  }();
+  return files;
+}
+
+/**
+ * Baseline: startup as it used to be, parsing each calibration and building
+ * its maps from scratch.
+ */
+void BM_StartupUncached(benchmark::State& state) {
+  for (auto _ : state) {
+    for (const std::filesystem::path& file : calibrations()) {
+      const CameraParameters parameters = load_camera_parameters(file);
+      const Rectifier rectifier{parameters, IMAGE_SIZE};
+      benchmark::DoNotOptimize(rectifier.optimal_matrix().data);
+    }
+  }
+  state.counters["cameras"] = CAMERA_COUNT;
+}
+BENCHMARK(BM_StartupUncached)->Unit(benchmark::kMillisecond);
+
+/**
+ * A fresh registry per iteration reading the maps back from sidecars.
+ */
+void BM_StartupFromSidecars(benchmark::State& state) {
+  const CameraRegistryOptions options{.cache_directory = CACHE_DIR};
+  {
+    CameraRegistry warm_up{options};
+    for (const auto& file : calibrations()) {
+      warm_up.rectifier(file, IMAGE_SIZE);
+    }
+  }
+  for (auto _ : state) {
+    CameraRegistry registry{options};
+    for (const std::filesystem::path& file : calibrations()) {
+      benchmark::DoNotOptimize(
+        registry.rectifier(file, IMAGE_SIZE).optimal_matrix().data
+      );
+    }
+  }
+  state.counters["cameras"] = CAMERA_COUNT;
+}
+BENCHMARK(BM_StartupFromSidecars)->Unit(benchmark::kMillisecond);
+
+/**
+ * As above with each camera loaded on its own thread, as the pipeline
+ * starting its cameras does.
+ */
+void BM_StartupFromSidecarsParallel(benchmark::State& state) {
+  const CameraRegistryOptions options{.cache_directory = CACHE_DIR};
+  {
+    CameraRegistry warm_up{options};
+    for (const auto& file : calibrations()) {
+      warm_up.rectifier(file, IMAGE_SIZE);
+    }
+  }
+  for (auto _ : state) {
+    CameraRegistry registry{options};
+    std::vector<std::thread> threads;
+    for (const std::filesystem::path& file : calibrations()) {
+      threads.emplace_back([&registry, &file]() {
+        benchmark::DoNotOptimize(
+          registry.rectifier(file, IMAGE_SIZE).optimal_matrix().data
+        );
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+  }
+  state.counters["cameras"] = CAMERA_COUNT;
+}
+BENCHMARK(BM_StartupFromSidecarsParallel)
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+/**
+ * Every lookup after the first, which no longer touches the disk.
+ */
+void BM_MemoizedLookup(benchmark::State& state) {
+  CameraRegistry registry;
+  for (const auto& file : calibrations()) registry.rectifier(file, IMAGE_SIZE);
+  for (auto _ : state) {
+    for (const std::filesystem::path& file : calibrations()) {
+      benchmark::DoNotOptimize(&registry.model(file));
+      benchmark::DoNotOptimize(&registry.rectifier(file, IMAGE_SIZE));
+    }
+  }
+  state.counters["cameras"] = CAMERA_COUNT;
+}
+BENCHMARK(BM_MemoizedLookup)->Unit(benchmark::kMicrosecond);
+
+}
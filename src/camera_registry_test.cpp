@@ -0,0 +1,193 @@
+#include "src/camera_registry.h"
+
+#include <chrono>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/camera_model.h"
+#include "src/cameras.h"
+
+namespace {
+
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/camera_registry";
+const cv::Size IMAGE_SIZE{320, 240};
+
+CameraParameters make_camera(double k1 = -0.2) {
+  return CameraParameters{
+    .device = {.device_path = "/dev/video0", .camera_id = 0, .name = "test"},
+    .matrix = (cv::Mat_<double>(3, 3) <<
+      250, 0, IMAGE_SIZE.width / 2.0,
+      0, 250, IMAGE_SIZE.height / 2.0,
+      0, 0, 1
+    ),
+    .distortion = (cv::Mat_<double>(1, 5) << k1, 0.05, 0, 0, 0),
+    .rotation = (cv::Mat_<double>(3, 1) << 0.1, -0.2, 0.3),
+    .translation = (cv::Mat_<double>(3, 1) << 0.5, 0.25, 2.0)
+  };
+}
+
+/**
+ * An empty directory for a single test.
+ */
+path make_directory(const std::string& name) {
+  const path directory = TEST_DIR / name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+path write_calibration(
+  const path& directory,
+  const CameraParameters& parameters,
+  const std::string& name = "camera.yml"
+) {
+  const path file = directory / name;
+  save_camera_parameters(parameters, file);
+  return file;
+}
+
+cv::Mat make_image() {
+  cv::Mat image{IMAGE_SIZE, CV_8UC3};
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  return image;
+}
+
+double difference(const cv::Mat& a, const cv::Mat& b) {
+  return cv::norm(a, b, cv::NORM_INF);
+}
+
+TEST(CameraRegistry, LoadsEachCameraOnce) {
+  const path directory = make_directory("loads_once");
+  const path file = write_calibration(directory, make_camera());
+  CameraRegistry registry;
+
+  const CameraParameters& parameters = registry.parameters(file);
+  EXPECT_EQ(&registry.parameters(file), &parameters);
+  EXPECT_EQ(&registry.parameters(directory / "." / "camera.yml"), &parameters);
+  EXPECT_EQ(difference(parameters.matrix, make_camera().matrix), 0);
+
+  const CameraModel& model = registry.model(file);
+  EXPECT_EQ(&registry.model(file), &model);
+  EXPECT_EQ(model.projection(), CameraModel{make_camera()}.projection());
+}
+
+TEST(CameraRegistry, ReadsJsonCalibrations) {
+  const path directory = make_directory("json");
+  const path file =
+    write_calibration(directory, make_camera(), "calibration.json");
+  CameraRegistry registry;
+  const CameraParameters& parameters = registry.parameters(file);
+  EXPECT_EQ(parameters.device.name, "test");
+  EXPECT_EQ(difference(parameters.distortion, make_camera().distortion), 0);
+}
+
+TEST(CameraRegistry, RequiresCalibration) {
+  const path directory = make_directory("missing");
+  CameraRegistry registry;
+  EXPECT_THROW(
+    registry.parameters(directory / "camera.yml"),
+    std::runtime_error
+  );
+}
+
+TEST(CameraRegistry, RectifiersArePerImageSize) {
+  const path directory = make_directory("per_size");
+  const path file = write_calibration(directory, make_camera());
+  CameraRegistry registry;
+
+  const Rectifier& rectifier = registry.rectifier(file, IMAGE_SIZE);
+  EXPECT_EQ(&registry.rectifier(file, IMAGE_SIZE), &rectifier);
+  EXPECT_EQ(
+    &registry.optimal_matrix(file, IMAGE_SIZE),
+    &rectifier.optimal_matrix()
+  );
+
+  const cv::Size half_size{IMAGE_SIZE.width / 2, IMAGE_SIZE.height / 2};
+  const Rectifier& half = registry.rectifier(file, half_size);
+  EXPECT_NE(&half, &rectifier);
+  cv::Mat image;
+  cv::resize(make_image(), image, half_size);
+  EXPECT_EQ(half.rectify(image).size(), half_size);
+}
+
+TEST(CameraRegistry, ReadsMapsFromSidecar) {
+  const path directory = make_directory("sidecar");
+  const path file = write_calibration(directory, make_camera());
+  const CameraRegistryOptions options{.cache_directory = directory / "cache"};
+  const cv::Mat image = make_image();
+
+  CameraRegistry building{options};
+  const cv::Mat built = building.rectifier(file, IMAGE_SIZE).rectify(image);
+  const path sidecar = building.sidecar_path(file, IMAGE_SIZE);
+  ASSERT_TRUE(std::filesystem::exists(sidecar));
+
+  // Backdated, so rewriting the sidecar would show in its write time.
+  std::filesystem::last_write_time(
+    sidecar,
+    std::filesystem::last_write_time(sidecar) - std::chrono::hours{1}
+  );
+  const auto written = std::filesystem::last_write_time(sidecar);
+
+  CameraRegistry loading{options};
+  const Rectifier& loaded = loading.rectifier(file, IMAGE_SIZE);
+  EXPECT_EQ(std::filesystem::last_write_time(sidecar), written);
+  EXPECT_EQ(difference(loaded.rectify(image), built), 0);
+  EXPECT_EQ(
+    difference(
+      loaded.optimal_matrix(),
+      building.optimal_matrix(file, IMAGE_SIZE)
+    ),
+    0
+  );
+}
+
+TEST(CameraRegistry, RebuildsMapsForChangedCalibration) {
+  const path directory = make_directory("changed");
+  const path file = write_calibration(directory, make_camera());
+  const CameraRegistryOptions options{.cache_directory = directory / "cache"};
+  const cv::Mat image = make_image();
+  {
+    CameraRegistry registry{options};
+    registry.rectifier(file, IMAGE_SIZE);
+  }
+
+  write_calibration(directory, make_camera(0.1));
+  CameraRegistry registry{options};
+  const cv::Mat expected =
+    Rectifier{make_camera(0.1), IMAGE_SIZE}.rectify(image);
+  EXPECT_EQ(
+    difference(registry.rectifier(file, IMAGE_SIZE).rectify(image), expected),
+    0
+  );
+}
+
+TEST(CameraRegistry, RebuildsTruncatedSidecar) {
+  const path directory = make_directory("truncated");
+  const path file = write_calibration(directory, make_camera());
+  const CameraRegistryOptions options{.cache_directory = directory / "cache"};
+  const cv::Mat image = make_image();
+  path sidecar;
+  {
+    CameraRegistry registry{options};
+    registry.rectifier(file, IMAGE_SIZE);
+    sidecar = registry.sidecar_path(file, IMAGE_SIZE);
+  }
+  const auto size = std::filesystem::file_size(sidecar);
+  std::filesystem::resize_file(sidecar, size / 2);
+
+  CameraRegistry registry{options};
+  const cv::Mat expected = Rectifier{make_camera(), IMAGE_SIZE}.rectify(image);
+  EXPECT_EQ(
+    difference(registry.rectifier(file, IMAGE_SIZE).rectify(image), expected),
+    0
+  );
+  EXPECT_EQ(std::filesystem::file_size(sidecar), size);
+}
+
+}
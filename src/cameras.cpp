@@ -1,20 +1,15 @@
 #include "src/cameras.h"
 
-#include <cstring>
-#include <exception>
-#include <fcntl.h>
 #include <filesystem>
-#include <linux/videodev2.h>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
-#include <regex>
+#include <stdexcept>
 #include <string>
-#include <sys/ioctl.h>
+#include <utility>
 #include <vector>
 
 namespace {
-namespace fs = std::filesystem;
 
 void write(cv::FileStorage& file, const CameraDevice& device) {
   file.write("device_path", device.device_path.string());
@@ -40,6 +35,21 @@ CameraDevice read_device(const cv::FileNode& file) {
   };
 }
 
+int to_cv_interpolation(Interpolation interpolation) {
+  switch (interpolation) {
+    case Interpolation::NEAREST: return cv::INTER_NEAREST;
+    case Interpolation::BILINEAR: return cv::INTER_LINEAR;
+    case Interpolation::CUBIC: return cv::INTER_CUBIC;
+  }
+  throw std::invalid_argument("Unknown interpolation.");
+}
+
+cv::Vec3d to_vec3(const cv::Mat& vector) {
+  cv::Mat values;
+  vector.reshape(1, 3).convertTo(values, CV_64F);
+  return {values.at<double>(0), values.at<double>(1), values.at<double>(2)};
+}
+
 CameraParameters read_parameters(const cv::FileNode& file) {
   return CameraParameters{
     .device{read_device(file["device"])},
@@ -52,44 +62,16 @@ CameraParameters read_parameters(const cv::FileNode& file) {
 
 }
 
-std::vector<CameraDevice> get_camera_devices() {
-  std::vector<CameraDevice> cameras;
-
-  std::regex video_pattern{"/dev/video(\\d+)"};
-  fs::path devices = "/dev";
-  for (const fs::directory_entry& device : fs::directory_iterator(devices)) {
-    const auto& device_path_str = device.path().string();
-    std::smatch m;
-    if (!std::regex_match(device_path_str, m, video_pattern)) continue;
-
-    int device_fd = ::open(device_path_str.c_str(), O_RDWR);
-    if (device_fd < 0) throw std::runtime_error("Failed to open device.");
-
-    v4l2_capability capability;
-    if (::ioctl(device_fd, VIDIOC_QUERYCAP, &capability) < 0) {
-      throw std::runtime_error("Failed to query device capabilities.");
-    }
-    if ((capability.device_caps & V4L2_CAP_VIDEO_CAPTURE) == 0) continue;
-
-    cameras.push_back(CameraDevice{
-      .device_path = device.path(),
-      .camera_id = std::stoi(m[1].str(), 0, 10),
-      .name{reinterpret_cast<const char*>(capability.card)}
-    });
-  }
-
-  cameras.shrink_to_fit();
-  return cameras;
-}
-
 void save_camera_parameters(
   const CameraParameters& parameters,
   const std::filesystem::path& filename
 ) {
-  cv::FileStorage file{
-    filename.string(),
-    cv::FileStorage::WRITE | cv::FileStorage::FORMAT_YAML
-  };
+  // Episode projects keep their calibrations as JSON. Reading picks the
+  // format from the file's contents.
+  const int format = filename.extension() == ".json"
+    ? cv::FileStorage::FORMAT_JSON
+    : cv::FileStorage::FORMAT_YAML;
+  cv::FileStorage file{filename.string(), cv::FileStorage::WRITE | format};
   write(file, parameters);
   file.release();
 }
@@ -102,36 +84,154 @@ CameraParameters load_camera_parameters(const std::filesystem::path& filename) {
   return read_parameters(file.root());
 }
 
-Rectifier::Rectifier(CameraParameters parameters, cv::Size image_size):
-  _parameters{std::move(parameters)}
-{
-  _optimal_matrix = cv::getOptimalNewCameraMatrix(
-    _parameters.matrix,
-    _parameters.distortion,
+Rectifier::Rectifier(
+  CameraParameters parameters,
+  cv::Size image_size,
+  RectifierOptions options
+):
+  Rectifier{
+    parameters,
     image_size,
-    0.0,
-    image_size
-  );
+    options,
+    cv::Mat{},
+    cv::getOptimalNewCameraMatrix(
+      parameters.matrix,
+      parameters.distortion,
+      image_size,
+      0.0,
+      image_size
+    )
+  }
+{}
+
+Rectifier::Rectifier(
+  CameraParameters parameters,
+  cv::Size image_size,
+  RectifierOptions options,
+  const cv::Mat& rotation,
+  cv::Mat new_matrix
+):
+  _parameters{std::move(parameters)},
+  _options{options},
+  _optimal_matrix{std::move(new_matrix)}
+{
+  // Integer source coordinates plus an index into OpenCV's table of
+  // fractional weights, the fast path for every interpolation.
   cv::initUndistortRectifyMap(
     _parameters.matrix,
     _parameters.distortion,
-    cv::noArray(),
+    rotation,
     _optimal_matrix,
     image_size,
     CV_16SC2,
     _undistorted_map_1,
     _undistorted_map_2
   );
+  // Nearest neighbour never reads the fractions.
+  if (_options.interpolation == Interpolation::NEAREST) {
+    _undistorted_map_2 = cv::Mat{};
+  }
 }
 
 cv::Mat Rectifier::rectify(const cv::Mat& image) const {
   cv::Mat rectified;
+  rectify(image, rectified);
+  return rectified;
+}
+
+void Rectifier::rectify(const cv::Mat& image, cv::Mat& rectified) const {
+  rectify(
+    image,
+    rectified,
+    cv::Rect{cv::Point{0, 0}, _undistorted_map_1.size()}
+  );
+}
+
+void Rectifier::rectify(
+  const cv::Mat& image,
+  cv::Mat& rectified,
+  const cv::Rect& roi
+) const {
+  if (image.data == rectified.data) {
+    throw std::invalid_argument("Images cannot be rectified in place.");
+  }
+  const cv::Rect area = roi & cv::Rect{
+    cv::Point{0, 0},
+    _undistorted_map_1.size()
+  };
   cv::remap(
     image,
     rectified,
-    _undistorted_map_1,
-    _undistorted_map_2,
-    cv::INTER_CUBIC
+    _undistorted_map_1(area),
+    _undistorted_map_2.empty() ? cv::Mat{} : _undistorted_map_2(area),
+    to_cv_interpolation(_options.interpolation)
   );
-  return rectified;
+}
+
+StereoRectifier::StereoRectifier(
+  const CameraParameters& left,
+  const CameraParameters& right,
+  cv::Size image_size,
+  RectifierOptions options
+) {
+  if (
+    left.rotation.empty() || left.translation.empty() ||
+    right.rotation.empty() || right.translation.empty()
+  ) {
+    throw std::invalid_argument(
+      "Stereo rectification needs both cameras' extrinsics."
+    );
+  }
+
+  // Pose of the right camera relative to the left one.
+  cv::Matx33d left_rotation;
+  cv::Matx33d right_rotation;
+  cv::Rodrigues(left.rotation, left_rotation);
+  cv::Rodrigues(right.rotation, right_rotation);
+  const cv::Matx33d rotation = right_rotation * left_rotation.t();
+  const cv::Vec3d translation =
+    to_vec3(right.translation) - rotation * to_vec3(left.translation);
+
+  cv::Mat left_rectification;
+  cv::Mat right_rectification;
+  cv::stereoRectify(
+    left.matrix,
+    left.distortion,
+    right.matrix,
+    right.distortion,
+    image_size,
+    rotation,
+    translation,
+    left_rectification,
+    right_rectification,
+    _left_projection,
+    _right_projection,
+    _disparity_to_depth,
+    cv::CALIB_ZERO_DISPARITY,
+    0.0
+  );
+  _left = Rectifier{
+    left,
+    image_size,
+    options,
+    left_rectification,
+    _left_projection.colRange(0, 3).clone()
+  };
+  _right = Rectifier{
+    right,
+    image_size,
+    options,
+    right_rectification,
+    _right_projection.colRange(0, 3).clone()
+  };
+}
+
+void StereoRectifier::rectify(
+  const cv::Mat& left_image,
+  const cv::Mat& right_image,
+  cv::Mat& left_rectified,
+  cv::Mat& right_rectified
+) const {
+  _left.rectify(left_image, left_rectified);
+  _right.rectify(right_image, right_rectified);
 }
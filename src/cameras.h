@@ -21,17 +21,34 @@ struct CameraParameters {
   cv::Mat translation;
 };
 
-/**
- * Fetches the ID and paths of webcams plugged into the machine.
- */
-std::vector<CameraDevice> get_camera_devices();
-
 CameraParameters load_camera_parameters(const std::filesystem::path& filename);
 void save_camera_parameters(
   const CameraParameters& parameters,
   const std::filesystem::path& filename
 );
 
+enum class Interpolation {
+  // Closest source pixel. Fastest, with visibly jagged edges.
+  NEAREST,
+
+  // Fixed-point bilinear over the 2x2 neighbourhood. Plenty for pose input.
+  BILINEAR,
+
+  // Bicubic over the 4x4 neighbourhood. Sharpest and by far the slowest.
+  CUBIC
+};
+
+struct RectifierOptions {
+  Interpolation interpolation = Interpolation::BILINEAR;
+};
+
+/**
+ * Removes lens distortion from a camera's images.
+ *
+ * The maps are built once as fixed-point source coordinates and reused for
+ * every image. Output can go into a buffer the caller keeps, which is only
+ * reallocated if it has the wrong size or type.
+ */
 class Rectifier {
 public:
   Rectifier() = default;
@@ -41,14 +58,109 @@ public:
   Rectifier& operator=(const Rectifier&) = default;
   Rectifier& operator=(Rectifier&&) = default;
 
-  explicit Rectifier(CameraParameters parameters, cv::Size image_size);
+  explicit Rectifier(
+    CameraParameters parameters,
+    cv::Size image_size,
+    RectifierOptions options = {}
+  );
 
   cv::Mat rectify(const cv::Mat& image) const;
   cv::Mat operator()(const cv::Mat& image) const { return rectify(image); }
 
+  /**
+   * Rectifies into `rectified`, reusing its buffer when it fits.
+   */
+  void rectify(const cv::Mat& image, cv::Mat& rectified) const;
+
+  /**
+   * Rectifies only the part of the rectified image within `roi`, writing
+   * just that region into `rectified`.
+   */
+  void rectify(
+    const cv::Mat& image,
+    cv::Mat& rectified,
+    const cv::Rect& roi
+  ) const;
+
+  /**
+   * Camera matrix of the rectified images.
+   */
+  const cv::Mat& optimal_matrix() const { return _optimal_matrix; }
+
+  const RectifierOptions& options() const { return _options; }
+
 private:
+  friend class CameraRegistry;
+  friend class StereoRectifier;
+
+  /**
+   * Builds the maps from an already computed rectification.
+   */
+  Rectifier(
+    CameraParameters parameters,
+    cv::Size image_size,
+    RectifierOptions options,
+    const cv::Mat& rotation,
+    cv::Mat new_matrix
+  );
+
   CameraParameters _parameters;
+  RectifierOptions _options;
   cv::Mat _undistorted_map_1;
   cv::Mat _undistorted_map_2;
   cv::Mat _optimal_matrix;
 };
+
+/**
+ * Rectifies the images of two cameras looking the same way, such as the
+ * OAK-D's mono pair, so that matching points fall on the same row.
+ *
+ * Both cameras' extrinsics must be calibrated in the same world. Their
+ * rectified images share one camera matrix, apart from the right one being
+ * shifted along the baseline.
+ */
+class StereoRectifier {
+public:
+  StereoRectifier() = default;
+  ~StereoRectifier() = default;
+  StereoRectifier(const StereoRectifier&) = default;
+  StereoRectifier(StereoRectifier&&) = default;
+  StereoRectifier& operator=(const StereoRectifier&) = default;
+  StereoRectifier& operator=(StereoRectifier&&) = default;
+
+  StereoRectifier(
+    const CameraParameters& left,
+    const CameraParameters& right,
+    cv::Size image_size,
+    RectifierOptions options = {}
+  );
+
+  void rectify(
+    const cv::Mat& left_image,
+    const cv::Mat& right_image,
+    cv::Mat& left_rectified,
+    cv::Mat& right_rectified
+  ) const;
+
+  const Rectifier& left() const { return _left; }
+  const Rectifier& right() const { return _right; }
+
+  /**
+   * 3x4 projection matrices of the rectified cameras, in the left rectified
+   * camera's coordinates.
+   */
+  const cv::Mat& left_projection() const { return _left_projection; }
+  const cv::Mat& right_projection() const { return _right_projection; }
+
+  /**
+   * 4x4 matrix taking a rectified left pixel and its disparity to a point.
+   */
+  const cv::Mat& disparity_to_depth() const { return _disparity_to_depth; }
+
+private:
+  Rectifier _left;
+  Rectifier _right;
+  cv::Mat _left_projection;
+  cv::Mat _right_projection;
+  cv::Mat _disparity_to_depth;
+};
@@ -0,0 +1,164 @@
+#include <opencv2/core.hpp>
+
+#include "benchmark/benchmark.h"
+#include "src/cameras.h"
+
+namespace {
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+/**
+ * 640x480 or 1920x1080, from the benchmark's `height` argument.
+ */
+cv::Size image_size(benchmark::State& state) {
+  return state.range(1) == 480 ? cv::Size{640, 480} : cv::Size{1920, 1080};
+}
+
+/**
+ * The C920's intrinsics scaled to the image size.
+ */
+CameraParameters make_parameters(cv::Size size) {
+  cv::Mat matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone();
+  for (int col = 0; col < 3; ++col) {
+    matrix.at<double>(0, col) *= size.width / 1920.0;
+    matrix.at<double>(1, col) *= size.height / 1080.0;
+  }
+  return CameraParameters{
+    .matrix = matrix,
+    .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone()
+  };
+}
+
+cv::Mat make_image(cv::Size size) {
+  cv::Mat image{size, CV_8UC3};
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  return image;
+}
+
+void set_counters(benchmark::State& state, cv::Size size) {
+  state.counters["MP/s"] = benchmark::Counter(
+    static_cast<double>(state.iterations()) * size.area() / 1e6,
+    benchmark::Counter::kIsRate
+  );
+}
+
+/**
+ * Baseline: rectification as it used to be, bicubic into a new image every
+ * frame.
+ */
+void BM_RectifyAllocating(benchmark::State& state) {
+  const cv::Size size = image_size(state);
+  const Rectifier rectifier{
+    make_parameters(size),
+    size,
+    {.interpolation = Interpolation::CUBIC}
+  };
+  const cv::Mat image = make_image(size);
+  for (auto _ : state) {
+    cv::Mat rectified = rectifier.rectify(image);
+    benchmark::DoNotOptimize(rectified.data);
+  }
+  set_counters(state, size);
+}
+BENCHMARK(BM_RectifyAllocating)
+  ->ArgNames({"mode", "height"})
+  ->Args({2, 480})
+  ->Args({2, 1080})
+  ->Unit(benchmark::kMillisecond);
+
+void BM_Rectify(benchmark::State& state) {
+  const cv::Size size = image_size(state);
+  const Rectifier rectifier{
+    make_parameters(size),
+    size,
+    {.interpolation = static_cast<Interpolation>(state.range(0))}
+  };
+  const cv::Mat image = make_image(size);
+  cv::Mat rectified;
+  for (auto _ : state) {
+    rectifier.rectify(image, rectified);
+    benchmark::DoNotOptimize(rectified.data);
+  }
+  set_counters(state, size);
+}
+BENCHMARK(BM_Rectify)
+  ->ArgNames({"mode", "height"})
+  ->ArgsProduct({{0, 1, 2}, {480, 1080}})
+  ->Unit(benchmark::kMillisecond);
+
+/**
+ * Only the middle quarter of the image, about where a person in frame is.
+ * Megapixels count the region rectified.
+ */
+void BM_RectifyRegion(benchmark::State& state) {
+  const cv::Size size = image_size(state);
+  const Rectifier rectifier{
+    make_parameters(size),
+    size,
+    {.interpolation = static_cast<Interpolation>(state.range(0))}
+  };
+  const cv::Mat image = make_image(size);
+  const cv::Rect roi{
+    cv::Point{size.width / 4, size.height / 4},
+    cv::Size{size.width / 2, size.height / 2}
+  };
+  cv::Mat rectified;
+  for (auto _ : state) {
+    rectifier.rectify(image, rectified, roi);
+    benchmark::DoNotOptimize(rectified.data);
+  }
+  set_counters(state, roi.size());
+}
+BENCHMARK(BM_RectifyRegion)
+  ->ArgNames({"mode", "height"})
+  ->ArgsProduct({{0, 1, 2}, {480, 1080}})
+  ->Unit(benchmark::kMillisecond);
+
+/**
+ * Both images of a stereo pair 7.5cm apart. Megapixels count both images.
+ */
+void BM_RectifyStereo(benchmark::State& state) {
+  const cv::Size size = image_size(state);
+  CameraParameters left = make_parameters(size);
+  left.rotation = cv::Mat::zeros(3, 1, CV_64F);
+  left.translation = cv::Mat::zeros(3, 1, CV_64F);
+  CameraParameters right = make_parameters(size);
+  right.rotation = cv::Mat::zeros(3, 1, CV_64F);
+  right.translation = (cv::Mat_<double>(3, 1) << -0.075, 0, 0);
+  const StereoRectifier rectifier{
+    left,
+    right,
+    size,
+    {.interpolation = static_cast<Interpolation>(state.range(0))}
+  };
+  const cv::Mat left_image = make_image(size);
+  const cv::Mat right_image = make_image(size);
+  cv::Mat left_rectified;
+  cv::Mat right_rectified;
+  for (auto _ : state) {
+    rectifier.rectify(
+      left_image,
+      right_image,
+      left_rectified,
+      right_rectified
+    );
+    benchmark::DoNotOptimize(left_rectified.data);
+    benchmark::DoNotOptimize(right_rectified.data);
+  }
+  set_counters(state, cv::Size{size.width * 2, size.height});
+}
+BENCHMARK(BM_RectifyStereo)
+  ->ArgNames({"mode", "height"})
+  ->ArgsProduct({{0, 1, 2}, {480, 1080}})
+  ->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,242 @@
+#include "src/cameras.h"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+const cv::Size IMAGE_SIZE{640, 400};
+constexpr double FOCAL_LENGTH = 450.0;
+
+CameraParameters make_camera() {
+  return CameraParameters{
+    .matrix = (cv::Mat_<double>(3, 3) <<
+      FOCAL_LENGTH, 0, IMAGE_SIZE.width / 2.0,
+      0, FOCAL_LENGTH, IMAGE_SIZE.height / 2.0,
+      0, 0, 1
+    ),
+    .distortion = (cv::Mat_<double>(1, 5) << -0.2, 0.05, 0, 0, 0)
+  };
+}
+
+/**
+ * Smooth shading with some detail, so interpolations can be compared.
+ */
+cv::Mat make_image() {
+  cv::Mat image{IMAGE_SIZE, CV_8UC3};
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      image.at<cv::Vec3b>(y, x) = cv::Vec3b{
+        static_cast<uchar>(128 + 100 * std::sin(x / 20.0)),
+        static_cast<uchar>(128 + 100 * std::cos(y / 15.0)),
+        static_cast<uchar>((x + y) / 4)
+      };
+    }
+  }
+  return image;
+}
+
+double mean_difference(const cv::Mat& a, const cv::Mat& b) {
+  cv::Mat difference_image;
+  cv::absdiff(a, b, difference_image);
+  const cv::Scalar difference = cv::mean(difference_image);
+  return (difference[0] + difference[1] + difference[2]) / 3;
+}
+
+TEST(Rectifier, ReusesOutputBuffer) {
+  const Rectifier rectifier{make_camera(), IMAGE_SIZE};
+  const cv::Mat image = make_image();
+  cv::Mat rectified;
+  rectifier.rectify(image, rectified);
+  const uchar* data = rectified.data;
+  ASSERT_EQ(rectified.size(), IMAGE_SIZE);
+
+  rectifier.rectify(image, rectified);
+  EXPECT_EQ(rectified.data, data);
+}
+
+TEST(Rectifier, RejectsRectifyingInPlace) {
+  const Rectifier rectifier{make_camera(), IMAGE_SIZE};
+  cv::Mat image = make_image();
+  EXPECT_THROW(rectifier.rectify(image, image), std::invalid_argument);
+}
+
+TEST(Rectifier, RegionMatchesFullImage) {
+  const Rectifier rectifier{make_camera(), IMAGE_SIZE};
+  const cv::Mat image = make_image();
+  const cv::Rect roi{100, 50, 200, 120};
+  cv::Mat full;
+  cv::Mat region;
+  rectifier.rectify(image, full);
+  rectifier.rectify(image, region, roi);
+  ASSERT_EQ(region.size(), roi.size());
+  EXPECT_EQ(cv::norm(full(roi), region, cv::NORM_INF), 0);
+}
+
+TEST(Rectifier, RegionIsClippedToImage) {
+  const Rectifier rectifier{make_camera(), IMAGE_SIZE};
+  cv::Mat region;
+  rectifier.rectify(make_image(), region, cv::Rect{600, 380, 100, 100});
+  EXPECT_EQ(region.size(), cv::Size(40, 20));
+}
+
+TEST(Rectifier, InterpolationsAgree) {
+  const cv::Mat image = make_image();
+  cv::Mat nearest;
+  cv::Mat bilinear;
+  cv::Mat cubic;
+  Rectifier{
+    make_camera(),
+    IMAGE_SIZE,
+    {.interpolation = Interpolation::NEAREST}
+  }.rectify(image, nearest);
+  Rectifier{
+    make_camera(),
+    IMAGE_SIZE,
+    {.interpolation = Interpolation::BILINEAR}
+  }.rectify(image, bilinear);
+  Rectifier{
+    make_camera(),
+    IMAGE_SIZE,
+    {.interpolation = Interpolation::CUBIC}
+  }.rectify(image, cubic);
+
+  EXPECT_LT(mean_difference(bilinear, cubic), 1.0);
+  EXPECT_LT(mean_difference(nearest, cubic), 3.0);
+  EXPECT_GT(
+    mean_difference(nearest, cubic),
+    mean_difference(bilinear, cubic)
+  );
+}
+
+/**
+ * An image from `camera` of a bright dot at each of `points`.
+ */
+cv::Mat draw_points(
+  const CameraParameters& camera,
+  const std::vector<cv::Point3d>& points
+) {
+  std::vector<cv::Point2d> pixels;
+  cv::projectPoints(
+    points,
+    camera.rotation,
+    camera.translation,
+    camera.matrix,
+    camera.distortion,
+    pixels
+  );
+  cv::Mat image = cv::Mat::zeros(IMAGE_SIZE, CV_8UC1);
+  // Drawn with 4 fractional bits so the dots are not snapped to whole
+  // pixels.
+  for (const cv::Point2d& pixel : pixels) {
+    cv::circle(
+      image,
+      cv::Point{cvRound(pixel.x * 16), cvRound(pixel.y * 16)},
+      3 * 16,
+      cv::Scalar::all(255),
+      cv::FILLED,
+      cv::LINE_AA,
+      4
+    );
+  }
+  cv::GaussianBlur(image, image, cv::Size{5, 5}, 0);
+  return image;
+}
+
+/**
+ * Centers of the bright dots in an image, from top to bottom.
+ */
+std::vector<cv::Point2d> find_dots(const cv::Mat& image) {
+  cv::Mat mask;
+  cv::Mat labels;
+  cv::Mat stats;
+  cv::Mat centroids;
+  cv::threshold(image, mask, 16, 255, cv::THRESH_BINARY);
+  const int count =
+    cv::connectedComponentsWithStats(mask, labels, stats, centroids);
+
+  // Weighted by brightness, finer than the thresholded centroid.
+  std::vector<cv::Point2d> dots;
+  for (int i = 1; i < count; ++i) {
+    const cv::Rect area{
+      stats.at<int>(i, cv::CC_STAT_LEFT),
+      stats.at<int>(i, cv::CC_STAT_TOP),
+      stats.at<int>(i, cv::CC_STAT_WIDTH),
+      stats.at<int>(i, cv::CC_STAT_HEIGHT)
+    };
+    const cv::Moments moments = cv::moments(image(area));
+    dots.emplace_back(
+      area.x + moments.m10 / moments.m00,
+      area.y + moments.m01 / moments.m00
+    );
+  }
+  std::sort(
+    dots.begin(),
+    dots.end(),
+    [](const cv::Point2d& a, const cv::Point2d& b) { return a.y < b.y; }
+  );
+  return dots;
+}
+
+TEST(StereoRectifier, AlignsRows) {
+  // The right camera sits 7.5cm to the right of the left one, slightly
+  // turned.
+  CameraParameters left = make_camera();
+  left.rotation = cv::Mat::zeros(3, 1, CV_64F);
+  left.translation = cv::Mat::zeros(3, 1, CV_64F);
+  CameraParameters right = make_camera();
+  const cv::Vec3d rotation{0.01, -0.02, 0.005};
+  cv::Matx33d rotation_matrix;
+  cv::Rodrigues(rotation, rotation_matrix);
+  right.rotation = cv::Mat{rotation, true};
+  right.translation =
+    cv::Mat{cv::Vec3d{-(rotation_matrix * cv::Vec3d{0.075, 0, 0})}, true};
+
+  const std::vector<cv::Point3d> points = {
+    {-0.3, -0.2, 1.0},
+    {0.2, 0.1, 1.5},
+    {0.0, 0.3, 2.0}
+  };
+  const StereoRectifier rectifier{left, right, IMAGE_SIZE};
+  cv::Mat left_rectified;
+  cv::Mat right_rectified;
+  rectifier.rectify(
+    draw_points(left, points),
+    draw_points(right, points),
+    left_rectified,
+    right_rectified
+  );
+
+  const std::vector<cv::Point2d> left_dots = find_dots(left_rectified);
+  const std::vector<cv::Point2d> right_dots = find_dots(right_rectified);
+  ASSERT_EQ(left_dots.size(), points.size());
+  ASSERT_EQ(right_dots.size(), points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    EXPECT_NEAR(left_dots[i].y, right_dots[i].y, 0.5) << "Point " << i;
+    EXPECT_GT(left_dots[i].x, right_dots[i].x) << "Point " << i;
+  }
+
+  // The baseline ends up in the right camera's projection.
+  EXPECT_NEAR(
+    -rectifier.right_projection().at<double>(0, 3) /
+      rectifier.right_projection().at<double>(0, 0),
+    0.075,
+    1e-6
+  );
+}
+
+TEST(StereoRectifier, RequiresExtrinsics) {
+  EXPECT_THROW(
+    StereoRectifier(make_camera(), make_camera(), IMAGE_SIZE),
+    std::invalid_argument
+  );
+}
+
+}
@@ -0,0 +1,568 @@
+#include "src/charuco.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/blocking_queue.h"
+#include "src/video_reader.h"
+
+namespace {
+
+/**
+ * Where a view of the board is, how big and how tilted, scaled so that each
+ * ranges over about 0 to 1.
+ */
+struct ViewDescriptor {
+  double center_x = 0.0;
+  double center_y = 0.0;
+  double scale = 0.0;
+  double tilt_x = 0.0;
+  double tilt_y = 0.0;
+};
+
+double distance(const ViewDescriptor& a, const ViewDescriptor& b) {
+  return std::sqrt(
+    (a.center_x - b.center_x) * (a.center_x - b.center_x) +
+    (a.center_y - b.center_y) * (a.center_y - b.center_y) +
+    (a.scale - b.scale) * (a.scale - b.scale) +
+    (a.tilt_x - b.tilt_x) * (a.tilt_x - b.tilt_x) +
+    (a.tilt_y - b.tilt_y) * (a.tilt_y - b.tilt_y)
+  );
+}
+
+ViewDescriptor describe(
+  const CharucoDetection& detection,
+  cv::Size image_size
+) {
+  const auto board = get_charuco_board();
+  std::vector<cv::Point2f> image_points;
+  std::vector<cv::Point2f> board_points;
+  for (int i = 0; i < detection.ids.rows; ++i) {
+    const cv::Point3f& corner =
+      board->chessboardCorners.at(detection.ids.at<int>(i));
+    board_points.emplace_back(corner.x, corner.y);
+    image_points.push_back(detection.corners.at<cv::Point2f>(i));
+  }
+
+  ViewDescriptor descriptor;
+  const cv::Scalar center = cv::mean(image_points);
+  descriptor.center_x = center[0] / image_size.width;
+  descriptor.center_y = center[1] / image_size.height;
+
+  std::vector<cv::Point2f> hull;
+  cv::convexHull(image_points, hull);
+  descriptor.scale = std::sqrt(cv::contourArea(hull) / image_size.area());
+
+  // The perspective row of the board to image homography is how fast depth
+  // changes across the board. Scaled by the board's size it becomes the
+  // fraction depth changes by from one side of the board to the other.
+  if (image_points.size() >= 4) {
+    const cv::Mat homography = cv::findHomography(board_points, image_points);
+    if (!homography.empty() && homography.at<double>(2, 2) != 0.0) {
+      const cv::Size squares = board->getChessboardSize();
+      const double length = board->getSquareLength() *
+        std::hypot(squares.width, squares.height);
+      const double w = homography.at<double>(2, 2);
+      descriptor.tilt_x = homography.at<double>(2, 0) / w * length;
+      descriptor.tilt_y = homography.at<double>(2, 1) / w * length;
+    }
+  }
+  return descriptor;
+}
+
+std::vector<int> covered_cells(
+  const CharucoDetection& detection,
+  cv::Size image_size,
+  int grid
+) {
+  std::vector<int> cells;
+  for (int i = 0; i < detection.corners.rows; ++i) {
+    const cv::Point2f& corner = detection.corners.at<cv::Point2f>(i);
+    const int x = std::clamp(
+      static_cast<int>(corner.x * grid / image_size.width), 0, grid - 1
+    );
+    const int y = std::clamp(
+      static_cast<int>(corner.y * grid / image_size.height), 0, grid - 1
+    );
+    cells.push_back(y * grid + x);
+  }
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+  return cells;
+}
+
+std::size_t sample_step(double fps, double sample_fps) {
+  if (fps <= 0.0 || sample_fps <= 0.0) return 1;
+  return std::max<std::size_t>(1, std::lround(fps / sample_fps));
+}
+
+}
+
+cv::Ptr<cv::aruco::CharucoBoard> get_charuco_board() {
+  static cv::Ptr<cv::aruco::CharucoBoard> board =
+    cv::aruco::CharucoBoard::create(
+      5, 7,
+      0.0303f, 0.01515f,
+      cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250)
+    );
+  return board;
+}
+
+CharucoDetector::CharucoDetector(CharucoDetectorOptions options):
+  _options{options},
+  _parameters{cv::aruco::DetectorParameters::create()}
+{
+  // Marker corners are refined here, at full resolution, instead.
+  _parameters->cornerRefinementMethod = cv::aruco::CORNER_REFINE_NONE;
+}
+
+std::optional<CharucoDetection> CharucoDetector::detect(const cv::Mat& image) {
+  const cv::Mat* gray = &image;
+  if (image.channels() != 1) {
+    cv::cvtColor(image, _gray, cv::COLOR_BGR2GRAY);
+    gray = &_gray;
+  }
+
+  const cv::Rect full{cv::Point{0, 0}, gray->size()};
+  _search_area = full;
+  if (_options.track && _tracked) {
+    const int margin_x =
+      static_cast<int>(_tracked->width * _options.track_margin);
+    const int margin_y =
+      static_cast<int>(_tracked->height * _options.track_margin);
+    _search_area = cv::Rect{
+      _tracked->x - margin_x,
+      _tracked->y - margin_y,
+      _tracked->width + 2 * margin_x,
+      _tracked->height + 2 * margin_y
+    } & full;
+  }
+  _find_markers(*gray, _search_area);
+  if (_marker_ids.empty() && _search_area != full) {
+    // The board moved further than expected, or left the image.
+    _search_area = full;
+    _find_markers(*gray, _search_area);
+  }
+  if (_marker_ids.empty()) {
+    _tracked.reset();
+    return std::nullopt;
+  }
+
+  std::vector<cv::Point2f> points;
+  for (const std::vector<cv::Point2f>& marker : _marker_corners) {
+    points.insert(points.end(), marker.begin(), marker.end());
+  }
+  if (_options.pyramid_levels > 0) {
+    cv::cornerSubPix(
+      *gray,
+      points,
+      cv::Size{_options.refine_window, _options.refine_window},
+      cv::Size{-1, -1},
+      cv::TermCriteria{
+        cv::TermCriteria::COUNT | cv::TermCriteria::EPS,
+        10,
+        0.05
+      }
+    );
+    std::size_t i = 0;
+    for (std::vector<cv::Point2f>& marker : _marker_corners) {
+      for (cv::Point2f& corner : marker) corner = points[i++];
+    }
+  }
+  _tracked = cv::boundingRect(points);
+
+  // Board corners are interpolated from the markers and then refined by
+  // looking only at the pixels around each of them.
+  CharucoDetection detection;
+  cv::aruco::interpolateCornersCharuco(
+    _marker_corners,
+    _marker_ids,
+    *gray,
+    get_charuco_board(),
+    detection.corners,
+    detection.ids
+  );
+  if (detection.ids.empty()) return std::nullopt;
+  return detection;
+}
+
+void CharucoDetector::_find_markers(
+  const cv::Mat& gray,
+  const cv::Rect& area
+) {
+  const cv::Mat region = gray(area);
+  const int scale = 1 << _options.pyramid_levels;
+  if (scale > 1) {
+    cv::resize(
+      region,
+      _small,
+      cv::Size{region.cols / scale, region.rows / scale},
+      0,
+      0,
+      cv::INTER_AREA
+    );
+  } else {
+    _small = region;
+  }
+
+  _marker_corners.clear();
+  _marker_ids.clear();
+  cv::aruco::detectMarkers(
+    _small,
+    get_charuco_board()->dictionary,
+    _marker_corners,
+    _marker_ids,
+    _parameters
+  );
+
+  // Each downscaled pixel averages a block of full resolution ones, whose
+  // center is half a block in.
+  const float offset = (scale - 1) / 2.0f;
+  for (std::vector<cv::Point2f>& marker : _marker_corners) {
+    for (cv::Point2f& corner : marker) {
+      corner.x = corner.x * scale + offset + area.x;
+      corner.y = corner.y * scale + offset + area.y;
+    }
+  }
+}
+
+std::optional<CharucoDetection> detect_charuco(const cv::Mat& image) {
+  CharucoDetector detector{{.pyramid_levels = 0, .track = false}};
+  return detector.detect(image);
+}
+
+std::vector<std::size_t> select_views(
+  const std::vector<CharucoDetection>& detections,
+  cv::Size image_size,
+  const ViewSelectionOptions& options
+) {
+  std::vector<std::size_t> candidates;
+  for (std::size_t i = 0; i < detections.size(); ++i) {
+    if (detections[i].ids.rows >= options.min_corners) candidates.push_back(i);
+  }
+  if (candidates.empty()) return {};
+
+  const int grid = options.coverage_grid;
+  std::vector<ViewDescriptor> descriptors;
+  std::vector<std::vector<int>> cells;
+  for (std::size_t i : candidates) {
+    descriptors.push_back(describe(detections[i], image_size));
+    cells.push_back(covered_cells(detections[i], image_size, grid));
+  }
+
+  std::vector<bool> covered(grid * grid, false);
+  std::vector<bool> selected(candidates.size(), false);
+  std::vector<double> nearest(
+    candidates.size(),
+    std::numeric_limits<double>::infinity()
+  );
+  std::vector<std::size_t> views;
+  const auto select = [&](std::size_t candidate) {
+    selected[candidate] = true;
+    views.push_back(candidates[candidate]);
+    for (int cell : cells[candidate]) covered[cell] = true;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+      nearest[i] = std::min(
+        nearest[i],
+        distance(descriptors[i], descriptors[candidate])
+      );
+    }
+  };
+
+  // The view with the most corners seeds the selection.
+  std::size_t first = 0;
+  for (std::size_t i = 1; i < candidates.size(); ++i) {
+    if (
+      detections[candidates[i]].ids.rows >
+      detections[candidates[first]].ids.rows
+    ) {
+      first = i;
+    }
+  }
+  select(first);
+
+  while (views.size() < options.max_views) {
+    std::optional<std::size_t> best;
+    double best_score = 0.0;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+      if (selected[i]) continue;
+      const auto new_cells = std::count_if(
+        cells[i].begin(),
+        cells[i].end(),
+        [&](int cell) { return !covered[cell]; }
+      );
+      if (new_cells == 0 && nearest[i] < options.min_view_distance) continue;
+
+      const double score = nearest[i] +
+        options.coverage_weight * new_cells / (grid * grid);
+      if (!best || score > best_score) {
+        best = i;
+        best_score = score;
+      }
+    }
+    if (!best) break;
+    select(*best);
+  }
+
+  std::sort(views.begin(), views.end());
+  return views;
+}
+
+IntrinsicCalibration calibrate_intrinsics(
+  const std::vector<CharucoDetection>& views,
+  cv::Size image_size,
+  const std::optional<IntrinsicCalibration>& guess
+) {
+  if (views.size() < MIN_CALIBRATION_VIEWS) {
+    throw std::invalid_argument(
+      "Calibration needs at least " + std::to_string(MIN_CALIBRATION_VIEWS) +
+      " views of the board, got " + std::to_string(views.size()) + "."
+    );
+  }
+
+  std::vector<cv::Mat> corners;
+  std::vector<cv::Mat> ids;
+  for (const CharucoDetection& view : views) {
+    corners.push_back(view.corners);
+    ids.push_back(view.ids);
+  }
+
+  IntrinsicCalibration calibration;
+  int flags = 0;
+  if (guess) {
+    calibration.matrix = guess->matrix.clone();
+    calibration.distortion = guess->distortion.clone();
+    flags |= cv::CALIB_USE_INTRINSIC_GUESS;
+  }
+  calibration.error = cv::aruco::calibrateCameraCharuco(
+    corners, ids, get_charuco_board(), image_size,
+    calibration.matrix, calibration.distortion,
+    cv::noArray(), cv::noArray(), flags
+  );
+  return calibration;
+}
+
+BackgroundCalibration::BackgroundCalibration(cv::Size image_size):
+  _image_size{image_size},
+  _thread{[this]() { _solve_loop(); }}
+{}
+
+BackgroundCalibration::~BackgroundCalibration() {
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _stopping = true;
+  }
+  _wake.notify_all();
+  _thread.join();
+}
+
+std::uint64_t BackgroundCalibration::update(
+  std::vector<CharucoDetection> views
+) {
+  std::uint64_t revision;
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    revision = ++_submitted;
+    // Views not yet being solved are superseded rather than queued.
+    _pending = std::move(views);
+  }
+  _wake.notify_all();
+  return revision;
+}
+
+std::shared_ptr<const CalibrationUpdate> BackgroundCalibration::latest() {
+  if (_failed) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (_error) {
+      std::exception_ptr error = std::exchange(_error, nullptr);
+      _failed = false;
+      std::rethrow_exception(error);
+    }
+  }
+  return _latest.load();
+}
+
+void BackgroundCalibration::wait() {
+  std::unique_lock<std::mutex> lock{_mutex};
+  _idle.wait(lock, [this]() { return !_pending && !_solving; });
+}
+
+void BackgroundCalibration::_solve_loop() {
+  std::unique_lock<std::mutex> lock{_mutex};
+  while (true) {
+    _wake.wait(lock, [this]() { return _stopping || _pending; });
+    if (_stopping) return;
+
+    std::vector<CharucoDetection> views = *std::move(_pending);
+    _pending.reset();
+    const std::uint64_t revision = _submitted;
+    _solving = true;
+    lock.unlock();
+
+    try {
+      std::optional<IntrinsicCalibration> guess;
+      if (std::shared_ptr<const CalibrationUpdate> last = _latest.load()) {
+        guess = last->intrinsics;
+      }
+      IntrinsicCalibration intrinsics;
+      try {
+        intrinsics = calibrate_intrinsics(views, _image_size, guess);
+      } catch (const cv::Exception&) {
+        // A poor starting point can send the solver astray, start over.
+        if (!guess) throw;
+        intrinsics = calibrate_intrinsics(views, _image_size);
+      }
+      _latest.store(std::make_shared<const CalibrationUpdate>(
+        CalibrationUpdate{
+          .intrinsics = std::move(intrinsics),
+          .view_count = views.size(),
+          .revision = revision
+        }
+      ));
+    } catch (...) {
+      std::lock_guard<std::mutex> error_lock{_mutex};
+      _error = std::current_exception();
+      _failed = true;
+    }
+
+    lock.lock();
+    _solving = false;
+    _idle.notify_all();
+  }
+}
+
+std::vector<CharucoDetection> scan_charuco(
+  VideoReader& reader,
+  const VideoCalibrationOptions& options
+) {
+  struct Job {
+    std::size_t frame_index;
+    cv::Mat image;
+  };
+
+  const std::size_t step = sample_step(reader.fps(), options.sample_fps);
+  const std::size_t thread_count = options.threads > 0
+    ? options.threads
+    : std::max(1u, std::thread::hardware_concurrency());
+
+  // Decoding stays just ahead of the detectors, each of which keeps its own
+  // results so they never contend for them.
+  BlockingQueue<Job> jobs{thread_count * 2};
+  std::atomic_bool failed = false;
+  std::vector<std::vector<CharucoDetection>> results(thread_count);
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&, i]() {
+      // Sampled frames are too far apart, and spread across threads, for
+      // the board to be tracked between them.
+      CharucoDetector detector{{.track = false}};
+      try {
+        while (std::optional<Job> job = jobs.pop()) {
+          if (failed) break;
+          std::optional<CharucoDetection> detection =
+            detector.detect(job->image);
+          if (!detection) continue;
+          detection->frame_index = job->frame_index;
+          results[i].push_back(*std::move(detection));
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+        failed = true;
+        // Refuses the decoder's next push so it stops too.
+        jobs.close();
+      }
+    });
+  }
+  const auto join = [&]() {
+    jobs.close();
+    for (std::thread& thread : threads) thread.join();
+  };
+
+  try {
+    for (
+      std::size_t frame = 0;
+      frame < reader.frame_count() && !failed;
+      frame += step
+    ) {
+      reader.seek(frame);
+      std::optional<cv::Mat> image = reader.read();
+      if (!image) break;
+      if (!jobs.push(Job{.frame_index = frame, .image = *std::move(image)})) {
+        break;
+      }
+    }
+  } catch (...) {
+    failed = true;
+    join();
+    throw;
+  }
+  join();
+  for (const std::exception_ptr& error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+
+  std::vector<CharucoDetection> detections;
+  for (std::vector<CharucoDetection>& result : results) {
+    std::move(result.begin(), result.end(), std::back_inserter(detections));
+  }
+  std::sort(
+    detections.begin(),
+    detections.end(),
+    [](const CharucoDetection& a, const CharucoDetection& b) {
+      return a.frame_index < b.frame_index;
+    }
+  );
+  return detections;
+}
+
+VideoCalibration calibrate_from_video(
+  const std::filesystem::path& path,
+  const VideoCalibrationOptions& options
+) {
+  VideoReader reader{path};
+  const std::size_t step = sample_step(reader.fps(), options.sample_fps);
+
+  VideoCalibration calibration;
+  calibration.image_size = reader.image_size();
+  calibration.frames_scanned = (reader.frame_count() + step - 1) / step;
+
+  std::vector<CharucoDetection> detections = scan_charuco(reader, options);
+  calibration.detections = detections.size();
+  for (
+    std::size_t i :
+    select_views(detections, calibration.image_size, options.selection)
+  ) {
+    calibration.views.push_back(std::move(detections[i]));
+  }
+  if (calibration.views.size() < MIN_CALIBRATION_VIEWS) {
+    throw std::runtime_error(
+      "Only " + std::to_string(calibration.views.size()) +
+      " usable views of the board in " + path.string() + "."
+    );
+  }
+
+  calibration.intrinsics =
+    calibrate_intrinsics(calibration.views, calibration.image_size);
+  return calibration;
+}
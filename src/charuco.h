@@ -0,0 +1,264 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "src/video_reader.h"
+
+// Fewest views of the board a camera can be calibrated from.
+constexpr std::size_t MIN_CALIBRATION_VIEWS = 5;
+
+/**
+ * The printed calibration board: 5x7 squares of 3.03cm with 6x6 markers.
+ */
+cv::Ptr<cv::aruco::CharucoBoard> get_charuco_board();
+
+/**
+ * Chessboard corners of the board found in one frame.
+ */
+struct CharucoDetection {
+  std::size_t frame_index = 0;
+
+  // Image position of each corner found, as an Nx1 CV_32FC2, and its id on
+  // the board as an Nx1 CV_32S.
+  cv::Mat corners;
+  cv::Mat ids;
+};
+
+struct CharucoDetectorOptions {
+  // Markers are searched for in the image halved this many times. Each level
+  // quarters the pixels thresholded and scanned for marker outlines.
+  int pyramid_levels = 1;
+
+  // Search only around where the board was found in the previous frame,
+  // falling back to the whole image when it is not there.
+  bool track = true;
+
+  // Fraction of the tracked board's size added around it on every side.
+  double track_margin = 0.5;
+
+  // Half size, in full resolution pixels, of the window each marker corner
+  // is refined in.
+  int refine_window = 4;
+};
+
+/**
+ * Finds the board in a stream of frames.
+ *
+ * Markers are found on a downscaled copy of the frame, then only the pixels
+ * around each marker corner and board corner are revisited at full
+ * resolution to refine them. The detector's parameters and buffers are kept
+ * between frames.
+ */
+class CharucoDetector {
+public:
+  explicit CharucoDetector(CharucoDetectorOptions options = {});
+  ~CharucoDetector() = default;
+  CharucoDetector(const CharucoDetector&) = delete;
+  CharucoDetector(CharucoDetector&&) = default;
+  CharucoDetector& operator=(const CharucoDetector&) = delete;
+  CharucoDetector& operator=(CharucoDetector&&) = default;
+
+  /**
+   * Returns the corners of the board found in the image, if any.
+   */
+  std::optional<CharucoDetection> detect(const cv::Mat& image);
+
+  /**
+   * Forgets where the board was so the next frame is searched in full.
+   */
+  void reset() { _tracked.reset(); }
+
+  // Markers found in the last frame, at full resolution.
+  const std::vector<std::vector<cv::Point2f>>& marker_corners() const {
+    return _marker_corners;
+  }
+  const std::vector<int>& marker_ids() const { return _marker_ids; }
+
+  // Region the last frame was searched in.
+  const cv::Rect& search_area() const { return _search_area; }
+
+private:
+  void _find_markers(const cv::Mat& gray, const cv::Rect& area);
+
+  CharucoDetectorOptions _options;
+  cv::Ptr<cv::aruco::DetectorParameters> _parameters;
+  std::optional<cv::Rect> _tracked;
+  cv::Rect _search_area;
+  cv::Mat _gray;
+  cv::Mat _small;
+  std::vector<std::vector<cv::Point2f>> _marker_corners;
+  std::vector<int> _marker_ids;
+};
+
+/**
+ * Detects the board in a single image at full resolution.
+ */
+std::optional<CharucoDetection> detect_charuco(const cv::Mat& image);
+
+struct ViewSelectionOptions {
+  // Most views passed to the calibration. Its cost grows with every view
+  // while views past a few dozen add little accuracy.
+  std::size_t max_views = 40;
+
+  // Views with fewer corners than this are not considered. Corners from only
+  // a couple of markers are poorly constrained.
+  int min_corners = 8;
+
+  // The image is divided into this many cells on each side to measure how
+  // much of it the selected views cover.
+  int coverage_grid = 8;
+
+  // Weight of covering new cells against differing from selected views.
+  double coverage_weight = 1.0;
+
+  // Selection stops early once every remaining view is closer than this to a
+  // selected one and covers no new cells.
+  double min_view_distance = 0.02;
+};
+
+/**
+ * Picks a diverse subset of detections to calibrate from, returning their
+ * indices in `detections`.
+ *
+ * Each view is described by where the board is in the image, how large it
+ * is and how tilted it is. Starting from the view with the most corners,
+ * views are greedily added that are farthest from those already selected
+ * while covering parts of the image none of them reached.
+ */
+std::vector<std::size_t> select_views(
+  const std::vector<CharucoDetection>& detections,
+  cv::Size image_size,
+  const ViewSelectionOptions& options = {}
+);
+
+struct IntrinsicCalibration {
+  cv::Mat matrix;
+  cv::Mat distortion;
+
+  // RMS reprojection error in pixels.
+  double error = 0.0;
+};
+
+/**
+ * Calibrates a camera's intrinsics from detections of the board.
+ */
+IntrinsicCalibration calibrate_intrinsics(
+  const std::vector<CharucoDetection>& views,
+  cv::Size image_size,
+  const std::optional<IntrinsicCalibration>& guess = std::nullopt
+);
+
+struct CalibrationUpdate {
+  IntrinsicCalibration intrinsics;
+  std::size_t view_count = 0;
+
+  // Which call to `BackgroundCalibration::update` the views came from.
+  std::uint64_t revision = 0;
+};
+
+/**
+ * Recalibrates on a background thread whenever the set of views changes, so
+ * callers never wait on the solver.
+ *
+ * Only the newest views are solved: sets submitted while the solver is busy
+ * replace each other and the solver moves on to the last one. Each solve
+ * starts from the previous intrinsics, which usually converges in a few
+ * iterations. Results are published as a whole for `latest` to pick up.
+ */
+class BackgroundCalibration {
+public:
+  explicit BackgroundCalibration(cv::Size image_size);
+  ~BackgroundCalibration();
+  BackgroundCalibration(const BackgroundCalibration&) = delete;
+  BackgroundCalibration(BackgroundCalibration&&) = delete;
+  BackgroundCalibration& operator=(const BackgroundCalibration&) = delete;
+  BackgroundCalibration& operator=(BackgroundCalibration&&) = delete;
+
+  /**
+   * Queues the views to be calibrated from, replacing any not yet started.
+   * Returns the revision their result will carry.
+   */
+  std::uint64_t update(std::vector<CharucoDetection> views);
+
+  /**
+   * The most recent calibration, if any has finished. Never blocks on the
+   * solver. Rethrows, once, an error from a failed solve.
+   */
+  std::shared_ptr<const CalibrationUpdate> latest();
+
+  /**
+   * Blocks until every submitted set of views has been solved.
+   */
+  void wait();
+
+private:
+  void _solve_loop();
+
+  cv::Size _image_size;
+  std::atomic<std::shared_ptr<const CalibrationUpdate>> _latest;
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _idle;
+  std::optional<std::vector<CharucoDetection>> _pending;
+  std::uint64_t _submitted = 0;
+  bool _solving = false;
+  bool _stopping = false;
+  std::atomic_bool _failed = false;
+  std::exception_ptr _error;
+
+  std::thread _thread;
+};
+
+struct VideoCalibrationOptions {
+  // Frames checked for the board per second of video. Neighbouring frames
+  // hardly differ, so checking all of them mostly adds time. Zero checks
+  // every frame.
+  double sample_fps = 5.0;
+
+  // Threads detecting the board, zero for one per core.
+  std::size_t threads = 0;
+
+  ViewSelectionOptions selection;
+};
+
+/**
+ * Decodes sampled frames of a video and detects the board in them on a pool
+ * of threads. Detections are returned in frame order.
+ */
+std::vector<CharucoDetection> scan_charuco(
+  VideoReader& reader,
+  const VideoCalibrationOptions& options = {}
+);
+
+struct VideoCalibration {
+  IntrinsicCalibration intrinsics;
+  cv::Size image_size;
+  std::size_t frames_scanned = 0;
+  std::size_t detections = 0;
+
+  // The views calibrated from.
+  std::vector<CharucoDetection> views;
+};
+
+/**
+ * Calibrates a camera's intrinsics from a recording of the board being
+ * moved around in front of it, without any interaction.
+ */
+VideoCalibration calibrate_from_video(
+  const std::filesystem::path& path,
+  const VideoCalibrationOptions& options = {}
+);
@@ -0,0 +1,237 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/cameras.h"
+#include "src/charuco.h"
+#include "src/video_reader.h"
+
+namespace {
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+constexpr int FRAME_COUNT = 60;
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+CameraParameters make_parameters() {
+  return CameraParameters{
+    .matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone(),
+    .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone()
+  };
+}
+
+/**
+ * Two seconds of the board being waved about a meter in front of the
+ * camera, rendered without distortion.
+ */
+std::vector<cv::Mat> render_frames() {
+  const auto board = get_charuco_board();
+  const cv::Size squares = board->getChessboardSize();
+  const float length = board->getSquareLength();
+  cv::Mat board_image;
+  board->draw(cv::Size{squares.width * 100, squares.height * 100}, board_image);
+
+  const std::vector<cv::Point2f> source = {
+    {0, 0},
+    {static_cast<float>(board_image.cols), 0},
+    {
+      static_cast<float>(board_image.cols),
+      static_cast<float>(board_image.rows)
+    },
+    {0, static_cast<float>(board_image.rows)}
+  };
+  const std::vector<cv::Point3f> outline = {
+    {-squares.width * length / 2, -squares.height * length / 2, 0},
+    {squares.width * length / 2, -squares.height * length / 2, 0},
+    {squares.width * length / 2, squares.height * length / 2, 0},
+    {-squares.width * length / 2, squares.height * length / 2, 0}
+  };
+  const cv::Mat matrix{3, 3, CV_64F, c920_matrix};
+
+  std::vector<cv::Mat> frames;
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    const double t = i / static_cast<double>(FRAME_COUNT);
+    const cv::Vec3d rotation{
+      0.4 * std::sin(2 * CV_PI * t),
+      0.4 * std::cos(2 * CV_PI * t),
+      0.2 * t
+    };
+    const cv::Vec3d translation{0.3 * std::sin(2 * CV_PI * t), 0.05, 1.0};
+    std::vector<cv::Point2f> destination;
+    cv::projectPoints(
+      outline,
+      rotation,
+      translation,
+      matrix,
+      cv::noArray(),
+      destination
+    );
+    cv::Mat frame;
+    cv::warpPerspective(
+      board_image,
+      frame,
+      cv::getPerspectiveTransform(source, destination),
+      IMAGE_SIZE,
+      cv::INTER_LINEAR,
+      cv::BORDER_CONSTANT,
+      cv::Scalar::all(200)
+    );
+    cv::cvtColor(frame, frame, cv::COLOR_GRAY2BGR);
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+/**
+ * Recorded footage of the board when CHARUCO_BENCHMARK_VIDEO names a video,
+ * otherwise rendered frames.
+ */
+const std::vector<cv::Mat>& frames() {
+  static const std::vector<cv::Mat> frames = []() {
+    const char* video_path = std::getenv("CHARUCO_BENCHMARK_VIDEO");
+    if (!video_path) return render_frames();
+
+    VideoReader reader{video_path};
+    std::vector<cv::Mat> frames;
+    while (frames.size() < FRAME_COUNT) {
+      std::optional<cv::Mat> frame = reader.read();
+      if (!frame) break;
+      frames.push_back(*std::move(frame));
+    }
+    return frames;
+  }();
+  return frames;
+}
+
+void set_counters(benchmark::State& state, std::int64_t detected) {
+  const double frame_count =
+    static_cast<double>(state.iterations()) * frames().size();
+  state.counters["fps"] =
+    benchmark::Counter(frame_count, benchmark::Counter::kIsRate);
+  state.counters["detected"] = detected / frame_count;
+}
+
+/**
+ * Baseline: the calibrator's detection as it used to be. Fresh parameters,
+ * contour refinement and a full resolution search for every frame, drawn
+ * over a new copy of it.
+ */
+void BM_DetectFullResolution(benchmark::State& state) {
+  const auto board = get_charuco_board();
+  std::int64_t detected = 0;
+  for (auto _ : state) {
+    for (const cv::Mat& frame : frames()) {
+      cv::Mat display_image;
+      frame.copyTo(display_image);
+      cv::Ptr<cv::aruco::DetectorParameters> params =
+        cv::aruco::DetectorParameters::create();
+      params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_CONTOUR;
+
+      std::vector<int> marker_ids;
+      std::vector<std::vector<cv::Point2f>> marker_corners;
+      cv::aruco::detectMarkers(
+        frame,
+        board->dictionary,
+        marker_corners,
+        marker_ids,
+        params
+      );
+      if (marker_ids.empty()) continue;
+
+      cv::Mat corners;
+      cv::Mat ids;
+      cv::aruco::interpolateCornersCharuco(
+        marker_corners,
+        marker_ids,
+        frame,
+        board,
+        corners,
+        ids
+      );
+      if (!ids.empty()) ++detected;
+      benchmark::DoNotOptimize(display_image.data);
+    }
+  }
+  set_counters(state, detected);
+}
+BENCHMARK(BM_DetectFullResolution)->Unit(benchmark::kMillisecond);
+
+void BM_CharucoDetector(benchmark::State& state) {
+  CharucoDetector detector{{
+    .pyramid_levels = static_cast<int>(state.range(0)),
+    .track = state.range(1) != 0
+  }};
+  cv::Mat display_image;
+  std::int64_t detected = 0;
+  for (auto _ : state) {
+    for (const cv::Mat& frame : frames()) {
+      frame.copyTo(display_image);
+      if (detector.detect(frame)) ++detected;
+      benchmark::DoNotOptimize(display_image.data);
+    }
+  }
+  set_counters(state, detected);
+}
+BENCHMARK(BM_CharucoDetector)
+  ->ArgNames({"levels", "track"})
+  ->Args({0, 0})
+  ->Args({0, 1})
+  ->Args({1, 0})
+  ->Args({1, 1})
+  ->Args({2, 1})
+  ->Unit(benchmark::kMillisecond);
+
+/**
+ * Baseline: undistorted previews as they used to be, with maps rebuilt for
+ * every frame.
+ */
+void BM_UndistortRebuildMaps(benchmark::State& state) {
+  const CameraParameters parameters = make_parameters();
+  const cv::Mat& frame = frames().front();
+  cv::Mat undistorted;
+  for (auto _ : state) {
+    Rectifier rectifier{parameters, frame.size()};
+    undistorted = rectifier.rectify(frame);
+    benchmark::DoNotOptimize(undistorted.data);
+  }
+  state.counters["fps"] = benchmark::Counter(
+    static_cast<double>(state.iterations()),
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_UndistortRebuildMaps)->Unit(benchmark::kMillisecond);
+
+void BM_UndistortCachedMaps(benchmark::State& state) {
+  const cv::Mat& frame = frames().front();
+  const Rectifier rectifier{make_parameters(), frame.size()};
+  cv::Mat undistorted;
+  for (auto _ : state) {
+    undistorted = rectifier.rectify(frame);
+    benchmark::DoNotOptimize(undistorted.data);
+  }
+  state.counters["fps"] = benchmark::Counter(
+    static_cast<double>(state.iterations()),
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_UndistortCachedMaps)->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,381 @@
+#include "src/charuco.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/video_writer.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/charuco";
+const cv::Size IMAGE_SIZE{640, 480};
+constexpr double FOCAL_LENGTH = 800.0;
+constexpr int BOARD_PIXELS_PER_SQUARE = 100;
+
+const cv::Mat& camera_matrix() {
+  static const cv::Mat matrix = (cv::Mat_<double>(3, 3) <<
+    FOCAL_LENGTH, 0, IMAGE_SIZE.width / 2.0,
+    0, FOCAL_LENGTH, IMAGE_SIZE.height / 2.0,
+    0, 0, 1
+  );
+  return matrix;
+}
+
+struct Pose {
+  cv::Vec3d rotation;
+  cv::Vec3d translation;
+};
+
+/**
+ * Board coordinates of the corners of its printed image, clockwise from the
+ * top left. The board's Y axis points up the print.
+ */
+std::vector<cv::Point3f> board_outline() {
+  const auto board = get_charuco_board();
+  const cv::Size squares = board->getChessboardSize();
+  const float length = board->getSquareLength();
+  return {
+    {0, squares.height * length, 0},
+    {squares.width * length, squares.height * length, 0},
+    {squares.width * length, 0, 0},
+    {0, 0, 0}
+  };
+}
+
+/**
+ * Renders the board as an ideal pinhole camera with no distortion would see
+ * it from `pose`.
+ */
+cv::Mat render_board(const Pose& pose) {
+  const auto board = get_charuco_board();
+  const cv::Size squares = board->getChessboardSize();
+  const cv::Size board_size{
+    squares.width * BOARD_PIXELS_PER_SQUARE,
+    squares.height * BOARD_PIXELS_PER_SQUARE
+  };
+  cv::Mat board_image;
+  board->draw(board_size, board_image, 0, 1);
+
+  const std::vector<cv::Point2f> source = {
+    {0, 0},
+    {static_cast<float>(board_size.width), 0},
+    {
+      static_cast<float>(board_size.width),
+      static_cast<float>(board_size.height)
+    },
+    {0, static_cast<float>(board_size.height)}
+  };
+  std::vector<cv::Point2f> destination;
+  cv::projectPoints(
+    board_outline(),
+    pose.rotation,
+    pose.translation,
+    camera_matrix(),
+    cv::noArray(),
+    destination
+  );
+
+  cv::Mat image;
+  cv::warpPerspective(
+    board_image,
+    image,
+    cv::getPerspectiveTransform(source, destination),
+    IMAGE_SIZE,
+    cv::INTER_LINEAR,
+    cv::BORDER_CONSTANT,
+    cv::Scalar::all(255)
+  );
+  cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+  return image;
+}
+
+/**
+ * A detection of every corner of the board, projected from `pose`.
+ */
+CharucoDetection project_board(const Pose& pose, std::size_t frame_index) {
+  const auto board = get_charuco_board();
+  std::vector<cv::Point2f> corners;
+  cv::projectPoints(
+    board->chessboardCorners,
+    pose.rotation,
+    pose.translation,
+    camera_matrix(),
+    cv::noArray(),
+    corners
+  );
+  CharucoDetection detection{.frame_index = frame_index};
+  cv::Mat{corners, true}.copyTo(detection.corners);
+  detection.ids = cv::Mat(static_cast<int>(corners.size()), 1, CV_32S);
+  for (int i = 0; i < detection.ids.rows; ++i) detection.ids.at<int>(i) = i;
+  return detection;
+}
+
+/**
+ * Board poses tilted every which way and moved around the image, with the
+ * board's center half a meter in front of the camera.
+ */
+std::vector<Pose> board_poses() {
+  const auto board = get_charuco_board();
+  const cv::Size squares = board->getChessboardSize();
+  const double length = board->getSquareLength();
+  std::vector<Pose> poses;
+  for (double tilt_x : {-0.4, 0.0, 0.4}) {
+    for (double tilt_y : {-0.4, 0.0, 0.4}) {
+      for (double shift : {-0.03, 0.03}) {
+        cv::Matx33d tilt;
+        cv::Rodrigues(cv::Vec3d{tilt_x, tilt_y, 0.0}, tilt);
+        // Turned over so the camera faces the printed side.
+        const cv::Matx33d rotation =
+          tilt * cv::Matx33d{1, 0, 0, 0, -1, 0, 0, 0, -1};
+        const cv::Vec3d center{
+          squares.width * length / 2,
+          squares.height * length / 2,
+          0.0
+        };
+        Pose pose{
+          .translation = cv::Vec3d{shift, -shift, 0.5} - rotation * center
+        };
+        cv::Rodrigues(rotation, pose.rotation);
+        poses.push_back(pose);
+      }
+    }
+  }
+  return poses;
+}
+
+path make_video() {
+  std::filesystem::create_directories(TEST_DIR);
+  const path video_path =
+    TEST_DIR / ("board" + video_extension(VideoCodec::FFV1));
+  if (std::filesystem::exists(video_path)) return video_path;
+
+  VideoWriter writer{video_path, IMAGE_SIZE, {.codec = VideoCodec::FFV1}};
+  const steady_clock::time_point start = steady_clock::now();
+  int i = 0;
+  for (const Pose& pose : board_poses()) {
+    writer.write(render_board(pose), start + milliseconds{33 * i++});
+  }
+  writer.close();
+  return video_path;
+}
+
+TEST(DetectCharuco, FindsEveryCorner) {
+  const Pose pose = board_poses()[1];
+  std::optional<CharucoDetection> detection =
+    detect_charuco(render_board(pose));
+  ASSERT_TRUE(detection);
+
+  const auto board = get_charuco_board();
+  EXPECT_EQ(
+    detection->ids.rows,
+    static_cast<int>(board->chessboardCorners.size())
+  );
+  EXPECT_EQ(detection->corners.rows, detection->ids.rows);
+}
+
+TEST(DetectCharuco, NothingInBlankImage) {
+  EXPECT_FALSE(
+    detect_charuco(cv::Mat{IMAGE_SIZE, CV_8UC3, cv::Scalar::all(255)})
+  );
+}
+
+double max_distance(
+  const CharucoDetection& actual,
+  const CharucoDetection& expected
+) {
+  double distance = 0.0;
+  for (int i = 0; i < actual.ids.rows; ++i) {
+    for (int j = 0; j < expected.ids.rows; ++j) {
+      if (actual.ids.at<int>(i) != expected.ids.at<int>(j)) continue;
+      distance = std::max<double>(
+        distance,
+        cv::norm(
+          actual.corners.at<cv::Point2f>(i) -
+          expected.corners.at<cv::Point2f>(j)
+        )
+      );
+    }
+  }
+  return distance;
+}
+
+TEST(CharucoDetector, DownscaledMatchesFullResolution) {
+  for (const Pose& pose : board_poses()) {
+    const cv::Mat image = render_board(pose);
+    std::optional<CharucoDetection> expected = detect_charuco(image);
+    std::optional<CharucoDetection> actual =
+      CharucoDetector{{.pyramid_levels = 1, .track = false}}.detect(image);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(actual);
+    EXPECT_EQ(actual->ids.rows, expected->ids.rows);
+    EXPECT_LT(max_distance(*actual, project_board(pose, 0)), 0.5);
+  }
+}
+
+TEST(CharucoDetector, TracksBoardBetweenFrames) {
+  CharucoDetector detector;
+  const cv::Rect full{cv::Point{0, 0}, IMAGE_SIZE};
+  const std::vector<Pose> poses = board_poses();
+  ASSERT_TRUE(detector.detect(render_board(poses[0])));
+  EXPECT_EQ(detector.search_area(), full);
+
+  // A slightly moved board is found searching only around where it was.
+  ASSERT_TRUE(detector.detect(render_board(poses[1])));
+  EXPECT_LT(detector.search_area().area(), full.area());
+
+  // Once lost, the whole image is searched again.
+  EXPECT_FALSE(
+    detector.detect(cv::Mat{IMAGE_SIZE, CV_8UC3, cv::Scalar::all(255)})
+  );
+  EXPECT_EQ(detector.search_area(), full);
+  ASSERT_TRUE(detector.detect(render_board(poses[0])));
+  EXPECT_EQ(detector.search_area(), full);
+}
+
+TEST(SelectViews, SkipsDuplicateViews) {
+  const Pose pose = board_poses().front();
+  std::vector<CharucoDetection> detections;
+  for (std::size_t i = 0; i < 10; ++i) {
+    detections.push_back(project_board(pose, i));
+  }
+  EXPECT_EQ(select_views(detections, IMAGE_SIZE).size(), 1);
+}
+
+TEST(SelectViews, PrefersDiverseViews) {
+  const std::vector<Pose> poses = board_poses();
+  std::vector<CharucoDetection> detections;
+  // Each pose is seen for several frames in a row, as it would be in a video.
+  for (std::size_t i = 0; i < poses.size() * 4; ++i) {
+    detections.push_back(project_board(poses[i / 4], i));
+  }
+
+  const std::vector<std::size_t> views = select_views(
+    detections,
+    IMAGE_SIZE,
+    {.max_views = poses.size()}
+  );
+  std::set<std::size_t> selected_poses;
+  for (std::size_t view : views) selected_poses.insert(view / 4);
+  EXPECT_EQ(selected_poses.size(), poses.size());
+}
+
+TEST(SelectViews, IgnoresPartialViews) {
+  CharucoDetection detection = project_board(board_poses().front(), 0);
+  detection.corners = detection.corners.rowRange(0, 3);
+  detection.ids = detection.ids.rowRange(0, 3);
+  EXPECT_TRUE(select_views({detection}, IMAGE_SIZE).empty());
+}
+
+TEST(CalibrateIntrinsics, RequiresEnoughViews) {
+  std::vector<CharucoDetection> views = {
+    project_board(board_poses().front(), 0)
+  };
+  EXPECT_THROW(
+    calibrate_intrinsics(views, IMAGE_SIZE),
+    std::invalid_argument
+  );
+}
+
+std::vector<CharucoDetection> project_views() {
+  std::vector<CharucoDetection> views;
+  for (const Pose& pose : board_poses()) {
+    views.push_back(project_board(pose, views.size()));
+  }
+  return views;
+}
+
+TEST(CalibrateIntrinsics, WarmStartMatchesColdStart) {
+  const std::vector<CharucoDetection> views = project_views();
+  const IntrinsicCalibration cold = calibrate_intrinsics(views, IMAGE_SIZE);
+  const IntrinsicCalibration warm = calibrate_intrinsics(
+    views,
+    IMAGE_SIZE,
+    calibrate_intrinsics(
+      std::vector<CharucoDetection>{views.begin(), views.begin() + 6},
+      IMAGE_SIZE
+    )
+  );
+  EXPECT_NEAR(
+    warm.matrix.at<double>(0, 0),
+    cold.matrix.at<double>(0, 0),
+    0.5
+  );
+  EXPECT_NEAR(warm.error, cold.error, 0.01);
+}
+
+TEST(BackgroundCalibration, SolvesNewestViews) {
+  const std::vector<CharucoDetection> all_views = project_views();
+  BackgroundCalibration calibration{IMAGE_SIZE};
+  EXPECT_FALSE(calibration.latest());
+
+  // Views saved in quick succession, as a user holding down the key would.
+  std::vector<CharucoDetection> views;
+  std::uint64_t revision = 0;
+  for (const CharucoDetection& view : all_views) {
+    views.push_back(view);
+    if (views.size() >= MIN_CALIBRATION_VIEWS) {
+      revision = calibration.update(views);
+    }
+  }
+  calibration.wait();
+
+  std::shared_ptr<const CalibrationUpdate> latest = calibration.latest();
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(latest->revision, revision);
+  EXPECT_EQ(latest->view_count, all_views.size());
+  EXPECT_NEAR(
+    latest->intrinsics.matrix.at<double>(0, 0),
+    FOCAL_LENGTH,
+    FOCAL_LENGTH * 0.01
+  );
+}
+
+TEST(BackgroundCalibration, RethrowsFailedSolveOnce) {
+  BackgroundCalibration calibration{IMAGE_SIZE};
+  calibration.update({project_board(board_poses().front(), 0)});
+  calibration.wait();
+  EXPECT_THROW(calibration.latest(), std::invalid_argument);
+  EXPECT_FALSE(calibration.latest());
+}
+
+TEST(CalibrateFromVideo, RecoversCameraMatrix) {
+  const VideoCalibration calibration =
+    calibrate_from_video(make_video(), {.sample_fps = 0.0, .threads = 3});
+
+  EXPECT_EQ(calibration.image_size, IMAGE_SIZE);
+  EXPECT_EQ(calibration.frames_scanned, board_poses().size());
+  EXPECT_EQ(calibration.detections, board_poses().size());
+  EXPECT_GE(calibration.views.size(), 5);
+  for (std::size_t i = 1; i < calibration.views.size(); ++i) {
+    EXPECT_LT(
+      calibration.views[i - 1].frame_index,
+      calibration.views[i].frame_index
+    );
+  }
+
+  const cv::Mat& matrix = calibration.intrinsics.matrix;
+  EXPECT_LT(calibration.intrinsics.error, 1.0);
+  EXPECT_NEAR(matrix.at<double>(0, 0), FOCAL_LENGTH, FOCAL_LENGTH * 0.03);
+  EXPECT_NEAR(matrix.at<double>(1, 1), FOCAL_LENGTH, FOCAL_LENGTH * 0.03);
+  EXPECT_NEAR(matrix.at<double>(0, 2), IMAGE_SIZE.width / 2.0, 10.0);
+  EXPECT_NEAR(matrix.at<double>(1, 2), IMAGE_SIZE.height / 2.0, 10.0);
+}
+
+}
@@ -0,0 +1,740 @@
+#include "src/extrinsics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/cameras.h"
+#include "src/charuco.h"
+
+namespace {
+
+using Matx26d = cv::Matx<double, 2, 6>;
+using Matx66d = cv::Matx<double, 6, 6>;
+using Vec6d = cv::Vec<double, 6>;
+
+constexpr int CUBE_SQUARES = 5;
+
+// Points closer to a camera than this are treated as behind it.
+constexpr double MIN_DEPTH = 1e-6;
+
+/**
+ * Rigid transform taking points from one frame into another.
+ */
+struct Pose {
+  cv::Matx33d rotation = cv::Matx33d::eye();
+  cv::Vec3d translation;
+
+  cv::Vec3d operator()(const cv::Vec3d& point) const {
+    return rotation * point + translation;
+  }
+};
+
+Pose compose(const Pose& outer, const Pose& inner) {
+  return Pose{
+    .rotation = outer.rotation * inner.rotation,
+    .translation = outer.rotation * inner.translation + outer.translation
+  };
+}
+
+Pose inverse(const Pose& pose) {
+  const cv::Matx33d rotation = pose.rotation.t();
+  return Pose{
+    .rotation = rotation,
+    .translation = -(rotation * pose.translation)
+  };
+}
+
+cv::Matx33d exp_rotation(const cv::Vec3d& rotation_vector) {
+  cv::Matx33d rotation;
+  cv::Rodrigues(rotation_vector, rotation);
+  return rotation;
+}
+
+/**
+ * Applies a step to a pose, rotating about the pose's destination frame.
+ */
+Pose update(const Pose& pose, const Vec6d& step) {
+  return Pose{
+    .rotation = exp_rotation({step[0], step[1], step[2]}) * pose.rotation,
+    .translation = pose.translation + cv::Vec3d{step[3], step[4], step[5]}
+  };
+}
+
+cv::Matx33d skew(const cv::Vec3d& v) {
+  return {
+    0, -v[2], v[1],
+    v[2], 0, -v[0],
+    -v[1], v[0], 0
+  };
+}
+
+/**
+ * Places the 3 columns of `right` after those of `left`.
+ */
+Matx26d concat(const cv::Matx23d& left, const cv::Matx23d& right) {
+  Matx26d result;
+  for (int row = 0; row < 2; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      result(row, col) = left(row, col);
+      result(row, col + 3) = right(row, col);
+    }
+  }
+  return result;
+}
+
+cv::Ptr<cv::aruco::CharucoBoard> make_cube_board(
+  float square_length,
+  int face
+) {
+  cv::Ptr<cv::aruco::CharucoBoard> board = cv::aruco::CharucoBoard::create(
+    CUBE_SQUARES, CUBE_SQUARES,
+    square_length, square_length / 2,
+    cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250)
+  );
+  const int marker_count = static_cast<int>(board->ids.size());
+  for (int& id : board->ids) id += face * marker_count;
+  return board;
+}
+
+/**
+ * Huber weight and cost of a residual of the given length.
+ */
+std::pair<double, double> huber(double length, double delta) {
+  if (length <= delta) return {1.0, length * length};
+  return {delta / length, 2 * delta * length - delta * delta};
+}
+
+/**
+ * Indices into the solver's compact arrays for one observation.
+ */
+struct Residual {
+  std::size_t camera;
+  std::size_t frame;
+  cv::Vec3d point;
+  cv::Point2d normalized;
+};
+
+/**
+ * Sparse normal equations of one Levenberg-Marquardt step. Camera blocks
+ * are few and end up dense; frame blocks only touch the cameras that saw
+ * them.
+ */
+struct NormalEquations {
+  std::vector<Matx66d> cameras;
+  std::vector<Vec6d> camera_gradients;
+  std::vector<Matx66d> frames;
+  std::vector<Vec6d> frame_gradients;
+  // Camera-frame coupling, one block for each pair seen together.
+  std::vector<Matx66d> pairs;
+  double cost = 0.0;
+};
+
+class BundleAdjuster {
+public:
+  BundleAdjuster(
+    std::vector<Residual> residuals,
+    std::vector<double> focal_lengths,
+    std::vector<Pose> cameras,
+    std::vector<Pose> frames,
+    std::size_t fixed_camera,
+    const ExtrinsicOptions& options
+  ):
+    _residuals{std::move(residuals)},
+    _focal_lengths{std::move(focal_lengths)},
+    _cameras{std::move(cameras)},
+    _frames{std::move(frames)},
+    _fixed_camera{fixed_camera},
+    _options{options}
+  {
+    std::map<std::pair<std::size_t, std::size_t>, std::size_t> pair_indices;
+    _frame_pairs.resize(_frames.size());
+    for (const Residual& residual : _residuals) {
+      const auto [itr, inserted] = pair_indices.try_emplace(
+        {residual.frame, residual.camera},
+        _pair_cameras.size()
+      );
+      if (inserted) {
+        _pair_cameras.push_back(residual.camera);
+        _frame_pairs[residual.frame].push_back(itr->second);
+      }
+      _residual_pairs.push_back(itr->second);
+    }
+  }
+
+  int solve() {
+    double lambda = 1e-4;
+    NormalEquations equations = _linearize();
+    int iterations = 0;
+    while (iterations < _options.max_iterations) {
+      ++iterations;
+      std::vector<Vec6d> camera_steps;
+      std::vector<Vec6d> frame_steps;
+      _step(equations, lambda, camera_steps, frame_steps);
+
+      std::vector<Pose> cameras = _cameras;
+      std::vector<Pose> frames = _frames;
+      for (std::size_t i = 0; i < _cameras.size(); ++i) {
+        _cameras[i] = update(_cameras[i], camera_steps[i]);
+      }
+      for (std::size_t i = 0; i < _frames.size(); ++i) {
+        _frames[i] = update(_frames[i], frame_steps[i]);
+      }
+
+      NormalEquations next = _linearize();
+      if (next.cost < equations.cost) {
+        const double improvement =
+          (equations.cost - next.cost) / equations.cost;
+        equations = std::move(next);
+        lambda = std::max(lambda / 10, 1e-12);
+        if (improvement < _options.tolerance) break;
+      } else {
+        // Too bold a step, back off towards gradient descent.
+        _cameras = std::move(cameras);
+        _frames = std::move(frames);
+        lambda *= 10;
+        if (lambda > 1e12) break;
+      }
+    }
+    return iterations;
+  }
+
+  const std::vector<Pose>& cameras() const { return _cameras; }
+  const std::vector<Pose>& frames() const { return _frames; }
+
+  /**
+   * Sum of squared pixel errors and observation count for each camera.
+   */
+  std::vector<std::pair<double, std::size_t>> camera_errors() const {
+    std::vector<std::pair<double, std::size_t>> errors(_cameras.size());
+    for (const Residual& residual : _residuals) {
+      const std::optional<cv::Vec2d> error = _error(residual);
+      if (!error) continue;
+      errors[residual.camera].first += error->dot(*error);
+      ++errors[residual.camera].second;
+    }
+    return errors;
+  }
+
+private:
+  /**
+   * Reprojection error in pixels, if the point is in front of the camera.
+   */
+  std::optional<cv::Vec2d> _error(const Residual& residual) const {
+    const cv::Vec3d point =
+      _cameras[residual.camera](_frames[residual.frame](residual.point));
+    if (point[2] < MIN_DEPTH) return std::nullopt;
+    const double focal_length = _focal_lengths[residual.camera];
+    return cv::Vec2d{
+      focal_length * (point[0] / point[2] - residual.normalized.x),
+      focal_length * (point[1] / point[2] - residual.normalized.y)
+    };
+  }
+
+  NormalEquations _linearize() const {
+    NormalEquations equations{
+      .cameras = std::vector<Matx66d>(_cameras.size(), Matx66d::zeros()),
+      .camera_gradients = std::vector<Vec6d>(_cameras.size()),
+      .frames = std::vector<Matx66d>(_frames.size(), Matx66d::zeros()),
+      .frame_gradients = std::vector<Vec6d>(_frames.size()),
+      .pairs = std::vector<Matx66d>(_pair_cameras.size(), Matx66d::zeros())
+    };
+    for (std::size_t i = 0; i < _residuals.size(); ++i) {
+      const Residual& residual = _residuals[i];
+      const Pose& camera = _cameras[residual.camera];
+      const Pose& frame = _frames[residual.frame];
+      const cv::Vec3d rotated = frame.rotation * residual.point;
+      const cv::Vec3d world = rotated + frame.translation;
+      const cv::Vec3d point = camera(world);
+      if (point[2] < MIN_DEPTH) {
+        // Counted at its worst so steps cannot win by hiding points.
+        equations.cost += huber(1e6, _options.huber_pixels).second;
+        continue;
+      }
+
+      const double focal_length = _focal_lengths[residual.camera];
+      const double z = point[2];
+      const cv::Vec2d error{
+        focal_length * (point[0] / z - residual.normalized.x),
+        focal_length * (point[1] / z - residual.normalized.y)
+      };
+      const auto [weight, cost] =
+        huber(std::sqrt(error.dot(error)), _options.huber_pixels);
+      equations.cost += cost;
+
+      const cv::Matx23d projection{
+        focal_length / z, 0, -focal_length * point[0] / (z * z),
+        0, focal_length / z, -focal_length * point[1] / (z * z)
+      };
+      const Matx26d camera_jacobian = concat(
+        projection * -skew(camera.rotation * world),
+        projection
+      );
+      const cv::Matx23d to_camera = projection * camera.rotation;
+      const Matx26d frame_jacobian =
+        concat(to_camera * -skew(rotated), to_camera);
+
+      equations.cameras[residual.camera] +=
+        weight * (camera_jacobian.t() * camera_jacobian);
+      equations.camera_gradients[residual.camera] +=
+        weight * (camera_jacobian.t() * error);
+      equations.frames[residual.frame] +=
+        weight * (frame_jacobian.t() * frame_jacobian);
+      equations.frame_gradients[residual.frame] +=
+        weight * (frame_jacobian.t() * error);
+      equations.pairs[_residual_pairs[i]] +=
+        weight * (camera_jacobian.t() * frame_jacobian);
+    }
+    return equations;
+  }
+
+  /**
+   * Solves the damped normal equations, eliminating the frames first.
+   *
+   * With cameras c and frames f the system is [A B; B' D] [dc; df] = -[gc;
+   * gf] where D is block diagonal. The cameras are solved from the reduced
+   * system (A - B D^-1 B') dc = -gc + B D^-1 gf, then each frame from
+   * D df = -gf - B' dc.
+   */
+  void _step(
+    const NormalEquations& equations,
+    double lambda,
+    std::vector<Vec6d>& camera_steps,
+    std::vector<Vec6d>& frame_steps
+  ) const {
+    const auto damp = [lambda](Matx66d block) {
+      for (int i = 0; i < 6; ++i) {
+        block(i, i) += lambda * block(i, i) + 1e-12;
+      }
+      return block;
+    };
+
+    // The fixed camera anchors the solution, it has no unknowns.
+    std::vector<int> offsets(_cameras.size(), -1);
+    int unknowns = 0;
+    for (std::size_t i = 0; i < _cameras.size(); ++i) {
+      if (i == _fixed_camera) continue;
+      offsets[i] = unknowns;
+      unknowns += 6;
+    }
+
+    cv::Mat reduced = cv::Mat::zeros(unknowns, unknowns, CV_64F);
+    cv::Mat right = cv::Mat::zeros(unknowns, 1, CV_64F);
+    const auto add_block = [&](int row, int col, const Matx66d& block) {
+      for (int r = 0; r < 6; ++r) {
+        for (int c = 0; c < 6; ++c) {
+          reduced.at<double>(row + r, col + c) += block(r, c);
+        }
+      }
+    };
+    const auto add_vector = [&](int row, const Vec6d& vector) {
+      for (int r = 0; r < 6; ++r) right.at<double>(row + r) += vector[r];
+    };
+    for (std::size_t i = 0; i < _cameras.size(); ++i) {
+      if (offsets[i] < 0) continue;
+      add_block(offsets[i], offsets[i], damp(equations.cameras[i]));
+      add_vector(offsets[i], -equations.camera_gradients[i]);
+    }
+
+    std::vector<Matx66d> frame_inverses(_frames.size());
+    for (std::size_t f = 0; f < _frames.size(); ++f) {
+      frame_inverses[f] = damp(equations.frames[f]).inv(cv::DECOMP_CHOLESKY);
+      for (std::size_t first : _frame_pairs[f]) {
+        const int row = offsets[_pair_cameras[first]];
+        if (row < 0) continue;
+        const Matx66d coupling = equations.pairs[first] * frame_inverses[f];
+        add_vector(row, coupling * equations.frame_gradients[f]);
+        for (std::size_t second : _frame_pairs[f]) {
+          const int col = offsets[_pair_cameras[second]];
+          if (col < 0) continue;
+          add_block(row, col, -(coupling * equations.pairs[second].t()));
+        }
+      }
+    }
+
+    cv::Mat solution;
+    if (unknowns > 0) cv::solve(reduced, right, solution, cv::DECOMP_CHOLESKY);
+    camera_steps.assign(_cameras.size(), Vec6d{});
+    for (std::size_t i = 0; i < _cameras.size(); ++i) {
+      if (offsets[i] < 0) continue;
+      for (int r = 0; r < 6; ++r) {
+        camera_steps[i][r] = solution.at<double>(offsets[i] + r);
+      }
+    }
+
+    frame_steps.assign(_frames.size(), Vec6d{});
+    for (std::size_t f = 0; f < _frames.size(); ++f) {
+      Vec6d gradient = -equations.frame_gradients[f];
+      for (std::size_t pair : _frame_pairs[f]) {
+        gradient -=
+          equations.pairs[pair].t() * camera_steps[_pair_cameras[pair]];
+      }
+      frame_steps[f] = frame_inverses[f] * gradient;
+    }
+  }
+
+  std::vector<Residual> _residuals;
+  std::vector<double> _focal_lengths;
+  std::vector<Pose> _cameras;
+  std::vector<Pose> _frames;
+  std::size_t _fixed_camera;
+  ExtrinsicOptions _options;
+
+  std::vector<std::size_t> _pair_cameras;
+  std::vector<std::vector<std::size_t>> _frame_pairs;
+  std::vector<std::size_t> _residual_pairs;
+};
+
+}
+
+CalibrationTarget::CalibrationTarget(std::vector<TargetFace> faces):
+  _faces{std::move(faces)},
+  _parameters{cv::aruco::DetectorParameters::create()}
+{
+  if (_faces.empty()) {
+    throw std::invalid_argument("A calibration target needs a board.");
+  }
+  _dictionary = _faces.front().board->dictionary;
+  _parameters->cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX;
+  for (const TargetFace& face : _faces) {
+    _face_offsets.push_back(static_cast<int>(_points.size()));
+    for (const cv::Point3f& corner : face.board->chessboardCorners) {
+      const cv::Vec3d point =
+        face.rotation * cv::Vec3d{corner.x, corner.y, corner.z} +
+        face.translation;
+      _points.emplace_back(point[0], point[1], point[2]);
+    }
+  }
+}
+
+CalibrationTarget CalibrationTarget::board() {
+  return CalibrationTarget{{TargetFace{.board = get_charuco_board()}}};
+}
+
+CalibrationTarget CalibrationTarget::cube(float square_length) {
+  const double side = CUBE_SQUARES * square_length;
+  // Each board's X and Y axes on the cube, its Z being the face's outward
+  // normal.
+  const std::vector<std::pair<cv::Vec3d, cv::Vec3d>> axes = {
+    {{1, 0, 0}, {0, 1, 0}},
+    {{0, 1, 0}, {0, 0, 1}},
+    {{-1, 0, 0}, {0, 0, 1}},
+    {{0, -1, 0}, {0, 0, 1}},
+    {{1, 0, 0}, {0, 0, 1}}
+  };
+  std::vector<TargetFace> faces;
+  for (std::size_t i = 0; i < axes.size(); ++i) {
+    const auto& [x_axis, y_axis] = axes[i];
+    const cv::Vec3d normal = x_axis.cross(y_axis);
+    TargetFace& face = faces.emplace_back(TargetFace{
+      .board = make_cube_board(square_length, static_cast<int>(i)),
+      .translation = (normal - x_axis - y_axis) * (side / 2)
+    });
+    for (int row = 0; row < 3; ++row) {
+      face.rotation(row, 0) = x_axis[row];
+      face.rotation(row, 1) = y_axis[row];
+      face.rotation(row, 2) = normal[row];
+    }
+  }
+  return CalibrationTarget{std::move(faces)};
+}
+
+std::optional<TargetView> CalibrationTarget::detect(
+  const cv::Mat& image
+) const {
+  std::vector<int> marker_ids;
+  std::vector<std::vector<cv::Point2f>> marker_corners;
+  cv::aruco::detectMarkers(
+    image,
+    _dictionary,
+    marker_corners,
+    marker_ids,
+    _parameters
+  );
+  if (marker_ids.empty()) return std::nullopt;
+
+  TargetView view;
+  for (std::size_t i = 0; i < _faces.size(); ++i) {
+    const cv::Ptr<cv::aruco::CharucoBoard>& board = _faces[i].board;
+    std::vector<int> face_ids;
+    std::vector<std::vector<cv::Point2f>> face_corners;
+    for (std::size_t j = 0; j < marker_ids.size(); ++j) {
+      if (
+        std::find(board->ids.begin(), board->ids.end(), marker_ids[j]) ==
+        board->ids.end()
+      ) {
+        continue;
+      }
+      face_ids.push_back(marker_ids[j]);
+      face_corners.push_back(marker_corners[j]);
+    }
+    if (face_ids.empty()) continue;
+
+    std::vector<cv::Point2f> corners;
+    std::vector<int> ids;
+    cv::aruco::interpolateCornersCharuco(
+      face_corners,
+      face_ids,
+      image,
+      board,
+      corners,
+      ids
+    );
+    for (std::size_t j = 0; j < ids.size(); ++j) {
+      view.point_ids.push_back(_face_offsets[i] + ids[j]);
+      view.pixels.push_back(corners[j]);
+    }
+  }
+  if (view.point_ids.empty()) return std::nullopt;
+  return view;
+}
+
+ExtrinsicCalibration::ExtrinsicCalibration(
+  std::vector<CameraParameters> cameras,
+  CalibrationTarget target,
+  ExtrinsicOptions options
+):
+  _cameras{std::move(cameras)},
+  _target{std::move(target)},
+  _options{options}
+{
+  for (const CameraParameters& camera : _cameras) {
+    if (camera.matrix.empty()) {
+      throw std::invalid_argument(
+        "Camera " + camera.device.device_path.string() + " has no intrinsics."
+      );
+    }
+  }
+}
+
+void ExtrinsicCalibration::add_view(
+  std::size_t camera,
+  std::uint64_t frame,
+  const TargetView& view
+) {
+  if (static_cast<int>(view.point_ids.size()) < _options.min_corners) return;
+
+  // Distortion is removed once here so the solver works with ideal pinhole
+  // projections.
+  std::vector<cv::Point2f> normalized;
+  cv::undistortPoints(
+    view.pixels,
+    normalized,
+    _cameras.at(camera).matrix,
+    _cameras.at(camera).distortion
+  );
+  for (std::size_t i = 0; i < normalized.size(); ++i) {
+    _observations.push_back(Observation{
+      .camera = camera,
+      .frame = frame,
+      .point = view.point_ids[i],
+      .normalized = normalized[i]
+    });
+  }
+  ++_view_count;
+}
+
+ExtrinsicResult ExtrinsicCalibration::solve() const {
+  // Views grouped by frame and then camera, each with its corners.
+  std::map<std::uint64_t, std::map<std::size_t, std::vector<std::size_t>>>
+    views;
+  for (std::size_t i = 0; i < _observations.size(); ++i) {
+    views[_observations[i].frame][_observations[i].camera].push_back(i);
+  }
+
+  // Only frames seen by several cameras say anything about where cameras are
+  // relative to each other.
+  std::vector<std::uint64_t> frame_ids;
+  for (const auto& [frame, cameras] : views) {
+    if (cameras.size() >= 2) frame_ids.push_back(frame);
+  }
+
+  // Where the target was relative to each camera that saw it, from that
+  // camera's view alone.
+  std::vector<std::map<std::size_t, Pose>> view_poses(frame_ids.size());
+  for (std::size_t f = 0; f < frame_ids.size(); ++f) {
+    for (const auto& [camera, indices] : views[frame_ids[f]]) {
+      std::vector<cv::Point3d> object_points;
+      std::vector<cv::Point2d> image_points;
+      for (std::size_t i : indices) {
+        object_points.push_back(_target.point(_observations[i].point));
+        image_points.push_back(_observations[i].normalized);
+      }
+      cv::Vec3d rotation;
+      cv::Vec3d translation;
+      if (
+        !cv::solvePnP(
+          object_points,
+          image_points,
+          cv::Matx33d::eye(),
+          cv::noArray(),
+          rotation,
+          translation
+        )
+      ) {
+        continue;
+      }
+      view_poses[f][camera] = Pose{
+        .rotation = exp_rotation(rotation),
+        .translation = translation
+      };
+    }
+  }
+
+  // Chain cameras together starting from the one with the most views, each
+  // time through the frame most strongly linking a placed camera to one not
+  // yet placed.
+  std::vector<std::size_t> view_counts(_cameras.size(), 0);
+  for (const auto& poses : view_poses) {
+    for (const auto& [camera, pose] : poses) ++view_counts[camera];
+  }
+  const std::size_t fixed_camera = std::distance(
+    view_counts.begin(),
+    std::max_element(view_counts.begin(), view_counts.end())
+  );
+  std::vector<std::optional<Pose>> cameras(_cameras.size());
+  cameras[fixed_camera] = Pose{};
+  while (true) {
+    std::optional<std::pair<std::size_t, Pose>> best;
+    std::size_t best_corners = 0;
+    for (std::size_t f = 0; f < frame_ids.size(); ++f) {
+      const auto& camera_views = views[frame_ids[f]];
+      for (const auto& [placed, placed_pose] : view_poses[f]) {
+        if (!cameras[placed]) continue;
+        for (const auto& [camera, pose] : view_poses[f]) {
+          if (cameras[camera]) continue;
+          const std::size_t corners = std::min(
+            camera_views.at(placed).size(),
+            camera_views.at(camera).size()
+          );
+          if (corners <= best_corners) continue;
+          best_corners = corners;
+          best = std::make_pair(
+            camera,
+            compose(compose(pose, inverse(placed_pose)), *cameras[placed])
+          );
+        }
+      }
+    }
+    if (!best) break;
+    cameras[best->first] = best->second;
+  }
+  for (std::size_t i = 0; i < cameras.size(); ++i) {
+    if (cameras[i]) continue;
+    throw std::runtime_error(
+      "Camera " + _cameras[i].device.device_path.string() +
+      " never saw the target at the same time as the other cameras."
+    );
+  }
+
+  // Each frame's target pose starts from the camera seeing most of it.
+  std::vector<Pose> frames;
+  std::map<std::uint64_t, std::size_t> frame_indices;
+  for (std::size_t f = 0; f < frame_ids.size(); ++f) {
+    std::optional<std::size_t> best;
+    for (const auto& [camera, pose] : view_poses[f]) {
+      if (
+        !best ||
+        views[frame_ids[f]][camera].size() > views[frame_ids[f]][*best].size()
+      ) {
+        best = camera;
+      }
+    }
+    if (!best) continue;
+    frame_indices[frame_ids[f]] = frames.size();
+    frames.push_back(
+      compose(inverse(*cameras[*best]), view_poses[f].at(*best))
+    );
+  }
+
+  std::vector<Residual> residuals;
+  for (const Observation& observation : _observations) {
+    auto itr = frame_indices.find(observation.frame);
+    if (itr == frame_indices.end()) continue;
+    const cv::Point3d& point = _target.point(observation.point);
+    residuals.push_back(Residual{
+      .camera = observation.camera,
+      .frame = itr->second,
+      .point = {point.x, point.y, point.z},
+      .normalized = observation.normalized
+    });
+  }
+  if (residuals.empty()) {
+    throw std::runtime_error(
+      "The target was never seen by several cameras at the same time."
+    );
+  }
+
+  std::vector<double> focal_lengths;
+  std::vector<Pose> initial_cameras;
+  for (std::size_t i = 0; i < _cameras.size(); ++i) {
+    const cv::Mat& matrix = _cameras[i].matrix;
+    focal_lengths.push_back(
+      (matrix.at<double>(0, 0) + matrix.at<double>(1, 1)) / 2
+    );
+    initial_cameras.push_back(*cameras[i]);
+  }
+
+  BundleAdjuster adjuster{
+    std::move(residuals),
+    std::move(focal_lengths),
+    std::move(initial_cameras),
+    std::move(frames),
+    fixed_camera,
+    _options
+  };
+  ExtrinsicResult result;
+  result.iterations = adjuster.solve();
+  result.frames = adjuster.frames().size();
+
+  // Move the world onto the target where the most cameras saw it.
+  std::size_t world_frame = 0;
+  std::size_t most_cameras = 0;
+  for (const auto& [frame, index] : frame_indices) {
+    if (views[frame].size() > most_cameras) {
+      most_cameras = views[frame].size();
+      world_frame = index;
+    }
+  }
+  const Pose& world = adjuster.frames()[world_frame];
+  double total_error = 0.0;
+  for (std::size_t i = 0; i < _cameras.size(); ++i) {
+    const Pose camera = compose(adjuster.cameras()[i], world);
+    cv::Vec3d rotation;
+    cv::Rodrigues(camera.rotation, rotation);
+    result.rotations.push_back(rotation);
+    result.translations.push_back(camera.translation);
+  }
+  for (const auto& [squared_error, count] : adjuster.camera_errors()) {
+    total_error += squared_error;
+    result.observations += count;
+    result.camera_errors.push_back(
+      count > 0 ? std::sqrt(squared_error / count) : 0.0
+    );
+  }
+  if (result.observations > 0) {
+    result.error = std::sqrt(total_error / result.observations);
+  }
+  return result;
+}
+
+std::vector<CameraParameters> ExtrinsicCalibration::apply(
+  const ExtrinsicResult& result
+) const {
+  std::vector<CameraParameters> cameras = _cameras;
+  for (std::size_t i = 0; i < cameras.size(); ++i) {
+    cameras[i].rotation = cv::Mat{result.rotations.at(i), true};
+    cameras[i].translation = cv::Mat{result.translations.at(i), true};
+  }
+  return cameras;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/aruco.hpp>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <vector>
+
+#include "src/cameras.h"
+
+/**
+ * One ChArUco board of a calibration target and where it sits on it.
+ */
+struct TargetFace {
+  cv::Ptr<cv::aruco::CharucoBoard> board;
+
+  // Maps the board's coordinates into the target's.
+  cv::Matx33d rotation = cv::Matx33d::eye();
+  cv::Vec3d translation;
+};
+
+/**
+ * Board corners of a target seen in one image.
+ */
+struct TargetView {
+  // Index of each corner among all of the target's corners.
+  std::vector<int> point_ids;
+  std::vector<cv::Point2f> pixels;
+};
+
+/**
+ * A rigid object covered in ChArUco boards, each with its own markers, that
+ * cameras around it can see at the same time.
+ */
+class CalibrationTarget {
+public:
+  explicit CalibrationTarget(std::vector<TargetFace> faces);
+  ~CalibrationTarget() = default;
+  CalibrationTarget(const CalibrationTarget&) = default;
+  CalibrationTarget(CalibrationTarget&&) = default;
+  CalibrationTarget& operator=(const CalibrationTarget&) = default;
+  CalibrationTarget& operator=(CalibrationTarget&&) = default;
+
+  /**
+   * The flat board used for intrinsic calibration, on its own.
+   */
+  static CalibrationTarget board();
+
+  /**
+   * A cube with a 5x5 board of `square_length` squares on its top and four
+   * sides. The cube's origin is its center, with Z up through the top.
+   *
+   * Each face's markers follow on from the previous face's ids, starting
+   * from the top and then going around the sides facing +X, +Y, -X and -Y.
+   * Each board's origin, the bottom left of its print, is at the bottom of
+   * its side, or at the -X -Y corner of the top. Its X axis runs
+   * counterclockwise around the cube seen from above, or along +X on top.
+   */
+  static CalibrationTarget cube(float square_length = 0.04f);
+
+  const std::vector<TargetFace>& faces() const { return _faces; }
+  std::size_t point_count() const { return _points.size(); }
+
+  /**
+   * A corner's position in the target's coordinates.
+   */
+  const cv::Point3d& point(int id) const { return _points.at(id); }
+
+  /**
+   * Detects the target's boards in an image. Returns nothing if no corner
+   * was found.
+   */
+  std::optional<TargetView> detect(const cv::Mat& image) const;
+
+private:
+  std::vector<TargetFace> _faces;
+  std::vector<int> _face_offsets;
+  std::vector<cv::Point3d> _points;
+  cv::Ptr<cv::aruco::Dictionary> _dictionary;
+  cv::Ptr<cv::aruco::DetectorParameters> _parameters;
+};
+
+struct ExtrinsicOptions {
+  // Views with fewer corners than this are not used. A pose from a handful
+  // of corners is too noisy to start from.
+  int min_corners = 6;
+
+  // Reprojection errors beyond this many pixels count linearly instead of
+  // quadratically, so a few bad corners do not drag the solution.
+  double huber_pixels = 2.0;
+
+  int max_iterations = 50;
+
+  // Solving stops once an iteration improves the error by less than this
+  // fraction.
+  double tolerance = 1e-9;
+};
+
+struct ExtrinsicResult {
+  // Rotation and translation from the world into each camera, as a
+  // Rodrigues vector and a vector, in the order the cameras were given.
+  std::vector<cv::Vec3d> rotations;
+  std::vector<cv::Vec3d> translations;
+
+  // RMS reprojection error in pixels, overall and for each camera.
+  double error = 0.0;
+  std::vector<double> camera_errors;
+
+  std::size_t frames = 0;
+  std::size_t observations = 0;
+  int iterations = 0;
+};
+
+/**
+ * Calibrates where cameras are relative to each other from views of a
+ * target they see at the same time.
+ *
+ * Every camera's pose and the target's pose in every frame are refined
+ * together by bundle adjustment, minimizing the reprojection error of all
+ * corners seen. Target poses are eliminated from each Levenberg-Marquardt
+ * step through the Schur complement. The step then only solves for the
+ * cameras, so its cost hardly grows with the number of frames.
+ *
+ * The world is the target as it was in the frame seen by the most cameras.
+ */
+class ExtrinsicCalibration {
+public:
+  /**
+   * `cameras` must already have their intrinsics calibrated.
+   */
+  ExtrinsicCalibration(
+    std::vector<CameraParameters> cameras,
+    CalibrationTarget target,
+    ExtrinsicOptions options = {}
+  );
+  ~ExtrinsicCalibration() = default;
+  ExtrinsicCalibration(const ExtrinsicCalibration&) = default;
+  ExtrinsicCalibration(ExtrinsicCalibration&&) = default;
+  ExtrinsicCalibration& operator=(const ExtrinsicCalibration&) = default;
+  ExtrinsicCalibration& operator=(ExtrinsicCalibration&&) = default;
+
+  /**
+   * Adds what `camera` saw of the target in `frame`. Views of the same frame
+   * from different cameras must have been captured at the same time.
+   */
+  void add_view(
+    std::size_t camera,
+    std::uint64_t frame,
+    const TargetView& view
+  );
+
+  std::size_t view_count() const { return _view_count; }
+
+  /**
+   * Throws if some camera never saw the target at the same time as the
+   * others.
+   */
+  ExtrinsicResult solve() const;
+
+  /**
+   * The cameras given with their rotation and translation set from `result`.
+   */
+  std::vector<CameraParameters> apply(const ExtrinsicResult& result) const;
+
+private:
+  struct Observation {
+    std::size_t camera;
+    std::uint64_t frame;
+    int point;
+    cv::Point2d normalized;
+  };
+
+  std::vector<CameraParameters> _cameras;
+  CalibrationTarget _target;
+  ExtrinsicOptions _options;
+  std::vector<Observation> _observations;
+  std::size_t _view_count = 0;
+};
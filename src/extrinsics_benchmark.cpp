@@ -0,0 +1,164 @@
+#include <cmath>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/cameras.h"
+#include "src/extrinsics.h"
+
+namespace {
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+CameraParameters make_camera(int id) {
+  return CameraParameters{
+    .device = {.device_path = "/dev/video" + std::to_string(id)},
+    .matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone(),
+    .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone()
+  };
+}
+
+/**
+ * World to camera rotation and translation of a camera at `eye` looking at
+ * the origin.
+ */
+std::pair<cv::Matx33d, cv::Vec3d> look_at_origin(const cv::Vec3d& eye) {
+  const cv::Vec3d forward = cv::normalize(-eye);
+  const cv::Vec3d right = cv::normalize(cv::Vec3d{0, 0, -1}.cross(forward));
+  const cv::Vec3d down = forward.cross(right);
+  cv::Matx33d rotation;
+  for (int col = 0; col < 3; ++col) {
+    rotation(0, col) = right[col];
+    rotation(1, col) = down[col];
+    rotation(2, col) = forward[col];
+  }
+  return {rotation, -(rotation * eye)};
+}
+
+/**
+ * A calibration with `camera_count` cameras in a ring seeing the cube being
+ * carried around between them for `frame_count` frames, corners detected
+ * with half a pixel of noise.
+ */
+ExtrinsicCalibration make_calibration(int camera_count, int frame_count) {
+  const CalibrationTarget cube = CalibrationTarget::cube();
+  std::vector<CameraParameters> parameters;
+  std::vector<std::pair<cv::Matx33d, cv::Vec3d>> cameras;
+  for (int i = 0; i < camera_count; ++i) {
+    const double angle = 2 * CV_PI * i / camera_count;
+    parameters.push_back(make_camera(i));
+    cameras.push_back(
+      look_at_origin({2.0 * std::cos(angle), 2.0 * std::sin(angle), 1.0})
+    );
+  }
+  ExtrinsicCalibration calibration{parameters, cube};
+
+  cv::RNG rng{7};
+  const cv::Rect2f image{
+    0, 0,
+    static_cast<float>(IMAGE_SIZE.width),
+    static_cast<float>(IMAGE_SIZE.height)
+  };
+  for (int frame = 0; frame < frame_count; ++frame) {
+    cv::Matx33d pose;
+    cv::Rodrigues(
+      cv::Vec3d{
+        rng.uniform(-0.3, 0.3),
+        rng.uniform(-0.3, 0.3),
+        rng.uniform(-CV_PI, CV_PI)
+      },
+      pose
+    );
+    const cv::Vec3d position{
+      rng.uniform(-0.5, 0.5),
+      rng.uniform(-0.5, 0.5),
+      rng.uniform(0.0, 0.4)
+    };
+
+    for (int camera = 0; camera < camera_count; ++camera) {
+      const auto& [rotation, translation] = cameras[camera];
+      std::vector<int> ids;
+      std::vector<cv::Point3d> points;
+      int offset = 0;
+      for (const TargetFace& face : cube.faces()) {
+        const cv::Vec3d normal = rotation * pose * face.rotation.col(2);
+        const int corner_count =
+          static_cast<int>(face.board->chessboardCorners.size());
+        for (int id = offset; id < offset + corner_count; ++id) {
+          const cv::Point3d& corner = cube.point(id);
+          const cv::Vec3d point =
+            pose * cv::Vec3d{corner.x, corner.y, corner.z} + position;
+          const cv::Vec3d seen = rotation * point + translation;
+          if (normal.dot(seen) > -0.3 * cv::norm(seen)) continue;
+          ids.push_back(id);
+          points.emplace_back(point[0], point[1], point[2]);
+        }
+        offset += corner_count;
+      }
+      if (points.empty()) continue;
+
+      cv::Vec3d rotation_vector;
+      cv::Rodrigues(rotation, rotation_vector);
+      std::vector<cv::Point2f> pixels;
+      cv::projectPoints(
+        points,
+        rotation_vector,
+        translation,
+        parameters[camera].matrix,
+        parameters[camera].distortion,
+        pixels
+      );
+      TargetView view;
+      for (std::size_t i = 0; i < pixels.size(); ++i) {
+        if (!image.contains(pixels[i])) continue;
+        view.point_ids.push_back(ids[i]);
+        view.pixels.emplace_back(
+          pixels[i].x + static_cast<float>(rng.gaussian(0.5)),
+          pixels[i].y + static_cast<float>(rng.gaussian(0.5))
+        );
+      }
+      calibration.add_view(camera, frame, view);
+    }
+  }
+  return calibration;
+}
+
+void BM_ExtrinsicCalibration(benchmark::State& state) {
+  const ExtrinsicCalibration calibration = make_calibration(
+    static_cast<int>(state.range(0)),
+    static_cast<int>(state.range(1))
+  );
+  ExtrinsicResult result;
+  for (auto _ : state) {
+    result = calibration.solve();
+    benchmark::DoNotOptimize(result.rotations.data());
+  }
+  state.counters["views"] = static_cast<double>(calibration.view_count());
+  state.counters["observations"] = static_cast<double>(result.observations);
+  state.counters["iterations"] = result.iterations;
+  state.counters["error"] = result.error;
+}
+BENCHMARK(BM_ExtrinsicCalibration)
+  ->ArgNames({"cameras", "frames"})
+  ->Args({2, 100})
+  ->Args({4, 100})
+  ->Args({4, 1000})
+  ->Args({8, 100})
+  ->Args({8, 1000})
+  ->Unit(benchmark::kMillisecond);
+
+}
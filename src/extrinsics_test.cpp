@@ -0,0 +1,459 @@
+#include "src/extrinsics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <opencv2/aruco/charuco.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/cameras.h"
+
+namespace {
+
+const cv::Size IMAGE_SIZE{1280, 720};
+constexpr double FOCAL_LENGTH = 900.0;
+constexpr float SQUARE_LENGTH = 0.04f;
+constexpr int BOARD_PIXELS_PER_SQUARE = 100;
+constexpr double NOISE_PIXELS = 0.3;
+
+struct Pose {
+  cv::Matx33d rotation = cv::Matx33d::eye();
+  cv::Vec3d translation;
+
+  cv::Vec3d operator()(const cv::Vec3d& point) const {
+    return rotation * point + translation;
+  }
+};
+
+Pose compose(const Pose& outer, const Pose& inner) {
+  return Pose{
+    .rotation = outer.rotation * inner.rotation,
+    .translation = outer.rotation * inner.translation + outer.translation
+  };
+}
+
+Pose inverse(const Pose& pose) {
+  const cv::Matx33d rotation = pose.rotation.t();
+  return Pose{
+    .rotation = rotation,
+    .translation = -(rotation * pose.translation)
+  };
+}
+
+Pose to_pose(const cv::Vec3d& rotation_vector, const cv::Vec3d& translation) {
+  Pose pose{.translation = translation};
+  cv::Rodrigues(rotation_vector, pose.rotation);
+  return pose;
+}
+
+/**
+ * Pose of a camera at `eye` looking at `target`, upright.
+ */
+Pose look_at(const cv::Vec3d& eye, const cv::Vec3d& target) {
+  const cv::Vec3d forward = cv::normalize(target - eye);
+  const cv::Vec3d right = cv::normalize(cv::Vec3d{0, 0, -1}.cross(forward));
+  const cv::Vec3d down = forward.cross(right);
+  Pose pose;
+  for (int col = 0; col < 3; ++col) {
+    pose.rotation(0, col) = right[col];
+    pose.rotation(1, col) = down[col];
+    pose.rotation(2, col) = forward[col];
+  }
+  pose.translation = -(pose.rotation * eye);
+  return pose;
+}
+
+double rotation_degrees(const cv::Matx33d& a, const cv::Matx33d& b) {
+  cv::Vec3d difference;
+  cv::Rodrigues(a * b.t(), difference);
+  return cv::norm(difference) * 180.0 / CV_PI;
+}
+
+CameraParameters make_camera(int id) {
+  return CameraParameters{
+    .device = {.device_path = "/dev/video" + std::to_string(id)},
+    .matrix = (cv::Mat_<double>(3, 3) <<
+      FOCAL_LENGTH, 0, IMAGE_SIZE.width / 2.0,
+      0, FOCAL_LENGTH, IMAGE_SIZE.height / 2.0,
+      0, 0, 1
+    ),
+    .distortion = (cv::Mat_<double>(1, 5) << -0.1, 0.05, 0, 0, 0)
+  };
+}
+
+/**
+ * Cameras evenly spaced on a ring around the origin, all looking at it from
+ * slightly above.
+ */
+std::vector<Pose> ring_of_cameras(int count) {
+  std::vector<Pose> cameras;
+  for (int i = 0; i < count; ++i) {
+    const double angle = 2 * CV_PI * i / count;
+    cameras.push_back(look_at(
+      {1.5 * std::cos(angle), 1.5 * std::sin(angle), 0.8},
+      {0, 0, 0.1}
+    ));
+  }
+  return cameras;
+}
+
+/**
+ * The cube turned and moved around in front of the cameras.
+ */
+std::vector<Pose> cube_poses(int count) {
+  cv::RNG rng{7};
+  std::vector<Pose> poses;
+  for (int i = 0; i < count; ++i) {
+    const Pose yaw = to_pose({0, 0, rng.uniform(-CV_PI, CV_PI)}, {});
+    const Pose tilt = to_pose(
+      {rng.uniform(-0.3, 0.3), rng.uniform(-0.3, 0.3), 0},
+      {rng.uniform(-0.3, 0.3), rng.uniform(-0.3, 0.3), rng.uniform(0.0, 0.3)}
+    );
+    poses.push_back(compose(tilt, yaw));
+  }
+  return poses;
+}
+
+/**
+ * The corners of `target` that `camera` sees with the target at `pose`,
+ * projected with noise. Faces turned away or seen too obliquely are left
+ * out.
+ */
+TargetView project_target(
+  const CalibrationTarget& target,
+  const CameraParameters& parameters,
+  const Pose& camera,
+  const Pose& pose,
+  cv::RNG& rng
+) {
+  const Pose to_camera = compose(camera, pose);
+  std::vector<int> ids;
+  std::vector<cv::Point3d> points;
+  int offset = 0;
+  for (const TargetFace& face : target.faces()) {
+    const cv::Vec3d normal = to_camera.rotation * face.rotation.col(2);
+    const int corner_count =
+      static_cast<int>(face.board->chessboardCorners.size());
+    for (int id = offset; id < offset + corner_count; ++id) {
+      const cv::Point3d& point = target.point(id);
+      const cv::Vec3d seen = to_camera({point.x, point.y, point.z});
+      if (normal.dot(seen) > -0.3 * cv::norm(seen)) continue;
+      ids.push_back(id);
+      points.push_back(point);
+    }
+    offset += corner_count;
+  }
+
+  TargetView view;
+  if (points.empty()) return view;
+  cv::Vec3d rotation;
+  cv::Rodrigues(to_camera.rotation, rotation);
+  std::vector<cv::Point2f> pixels;
+  cv::projectPoints(
+    points,
+    rotation,
+    to_camera.translation,
+    parameters.matrix,
+    parameters.distortion,
+    pixels
+  );
+  const cv::Rect2f image{
+    0, 0,
+    static_cast<float>(IMAGE_SIZE.width),
+    static_cast<float>(IMAGE_SIZE.height)
+  };
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    if (!image.contains(pixels[i])) continue;
+    view.point_ids.push_back(ids[i]);
+    view.pixels.emplace_back(
+      pixels[i].x + static_cast<float>(rng.gaussian(NOISE_PIXELS)),
+      pixels[i].y + static_cast<float>(rng.gaussian(NOISE_PIXELS))
+    );
+  }
+  return view;
+}
+
+/**
+ * Checks that the cameras ended up where they are relative to each other.
+ * The world they are placed in is arbitrary.
+ */
+void expect_relative_poses(
+  const ExtrinsicResult& result,
+  const std::vector<Pose>& cameras
+) {
+  ASSERT_EQ(result.rotations.size(), cameras.size());
+  const Pose first = to_pose(result.rotations[0], result.translations[0]);
+  for (std::size_t i = 1; i < cameras.size(); ++i) {
+    const Pose expected = compose(cameras[i], inverse(cameras[0]));
+    const Pose actual = compose(
+      to_pose(result.rotations[i], result.translations[i]),
+      inverse(first)
+    );
+    EXPECT_LT(rotation_degrees(actual.rotation, expected.rotation), 0.1)
+      << "Camera " << i;
+    EXPECT_LT(cv::norm(actual.translation - expected.translation), 0.002)
+      << "Camera " << i;
+  }
+}
+
+TEST(CalibrationTarget, CubeCornersLieOnItsFaces) {
+  const CalibrationTarget cube = CalibrationTarget::cube(SQUARE_LENGTH);
+  const double half_side = 2.5 * SQUARE_LENGTH;
+  ASSERT_EQ(cube.faces().size(), 5);
+  EXPECT_EQ(cube.point_count(), 5 * 16);
+
+  int offset = 0;
+  for (const TargetFace& face : cube.faces()) {
+    const cv::Vec3d normal = face.rotation.col(2);
+    const int corner_count =
+      static_cast<int>(face.board->chessboardCorners.size());
+    for (int id = offset; id < offset + corner_count; ++id) {
+      const cv::Point3d& point = cube.point(id);
+      EXPECT_NEAR(normal.dot({point.x, point.y, point.z}), half_side, 1e-6);
+      EXPECT_LT(std::abs(point.x), half_side + 1e-6);
+      EXPECT_LT(std::abs(point.y), half_side + 1e-6);
+      EXPECT_LT(std::abs(point.z), half_side + 1e-6);
+    }
+    offset += corner_count;
+  }
+}
+
+TEST(CalibrationTarget, CubeFacesHaveTheirOwnMarkers) {
+  const CalibrationTarget cube = CalibrationTarget::cube(SQUARE_LENGTH);
+  std::set<int> ids;
+  std::size_t marker_count = 0;
+  for (const TargetFace& face : cube.faces()) {
+    ids.insert(face.board->ids.begin(), face.board->ids.end());
+    marker_count += face.board->ids.size();
+  }
+  EXPECT_EQ(ids.size(), marker_count);
+}
+
+TEST(CalibrationTarget, DetectsCubeFace) {
+  const CalibrationTarget cube = CalibrationTarget::cube(SQUARE_LENGTH);
+  const CameraParameters parameters = make_camera(0);
+  // Looking straight down at the top, the only face drawn.
+  const Pose camera = to_pose({CV_PI, 0, 0}, {0, 0, 0.6});
+  const TargetFace& top = cube.faces().front();
+
+  cv::Mat board_image;
+  top.board->draw(
+    cv::Size{5 * BOARD_PIXELS_PER_SQUARE, 5 * BOARD_PIXELS_PER_SQUARE},
+    board_image,
+    0,
+    1
+  );
+  const float side = 5 * SQUARE_LENGTH;
+  std::vector<cv::Point3f> outline;
+  for (const cv::Vec3d& corner : {
+    cv::Vec3d{0, 0, 0}, cv::Vec3d{side, 0, 0},
+    cv::Vec3d{side, side, 0}, cv::Vec3d{0, side, 0}
+  }) {
+    const cv::Vec3d point = top.rotation * corner + top.translation;
+    outline.emplace_back(point[0], point[1], point[2]);
+  }
+  cv::Vec3d rotation;
+  cv::Rodrigues(camera.rotation, rotation);
+  std::vector<cv::Point2f> destination;
+  cv::projectPoints(
+    outline,
+    rotation,
+    camera.translation,
+    parameters.matrix,
+    cv::noArray(),
+    destination
+  );
+  const std::vector<cv::Point2f> source = {
+    {0, static_cast<float>(board_image.rows)},
+    {
+      static_cast<float>(board_image.cols),
+      static_cast<float>(board_image.rows)
+    },
+    {static_cast<float>(board_image.cols), 0},
+    {0, 0}
+  };
+  cv::Mat image;
+  cv::warpPerspective(
+    board_image,
+    image,
+    cv::getPerspectiveTransform(source, destination),
+    IMAGE_SIZE,
+    cv::INTER_LINEAR,
+    cv::BORDER_CONSTANT,
+    cv::Scalar::all(255)
+  );
+  cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+
+  const std::optional<TargetView> view = cube.detect(image);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(view->point_ids.size(), top.board->chessboardCorners.size());
+  for (std::size_t i = 0; i < view->point_ids.size(); ++i) {
+    const int id = view->point_ids[i];
+    ASSERT_LT(id, static_cast<int>(top.board->chessboardCorners.size()));
+    const cv::Point3d& point = cube.point(id);
+    std::vector<cv::Point2f> expected;
+    cv::projectPoints(
+      std::vector<cv::Point3d>{point},
+      rotation,
+      camera.translation,
+      parameters.matrix,
+      cv::noArray(),
+      expected
+    );
+    EXPECT_LT(cv::norm(view->pixels[i] - expected.front()), 1.5)
+      << "Corner " << id;
+  }
+}
+
+TEST(CalibrationTarget, NothingInBlankImage) {
+  const cv::Mat image{IMAGE_SIZE, CV_8UC3, cv::Scalar::all(255)};
+  EXPECT_FALSE(CalibrationTarget::cube().detect(image));
+}
+
+TEST(ExtrinsicCalibration, RecoversCameraPoses) {
+  const CalibrationTarget cube = CalibrationTarget::cube(SQUARE_LENGTH);
+  const std::vector<Pose> cameras = ring_of_cameras(4);
+  std::vector<CameraParameters> parameters;
+  for (int i = 0; i < 4; ++i) parameters.push_back(make_camera(i));
+  ExtrinsicCalibration calibration{parameters, cube};
+
+  cv::RNG rng{42};
+  const std::vector<Pose> poses = cube_poses(200);
+  for (std::size_t frame = 0; frame < poses.size(); ++frame) {
+    for (std::size_t camera = 0; camera < cameras.size(); ++camera) {
+      calibration.add_view(
+        camera,
+        frame,
+        project_target(
+          cube,
+          parameters[camera],
+          cameras[camera],
+          poses[frame],
+          rng
+        )
+      );
+    }
+  }
+  ASSERT_GT(calibration.view_count(), 400);
+
+  const ExtrinsicResult result = calibration.solve();
+  expect_relative_poses(result, cameras);
+  EXPECT_LT(result.error, 2 * NOISE_PIXELS);
+  ASSERT_EQ(result.camera_errors.size(), 4);
+  for (double error : result.camera_errors) {
+    EXPECT_LT(error, 2 * NOISE_PIXELS);
+  }
+
+  const std::vector<CameraParameters> calibrated = calibration.apply(result);
+  ASSERT_EQ(calibrated.size(), 4);
+  for (std::size_t i = 0; i < calibrated.size(); ++i) {
+    EXPECT_EQ(
+      calibrated[i].device.device_path,
+      parameters[i].device.device_path
+    );
+    EXPECT_EQ(cv::norm(calibrated[i].matrix, parameters[i].matrix), 0);
+    EXPECT_EQ(
+      cv::norm(calibrated[i].rotation, cv::Mat{result.rotations[i]}),
+      0
+    );
+    EXPECT_EQ(
+      cv::norm(calibrated[i].translation, cv::Mat{result.translations[i]}),
+      0
+    );
+  }
+}
+
+TEST(ExtrinsicCalibration, IgnoresOutliers) {
+  const CalibrationTarget cube = CalibrationTarget::cube(SQUARE_LENGTH);
+  const std::vector<Pose> cameras = ring_of_cameras(3);
+  std::vector<CameraParameters> parameters;
+  for (int i = 0; i < 3; ++i) parameters.push_back(make_camera(i));
+  ExtrinsicCalibration calibration{parameters, cube};
+
+  cv::RNG rng{42};
+  const std::vector<Pose> poses = cube_poses(200);
+  for (std::size_t frame = 0; frame < poses.size(); ++frame) {
+    for (std::size_t camera = 0; camera < cameras.size(); ++camera) {
+      TargetView view = project_target(
+        cube,
+        parameters[camera],
+        cameras[camera],
+        poses[frame],
+        rng
+      );
+      // Every so often a corner is matched to the wrong place entirely.
+      for (cv::Point2f& pixel : view.pixels) {
+        if (rng.uniform(0.0, 1.0) > 0.02) continue;
+        pixel += cv::Point2f{
+          static_cast<float>(rng.uniform(-40.0, 40.0)),
+          static_cast<float>(rng.uniform(-40.0, 40.0))
+        };
+      }
+      calibration.add_view(camera, frame, view);
+    }
+  }
+
+  expect_relative_poses(calibration.solve(), cameras);
+}
+
+TEST(ExtrinsicCalibration, RequiresLinkedCameras) {
+  const CalibrationTarget cube = CalibrationTarget::cube(SQUARE_LENGTH);
+  const std::vector<Pose> cameras = ring_of_cameras(3);
+  std::vector<CameraParameters> parameters;
+  for (int i = 0; i < 3; ++i) parameters.push_back(make_camera(i));
+  ExtrinsicCalibration calibration{parameters, cube};
+
+  // The last camera only ever sees the cube on its own.
+  cv::RNG rng{42};
+  const std::vector<Pose> poses = cube_poses(20);
+  for (std::size_t frame = 0; frame < poses.size(); ++frame) {
+    for (std::size_t camera = 0; camera < cameras.size(); ++camera) {
+      calibration.add_view(
+        camera,
+        camera == 2 ? frame + poses.size() : frame,
+        project_target(
+          cube,
+          parameters[camera],
+          cameras[camera],
+          poses[frame],
+          rng
+        )
+      );
+    }
+  }
+  EXPECT_THROW(calibration.solve(), std::runtime_error);
+}
+
+TEST(ExtrinsicCalibration, RequiresIntrinsics) {
+  CameraParameters uncalibrated = make_camera(1);
+  uncalibrated.matrix = cv::Mat{};
+  EXPECT_THROW(
+    ExtrinsicCalibration(
+      {make_camera(0), uncalibrated},
+      CalibrationTarget::cube()
+    ),
+    std::invalid_argument
+  );
+}
+
+TEST(ExtrinsicCalibration, SkipsViewsWithFewCorners) {
+  ExtrinsicCalibration calibration{
+    {make_camera(0)},
+    CalibrationTarget::cube(),
+    {.min_corners = 6}
+  };
+  calibration.add_view(0, 0, TargetView{
+    .point_ids = {0, 1, 2},
+    .pixels = {{10, 10}, {20, 10}, {30, 10}}
+  });
+  EXPECT_EQ(calibration.view_count(), 0);
+}
+
+}
@@ -3,6 +3,10 @@
 #include <filesystem>
 #include <string_view>
 
+// Rate the recorder samples the cameras at, and so the frame rate of every
+// animation made from its recordings.
+constexpr double RECORDING_FPS = 24.0;
+
 const std::filesystem::path& get_output_root_path();
 const std::filesystem::path& get_recordings_directory_path();
 const std::filesystem::path& get_calibration_directory_path();
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct FrameCacheOptions {
+  // Loaded frames kept, least recently used dropped first.
+  std::size_t capacity = 64;
+
+  // Frames loaded ahead of the last one asked for, in the direction and
+  // stride the reader is moving.
+  std::size_t prefetch = 8;
+
+  // Background threads loading prefetched frames.
+  std::size_t threads = 2;
+};
+
+/**
+ * Frames of a recording, numbered `0` to `size - 1`, loaded on demand and
+ * kept in a least recently used cache. `T` is whatever `load` makes of a
+ * frame: a decoded image, parsed keypoints, or both.
+ *
+ * Every `get` also queues loads of the frames after it at the same step as
+ * the `get` before, so scrubbing in either direction at any speed finds its
+ * next frames already loaded. Only the latest `get`'s prefetches are queued.
+ */
+template <typename T>
+class FrameCache {
+public:
+  using Loader = std::function<T(std::size_t index)>;
+
+  FrameCache(std::size_t size, Loader load, FrameCacheOptions options = {}):
+    _size{size},
+    _load{std::move(load)},
+    _options{options}
+  {
+    for (std::size_t i = 0; i < _options.threads; ++i) {
+      _threads.emplace_back([this]() { _prefetch_loop(); });
+    }
+  }
+
+  ~FrameCache() {
+    {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _stopping = true;
+    }
+    _wake.notify_all();
+    for (std::thread& thread : _threads) thread.join();
+  }
+
+  FrameCache(const FrameCache&) = delete;
+  FrameCache(FrameCache&&) = delete;
+  FrameCache& operator=(const FrameCache&) = delete;
+  FrameCache& operator=(FrameCache&&) = delete;
+
+  /**
+   * The frame at `index`, loaded here unless it is cached or already being
+   * loaded in the background. Rethrows errors from `load`.
+   */
+  std::shared_ptr<const T> get(std::size_t index) {
+    std::unique_lock<std::mutex> lock{_mutex};
+    _queue_prefetches(index);
+
+    auto itr = _entries.find(index);
+    if (itr != _entries.end() && itr->second.value) {
+      ++_hits;
+      _touch(itr->second);
+      return itr->second.value;
+    }
+    if (itr != _entries.end()) {
+      ++_waits;
+      _loaded.wait(lock, [&]() {
+        itr = _entries.find(index);
+        return itr == _entries.end() || itr->second.value;
+      });
+      if (itr != _entries.end()) {
+        _touch(itr->second);
+        return itr->second.value;
+      }
+      // The background load failed, try again here to report why.
+    }
+
+    ++_misses;
+    _entries.emplace(index, Entry{});
+    lock.unlock();
+    std::shared_ptr<const T> value;
+    try {
+      value = std::make_shared<const T>(_load(index));
+    } catch (...) {
+      lock.lock();
+      _entries.erase(index);
+      _loaded.notify_all();
+      throw;
+    }
+    lock.lock();
+    _store(index, value);
+    return value;
+  }
+
+  std::size_t size() const { return _size; }
+
+  /**
+   * Frames returned from the cache, those waited for while loading in the
+   * background, and those loaded on the spot.
+   */
+  std::uint64_t hits() const { return _hits; }
+  std::uint64_t waits() const { return _waits; }
+  std::uint64_t misses() const { return _misses; }
+
+private:
+  struct Entry {
+    // Empty while being loaded.
+    std::shared_ptr<const T> value;
+    std::list<std::size_t>::iterator recent;
+  };
+
+  void _touch(Entry& entry) {
+    _recent.splice(_recent.begin(), _recent, entry.recent);
+  }
+
+  void _store(std::size_t index, std::shared_ptr<const T> value) {
+    Entry& entry = _entries[index];
+    entry.value = std::move(value);
+    _recent.push_front(index);
+    entry.recent = _recent.begin();
+    while (_recent.size() > _options.capacity) {
+      _entries.erase(_recent.back());
+      _recent.pop_back();
+    }
+    _loaded.notify_all();
+  }
+
+  void _queue_prefetches(std::size_t index) {
+    // Steps are taken modulo the frame count, as the reader wraps around.
+    if (_size == 0) return;
+    const std::size_t step = _last_index
+      ? (index + _size - *_last_index) % _size
+      : 1;
+    _last_index = index;
+    _pending.clear();
+    if (step == 0) return;
+    std::size_t next = index;
+    for (std::size_t i = 0; i < _options.prefetch; ++i) {
+      next = (next + step) % _size;
+      _pending.push_back(next);
+    }
+    _wake.notify_all();
+  }
+
+  void _prefetch_loop() {
+    std::unique_lock<std::mutex> lock{_mutex};
+    while (true) {
+      _wake.wait(lock, [&]() { return _stopping || !_pending.empty(); });
+      if (_stopping) return;
+      const std::size_t index = _pending.front();
+      _pending.pop_front();
+      if (_entries.contains(index)) continue;
+
+      _entries.emplace(index, Entry{});
+      lock.unlock();
+      std::shared_ptr<const T> value;
+      try {
+        value = std::make_shared<const T>(_load(index));
+      } catch (...) {
+        // Left for `get` to load and report, should it ever be asked for.
+      }
+      lock.lock();
+      if (value) {
+        _store(index, std::move(value));
+      } else {
+        _entries.erase(index);
+        _loaded.notify_all();
+      }
+    }
+  }
+
+  std::size_t _size;
+  Loader _load;
+  FrameCacheOptions _options;
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _loaded;
+  std::unordered_map<std::size_t, Entry> _entries;
+
+  // Indices of loaded entries, most recently used first.
+  std::list<std::size_t> _recent;
+
+  std::deque<std::size_t> _pending;
+  std::optional<std::size_t> _last_index;
+  bool _stopping = false;
+
+  std::atomic_uint64_t _hits = 0;
+  std::atomic_uint64_t _waits = 0;
+  std::atomic_uint64_t _misses = 0;
+
+  std::vector<std::thread> _threads;
+};
@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/frame_cache.h"
+#include "src/tracking.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+const std::filesystem::path BENCHMARK_DIR = "/tmp/benchmark/ar/frame_cache";
+const cv::Size IMAGE_SIZE{1920, 1080};
+constexpr std::size_t FRAME_COUNT = 60;
+
+// The display's budget per frame at 60 fps, spent drawing while the cache
+// loads ahead.
+constexpr auto FRAME_TIME = 16ms;
+
+struct LoadedFrame {
+  cv::Mat image;
+  std::vector<Person> people;
+};
+
+std::filesystem::path image_path(std::size_t index) {
+  return BENCHMARK_DIR / (std::to_string(index) + ".png");
+}
+
+std::filesystem::path keypoints_path(std::size_t index) {
+  return BENCHMARK_DIR / (std::to_string(index) + ".yml");
+}
+
+/**
+ * A second of noisy 1080p frames with two people's keypoints each, written
+ * once.
+ */
+void write_frames() {
+  static const bool written = []() {
+    std::filesystem::create_directories(BENCHMARK_DIR);
+    cv::Mat image{IMAGE_SIZE, CV_8UC3};
+    std::vector<Person> people(2);
+    for (std::size_t p = 0; p < people.size(); ++p) {
+      people[p].person_id = static_cast<int>(p);
+      for (int i = 0; i < 25; ++i) {
+        people[p].body.push_back(
+          Point{.point_id = i, .x = 100.0 * i, .y = 40.0 * i, .confidence = 1}
+        );
+      }
+    }
+    for (std::size_t i = 0; i < FRAME_COUNT; ++i) {
+      cv::randu(image, 0, 255);
+      cv::imwrite(image_path(i).string(), image);
+      save_people(people, keypoints_path(i));
+    }
+    return true;
+  }();
+  benchmark::DoNotOptimize(written);
+}
+
+LoadedFrame load(std::size_t index) {
+  return LoadedFrame{
+    .image = cv::imread(image_path(index).string()),
+    .people = load_people(keypoints_path(index))
+  };
+}
+
+/**
+ * Baseline: playback as the visualizer used to do it, reading and parsing
+ * every frame as it is shown.
+ */
+void BM_PlaybackUncached(benchmark::State& state) {
+  write_frames();
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < FRAME_COUNT; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      LoadedFrame frame = load(i);
+      benchmark::DoNotOptimize(frame.image.data);
+      std::this_thread::sleep_until(start + FRAME_TIME);
+    }
+  }
+  state.counters["fps"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * FRAME_COUNT),
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_PlaybackUncached)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * Playback through the cache, by prefetch threads. Frames load behind the
+ * display's wait, so playback holds 60 fps once enough threads keep up.
+ */
+void BM_PlaybackCached(benchmark::State& state) {
+  write_frames();
+  for (auto _ : state) {
+    FrameCache<LoadedFrame> cache{
+      FRAME_COUNT,
+      load,
+      {.threads = static_cast<std::size_t>(state.range(0))}
+    };
+    for (std::size_t i = 0; i < FRAME_COUNT; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      benchmark::DoNotOptimize(cache.get(i)->image.data);
+      std::this_thread::sleep_until(start + FRAME_TIME);
+    }
+  }
+  state.counters["fps"] = benchmark::Counter(
+    static_cast<double>(state.iterations() * FRAME_COUNT),
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_PlaybackCached)
+  ->ArgName("threads")
+  ->Arg(0)
+  ->Arg(1)
+  ->Arg(2)
+  ->Arg(4)
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+/**
+ * Scrubbing back over frames just shown, which the cache still holds.
+ */
+void BM_ScrubBack(benchmark::State& state) {
+  write_frames();
+  FrameCache<LoadedFrame> cache{FRAME_COUNT, load};
+  for (std::size_t i = 0; i < FRAME_COUNT; ++i) cache.get(i);
+  for (auto _ : state) {
+    for (std::size_t i = FRAME_COUNT; i > 0; --i) {
+      benchmark::DoNotOptimize(cache.get(i - 1)->image.data);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * FRAME_COUNT);
+}
+BENCHMARK(BM_ScrubBack)->Unit(benchmark::kMicrosecond);
+
+}
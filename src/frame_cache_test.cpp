@@ -0,0 +1,124 @@
+#include "src/frame_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+/**
+ * Loads each frame as its own index, remembering which were loaded.
+ */
+struct CountingLoader {
+  std::mutex mutex;
+  std::vector<std::size_t> loaded;
+
+  std::size_t operator()(std::size_t index) {
+    std::lock_guard<std::mutex> lock{mutex};
+    loaded.push_back(index);
+    return index;
+  }
+
+  std::set<std::size_t> loaded_set() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return {loaded.begin(), loaded.end()};
+  }
+};
+
+/**
+ * Waits for the background threads to have loaded everything in `expected`.
+ */
+bool wait_for_loads(
+  CountingLoader& loader,
+  const std::set<std::size_t>& expected
+) {
+  for (int i = 0; i < 200; ++i) {
+    const std::set<std::size_t> loaded = loader.loaded_set();
+    if (std::includes(
+      loaded.begin(), loaded.end(), expected.begin(), expected.end()
+    )) {
+      return true;
+    }
+    std::this_thread::sleep_for(5ms);
+  }
+  return false;
+}
+
+TEST(FrameCache, LoadsOnceThenHits) {
+  CountingLoader loader;
+  FrameCache<std::size_t> cache{
+    10,
+    [&](std::size_t index) { return loader(index); },
+    {.prefetch = 0, .threads = 0}
+  };
+
+  EXPECT_EQ(*cache.get(3), 3);
+  EXPECT_EQ(*cache.get(3), 3);
+  EXPECT_EQ(cache.misses(), 1);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(loader.loaded, (std::vector<std::size_t>{3}));
+}
+
+TEST(FrameCache, EvictsLeastRecentlyUsed) {
+  CountingLoader loader;
+  FrameCache<std::size_t> cache{
+    10,
+    [&](std::size_t index) { return loader(index); },
+    {.capacity = 2, .prefetch = 0, .threads = 0}
+  };
+
+  cache.get(0);
+  cache.get(1);
+  cache.get(0);
+  cache.get(2); // Evicts 1.
+  cache.get(0);
+  cache.get(1);
+  EXPECT_EQ(loader.loaded, (std::vector<std::size_t>{0, 1, 2, 1}));
+}
+
+TEST(FrameCache, PrefetchesInScrubDirection) {
+  CountingLoader loader;
+  FrameCache<std::size_t> cache{
+    100,
+    [&](std::size_t index) { return loader(index); },
+    {.prefetch = 3}
+  };
+
+  cache.get(50);
+  cache.get(46);
+  EXPECT_TRUE(wait_for_loads(loader, {42, 38, 34}));
+
+  // Wraps around the end of the recording.
+  cache.get(98);
+  cache.get(99);
+  EXPECT_TRUE(wait_for_loads(loader, {0, 1, 2}));
+  EXPECT_EQ(*cache.get(0), 0);
+  EXPECT_GE(cache.hits() + cache.waits(), 1);
+}
+
+TEST(FrameCache, RethrowsLoadErrors) {
+  FrameCache<int> cache{
+    10,
+    [](std::size_t index) -> int {
+      if (index == 4) throw std::runtime_error("Bad frame.");
+      return static_cast<int>(index);
+    },
+    {.prefetch = 2}
+  };
+
+  cache.get(2);
+  EXPECT_THROW(cache.get(4), std::runtime_error);
+  EXPECT_EQ(*cache.get(3), 3);
+  EXPECT_THROW(cache.get(4), std::runtime_error);
+}
+
+}
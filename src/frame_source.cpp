@@ -0,0 +1,247 @@
+#include "src/frame_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/cameras.h"
+#include "src/v4l2_camera.h"
+#include "src/video_reader.h"
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+
+namespace {
+
+// A connected camera that sends nothing for this long has stalled.
+constexpr auto CAMERA_STALL_TIMEOUT = std::chrono::seconds{5};
+
+}
+
+std::filesystem::path keypoints_path(const Frame& frame) {
+  if (is_video_file(frame.path)) {
+    return frame.path.parent_path() / (std::to_string(frame.frame_id) + ".yml");
+  }
+  std::filesystem::path keypoints = frame.path;
+  keypoints.replace_extension(".yml");
+  return keypoints;
+}
+
+CameraSource::CameraSource(const CameraDevice& device, cv::Size image_size):
+  _device_path{device.device_path},
+  _camera{device.device_path, V4L2CameraOptions{.image_size = image_size}}
+{}
+
+std::optional<Frame> CameraSource::read() {
+  const steady_clock::time_point deadline =
+    steady_clock::now() + CAMERA_STALL_TIMEOUT;
+  std::optional<V4L2Frame> captured;
+  while (!(captured = _camera.read())) {
+    if (_camera.disconnected()) return std::nullopt;
+    if (steady_clock::now() >= deadline) {
+      throw std::runtime_error(
+        _device_path.string() + " stopped sending frames."
+      );
+    }
+  }
+
+  // Decoding copies the pixels out, handing the buffer straight back.
+  return Frame{
+    .frame_id = _next_frame_id++,
+    .captured_at = captured->timestamp(),
+    .image = captured->decode()
+  };
+}
+
+FileReplaySource::FileReplaySource(
+  const std::filesystem::path& directory,
+  FileReplayOptions options
+):
+  _options{options}
+{
+  for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+    if (entry.path().extension() == ".png") _files.push_back(entry.path());
+  }
+  std::sort(
+    _files.begin(),
+    _files.end(),
+    [](const std::filesystem::path& a, const std::filesystem::path& b) {
+      return std::stoi(a.stem().string()) < std::stoi(b.stem().string());
+    }
+  );
+}
+
+std::optional<Frame> FileReplaySource::read() {
+  if (_next_file == _files.size()) {
+    if (!_options.loop || _files.empty()) return std::nullopt;
+    _next_file = 0;
+  }
+
+  const std::filesystem::path& path = _files[_next_file++];
+  cv::Mat image = cv::imread(path.string());
+
+  if (_options.fps > 0) {
+    steady_clock::time_point now = steady_clock::now();
+    if (_next_release > now) std::this_thread::sleep_until(_next_release);
+    else _next_release = now;
+    _next_release += duration_cast<steady_clock::duration>(
+      duration<double>{1.0 / _options.fps}
+    );
+  }
+
+  return Frame{
+    .frame_id = _next_frame_id++,
+    .captured_at = steady_clock::now(),
+    .image = std::move(image),
+    .path = path
+  };
+}
+
+VideoFileSource::VideoFileSource(
+  const std::filesystem::path& path,
+  VideoFileOptions options
+):
+  _path{path},
+  _options{options},
+  _reader{path},
+  _frame_count{_reader.frame_count()},
+  _image_size{_reader.image_size()},
+  _fps{_reader.fps()}
+{
+  _thread = std::thread{[this]() { _decode_loop(); }};
+}
+
+VideoFileSource::~VideoFileSource() {
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _stopping = true;
+  }
+  _wanted.notify_all();
+  if (_thread.joinable()) _thread.join();
+}
+
+std::optional<Frame> VideoFileSource::read() {
+  std::unique_lock<std::mutex> lock{_mutex};
+  _decoded.wait(lock, [&]() {
+    return !_frames.empty() || _finished || _error;
+  });
+  if (_frames.empty()) {
+    if (_error) std::rethrow_exception(_error);
+    return std::nullopt;
+  }
+  Frame frame = std::move(_frames.front());
+  _frames.pop_front();
+  lock.unlock();
+  _wanted.notify_all();
+
+  frame.captured_at = steady_clock::now();
+  return frame;
+}
+
+void VideoFileSource::seek(std::size_t frame) {
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _pending_seek = frame;
+    ++_generation;
+    _frames.clear();
+    _finished = false;
+  }
+  _wanted.notify_all();
+}
+
+void VideoFileSource::_decode_loop() {
+  try {
+    std::unique_lock<std::mutex> lock{_mutex};
+    while (true) {
+      _wanted.wait(lock, [&]() {
+        return _stopping || _pending_seek ||
+          (!_finished && _frames.size() < _options.read_ahead);
+      });
+      if (_stopping) return;
+      if (_pending_seek) {
+        _reader.seek(*_pending_seek);
+        _pending_seek.reset();
+      }
+
+      // Decoded without the lock so the reader can keep taking frames.
+      const std::uint64_t generation = _generation;
+      lock.unlock();
+      std::optional<cv::Mat> image = _reader.read();
+      lock.lock();
+      if (generation != _generation) continue;
+
+      if (!image) {
+        if (_options.loop) {
+          _reader.seek(0);
+        } else {
+          _finished = true;
+          _decoded.notify_all();
+        }
+        continue;
+      }
+      _frames.push_back(Frame{
+        .frame_id = _reader.position() - 1,
+        .image = *std::move(image),
+        .path = _path
+      });
+      _decoded.notify_all();
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock{_mutex};
+      _error = std::current_exception();
+    }
+    _decoded.notify_all();
+  }
+}
+
+std::unique_ptr<FrameSource> open_recording(
+  const std::filesystem::path& path,
+  bool loop
+) {
+  if (std::filesystem::is_directory(path)) {
+    if (std::optional<std::filesystem::path> video = find_video(path)) {
+      return std::make_unique<VideoFileSource>(
+        *video,
+        VideoFileOptions{.loop = loop}
+      );
+    }
+    return std::make_unique<FileReplaySource>(
+      path,
+      FileReplayOptions{.fps = 0, .loop = loop}
+    );
+  }
+  if (!is_video_file(path)) {
+    throw std::invalid_argument(
+      path.string() + " is neither a video nor a recording directory."
+    );
+  }
+  return std::make_unique<VideoFileSource>(
+    path,
+    VideoFileOptions{.loop = loop}
+  );
+}
+
+std::optional<std::filesystem::path> find_video(
+  const std::filesystem::path& directory
+) {
+  std::optional<std::filesystem::path> video;
+  for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+    if (!entry.is_regular_file() || !is_video_file(entry.path())) continue;
+    if (!video || entry.path() < *video) video = entry.path();
+  }
+  return video;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "src/cameras.h"
+#include "src/v4l2_camera.h"
+#include "src/video_reader.h"
+
+struct Frame {
+  std::uint64_t frame_id;
+
+  // Taken as soon as the frame leaves the camera. Measured latencies start
+  // from here.
+  std::chrono::steady_clock::time_point captured_at;
+  cv::Mat image;
+
+  // File the frame was read from, empty for live cameras. For videos this is
+  // the video file and `frame_id` the frame's index in it.
+  std::filesystem::path path;
+};
+
+/**
+ * Where the extractor saves the keypoints detected in a recorded frame: next
+ * to the image, or in the video's directory named by frame index.
+ */
+std::filesystem::path keypoints_path(const Frame& frame);
+
+/**
+ * Blocking source of frames from a single camera.
+ */
+class FrameSource {
+public:
+  virtual ~FrameSource() = default;
+
+  /**
+   * Waits for the next frame. Returns nothing once the source is exhausted.
+   */
+  virtual std::optional<Frame> read() = 0;
+
+  /**
+   * Number of frames in a recording, zero for live sources.
+   */
+  virtual std::size_t frame_count() const { return 0; }
+};
+
+/**
+ * Live camera frames stamped with the driver's capture time.
+ */
+class CameraSource : public FrameSource {
+public:
+  CameraSource(const CameraDevice& device, cv::Size image_size);
+
+  /**
+   * Waits for the next frame, riding out timeouts and corrupt frames. Returns
+   * nothing once the camera is disconnected and throws if it stops sending
+   * frames while still connected.
+   */
+  std::optional<Frame> read() override;
+
+private:
+  std::filesystem::path _device_path;
+  V4L2Camera _camera;
+  std::uint64_t _next_frame_id = 0;
+};
+
+struct FileReplayOptions {
+  // Frames are released at this rate to mimic a live camera. Zero replays as
+  // fast as the frames can be read.
+  double fps = 30.0;
+
+  // Start over from the first frame after the last one.
+  bool loop = false;
+};
+
+/**
+ * Replays a directory of recorded frames, such as one written by the
+ * recorder, as if it were a live camera.
+ */
+class FileReplaySource : public FrameSource {
+public:
+  explicit FileReplaySource(
+    const std::filesystem::path& directory,
+    FileReplayOptions options = {}
+  );
+
+  std::optional<Frame> read() override;
+
+  std::size_t frame_count() const override { return _files.size(); }
+
+private:
+  FileReplayOptions _options;
+  std::vector<std::filesystem::path> _files;
+  std::size_t _next_file = 0;
+  std::uint64_t _next_frame_id = 0;
+  std::chrono::steady_clock::time_point _next_release;
+};
+
+struct VideoFileOptions {
+  // Frames decoded ahead of the reader.
+  std::size_t read_ahead = 8;
+
+  // Start over from the first frame after the last one.
+  bool loop = false;
+};
+
+/**
+ * Plays back a video file, decoding on a background thread that stays up to
+ * `read_ahead` frames ahead of the reader.
+ */
+class VideoFileSource : public FrameSource {
+public:
+  explicit VideoFileSource(
+    const std::filesystem::path& path,
+    VideoFileOptions options = {}
+  );
+  ~VideoFileSource() override;
+
+  /**
+   * Waits for the next decoded frame. Rethrows decoding errors.
+   */
+  std::optional<Frame> read() override;
+
+  /**
+   * Makes `frame` the next one read. Frames already decoded are discarded.
+   */
+  void seek(std::size_t frame);
+
+  std::size_t frame_count() const override { return _frame_count; }
+  cv::Size image_size() const { return _image_size; }
+  double fps() const { return _fps; }
+
+private:
+  void _decode_loop();
+
+  std::filesystem::path _path;
+  VideoFileOptions _options;
+  VideoReader _reader;
+  std::size_t _frame_count;
+  cv::Size _image_size;
+  double _fps;
+
+  // Guards everything below it that the reader and decoder share.
+  std::mutex _mutex;
+
+  // Signalled when a frame is queued, the video ends, or decoding fails.
+  std::condition_variable _decoded;
+
+  // Signalled when the reader makes room, seeks, or stops the decoder.
+  std::condition_variable _wanted;
+
+  std::deque<Frame> _frames;
+
+  // Seeks bump the generation so a frame decoded across one is dropped.
+  std::optional<std::size_t> _pending_seek;
+  std::uint64_t _generation = 0;
+
+  bool _finished = false;
+  bool _stopping = false;
+  std::exception_ptr _error;
+  std::thread _thread;
+};
+
+/**
+ * Opens a recording for reading from start to end: a video file, or a camera
+ * directory holding either a video or numbered PNGs.
+ */
+std::unique_ptr<FrameSource> open_recording(
+  const std::filesystem::path& path,
+  bool loop = false
+);
+
+/**
+ * The video inside a camera's recording directory, if it has one.
+ */
+std::optional<std::filesystem::path> find_video(
+  const std::filesystem::path& directory
+);
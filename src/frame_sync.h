@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * The most recent frames from one camera, for picking the frame closest to a
+ * moment in time. `FrameT` needs a `timestamp()` on the steady clock.
+ *
+ * Pushed from the camera's capture thread and read from the scheduler, so all
+ * access is guarded.
+ */
+template <typename FrameT>
+class FrameHistory {
+public:
+  explicit FrameHistory(std::size_t capacity): _capacity{capacity} {}
+
+  /**
+   * Adds a frame newer than all the others, forgetting the oldest if full.
+   */
+  void push(FrameT frame) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (_frames.size() == _capacity) _frames.pop_front();
+    _frames.push_back(std::move(frame));
+  }
+
+  /**
+   * Copy of the frame taken closest to `target`, or nothing if empty.
+   */
+  std::optional<FrameT> nearest(
+    std::chrono::steady_clock::time_point target
+  ) const {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (_frames.empty()) return std::nullopt;
+    auto distance = [&](const FrameT& frame) {
+      return frame.timestamp() > target
+        ? frame.timestamp() - target
+        : target - frame.timestamp();
+    };
+    return *std::min_element(
+      _frames.begin(),
+      _frames.end(),
+      [&](const FrameT& a, const FrameT& b) {
+        return distance(a) < distance(b);
+      }
+    );
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _frames.size();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _frames.clear();
+  }
+
+private:
+  std::size_t _capacity;
+  mutable std::mutex _mutex;
+  std::deque<FrameT> _frames;
+};
+
+/**
+ * Time between the first and last frame of a set taken for the same moment.
+ */
+template <typename FrameT>
+std::chrono::steady_clock::duration frame_skew(
+  const std::vector<FrameT>& frames
+) {
+  if (frames.empty()) return std::chrono::steady_clock::duration::zero();
+  auto [first, last] = std::minmax_element(
+    frames.begin(),
+    frames.end(),
+    [](const FrameT& a, const FrameT& b) {
+      return a.timestamp() < b.timestamp();
+    }
+  );
+  return last->timestamp() - first->timestamp();
+}
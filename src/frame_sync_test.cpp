@@ -0,0 +1,68 @@
+#include "src/frame_sync.h"
+
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+struct FakeFrame {
+  int id;
+  steady_clock::time_point captured_at;
+
+  steady_clock::time_point timestamp() const { return captured_at; }
+};
+
+const steady_clock::time_point START = steady_clock::now();
+
+FakeFrame make_frame(int id, milliseconds offset) {
+  return FakeFrame{.id = id, .captured_at = START + offset};
+}
+
+TEST(FrameHistory, EmptyHasNoNearest) {
+  FrameHistory<FakeFrame> history{3};
+  EXPECT_FALSE(history.nearest(START));
+}
+
+TEST(FrameHistory, PicksNearestFrame) {
+  FrameHistory<FakeFrame> history{3};
+  history.push(make_frame(0, milliseconds{0}));
+  history.push(make_frame(1, milliseconds{33}));
+  history.push(make_frame(2, milliseconds{66}));
+
+  EXPECT_EQ(history.nearest(START + milliseconds{10})->id, 0);
+  EXPECT_EQ(history.nearest(START + milliseconds{20})->id, 1);
+  EXPECT_EQ(history.nearest(START + milliseconds{60})->id, 2);
+  EXPECT_EQ(history.nearest(START + milliseconds{500})->id, 2);
+  EXPECT_EQ(history.nearest(START - milliseconds{500})->id, 0);
+}
+
+TEST(FrameHistory, ForgetsOldestFrames) {
+  FrameHistory<FakeFrame> history{2};
+  for (int i = 0; i < 5; ++i) history.push(make_frame(i, milliseconds{i * 10}));
+
+  EXPECT_EQ(history.size(), 2);
+  EXPECT_EQ(history.nearest(START)->id, 3);
+
+  history.clear();
+  EXPECT_EQ(history.size(), 0);
+}
+
+TEST(FrameSkew, SpanOfTimestamps) {
+  EXPECT_EQ(frame_skew(std::vector<FakeFrame>{}), steady_clock::duration{});
+  EXPECT_EQ(
+    frame_skew(std::vector<FakeFrame>{
+      make_frame(0, milliseconds{12}),
+      make_frame(1, milliseconds{3}),
+      make_frame(2, milliseconds{7})
+    }),
+    milliseconds{9}
+  );
+}
+
+}
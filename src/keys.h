@@ -20,6 +20,7 @@ enum class Key: int {
   M = 109,
   Q = 113,
   R = 114,
+  T = 116,
   W = 119,
   X = 120,
   Z = 122
@@ -0,0 +1,101 @@
+#include "src/openpose_backend.h"
+
+#include <cstddef>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <openpose/headers.hpp>
+#include <vector>
+
+#include "src/frame_source.h"
+#include "src/tracking.h"
+
+namespace {
+
+std::vector<Point> to_points(const op::Array<float>& keypoints, int person_id) {
+  std::vector<Point> points;
+  for (int point_idx = 0; point_idx < keypoints.getSize(1); ++point_idx) {
+    Point& point = points.emplace_back(Point{.point_id = point_idx});
+    point.x = keypoints[{person_id, point_idx, 0}];
+    point.y = keypoints[{person_id, point_idx, 1}];
+    point.confidence = keypoints[{person_id, point_idx, 2}];
+  }
+  return points;
+}
+
+/**
+ * Returns the person at `idx`, adding people as needed when a part was found
+ * for someone whose body was not.
+ */
+Person& person_at(std::vector<Person>& people, int idx) {
+  while (static_cast<std::size_t>(idx) >= people.size()) {
+    people.push_back({.person_id = static_cast<int>(people.size())});
+  }
+  return people[idx];
+}
+
+std::vector<Person> to_people(const op::Datum& data) {
+  std::vector<Person> people;
+  for (int i = 0; i < data.poseKeypoints.getSize(0); ++i) {
+    person_at(people, i).body = to_points(data.poseKeypoints, i);
+  }
+  for (int i = 0; i < data.faceKeypoints.getSize(0); ++i) {
+    person_at(people, i).face = to_points(data.faceKeypoints, i);
+  }
+  for (int i = 0; i < data.handKeypoints[0].getSize(0); ++i) {
+    person_at(people, i).left_paw = to_points(data.handKeypoints[0], i);
+  }
+  for (int i = 0; i < data.handKeypoints[1].getSize(0); ++i) {
+    person_at(people, i).right_paw = to_points(data.handKeypoints[1], i);
+  }
+  return people;
+}
+
+}
+
+OpenPoseBackend::OpenPoseBackend(OpenPoseOptions options):
+  _wrapper{std::make_unique<op::Wrapper>(op::ThreadManagerMode::Asynchronous)}
+{
+  op::WrapperStructPose pose_config;
+  pose_config.modelFolder = options.model_dir.c_str();
+  pose_config.netInputSize = {
+    options.net_input_size.width,
+    options.net_input_size.height
+  };
+  pose_config.renderMode = op::RenderMode::None;
+
+  op::WrapperStructFace face_config;
+  face_config.enable = options.face;
+  face_config.detector = op::Detector::Body;
+  face_config.renderMode = op::RenderMode::None;
+
+  op::WrapperStructHand paw_config;
+  paw_config.enable = options.paws;
+  paw_config.detector = op::Detector::BodyWithTracking;
+  paw_config.renderMode = op::RenderMode::None;
+
+  // TODO: Enable these features once out of "experimental."
+  // Until then person IDs are assigned by `PersonTracker` instead.
+  op::WrapperStructExtra extra_config;
+  // extra_config.identification = true;
+  // extra_config.tracking = 0; // Every frame.
+
+  _wrapper->configure(pose_config);
+  _wrapper->configure(face_config);
+  _wrapper->configure(paw_config);
+  _wrapper->configure(extra_config);
+  _wrapper->start();
+}
+
+OpenPoseBackend::~OpenPoseBackend() {
+  _wrapper->stop();
+}
+
+std::vector<Person> OpenPoseBackend::detect(const Frame& frame) {
+  return detect(frame.image);
+}
+
+std::vector<Person> OpenPoseBackend::detect(const cv::Mat& image) {
+  auto data = _wrapper->emplaceAndPop(OP_CV2OPCONSTMAT(image));
+  if (!data || data->empty()) return {};
+  return to_people(*data->at(0));
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <openpose/headers.hpp>
+#include <vector>
+
+#include "src/frame_source.h"
+#include "src/pose_backend.h"
+#include "src/tracking.h"
+
+struct OpenPoseOptions {
+  std::filesystem::path model_dir = "/home/oz/work/ext/openpose/models";
+  cv::Size net_input_size{656, 368};
+
+  // Face and paw keypoints roughly triple detection time, so live tracking
+  // leaves them off.
+  bool face = true;
+  bool paws = true;
+};
+
+/**
+ * Runs OpenPose on each frame. Person IDs are only the detection order and
+ * are meant to be replaced by a tracker.
+ */
+class OpenPoseBackend : public PoseBackend {
+public:
+  explicit OpenPoseBackend(OpenPoseOptions options = {});
+  ~OpenPoseBackend() override;
+  OpenPoseBackend(const OpenPoseBackend&) = delete;
+  OpenPoseBackend& operator=(const OpenPoseBackend&) = delete;
+
+  std::vector<Person> detect(const Frame& frame) override;
+  std::vector<Person> detect(const cv::Mat& image);
+
+private:
+  std::unique_ptr<op::Wrapper> _wrapper;
+};
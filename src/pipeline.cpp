@@ -0,0 +1,344 @@
+#include "src/pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "lf/queue.h"
+#include "src/camera_model.h"
+#include "src/frame_source.h"
+#include "src/pose_backend.h"
+#include "src/timing.h"
+#include "src/tracker.h"
+#include "src/tracking.h"
+#include "src/triangulation.h"
+#include "src/undistort.h"
+
+namespace {
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+
+double to_ms(steady_clock::duration latency) {
+  return duration_cast<duration<double, std::milli>>(latency).count();
+}
+
+void print(std::ostream& out, const char* name, const LatencyHistogram& stats) {
+  out
+    << std::setw(12) << name << ": p50 " << std::setw(7)
+    << to_ms(stats.percentile(50)) << "ms  p99 " << std::setw(7)
+    << to_ms(stats.percentile(99)) << "ms  max " << std::setw(7)
+    << to_ms(stats.max()) << "ms  (" << stats.count() << ")\n";
+}
+
+}
+
+std::ostream& operator<<(std::ostream& out, const PipelineStats& stats) {
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::fixed << std::setprecision(2);
+  print(out, "queued", stats.queued);
+  print(out, "pose", stats.pose);
+  print(out, "undistort", stats.undistort);
+  print(out, "sync", stats.sync);
+  print(out, "triangulate", stats.triangulate);
+  print(out, "output", stats.output);
+  print(out, "end to end", stats.end_to_end);
+  out
+    << stats.captured << " captured, " << stats.published << " published, "
+    << stats.dropped << " dropped, " << stats.unmatched << " unmatched, "
+    << stats.over_budget << " over budget\n";
+  out.flags(flags);
+  out.precision(precision);
+  return out;
+}
+
+Pipeline::Pipeline(
+  std::vector<PipelineCamera> cameras,
+  std::unique_ptr<PoseBackend> backend,
+  Output output,
+  PipelineOptions options
+):
+  _backend{std::move(backend)},
+  _output{std::move(output)},
+  _options{options},
+  _frames{options.queue_capacity},
+  _detections{options.queue_capacity},
+  _live_frames{options.queue_capacity}
+{
+  if (cameras.size() < 2) {
+    throw std::invalid_argument("Live tracking requires at least 2 cameras.");
+  }
+  for (PipelineCamera& camera : cameras) {
+    PointUndistorter undistorter =
+      camera.image_size.empty()
+        ? PointUndistorter{camera.parameters}
+        : PointUndistorter{
+          camera.parameters,
+          camera.image_size,
+          options.undistort_grid_step
+        };
+    _cameras.push_back(Camera{
+      .source = std::move(camera.source),
+      .model = CameraModel{camera.parameters},
+      .undistorter = std::move(undistorter)
+    });
+  }
+}
+
+Pipeline::~Pipeline() {
+  // Nowhere to report a source's error, wait() should have been called.
+  _reading = false;
+  _join();
+}
+
+void Pipeline::start() {
+  if (!_threads.empty()) return;
+
+  _reading = true;
+  _active_sources = _cameras.size();
+  _pose_done = false;
+  _sync_done = false;
+  _output_done = false;
+
+  // Start from the end of the pipeline so nothing backs up behind a stage
+  // that is not running yet.
+  _threads.emplace_back([this]() { _output_loop(); });
+  _threads.emplace_back([this]() { _sync_loop(); });
+  _threads.emplace_back([this]() { _pose_loop(); });
+  for (std::size_t i = 0; i < _cameras.size(); ++i) {
+    _threads.emplace_back([this, i]() { _capture_loop(_cameras[i], i); });
+  }
+}
+
+void Pipeline::stop() {
+  _reading = false;
+  wait();
+}
+
+void Pipeline::wait() {
+  _join();
+  std::lock_guard<std::mutex> lock{_error_mutex};
+  if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+}
+
+void Pipeline::_join() {
+  for (std::thread& thread : _threads) {
+    if (thread.joinable()) thread.join();
+  }
+  _threads.clear();
+}
+
+PipelineStats Pipeline::stats() const {
+  std::lock_guard<std::mutex> lock{_stats_mutex};
+  PipelineStats stats = _stats;
+  stats.captured = _captured;
+  stats.dropped = _dropped;
+  stats.unmatched = _unmatched;
+  return stats;
+}
+
+std::vector<Person3d> Pipeline::_triangulate(
+  const std::vector<std::optional<View>>& views
+) const {
+  std::vector<Person3d> best;
+  std::uint64_t best_joints = 0;
+  double best_error = 0.0;
+  for (std::size_t i = 0; i < views.size(); ++i) {
+    for (std::size_t j = i + 1; j < views.size(); ++j) {
+      TriangulationQuality quality;
+      std::vector<Person3d> people = triangulate_people(
+        _cameras[i].model, views[i]->people,
+        _cameras[j].model, views[j]->people,
+        _options.triangulation,
+        &quality
+      );
+
+      // Prefer the pair that sees the most joints, then the one that agrees
+      // with its views best.
+      const std::uint64_t joints = quality.reprojection_error.count();
+      const double error = quality.reprojection_error.rms();
+      const bool first = i == 0 && j == 1;
+      if (
+        first || joints > best_joints ||
+        (joints == best_joints && error < best_error)
+      ) {
+        best = std::move(people);
+        best_joints = joints;
+        best_error = error;
+      }
+    }
+  }
+  return best;
+}
+
+template <typename T>
+void Pipeline::_push(Stage<T>& stage, T value) {
+  lf::Queue<T>& queue = stage.queue;
+  if (queue.size() >= queue.max_size() && queue.pop()) ++_dropped;
+  try {
+    queue.push(std::move(value));
+  } catch (const std::length_error&) {
+    // Another producer filled the slot first, this frame is the one dropped.
+    ++_dropped;
+  }
+  _notify(stage);
+}
+
+template <typename T, typename Done>
+std::optional<T> Pipeline::_pop(Stage<T>& stage, const Done& done) {
+  while (true) {
+    if (std::optional<T> value = stage.queue.pop()) return value;
+
+    // Producers take the lock before notifying, so checking under it cannot
+    // miss a push or the last producer finishing.
+    std::unique_lock<std::mutex> lock{stage.mutex};
+    stage.ready.wait(lock, [&]() { return !stage.queue.empty() || done(); });
+    if (stage.queue.empty()) return std::nullopt;
+  }
+}
+
+template <typename T>
+void Pipeline::_notify(Stage<T>& stage) {
+  { std::lock_guard<std::mutex> lock{stage.mutex}; }
+  stage.ready.notify_all();
+}
+
+void Pipeline::_capture_loop(Camera& camera, std::size_t camera_idx) {
+  try {
+    while (_reading) {
+      std::optional<Frame> frame = camera.source->read();
+      if (!frame) break;
+      ++_captured;
+      _push(
+        _frames,
+        View{.camera_idx = camera_idx, .frame = *std::move(frame)}
+      );
+    }
+  } catch (...) {
+    // Triangulation needs every camera, so one failing stops them all.
+    _reading = false;
+    std::lock_guard<std::mutex> lock{_error_mutex};
+    if (!_error) _error = std::current_exception();
+  }
+  --_active_sources;
+  _notify(_frames);
+}
+
+void Pipeline::_pose_loop() {
+  auto sources_done = [this]() { return _active_sources == 0; };
+  while (std::optional<View> view = _pop(_frames, sources_done)) {
+    view->dequeued_at = steady_clock::now();
+    std::vector<Person> people = _backend->detect(view->frame);
+    view->detected_at = steady_clock::now();
+
+    const PointUndistorter& undistorter =
+      _cameras[view->camera_idx].undistorter;
+    view->people.reserve(people.size());
+    for (const Person& person : people) {
+      view->people.push_back(undistort_person(person, undistorter));
+    }
+    view->undistorted_at = steady_clock::now();
+
+    {
+      std::lock_guard<std::mutex> lock{_stats_mutex};
+      _stats.queued.record(view->dequeued_at - view->frame.captured_at);
+      _stats.pose.record(view->detected_at - view->dequeued_at);
+      _stats.undistort.record(view->undistorted_at - view->detected_at);
+    }
+
+    // Later stages only need the keypoints, let the image buffer go now.
+    view->frame.image.release();
+    _push(_detections, *std::move(view));
+  }
+  _pose_done = true;
+  _notify(_detections);
+}
+
+void Pipeline::_sync_loop() {
+  PersonTracker3d tracker{_options.tracker};
+  std::vector<std::optional<View>> views(_cameras.size());
+  std::uint64_t next_frame_id = 0;
+  auto pose_done = [this]() -> bool { return _pose_done; };
+  while (std::optional<View> view = _pop(_detections, pose_done)) {
+    std::optional<View>& slot = views[view->camera_idx];
+    if (slot) ++_unmatched;
+    slot = std::move(view);
+
+    // Wait until every camera has a view, then throw out any that are too
+    // old to pair with the newest.
+    if (std::any_of(views.begin(), views.end(), [](const auto& v) {
+      return !v.has_value();
+    })) {
+      continue;
+    }
+    steady_clock::time_point newest = steady_clock::time_point::min();
+    for (const std::optional<View>& v : views) {
+      newest = std::max(newest, v->frame.captured_at);
+    }
+    bool complete = true;
+    for (std::optional<View>& v : views) {
+      if (newest - v->frame.captured_at > _options.max_skew) {
+        v.reset();
+        ++_unmatched;
+        complete = false;
+      }
+    }
+    if (!complete) continue;
+
+    const steady_clock::time_point synced_at = steady_clock::now();
+    LiveFrame live_frame{
+      .frame_id = next_frame_id++,
+      .people = _triangulate(views),
+      .captured_at = steady_clock::time_point::max()
+    };
+    tracker.track(live_frame.people);
+    live_frame.triangulated_at = steady_clock::now();
+
+    steady_clock::time_point first_ready = steady_clock::time_point::max();
+    for (std::optional<View>& v : views) {
+      live_frame.captured_at =
+        std::min(live_frame.captured_at, v->frame.captured_at);
+      first_ready = std::min(first_ready, v->undistorted_at);
+      v.reset();
+    }
+    {
+      std::lock_guard<std::mutex> lock{_stats_mutex};
+      _stats.sync.record(synced_at - first_ready);
+      _stats.triangulate.record(live_frame.triangulated_at - synced_at);
+    }
+    _push(_live_frames, std::move(live_frame));
+  }
+  _sync_done = true;
+  _notify(_live_frames);
+}
+
+void Pipeline::_output_loop() {
+  auto sync_done = [this]() -> bool { return _sync_done; };
+  while (std::optional<LiveFrame> live_frame = _pop(_live_frames, sync_done)) {
+    const steady_clock::time_point dequeued_at = steady_clock::now();
+    _output(*live_frame);
+    const steady_clock::time_point published_at = steady_clock::now();
+
+    const steady_clock::duration latency =
+      published_at - live_frame->captured_at;
+    std::lock_guard<std::mutex> lock{_stats_mutex};
+    _stats.output.record(published_at - dequeued_at);
+    _stats.end_to_end.record(latency);
+    ++_stats.published;
+    if (latency > _options.latency_budget) ++_stats.over_budget;
+  }
+  _output_done = true;
+}
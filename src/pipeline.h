@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "lf/queue.h"
+#include "src/camera_model.h"
+#include "src/cameras.h"
+#include "src/frame_source.h"
+#include "src/pose_backend.h"
+#include "src/timing.h"
+#include "src/tracker.h"
+#include "src/tracking.h"
+#include "src/triangulation.h"
+#include "src/undistort.h"
+
+struct PipelineCamera {
+  std::unique_ptr<FrameSource> source;
+  CameraParameters parameters;
+
+  // Size of the source's frames. When set, keypoints are undistorted through
+  // a precomputed grid instead of the iterative solve.
+  cv::Size image_size;
+};
+
+struct PipelineOptions {
+  // Capacity of every queue between stages. Kept small so a slow stage drops
+  // stale frames rather than letting latency build up behind it.
+  std::size_t queue_capacity = 2;
+
+  // Views captured further apart than this are not triangulated together.
+  steady_clock::duration max_skew = std::chrono::milliseconds{20};
+
+  // Glass-to-3D latency the pipeline is expected to stay under.
+  steady_clock::duration latency_budget = std::chrono::milliseconds{100};
+
+  int undistort_grid_step = 4;
+  TriangulationOptions triangulation;
+  TrackerOptions tracker;
+};
+
+/**
+ * A set of people triangulated from views captured at about the same time,
+ * with when each stage finished working on it.
+ */
+struct LiveFrame {
+  std::uint64_t frame_id;
+  std::vector<Person3d> people;
+
+  // Earliest capture time among the views.
+  steady_clock::time_point captured_at;
+  steady_clock::time_point triangulated_at;
+};
+
+struct PipelineStats {
+  // Time each view waited for the pose stage.
+  LatencyHistogram queued;
+  LatencyHistogram pose;
+  LatencyHistogram undistort;
+  // Time from the first view of a set being ready to the set being complete.
+  LatencyHistogram sync;
+  LatencyHistogram triangulate;
+  LatencyHistogram output;
+  // Glass-to-3D: capture of the earliest view to the output callback
+  // returning.
+  LatencyHistogram end_to_end;
+
+  std::uint64_t captured = 0;
+  std::uint64_t published = 0;
+  // Frames discarded because the next stage was still busy.
+  std::uint64_t dropped = 0;
+  // Views discarded because no other camera had a view close enough in time.
+  std::uint64_t unmatched = 0;
+  // Published frames that took longer than the latency budget.
+  std::uint64_t over_budget = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const PipelineStats& stats);
+
+/**
+ * Live capture to 3D skeleton pipeline.
+ *
+ * Each camera is read on its own thread. Frames then go through pose
+ * detection and keypoint undistortion on one thread, are matched across views
+ * and triangulated on another, and are handed to the output callback on a
+ * last one. Stages are joined by bounded lock-free queues and when a queue is
+ * full its oldest entry is dropped, so a slow stage costs frame rate instead
+ * of latency. Idle stages sleep until their queue is pushed to.
+ *
+ * With more than 2 cameras, each set of views is triangulated from every
+ * pair of them and the pair that triangulates the most joints is kept.
+ */
+class Pipeline {
+public:
+  using Output = std::function<void(const LiveFrame&)>;
+
+  Pipeline(
+    std::vector<PipelineCamera> cameras,
+    std::unique_ptr<PoseBackend> backend,
+    Output output,
+    PipelineOptions options = {}
+  );
+  ~Pipeline();
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  void start();
+
+  /**
+   * Stops reading from the cameras and waits for frames already read to
+   * finish.
+   */
+  void stop();
+
+  /**
+   * Waits for every source to be exhausted and the pipeline to drain.
+   * Rethrows the first error a source failed with, which also stops the
+   * others.
+   */
+  void wait();
+
+  bool running() const { return !_output_done; }
+
+  PipelineStats stats() const;
+
+private:
+  struct View {
+    std::size_t camera_idx;
+    Frame frame;
+    std::vector<Person> people;
+    steady_clock::time_point dequeued_at;
+    steady_clock::time_point detected_at;
+    steady_clock::time_point undistorted_at;
+  };
+
+  struct Camera {
+    std::unique_ptr<FrameSource> source;
+    CameraModel model;
+    PointUndistorter undistorter;
+  };
+
+  /**
+   * Bounded queue into a stage, with a condition variable the stage waits on
+   * while the queue is empty.
+   */
+  template <typename T>
+  struct Stage {
+    explicit Stage(std::size_t capacity): queue{capacity} {}
+
+    lf::Queue<T> queue;
+    std::mutex mutex;
+    std::condition_variable ready;
+  };
+
+  void _join();
+  void _capture_loop(Camera& camera, std::size_t camera_idx);
+  void _pose_loop();
+  void _sync_loop();
+  void _output_loop();
+
+  /**
+   * Triangulates a complete set of views from the best pair of cameras.
+   */
+  std::vector<Person3d> _triangulate(
+    const std::vector<std::optional<View>>& views
+  ) const;
+
+  /**
+   * Pushes onto a stage queue, first dropping the oldest entry if it is full,
+   * and wakes the stage.
+   */
+  template <typename T>
+  void _push(Stage<T>& stage, T value);
+
+  /**
+   * Waits for the next entry of a stage queue. Returns nothing once the queue
+   * is empty and `done` says nothing more will be pushed.
+   */
+  template <typename T, typename Done>
+  std::optional<T> _pop(Stage<T>& stage, const Done& done);
+
+  /**
+   * Wakes a stage to check on its producers.
+   */
+  template <typename T>
+  void _notify(Stage<T>& stage);
+
+  std::vector<Camera> _cameras;
+  std::unique_ptr<PoseBackend> _backend;
+  Output _output;
+  PipelineOptions _options;
+
+  Stage<View> _frames;
+  Stage<View> _detections;
+  Stage<LiveFrame> _live_frames;
+
+  std::atomic_bool _reading = false;
+  std::atomic_size_t _active_sources = 0;
+  std::atomic_bool _pose_done = true;
+  std::atomic_bool _sync_done = true;
+  std::atomic_bool _output_done = true;
+  std::atomic_uint64_t _captured = 0;
+  std::atomic_uint64_t _dropped = 0;
+  std::atomic_uint64_t _unmatched = 0;
+
+  mutable std::mutex _stats_mutex;
+  PipelineStats _stats;
+
+  std::mutex _error_mutex;
+  std::exception_ptr _error;
+
+  std::vector<std::thread> _threads;
+};
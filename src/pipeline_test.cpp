@@ -0,0 +1,287 @@
+#include "src/pipeline.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/camera_model.h"
+#include "src/cameras.h"
+#include "src/frame_source.h"
+#include "src/pose_backend.h"
+#include "src/tracking.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+
+double camera_matrix[] = {
+  1000.0, 0.0, 960.0,
+  0.0, 1000.0, 540.0,
+  0.0, 0.0, 1.0
+};
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+
+CameraParameters make_parameters(const cv::Vec3d& center) {
+  return CameraParameters{
+    .matrix = cv::Mat{3, 3, CV_64F, camera_matrix}.clone(),
+    .distortion = cv::Mat::zeros(1, 5, CV_64F),
+    .rotation = cv::Mat::zeros(3, 1, CV_64F),
+    .translation = cv::Mat{-center}.clone()
+  };
+}
+
+/**
+ * Produces a fixed number of frames at a steady rate. The camera index is
+ * stored in the single pixel of each image so the backend can tell the views
+ * apart.
+ */
+class FakeSource : public FrameSource {
+public:
+  FakeSource(
+    int camera_idx,
+    std::size_t frame_count,
+    steady_clock::duration interval,
+    steady_clock::duration clock_offset = {}
+  ):
+    _camera_idx{camera_idx},
+    _frame_count{frame_count},
+    _interval{interval},
+    _clock_offset{clock_offset}
+  {}
+
+  std::optional<Frame> read() override {
+    if (_next_frame_id == _frame_count) return std::nullopt;
+    std::this_thread::sleep_for(_interval);
+    return Frame{
+      .frame_id = _next_frame_id++,
+      .captured_at = steady_clock::now() + _clock_offset,
+      .image = cv::Mat{1, 1, CV_8U, cv::Scalar(_camera_idx)}
+    };
+  }
+
+private:
+  int _camera_idx;
+  std::size_t _frame_count;
+  steady_clock::duration _interval;
+  steady_clock::duration _clock_offset;
+  std::uint64_t _next_frame_id = 0;
+};
+
+/**
+ * A camera that stops sending frames.
+ */
+class StalledSource : public FrameSource {
+public:
+  std::optional<Frame> read() override {
+    throw std::runtime_error("Camera stopped sending frames.");
+  }
+};
+
+/**
+ * Reports one person standing in front of the cameras it has models for.
+ * Cameras past those see nobody.
+ */
+class FakeBackend : public PoseBackend {
+public:
+  FakeBackend(
+    std::vector<CameraModel> cameras,
+    steady_clock::duration delay = {}
+  ):
+    _cameras{std::move(cameras)},
+    _delay{delay}
+  {}
+
+  std::vector<Person> detect(const Frame& frame) override {
+    std::this_thread::sleep_for(_delay);
+    const std::size_t camera_idx = frame.image.at<unsigned char>(0, 0);
+    if (camera_idx >= _cameras.size()) return {};
+    const CameraModel& camera = _cameras[camera_idx];
+    Person person{.person_id = 0};
+    for (int i = 0; i < 5; ++i) {
+      const cv::Point2d pixel = camera.project({0.5, -0.2 * i, 3.0});
+      person.body.push_back(
+        Point{.point_id = i, .x = pixel.x, .y = pixel.y, .confidence = 1.0}
+      );
+    }
+    return {person};
+  }
+
+private:
+  std::vector<CameraModel> _cameras;
+  steady_clock::duration _delay;
+};
+
+struct Output {
+  std::mutex mutex;
+  std::vector<LiveFrame> frames;
+
+  Pipeline::Output callback() {
+    return [this](const LiveFrame& frame) {
+      std::lock_guard<std::mutex> lock{mutex};
+      frames.push_back(frame);
+    };
+  }
+};
+
+std::vector<PipelineCamera> make_cameras(
+  std::size_t frame_count,
+  steady_clock::duration interval,
+  steady_clock::duration skew = {}
+) {
+  std::vector<PipelineCamera> cameras;
+  cameras.push_back(PipelineCamera{
+    .source = std::make_unique<FakeSource>(0, frame_count, interval),
+    .parameters = make_parameters({0.0, 0.0, 0.0}),
+    .image_size = IMAGE_SIZE
+  });
+  cameras.push_back(PipelineCamera{
+    .source = std::make_unique<FakeSource>(1, frame_count, interval, skew),
+    .parameters = make_parameters({1.0, 0.0, 0.0}),
+    .image_size = IMAGE_SIZE
+  });
+  return cameras;
+}
+
+std::unique_ptr<PoseBackend> make_backend(steady_clock::duration delay = {}) {
+  return std::make_unique<FakeBackend>(
+    std::vector<CameraModel>{
+      CameraModel{make_parameters({0.0, 0.0, 0.0})},
+      CameraModel{make_parameters({1.0, 0.0, 0.0})}
+    },
+    delay
+  );
+}
+
+TEST(Pipeline, TriangulatesMatchingViews) {
+  Output output;
+  Pipeline pipeline{
+    make_cameras(20, milliseconds{10}),
+    make_backend(),
+    output.callback()
+  };
+  pipeline.start();
+  pipeline.wait();
+  EXPECT_FALSE(pipeline.running());
+
+  const PipelineStats stats = pipeline.stats();
+  EXPECT_EQ(stats.captured, 40);
+  EXPECT_EQ(stats.published, output.frames.size());
+  ASSERT_FALSE(output.frames.empty());
+
+  for (const LiveFrame& frame : output.frames) {
+    ASSERT_EQ(frame.people.size(), 1);
+    EXPECT_EQ(frame.people[0].person_id, 0);
+    EXPECT_EQ(frame.people[0].body.size(), 5);
+    EXPECT_LE(frame.captured_at, frame.triangulated_at);
+  }
+  EXPECT_EQ(stats.end_to_end.count(), output.frames.size());
+  EXPECT_GT(stats.pose.count(), 0);
+}
+
+TEST(Pipeline, TriangulatesFromBestPairOfCameras) {
+  std::vector<PipelineCamera> cameras = make_cameras(20, milliseconds{10});
+  cameras.insert(cameras.begin(), PipelineCamera{
+    .source = std::make_unique<FakeSource>(2, 20, milliseconds{10}),
+    .parameters = make_parameters({-1.0, 0.0, 0.0}),
+    .image_size = IMAGE_SIZE
+  });
+
+  Output output;
+  Pipeline pipeline{std::move(cameras), make_backend(), output.callback()};
+  pipeline.start();
+  pipeline.wait();
+
+  // The first camera sees nobody, so only the last two can find the person.
+  const PipelineStats stats = pipeline.stats();
+  EXPECT_EQ(stats.captured, 60);
+  ASSERT_FALSE(output.frames.empty());
+  for (const LiveFrame& frame : output.frames) {
+    ASSERT_EQ(frame.people.size(), 1);
+    ASSERT_EQ(frame.people[0].body.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_NEAR(frame.people[0].body[i].x, 0.5, 1e-6);
+      EXPECT_NEAR(frame.people[0].body[i].y, -0.2 * i, 1e-6);
+      EXPECT_NEAR(frame.people[0].body[i].z, 3.0, 1e-6);
+    }
+  }
+}
+
+TEST(Pipeline, DropsFramesBehindSlowPose) {
+  Output output;
+  Pipeline pipeline{
+    make_cameras(50, milliseconds{2}),
+    make_backend(milliseconds{15}),
+    output.callback()
+  };
+  pipeline.start();
+  pipeline.wait();
+
+  // Frames arrive about 15 times faster than they can be detected, so most
+  // are dropped instead of queueing up.
+  const PipelineStats stats = pipeline.stats();
+  EXPECT_EQ(stats.captured, 100);
+  EXPECT_GT(stats.dropped, 50);
+  EXPECT_LT(stats.pose.count(), 50);
+}
+
+TEST(Pipeline, SkipsViewsCapturedTooFarApart) {
+  Output output;
+  Pipeline pipeline{
+    make_cameras(10, milliseconds{5}, milliseconds{200}),
+    make_backend(),
+    output.callback()
+  };
+  pipeline.start();
+  pipeline.wait();
+
+  const PipelineStats stats = pipeline.stats();
+  EXPECT_EQ(stats.published, 0);
+  EXPECT_GT(stats.unmatched, 0);
+  EXPECT_TRUE(output.frames.empty());
+}
+
+TEST(Pipeline, StopsLiveSources) {
+  Output output;
+  Pipeline pipeline{
+    make_cameras(1'000'000, milliseconds{1}),
+    make_backend(),
+    output.callback()
+  };
+  pipeline.start();
+  std::this_thread::sleep_for(milliseconds{50});
+  pipeline.stop();
+  EXPECT_FALSE(pipeline.running());
+  EXPECT_LT(pipeline.stats().captured, 2'000'000);
+}
+
+TEST(Pipeline, StopsOnFailedSource) {
+  std::vector<PipelineCamera> cameras =
+    make_cameras(1'000'000, milliseconds{1});
+  cameras[1].source = std::make_unique<StalledSource>();
+
+  Output output;
+  Pipeline pipeline{std::move(cameras), make_backend(), output.callback()};
+  pipeline.start();
+  EXPECT_THROW(pipeline.wait(), std::runtime_error);
+  EXPECT_FALSE(pipeline.running());
+  EXPECT_TRUE(output.frames.empty());
+}
+
+TEST(Pipeline, RequiresTwoCameras) {
+  std::vector<PipelineCamera> cameras = make_cameras(1, milliseconds{1});
+  cameras.pop_back();
+  EXPECT_THROW(
+    Pipeline(std::move(cameras), make_backend(), [](const LiveFrame&) {}),
+    std::invalid_argument
+  );
+}
+
+}
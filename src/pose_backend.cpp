@@ -0,0 +1,14 @@
+#include "src/pose_backend.h"
+
+#include <filesystem>
+#include <vector>
+
+#include "src/frame_source.h"
+#include "src/tracking.h"
+
+std::vector<Person> RecordedPoseBackend::detect(const Frame& frame) {
+  if (frame.path.empty()) return {};
+  const std::filesystem::path keypoints = keypoints_path(frame);
+  if (!std::filesystem::exists(keypoints)) return {};
+  return load_people(keypoints);
+}
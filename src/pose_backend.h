@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "src/frame_source.h"
+#include "src/tracking.h"
+
+/**
+ * Detects the 2D pose of every person in a frame.
+ *
+ * Backends are only ever called from one thread at a time.
+ */
+class PoseBackend {
+public:
+  virtual ~PoseBackend() = default;
+
+  virtual std::vector<Person> detect(const Frame& frame) = 0;
+};
+
+/**
+ * Reads back keypoints the extractor already saved next to each replayed
+ * frame, for running the live pipeline without a pose network.
+ */
+class RecordedPoseBackend : public PoseBackend {
+public:
+  std::vector<Person> detect(const Frame& frame) override;
+};
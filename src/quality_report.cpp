@@ -0,0 +1,161 @@
+#include "src/quality_report.h"
+
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/skeleton.h"
+#include "src/triangulation.h"
+
+namespace {
+namespace fs = std::filesystem;
+
+/**
+ * Writes a CSV field, left empty when there is no value.
+ */
+void write_field(std::ofstream& out, double value) {
+  out << ',';
+  if (!std::isnan(value)) out << value;
+}
+
+/**
+ * Writes a summary's maximum as a CSV field, left empty when it has none.
+ */
+void write_max(std::ofstream& out, const ErrorSummary& summary) {
+  out << ',';
+  if (summary.count() > 0) out << summary.max();
+}
+
+void write(cv::FileStorage& file, const ErrorSummary& summary) {
+  file.write("count", static_cast<int>(summary.count()));
+  file.write("mean", summary.mean());
+  file.write("rms", summary.rms());
+  file.write("max", summary.max());
+}
+
+}
+
+QualityReport::QualityReport(
+  const fs::path& directory,
+  QualityReportOptions options
+):
+  _directory{directory},
+  _options{options},
+  _frames{directory / "quality.csv"}
+{
+  if (!_frames) {
+    throw std::runtime_error(
+      "Failed to open " + (directory / "quality.csv").string()
+    );
+  }
+  _frames
+    << "frame_id,people,joints,reprojection_rms,reprojection_max,"
+    << "ray_gap_mean,ray_gap_max,rejected_people\n";
+}
+
+QualityReport::~QualityReport() {
+  try {
+    close();
+  } catch (...) {
+    // Nowhere to report it, close() should have been called.
+  }
+}
+
+std::vector<std::size_t> QualityReport::add(
+  int frame_id,
+  const TriangulationQuality& quality
+) {
+  if (!_frames.is_open()) {
+    throw std::runtime_error(
+      "Quality report " + _directory.string() + " is closed."
+    );
+  }
+
+  std::vector<std::size_t> rejected;
+  for (std::size_t p = 0; p < quality.people.size(); ++p) {
+    const PersonQuality& person = quality.people[p];
+    if (_joint_reprojection_errors.size() < person.body.size()) {
+      _joint_reprojection_errors.resize(person.body.size());
+    }
+    ErrorSummary reprojection_error;
+    ErrorSummary ray_gap;
+    for (std::size_t j = 0; j < person.body.size(); ++j) {
+      const PointQuality& point = person.body[j];
+      if (std::isnan(point.ray_gap)) continue;
+      ray_gap.add(point.ray_gap);
+      reprojection_error.add(point.reprojection_error_1);
+      reprojection_error.add(point.reprojection_error_2);
+      _joint_reprojection_errors[j].add(point.reprojection_error_1);
+      _joint_reprojection_errors[j].add(point.reprojection_error_2);
+    }
+    if (
+      reprojection_error.rms() > _options.max_reprojection_error ||
+      ray_gap.mean() > _options.max_ray_gap
+    ) {
+      rejected.push_back(p);
+    }
+  }
+
+  ++_frame_count;
+  _rejected_people += rejected.size();
+  if (!rejected.empty()) _rejected_frame_ids.push_back(frame_id);
+  _reprojection_error.merge(quality.reprojection_error);
+  _ray_gap.merge(quality.ray_gap);
+
+  _frames << frame_id << ',' << quality.people.size() << ','
+    << quality.ray_gap.count();
+  write_field(_frames, quality.reprojection_error.rms());
+  write_max(_frames, quality.reprojection_error);
+  write_field(_frames, quality.ray_gap.mean());
+  write_max(_frames, quality.ray_gap);
+  _frames << ',' << rejected.size() << '\n';
+  return rejected;
+}
+
+void QualityReport::close() {
+  if (!_frames.is_open()) return;
+  _frames.close();
+  if (!_frames) {
+    throw std::runtime_error(
+      "Failed to write " + (_directory / "quality.csv").string()
+    );
+  }
+
+  const fs::path path = _directory / "quality.yml";
+  cv::FileStorage file{path.string(), cv::FileStorage::WRITE};
+  if (!file.isOpened()) {
+    throw std::runtime_error("Failed to open " + path.string());
+  }
+  file.write("frames", static_cast<int>(_frame_count));
+  file.write("rejected_people", static_cast<int>(_rejected_people));
+  file.startWriteStruct("rejected_frame_ids", cv::FileNode::SEQ);
+  for (int frame_id : _rejected_frame_ids) file.write("", frame_id);
+  file.endWriteStruct();
+  file.startWriteStruct("reprojection_error", cv::FileNode::MAP);
+  write(file, _reprojection_error);
+  file.endWriteStruct();
+  file.startWriteStruct("ray_gap", cv::FileNode::MAP);
+  write(file, _ray_gap);
+  file.endWriteStruct();
+
+  file.startWriteStruct("joints", cv::FileNode::SEQ);
+  for (std::size_t j = 0; j < _joint_reprojection_errors.size(); ++j) {
+    file.startWriteStruct("", cv::FileNode::MAP);
+    file.write(
+      "name",
+      j < BODY_25_JOINT_NAMES.size()
+        ? std::string{BODY_25_JOINT_NAMES[j]}
+        : std::to_string(j)
+    );
+    file.startWriteStruct("reprojection_error", cv::FileNode::MAP);
+    write(file, _joint_reprojection_errors[j]);
+    file.endWriteStruct();
+    file.endWriteStruct();
+  }
+  file.endWriteStruct();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include "src/triangulation.h"
+
+struct QualityReportOptions {
+  // People whose reprojection error RMS, in undistorted pixels, is past this
+  // are rejected.
+  double max_reprojection_error = 20.0;
+
+  // People whose mean ray gap, in world units, is past this are rejected.
+  double max_ray_gap = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * Triangulation quality of a whole session, written next to its animation.
+ *
+ * Each frame's `TriangulationQuality` is folded into running summaries for
+ * the session and for each body joint as it is added, and written straight
+ * away as a row of `quality.csv`. People are judged one at a time, so a
+ * badly matched person does not take everyone else in the frame with them.
+ * Closing writes `quality.yml` with the session's summaries and the frames
+ * that had someone rejected.
+ */
+class QualityReport {
+public:
+  explicit QualityReport(
+    const std::filesystem::path& directory,
+    QualityReportOptions options = {}
+  );
+  ~QualityReport();
+  QualityReport(const QualityReport&) = delete;
+  QualityReport(QualityReport&&) = delete;
+  QualityReport& operator=(const QualityReport&) = delete;
+  QualityReport& operator=(QualityReport&&) = delete;
+
+  /**
+   * Adds a frame, returning the indices in `quality.people` of those past
+   * the limits, whose joints should not be trusted. People without a single
+   * confident joint are never rejected.
+   */
+  std::vector<std::size_t> add(
+    int frame_id,
+    const TriangulationQuality& quality
+  );
+
+  /**
+   * Writes the session summary. Called by the destructor if not before,
+   * though errors are only reported from here.
+   */
+  void close();
+
+  std::size_t frame_count() const { return _frame_count; }
+  std::size_t rejected_people() const { return _rejected_people; }
+
+  /**
+   * Frames with at least one person rejected.
+   */
+  const std::vector<int>& rejected_frame_ids() const {
+    return _rejected_frame_ids;
+  }
+
+  /**
+   * Over every frame added, rejected people included.
+   */
+  const ErrorSummary& reprojection_error() const {
+    return _reprojection_error;
+  }
+  const ErrorSummary& ray_gap() const { return _ray_gap; }
+
+  /**
+   * Reprojection error of each body joint over every frame added.
+   */
+  const std::vector<ErrorSummary>& joint_reprojection_errors() const {
+    return _joint_reprojection_errors;
+  }
+
+private:
+  std::filesystem::path _directory;
+  QualityReportOptions _options;
+  std::ofstream _frames;
+
+  std::size_t _frame_count = 0;
+  std::size_t _rejected_people = 0;
+  std::vector<int> _rejected_frame_ids;
+  ErrorSummary _reprojection_error;
+  ErrorSummary _ray_gap;
+  std::vector<ErrorSummary> _joint_reprojection_errors;
+};
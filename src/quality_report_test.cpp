@@ -0,0 +1,194 @@
+#include "src/quality_report.h"
+
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/triangulation.h"
+
+namespace {
+
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/quality_report";
+
+/**
+ * An empty directory for a single test.
+ */
+path make_directory(const std::string& name) {
+  const path directory = TEST_DIR / name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+/**
+ * Adds a person whose joints all have the same errors.
+ */
+void add_person(
+  TriangulationQuality& quality,
+  double reprojection_error,
+  double ray_gap,
+  int joint_count = 3
+) {
+  PersonQuality& person = quality.people.emplace_back(
+    PersonQuality{.person_id = static_cast<int>(quality.people.size())}
+  );
+  for (int i = 0; i < joint_count; ++i) {
+    person.body.push_back(PointQuality{
+      .point_id = i,
+      .ray_gap = ray_gap,
+      .reprojection_error_1 = reprojection_error,
+      .reprojection_error_2 = reprojection_error
+    });
+    quality.ray_gap.add(ray_gap);
+    quality.reprojection_error.add(reprojection_error);
+    quality.reprojection_error.add(reprojection_error);
+  }
+}
+
+/**
+ * A frame with just one person.
+ */
+TriangulationQuality make_quality(
+  double reprojection_error,
+  double ray_gap,
+  int joint_count = 3
+) {
+  TriangulationQuality quality;
+  add_person(quality, reprojection_error, ray_gap, joint_count);
+  return quality;
+}
+
+using Indices = std::vector<std::size_t>;
+
+std::vector<std::string> read_lines(const path& file) {
+  std::ifstream in{file};
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(in, line);) lines.push_back(line);
+  return lines;
+}
+
+TEST(QualityReport, WritesRowPerFrame) {
+  const path directory = make_directory("rows");
+  {
+    QualityReport report{directory};
+    EXPECT_TRUE(report.add(10, make_quality(5.0, 0.01)).empty());
+    EXPECT_TRUE(report.add(11, TriangulationQuality{}).empty());
+    report.close();
+  }
+
+  const std::vector<std::string> lines = read_lines(directory / "quality.csv");
+  ASSERT_EQ(lines.size(), 3);
+  EXPECT_EQ(
+    lines[0],
+    "frame_id,people,joints,reprojection_rms,reprojection_max,"
+    "ray_gap_mean,ray_gap_max,rejected_people"
+  );
+  EXPECT_EQ(lines[1], "10,1,3,5,5,0.01,0.01,0");
+  EXPECT_EQ(lines[2], "11,0,0,,,,,0");
+}
+
+TEST(QualityReport, RejectsPeoplePastLimits) {
+  const path directory = make_directory("rejects");
+  QualityReport report{
+    directory,
+    {.max_reprojection_error = 10.0, .max_ray_gap = 0.05}
+  };
+  EXPECT_EQ(report.add(1, make_quality(5.0, 0.01)), Indices{});
+  EXPECT_EQ(report.add(2, make_quality(15.0, 0.01)), Indices{0});
+  EXPECT_EQ(report.add(3, make_quality(5.0, 0.1)), Indices{0});
+  EXPECT_EQ(report.add(4, TriangulationQuality{}), Indices{});
+  EXPECT_EQ(report.frame_count(), 4);
+  EXPECT_EQ(report.rejected_people(), 2);
+  EXPECT_EQ(report.rejected_frame_ids(), (std::vector<int>{2, 3}));
+
+  report.close();
+  const std::vector<std::string> lines = read_lines(directory / "quality.csv");
+  ASSERT_EQ(lines.size(), 5);
+  EXPECT_EQ(lines[2].back(), '1');
+  EXPECT_EQ(lines[3].back(), '1');
+}
+
+TEST(QualityReport, JudgesEachPersonAlone) {
+  const path directory = make_directory("each_person");
+  QualityReport report{directory, {.max_reprojection_error = 10.0}};
+
+  // Together they are under the limit, but the second is still off.
+  TriangulationQuality quality;
+  add_person(quality, 1.0, 0.01, 25);
+  add_person(quality, 30.0, 0.01, 1);
+  add_person(quality, 2.0, 0.01, 25);
+  ASSERT_LT(quality.reprojection_error.rms(), 10.0);
+  EXPECT_EQ(report.add(1, quality), Indices{1});
+  EXPECT_EQ(report.rejected_people(), 1);
+
+  report.close();
+  const std::vector<std::string> lines = read_lines(directory / "quality.csv");
+  ASSERT_EQ(lines.size(), 2);
+  EXPECT_EQ(lines[1].substr(0, 7), "1,3,51,");
+  EXPECT_EQ(lines[1].back(), '1');
+}
+
+TEST(QualityReport, SummarizesSession) {
+  const path directory = make_directory("summary");
+  QualityReport report{directory, {.max_reprojection_error = 10.0}};
+  report.add(1, make_quality(3.0, 0.01));
+  report.add(2, make_quality(4.0, 0.03, 2));
+  report.add(3, make_quality(20.0, 0.02, 1));
+
+  EXPECT_EQ(report.reprojection_error().count(), 12);
+  EXPECT_DOUBLE_EQ(report.reprojection_error().max(), 20.0);
+  EXPECT_EQ(report.ray_gap().count(), 6);
+  EXPECT_NEAR(report.ray_gap().mean(), 0.11 / 6, 1e-12);
+  ASSERT_EQ(report.joint_reprojection_errors().size(), 3);
+  EXPECT_EQ(report.joint_reprojection_errors()[0].count(), 6);
+  EXPECT_DOUBLE_EQ(report.joint_reprojection_errors()[0].max(), 20.0);
+  EXPECT_EQ(report.joint_reprojection_errors()[2].count(), 2);
+  EXPECT_DOUBLE_EQ(report.joint_reprojection_errors()[2].mean(), 3.0);
+  report.close();
+
+  cv::FileStorage file{
+    (directory / "quality.yml").string(),
+    cv::FileStorage::READ
+  };
+  ASSERT_TRUE(file.isOpened());
+  EXPECT_EQ(static_cast<int>(file["frames"]), 3);
+  EXPECT_EQ(static_cast<int>(file["rejected_people"]), 1);
+  std::vector<int> rejected;
+  for (const cv::FileNode& node : file["rejected_frame_ids"]) {
+    rejected.push_back(static_cast<int>(node));
+  }
+  EXPECT_EQ(rejected, (std::vector<int>{3}));
+  EXPECT_EQ(static_cast<int>(file["reprojection_error"]["count"]), 12);
+  EXPECT_DOUBLE_EQ(
+    static_cast<double>(file["reprojection_error"]["max"]),
+    20.0
+  );
+
+  const cv::FileNode joints = file["joints"];
+  ASSERT_EQ(joints.size(), 3);
+  EXPECT_EQ(static_cast<std::string>(joints[0]["name"]), "Nose");
+  EXPECT_EQ(static_cast<int>(joints[1]["reprojection_error"]["count"]), 4);
+}
+
+TEST(QualityReport, SkipsUnmeasuredJoints) {
+  const path directory = make_directory("unmeasured");
+  TriangulationQuality quality = make_quality(3.0, 0.01);
+  quality.people[0].body[1].ray_gap = std::nan("");
+  quality.people[0].body[1].reprojection_error_1 = std::nan("");
+  quality.people[0].body[1].reprojection_error_2 = std::nan("");
+
+  QualityReport report{directory};
+  report.add(1, quality);
+  ASSERT_EQ(report.joint_reprojection_errors().size(), 3);
+  EXPECT_EQ(report.joint_reprojection_errors()[0].count(), 2);
+  EXPECT_EQ(report.joint_reprojection_errors()[1].count(), 0);
+}
+
+}
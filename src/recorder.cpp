@@ -1,129 +1,402 @@
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
-#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
-#include <opencv2/videoio.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
-#include "src/cameras.h"
+#include "src/blocking_queue.h"
+#include "src/camera_devices.h"
 #include "src/files.h"
+#include "src/frame_sync.h"
 #include "src/timing.h"
+#include "src/tracing.h"
+#include "src/v4l2_camera.h"
+#include "src/video_writer.h"
 
-static std::atomic_size_t frame_counter = 0;
+namespace {
 
-class Camera {
-private:
-  enum class Action {
-    NONE,
-    EXIT,
-    CAPTURE
-  };
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using namespace std::chrono_literals;
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+constexpr auto FRAME_DURATION = duration_cast<std::chrono::nanoseconds>(
+  std::chrono::duration<double>{1.0 / RECORDING_FPS}
+);
+constexpr auto REPORT_INTERVAL = seconds{5};
+
+// Each tick records the frames nearest to one frame duration ago, so the
+// frames just after that moment have had time to arrive.
+constexpr auto SELECTION_DELAY = FRAME_DURATION;
+
+// Frames kept per camera for picking the nearest one, enough to cover the
+// selection delay at the camera's own frame rate.
+constexpr std::size_t HISTORY_SIZE = 3;
+
+// Frame sets waiting to be encoded before new ones are dropped.
+constexpr std::size_t ENCODE_QUEUE_SIZE = 4;
+
+volatile std::sig_atomic_t interrupted = 0;
+
+double to_ms(steady_clock::duration duration) {
+  return duration_cast<std::chrono::duration<double, std::milli>>(duration)
+    .count();
+}
+
+struct EncodeJob {
+  std::uint64_t frame_index;
+  V4L2Frame frame;
+};
 
+/**
+ * Grabs every frame a camera produces on one thread and saves the frames the
+ * scheduler picks on another, so slow encoding never delays capture. Frames
+ * are saved as numbered PNGs, or into one video when given a codec.
+ */
+class Camera {
 public:
-  explicit Camera(int camera_id):
-    _camera_id{camera_id},
-    _save_path{get_recordings_path(camera_id)}
+  Camera(const CameraInfo& camera, std::optional<VideoCodec> codec):
+    _save_path{get_recordings_path(camera.device.camera_id)},
+    _camera{
+      camera.device.device_path,
+      // Held buffers: the history, queued and in-progress encodes, plus a
+      // few for the driver to keep filling.
+      negotiate_mode(
+        camera,
+        {
+          .image_size = IMAGE_SIZE,
+          .buffer_count = HISTORY_SIZE + ENCODE_QUEUE_SIZE + 3
+        }
+      )
+    },
+    _history{HISTORY_SIZE},
+    _encode_queue{ENCODE_QUEUE_SIZE}
   {
-    _camera_input.open(_camera_id);
-    _camera_input.set(cv::CAP_PROP_FRAME_WIDTH, 1920);
-    _camera_input.set(cv::CAP_PROP_FRAME_HEIGHT, 1080);
-    _thread = std::thread{std::bind(&Camera::_thread_loop, this)};
+    if (codec) {
+      _video = std::make_unique<VideoWriter>(
+        _save_path / ("video" + video_extension(*codec)),
+        _camera.image_size(),
+        VideoWriterOptions{.codec = *codec, .fps = 1s / FRAME_DURATION}
+      );
+    }
+    _capture_thread = std::thread{[this]() { _capture_loop(); }};
+    _encode_thread = std::thread{[this]() { _encode_loop(); }};
   }
 
   ~Camera() {
-    _trigger_action(Action::EXIT);
-    _thread.join();
+    try {
+      stop();
+    } catch (const std::exception& err) {
+      std::cerr << _camera.card() << ": " << err.what() << std::endl;
+    }
   }
 
-  void capture() { _trigger_action(Action::CAPTURE); }
-
-  cv::Mat last_capture() {
-    cv::Mat image;
-    {
-      std::unique_lock<std::mutex> lock{_action_mutex};
-      _last_frame.copyTo(image);
+  /**
+   * Stops capturing and waits for the queued frames to be saved, then throws
+   * whatever stopped either thread early.
+   */
+  void stop() {
+    _running = false;
+    if (_capture_thread.joinable()) _capture_thread.join();
+    _encode_queue.close();
+    if (_encode_thread.joinable()) _encode_thread.join();
+    _history.clear();
+    // Closed even after a failure, the trailer is what makes the frames
+    // already encoded playable.
+    if (_video) {
+      try {
+        _video->close();
+      } catch (...) {
+        _fail(std::current_exception());
+      }
     }
-    return image;
+    if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
   }
 
-private:
-  void _thread_loop() {
-    std::unique_lock<std::mutex> action_lock{_action_mutex};
-    while (_action != Action::EXIT) {
-      _action_flag.wait(
-        action_lock,
-        [this]() { return _action != Action::NONE; }
-      );
-      switch (_action) {
-        case Action::NONE:
-        case Action::EXIT: continue;
+  /**
+   * True once capturing or saving has failed and the camera stopped recording.
+   */
+  bool failed() const { return _failed; }
+
+  std::optional<V4L2Frame> nearest(steady_clock::time_point target) const {
+    return _history.nearest(target);
+  }
+
+  bool can_encode() const {
+    return _encode_queue.size() < _encode_queue.max_size();
+  }
 
-        case Action::CAPTURE: {
-          _capture();
-          break;
+  /**
+   * Queues a frame to be saved, only after `can_encode` so it never waits.
+   */
+  void encode(std::uint64_t frame_index, V4L2Frame frame) {
+    _encode_queue.push({.frame_index = frame_index, .frame = std::move(frame)});
+  }
+
+  const V4L2Camera& camera() const { return _camera; }
+  std::uint64_t captured() const { return _captured; }
+  std::uint64_t missed() const { return _missed; }
+  std::uint64_t saved() const { return _saved; }
+
+private:
+  void _capture_loop() {
+    Tracer::global().name_thread("capture " + _camera.card());
+    try {
+      std::optional<std::uint32_t> last_sequence;
+      while (_running) {
+        std::optional<V4L2Frame> frame = _camera.read(milliseconds{100});
+        if (!frame) {
+          if (_camera.disconnected()) {
+            throw std::runtime_error(_camera.card() + " was disconnected.");
+          }
+          continue;
         }
+        const TraceSpan span{"capture"};
+        if (last_sequence && frame->sequence() > *last_sequence + 1) {
+          _missed += frame->sequence() - *last_sequence - 1;
+        }
+        last_sequence = frame->sequence();
+        ++_captured;
+        _history.push(*std::move(frame));
       }
-      _action = Action::NONE;
+    } catch (...) {
+      _fail(std::current_exception());
     }
   }
 
-  void _trigger_action(Action action) {
-    std::unique_lock<std::mutex> lock{_action_mutex};
-    _action = action;
-    _action_flag.notify_all();
-  }
+  void _encode_loop() {
+    Tracer::global().name_thread("encode " + _camera.card());
+    try {
+      while (std::optional<EncodeJob> job = _encode_queue.pop()) {
+        const TraceSpan span{"encode"};
+        if (_video) {
+          _write_video(job->frame);
+          ++_saved;
+          continue;
+        }
 
-  void _capture() {
-    _camera_input >> _last_frame;
-    std::filesystem::path image_name =
-      _save_path / (std::to_string(frame_counter) + ".png");
-    if (!cv::imwrite(image_name.c_str(), _last_frame)) {
-      throw std::runtime_error("Failed to save frame " + image_name.string());
+        const cv::Mat image = job->frame.decode();
+        job->frame.release();
+        std::filesystem::path image_name =
+          _save_path / (std::to_string(job->frame_index) + ".png");
+        if (!cv::imwrite(image_name.c_str(), image)) {
+          throw std::runtime_error(
+            "Failed to save frame " + image_name.string()
+          );
+        }
+        ++_saved;
+      }
+    } catch (...) {
+      _fail(std::current_exception());
     }
   }
 
-  Action _action = Action::NONE;
-  std::mutex _action_mutex;
-  std::condition_variable _action_flag;
+  /**
+   * Keeps the first error from either thread for stop() to throw.
+   */
+  void _fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock{_error_mutex};
+    if (!_error) _error = std::move(error);
+    _failed = true;
+  }
+
+  void _write_video(V4L2Frame& frame) {
+    // YUYV goes to the encoder as is, converting it there is cheaper than
+    // going through BGR. The copy frees the driver's buffer right away.
+    cv::Mat image = frame.format() == PixelFormat::YUYV
+      ? frame.image().clone()
+      : frame.decode();
+    const steady_clock::time_point captured_at = frame.timestamp();
+    frame.release();
+    // Waits when the encoder falls behind, which backs up the encode queue
+    // and makes the scheduler drop whole frame sets instead.
+    _video->write(std::move(image), captured_at);
+  }
 
-  int _camera_id;
-  std::thread _thread;
   std::filesystem::path _save_path;
+  V4L2Camera _camera;
+  FrameHistory<V4L2Frame> _history;
+  BlockingQueue<EncodeJob> _encode_queue;
+  std::unique_ptr<VideoWriter> _video;
+  std::atomic_bool _running = true;
+  std::atomic_uint64_t _captured = 0;
+  std::atomic_uint64_t _missed = 0;
+  std::atomic_uint64_t _saved = 0;
+  std::atomic_bool _failed = false;
+  std::mutex _error_mutex;
+  std::exception_ptr _error;
+  std::thread _capture_thread;
+  std::thread _encode_thread;
+};
+
+struct RecordingStats {
+  std::uint64_t recorded = 0;
+
+  // Ticks skipped because an encoder was still full.
+  std::uint64_t dropped = 0;
 
-  cv::VideoCapture _camera_input;
-  cv::Mat _last_frame;
+  // Ticks skipped because a camera had not produced any frames yet.
+  std::uint64_t incomplete = 0;
+
+  // Time between the first and last frame picked for each tick.
+  LatencyHistogram skew;
 };
 
+void report(
+  std::ostream& out,
+  const RecordingStats& stats,
+  const std::vector<std::unique_ptr<Camera>>& cameras,
+  steady_clock::duration elapsed
+) {
+  out
+    << std::fixed << std::setprecision(2) << to_hms(elapsed) << "  "
+    << stats.recorded << " recorded (" << to_fps(stats.recorded, elapsed)
+    << "fps), " << stats.dropped << " dropped, " << stats.incomplete
+    << " incomplete\n  skew: mean " << to_ms(stats.skew.mean()) << "ms  p50 "
+    << to_ms(stats.skew.percentile(50)) << "ms  p99 "
+    << to_ms(stats.skew.percentile(99)) << "ms  max "
+    << to_ms(stats.skew.max()) << "ms\n";
+  for (const std::unique_ptr<Camera>& camera : cameras) {
+    out
+      << "  " << camera->camera().card() << ": "
+      << to_fps(camera->captured(), elapsed) << "fps captured, "
+      << camera->missed() << " missed by driver, " << camera->saved()
+      << " saved\n";
+  }
+  out << std::flush;
+}
+
+}
+
 int main(int argc, char* argv[]) {
-  const std::vector<CameraDevice>& devices = get_camera_devices();
+  // Without a frame count, record until interrupted.
+  std::uint64_t frame_limit = 0;
+  std::optional<VideoCodec> codec;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--h264") {
+      codec = VideoCodec::H264;
+    } else if (arg == "--ffv1") {
+      codec = VideoCodec::FFV1;
+    } else if (
+      !arg.empty() && arg.find_first_not_of("0123456789") == arg.npos
+    ) {
+      frame_limit = std::stoull(argv[i]);
+    } else {
+      std::cerr
+        << "Usage: " << argv[0] << " [--h264|--ffv1] [frame_count]"
+        << std::endl;
+      return -1;
+    }
+  }
+
+  const std::unique_ptr<TracingSession> tracing =
+    TracingSession::from_environment();
+  Tracer::global().name_thread("scheduler");
+
+  const std::vector<CameraInfo> found = CameraEnumerator::global().cameras();
   std::vector<std::unique_ptr<Camera>> cameras;
-  cameras.reserve(devices.size());
-  for (const CameraDevice& device : devices) {
-    std::cout << device.device_path.string() << ": " << device.name << std::endl;
-    cameras.push_back(std::make_unique<Camera>(device.camera_id));
+  cameras.reserve(found.size());
+  for (const CameraInfo& camera : found) {
+    cameras.push_back(std::make_unique<Camera>(camera, codec));
+    const V4L2Camera& capture = cameras.back()->camera();
+    std::cout
+      << camera.device.device_path.string() << ": " << camera.device.name
+      << " (" << to_string(capture.format()) << " "
+      << capture.image_size().width << "x" << capture.image_size().height
+      << " @ " << capture.fps() << " fps)" << std::endl;
   }
 
-  // Make an initial capture and pause to wake up all the cameras.
-  for (std::unique_ptr<Camera>& camera : cameras) {
-    camera->capture();
+  // Pause to wake up all the cameras.
+  std::this_thread::sleep_for(seconds{1});
+  std::signal(SIGINT, [](int) { interrupted = 1; });
+
+  // Ticks only pick frames by their driver timestamps, so a late wake up
+  // delays encoding but does not change which frames are recorded.
+  RecordingStats stats;
+  const steady_clock::time_point start = steady_clock::now();
+  steady_clock::time_point last_report = start;
+  std::vector<V4L2Frame> frame_set;
+  frame_set.reserve(cameras.size());
+  for (
+    std::uint64_t tick = 0;
+    !interrupted && (frame_limit == 0 || stats.recorded < frame_limit);
+    ++tick
+  ) {
+    const steady_clock::time_point tick_time = start + FRAME_DURATION * tick;
+    std::this_thread::sleep_until(tick_time + SELECTION_DELAY);
+
+    // One camera failing ends the recording so every camera keeps the same
+    // frames, and what was already saved is still finished below.
+    if (std::any_of(
+      cameras.begin(),
+      cameras.end(),
+      [](const std::unique_ptr<Camera>& camera) { return camera->failed(); }
+    )) {
+      break;
+    }
+
+    const TraceSpan span{"select"};
+    frame_set.clear();
+    for (const std::unique_ptr<Camera>& camera : cameras) {
+      std::optional<V4L2Frame> frame = camera->nearest(tick_time);
+      if (!frame) break;
+      frame_set.push_back(*std::move(frame));
+    }
+    if (frame_set.size() != cameras.size()) {
+      ++stats.incomplete;
+    } else if (std::any_of(
+      cameras.begin(),
+      cameras.end(),
+      [](const std::unique_ptr<Camera>& camera) {
+        return !camera->can_encode();
+      }
+    )) {
+      // Drop the whole set so every camera's recording keeps the same frames.
+      ++stats.dropped;
+    } else {
+      stats.skew.record(frame_skew(frame_set));
+      for (std::size_t i = 0; i < cameras.size(); ++i) {
+        cameras[i]->encode(stats.recorded, std::move(frame_set[i]));
+      }
+      ++stats.recorded;
+    }
+
+    const steady_clock::time_point now = steady_clock::now();
+    if (now - last_report >= REPORT_INTERVAL) {
+      report(std::cout, stats, cameras, now - start);
+      last_report = now;
+    }
   }
-  std::this_thread::sleep_for(std::chrono::seconds(1));
-
-  auto start = steady_clock::now();
-  auto frame_duration = std::chrono::nanoseconds(41'666'666); // 24 fps
-  for (; frame_counter < 48; ++frame_counter) {
-    auto next_shot = start + (frame_duration * (frame_counter + 1));
-    for (std::unique_ptr<Camera>& camera : cameras) {
-      camera->capture();
+  frame_set.clear();
+
+  const steady_clock::duration elapsed = steady_clock::now() - start;
+  std::cout << "Saving queued frames..." << std::endl;
+  int status = 0;
+  for (std::unique_ptr<Camera>& camera : cameras) {
+    try {
+      camera->stop();
+    } catch (const std::exception& err) {
+      std::cerr << camera->camera().card() << ": " << err.what() << std::endl;
+      status = 1;
     }
-    std::this_thread::sleep_until(next_shot);
   }
-  auto elapsed = steady_clock::now() - start;
-  std::cout << to_fps(frame_counter, elapsed) << "fps" << std::endl;
+  report(std::cout, stats, cameras, elapsed);
+  return status;
 }
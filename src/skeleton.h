@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/**
+ * Connection between two joints, identified by their `point_id`.
+ */
+struct Bone {
+  int parent;
+  int child;
+};
+
+constexpr std::size_t BODY_25_POINT_COUNT = 25;
+constexpr int BODY_25_ROOT = 1; // Neck.
+
+/**
+ * Bones of OpenPose's BODY_25 model as a tree rooted at the neck. Bones are
+ * ordered so that every parent joint is reached before its children.
+ *
+ * https://github.com/CMU-Perceptual-Computing-Lab/openpose/blob/master/doc/02_output.md
+ */
+constexpr std::array<Bone, BODY_25_POINT_COUNT - 1> BODY_25_BONES = {{
+  {1, 0},   // Neck -> Nose
+  {1, 2},   // Neck -> RShoulder
+  {1, 5},   // Neck -> LShoulder
+  {1, 8},   // Neck -> MidHip
+  {0, 15},  // Nose -> REye
+  {0, 16},  // Nose -> LEye
+  {2, 3},   // RShoulder -> RElbow
+  {5, 6},   // LShoulder -> LElbow
+  {8, 9},   // MidHip -> RHip
+  {8, 12},  // MidHip -> LHip
+  {15, 17}, // REye -> REar
+  {16, 18}, // LEye -> LEar
+  {3, 4},   // RElbow -> RWrist
+  {6, 7},   // LElbow -> LWrist
+  {9, 10},  // RHip -> RKnee
+  {12, 13}, // LHip -> LKnee
+  {10, 11}, // RKnee -> RAnkle
+  {13, 14}, // LKnee -> LAnkle
+  {11, 22}, // RAnkle -> RBigToe
+  {11, 24}, // RAnkle -> RHeel
+  {14, 19}, // LAnkle -> LBigToe
+  {14, 21}, // LAnkle -> LHeel
+  {22, 23}, // RBigToe -> RSmallToe
+  {19, 20}  // LBigToe -> LSmallToe
+}};
+
+/**
+ * Names of the BODY_25 joints, indexed by `point_id`, as OpenPose spells them.
+ */
+constexpr std::array<std::string_view, BODY_25_POINT_COUNT>
+BODY_25_JOINT_NAMES = {
+  "Nose", "Neck", "RShoulder", "RElbow", "RWrist", "LShoulder", "LElbow",
+  "LWrist", "MidHip", "RHip", "RKnee", "RAnkle", "LHip", "LKnee", "LAnkle",
+  "REye", "LEye", "REar", "LEar", "LBigToe", "LSmallToe", "LHeel", "RBigToe",
+  "RSmallToe", "RHeel"
+};
+
+namespace impl {
+
+template <std::size_t N>
+constexpr bool is_ordered_tree(
+  const std::array<Bone, N>& bones,
+  int root,
+  std::size_t point_count
+) {
+  std::array<bool, BODY_25_POINT_COUNT> reached{};
+  if (point_count > reached.size()) return false;
+  reached[root] = true;
+  for (const Bone& bone : bones) {
+    if (!reached[bone.parent] || reached[bone.child]) return false;
+    reached[bone.child] = true;
+  }
+  for (std::size_t i = 0; i < point_count; ++i) {
+    if (!reached[i]) return false;
+  }
+  return true;
+}
+
+}
+
+static_assert(
+  impl::is_ordered_tree(BODY_25_BONES, BODY_25_ROOT, BODY_25_POINT_COUNT),
+  "BODY_25_BONES must be a parent-first tree covering every joint."
+);
@@ -0,0 +1,359 @@
+#include "src/smoothing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/tracking.h"
+
+namespace {
+
+template <typename PersonT, typename Fn>
+void for_each_joint(PersonT& person, Fn fn) {
+  std::size_t idx = 0;
+  for (auto* part : {
+    &person.body, &person.face, &person.right_paw, &person.left_paw
+  }) {
+    for (auto& point : *part) fn(idx++, point);
+  }
+}
+
+std::size_t joint_count(const Person3d& person) {
+  return
+    person.body.size() + person.face.size() + person.right_paw.size() +
+    person.left_paw.size();
+}
+
+const Point3d* joint_at(const Person3d& person, std::size_t idx) {
+  for (const auto* part : {
+    &person.body, &person.face, &person.right_paw, &person.left_paw
+  }) {
+    if (idx < part->size()) return &(*part)[idx];
+    idx -= part->size();
+  }
+  return nullptr;
+}
+
+const Person3d* find_person(const std::vector<Person3d>& people, int id) {
+  for (const Person3d& person : people) {
+    if (person.person_id == id) return &person;
+  }
+  return nullptr;
+}
+
+void gather(
+  const Person3d& person,
+  std::vector<float>& coordinates,
+  std::vector<float>& confidence
+) {
+  const std::size_t count = joint_count(person);
+  coordinates.resize(count * 3);
+  confidence.resize(count);
+  for_each_joint(person, [&](std::size_t i, const Point3d& point) {
+    coordinates[(i * 3) + 0] = static_cast<float>(point.x);
+    coordinates[(i * 3) + 1] = static_cast<float>(point.y);
+    coordinates[(i * 3) + 2] = static_cast<float>(point.z);
+    confidence[i] = static_cast<float>(point.confidence);
+  });
+}
+
+void scatter(
+  const float* coordinates,
+  const float* confidence,
+  Person3d& person
+) {
+  for_each_joint(person, [&](std::size_t i, Point3d& point) {
+    point.x = coordinates[(i * 3) + 0];
+    point.y = coordinates[(i * 3) + 1];
+    point.z = coordinates[(i * 3) + 2];
+    point.confidence = confidence[i];
+  });
+}
+
+void lerp_joint(
+  const float* from,
+  const float* to,
+  float fraction,
+  float* out
+) {
+  for (std::size_t c = 0; c < 3; ++c) {
+    out[c] = from[c] + ((to[c] - from[c]) * fraction);
+  }
+}
+
+}
+
+void OneEuroState::reset(std::size_t coordinate_count) {
+  value.assign(coordinate_count, 0.0f);
+  derivative.assign(coordinate_count, 0.0f);
+  initialized.assign(coordinate_count, false);
+}
+
+void one_euro_step(
+  float* coordinates,
+  const unsigned char* valid,
+  OneEuroState& state,
+  std::size_t count,
+  float dt,
+  const SmoothingOptions& options
+) {
+  constexpr float TWO_PI = 2.0f * std::numbers::pi_v<float>;
+  const float min_cutoff = static_cast<float>(options.min_cutoff);
+  const float beta = static_cast<float>(options.beta);
+  const float derivative_alpha =
+    1.0f / (1.0f + (1.0f / (TWO_PI * options.derivative_cutoff * dt)));
+
+  float* value = state.value.data();
+  float* derivative = state.derivative.data();
+  unsigned char* initialized = state.initialized.data();
+
+  // Written branch-free so the compiler can vectorize across joints.
+  for (std::size_t i = 0; i < count; ++i) {
+    const float x = coordinates[i];
+    const float previous = value[i];
+    const bool has_previous = initialized[i];
+    const bool update = valid[i];
+
+    const float dx = has_previous ? (x - previous) / dt : 0.0f;
+    const float smooth_dx =
+      derivative[i] + (derivative_alpha * (dx - derivative[i]));
+    const float cutoff = min_cutoff + (beta * std::fabs(smooth_dx));
+    const float alpha = 1.0f / (1.0f + (1.0f / (TWO_PI * cutoff * dt)));
+    const float filtered =
+      has_previous ? previous + (alpha * (x - previous)) : x;
+
+    coordinates[i] = update ? filtered : x;
+    value[i] = update ? filtered : previous;
+    derivative[i] = update ? smooth_dx : derivative[i];
+    initialized[i] = has_previous | update;
+  }
+}
+
+std::optional<std::vector<Person3d>> SkeletonFilter::push(
+  std::vector<Person3d> people
+) {
+  _buffer.push_back(std::move(people));
+  if (_buffer.size() <= _options.lookahead) return std::nullopt;
+  return _emit();
+}
+
+std::vector<std::vector<Person3d>> SkeletonFilter::flush() {
+  std::vector<std::vector<Person3d>> frames;
+  while (!_buffer.empty()) frames.push_back(_emit());
+  return frames;
+}
+
+std::vector<Person3d> SkeletonFilter::_emit() {
+  std::vector<Person3d> frame = std::move(_buffer.front());
+  for (Person3d& person : frame) {
+    auto [itr, inserted] = _people.try_emplace(person.person_id);
+    if (inserted) itr->second.last_frame = _frame_index;
+    _filter(person, itr->second);
+  }
+  _buffer.pop_front();
+
+  // Forget anyone who has been gone longer than we could fill across.
+  std::erase_if(_people, [&](const auto& entry) {
+    return _frame_index - entry.second.last_frame > _options.lookahead;
+  });
+  ++_frame_index;
+  return frame;
+}
+
+void SkeletonFilter::_filter(Person3d& person, PersonState& state) {
+  const std::size_t count = joint_count(person);
+  if (state.has_last_valid.size() != count) {
+    state.last_valid.assign(count * 3, 0.0f);
+    state.last_valid_frame.assign(count, 0);
+    state.has_last_valid.assign(count, false);
+    state.smoothing.reset(count * 3);
+  }
+
+  const float min_confidence = static_cast<float>(_options.min_confidence);
+  gather(person, _coordinates, _confidence);
+  _valid.resize(count * 3);
+
+  // Find where this person is in each of the buffered future frames.
+  std::vector<const Person3d*> ahead;
+  for (std::size_t k = 1; k < _buffer.size(); ++k) {
+    ahead.push_back(find_person(_buffer[k], person.person_id));
+  }
+
+  for (std::size_t j = 0; j < count; ++j) {
+    float* coordinates = &_coordinates[j * 3];
+    bool observed = _confidence[j] >= min_confidence;
+    bool usable = observed;
+    if (!observed && state.has_last_valid[j]) {
+      for (std::size_t k = 0; k < ahead.size(); ++k) {
+        if (ahead[k] == nullptr) continue;
+        const Point3d* next = joint_at(*ahead[k], j);
+        if (next == nullptr || next->confidence < min_confidence) continue;
+
+        const float next_coordinates[] = {
+          static_cast<float>(next->x),
+          static_cast<float>(next->y),
+          static_cast<float>(next->z)
+        };
+        const std::size_t since = _frame_index - state.last_valid_frame[j];
+        const float fraction =
+          static_cast<float>(since) / static_cast<float>(since + k + 1);
+        lerp_joint(
+          &state.last_valid[j * 3],
+          next_coordinates,
+          fraction,
+          coordinates
+        );
+        // Filled joints are marked as just barely trustworthy.
+        _confidence[j] = min_confidence;
+        usable = true;
+        break;
+      }
+    }
+
+    if (observed) {
+      state.last_valid[(j * 3) + 0] = coordinates[0];
+      state.last_valid[(j * 3) + 1] = coordinates[1];
+      state.last_valid[(j * 3) + 2] = coordinates[2];
+      state.last_valid_frame[j] = _frame_index;
+      state.has_last_valid[j] = true;
+    }
+    _valid[(j * 3) + 0] = usable;
+    _valid[(j * 3) + 1] = usable;
+    _valid[(j * 3) + 2] = usable;
+  }
+
+  const std::size_t elapsed =
+    std::max<std::size_t>(_frame_index - state.last_frame, 1);
+  one_euro_step(
+    _coordinates.data(),
+    _valid.data(),
+    state.smoothing,
+    count * 3,
+    static_cast<float>(elapsed / _options.frequency),
+    _options
+  );
+  scatter(_coordinates.data(), _confidence.data(), person);
+  state.last_frame = _frame_index;
+}
+
+void filter_clip(
+  std::vector<std::vector<Person3d>>& clip,
+  const SmoothingOptions& options
+) {
+  struct Sighting {
+    std::size_t frame;
+    Person3d* person;
+  };
+
+  // Gather each person's trajectory, splitting it wherever the number of
+  // joints changes so every segment is a dense frame-by-joint array.
+  std::unordered_map<int, std::vector<std::vector<Sighting>>> segments;
+  for (std::size_t f = 0; f < clip.size(); ++f) {
+    for (Person3d& person : clip[f]) {
+      std::vector<std::vector<Sighting>>& person_segments =
+        segments[person.person_id];
+      if (
+        person_segments.empty() ||
+        joint_count(*person_segments.back().front().person) !=
+          joint_count(person)
+      ) {
+        person_segments.emplace_back();
+      }
+      person_segments.back().push_back({.frame = f, .person = &person});
+    }
+  }
+
+  const float min_confidence = static_cast<float>(options.min_confidence);
+  std::vector<float> coordinates;
+  std::vector<float> confidence;
+  std::vector<unsigned char> valid;
+  std::vector<float> scratch_coordinates;
+  std::vector<float> scratch_confidence;
+  std::vector<std::ptrdiff_t> next_valid;
+  OneEuroState state;
+
+  for (auto& [person_id, person_segments] : segments) {
+    for (const std::vector<Sighting>& segment : person_segments) {
+      const std::size_t frames = segment.size();
+      const std::size_t count = joint_count(*segment.front().person);
+      const std::size_t stride = count * 3;
+      if (count == 0) continue;
+
+      coordinates.resize(frames * stride);
+      confidence.resize(frames * count);
+      valid.resize(frames * stride);
+      for (std::size_t f = 0; f < frames; ++f) {
+        gather(*segment[f].person, scratch_coordinates, scratch_confidence);
+        std::copy(
+          scratch_coordinates.begin(),
+          scratch_coordinates.end(),
+          coordinates.begin() + (f * stride)
+        );
+        std::copy(
+          scratch_confidence.begin(),
+          scratch_confidence.end(),
+          confidence.begin() + (f * count)
+        );
+      }
+
+      // Interpolate every gap that has a confident joint on both sides.
+      next_valid.resize(frames);
+      for (std::size_t j = 0; j < count; ++j) {
+        std::ptrdiff_t next = -1;
+        for (std::size_t f = frames; f-- > 0;) {
+          next_valid[f] = next;
+          if (confidence[(f * count) + j] >= min_confidence) next = f;
+        }
+
+        std::ptrdiff_t previous = -1;
+        for (std::size_t f = 0; f < frames; ++f) {
+          bool usable = confidence[(f * count) + j] >= min_confidence;
+          if (usable) {
+            previous = f;
+          } else if (previous >= 0 && next_valid[f] >= 0) {
+            const std::size_t from = segment[previous].frame;
+            const std::size_t to = segment[next_valid[f]].frame;
+            const float fraction =
+              static_cast<float>(segment[f].frame - from) /
+              static_cast<float>(to - from);
+            lerp_joint(
+              &coordinates[(previous * stride) + (j * 3)],
+              &coordinates[(next_valid[f] * stride) + (j * 3)],
+              fraction,
+              &coordinates[(f * stride) + (j * 3)]
+            );
+            confidence[(f * count) + j] = min_confidence;
+            usable = true;
+          }
+          valid[(f * stride) + (j * 3) + 0] = usable;
+          valid[(f * stride) + (j * 3) + 1] = usable;
+          valid[(f * stride) + (j * 3) + 2] = usable;
+        }
+      }
+
+      state.reset(stride);
+      for (std::size_t f = 0; f < frames; ++f) {
+        const std::size_t elapsed =
+          f == 0 ? 1 : segment[f].frame - segment[f - 1].frame;
+        one_euro_step(
+          &coordinates[f * stride],
+          &valid[f * stride],
+          state,
+          stride,
+          static_cast<float>(elapsed / options.frequency),
+          options
+        );
+        scatter(
+          &coordinates[f * stride],
+          &confidence[f * count],
+          *segment[f].person
+        );
+      }
+    }
+  }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "src/tracking.h"
+
+struct SmoothingOptions {
+  // Joints below this confidence are treated as missing and back-filled.
+  double min_confidence = 0.3;
+
+  // Number of frames the online filter waits for before emitting a frame. A
+  // gap is only filled if the joint reappears within this many frames.
+  std::size_t lookahead = 6;
+
+  // One-Euro filter parameters, see https://gery.casiez.net/1euro/.
+  double frequency = 24.0;
+  double min_cutoff = 1.0;
+  double beta = 0.05;
+  double derivative_cutoff = 1.0;
+};
+
+/**
+ * Per-person One-Euro filter state, stored as flat coordinate arrays so that
+ * each frame's update is a single pass over all of the person's joints.
+ */
+struct OneEuroState {
+  std::vector<float> value;
+  std::vector<float> derivative;
+  std::vector<unsigned char> initialized;
+
+  void reset(std::size_t coordinate_count);
+};
+
+/**
+ * Applies one frame of One-Euro filtering to `count` coordinates in place.
+ * Coordinates whose `valid` flag is zero are passed through untouched and do
+ * not update the filter state.
+ */
+void one_euro_step(
+  float* coordinates,
+  const unsigned char* valid,
+  OneEuroState& state,
+  std::size_t count,
+  float dt,
+  const SmoothingOptions& options
+);
+
+/**
+ * Streaming gap filler and smoother for tracked 3D skeletons.
+ *
+ * Frames are delayed by `lookahead` frames so missing joints can be linearly
+ * interpolated between their last and next confident positions. People are
+ * matched between frames by `person_id`, so frames should already be run
+ * through `PersonTracker3d`.
+ */
+class SkeletonFilter {
+public:
+  SkeletonFilter() = default;
+  explicit SkeletonFilter(SmoothingOptions options): _options{options} {}
+
+  /**
+   * Adds a frame to the filter. Returns the filtered frame from `lookahead`
+   * frames ago once enough frames have been buffered.
+   */
+  std::optional<std::vector<Person3d>> push(std::vector<Person3d> people);
+
+  /**
+   * Emits all remaining buffered frames. Call at the end of a stream.
+   */
+  std::vector<std::vector<Person3d>> flush();
+
+private:
+  struct PersonState {
+    std::size_t last_frame;
+    std::vector<float> last_valid;
+    std::vector<std::size_t> last_valid_frame;
+    std::vector<unsigned char> has_last_valid;
+    OneEuroState smoothing;
+  };
+
+  std::vector<Person3d> _emit();
+  void _filter(Person3d& person, PersonState& state);
+
+  SmoothingOptions _options;
+  std::deque<std::vector<Person3d>> _buffer;
+  std::unordered_map<int, PersonState> _people;
+  std::size_t _frame_index = 0;
+
+  // Scratch space reused between people.
+  std::vector<float> _coordinates;
+  std::vector<float> _confidence;
+  std::vector<unsigned char> _valid;
+};
+
+/**
+ * Gap fills and smooths a whole clip in place. Each person's trajectory is
+ * gathered into frame-by-joint arrays and processed in bulk, with no bound on
+ * how far ahead gaps may be filled from.
+ */
+void filter_clip(
+  std::vector<std::vector<Person3d>>& clip,
+  const SmoothingOptions& options = {}
+);
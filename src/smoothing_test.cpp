@@ -0,0 +1,162 @@
+#include "src/smoothing.h"
+
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/tracking.h"
+
+namespace {
+
+constexpr int BODY_POINTS = 25;
+
+Person3d make_person(int person_id, double x, double confidence = 0.9) {
+  Person3d person{.person_id = person_id};
+  for (int i = 0; i < BODY_POINTS; ++i) {
+    person.body.push_back(Point3d{
+      .point_id = i,
+      .x = x,
+      .y = i * 0.1,
+      .z = 2.0,
+      .confidence = confidence
+    });
+  }
+  return person;
+}
+
+std::vector<std::vector<Person3d>> run_online(
+  SkeletonFilter& filter,
+  std::vector<std::vector<Person3d>> clip
+) {
+  std::vector<std::vector<Person3d>> output;
+  for (std::vector<Person3d>& frame : clip) {
+    std::optional<std::vector<Person3d>> filtered =
+      filter.push(std::move(frame));
+    if (filtered) output.push_back(std::move(*filtered));
+  }
+  for (std::vector<Person3d>& frame : filter.flush()) {
+    output.push_back(std::move(frame));
+  }
+  return output;
+}
+
+TEST(SkeletonFilter, DelaysByLookahead) {
+  SkeletonFilter filter{SmoothingOptions{.lookahead = 3}};
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(filter.push({make_person(0, i)}));
+  }
+  EXPECT_TRUE(filter.push({make_person(0, 3)}));
+  EXPECT_EQ(filter.flush().size(), 3);
+}
+
+TEST(SkeletonFilter, FillsGapByInterpolation) {
+  // Disable smoothing so only the gap filling is observed.
+  SmoothingOptions options{.lookahead = 4, .min_cutoff = 1e6};
+  SkeletonFilter filter{options};
+
+  std::vector<std::vector<Person3d>> clip;
+  for (int i = 0; i < 8; ++i) clip.push_back({make_person(0, i * 1.0)});
+  clip[3][0].body[5].confidence = 0.0;
+  clip[3][0].body[5].x = 100.0;
+  clip[4][0].body[5].confidence = 0.0;
+  clip[4][0].body[5].x = -100.0;
+
+  std::vector<std::vector<Person3d>> output = run_online(filter, clip);
+  ASSERT_EQ(output.size(), clip.size());
+  EXPECT_NEAR(output[3][0].body[5].x, 3.0, 1e-3);
+  EXPECT_NEAR(output[4][0].body[5].x, 4.0, 1e-3);
+  EXPECT_NEAR(output[3][0].body[5].confidence, options.min_confidence, 1e-6);
+}
+
+TEST(SkeletonFilter, LeavesGapBeyondLookahead) {
+  SmoothingOptions options{.lookahead = 1, .min_cutoff = 1e6};
+  SkeletonFilter filter{options};
+
+  std::vector<std::vector<Person3d>> clip;
+  for (int i = 0; i < 6; ++i) clip.push_back({make_person(0, i * 1.0)});
+  for (int i = 1; i < 5; ++i) {
+    clip[i][0].body[0].confidence = 0.0;
+    clip[i][0].body[0].x = 42.0;
+  }
+
+  std::vector<std::vector<Person3d>> output = run_online(filter, clip);
+  EXPECT_DOUBLE_EQ(output[1][0].body[0].x, 42.0);
+  EXPECT_DOUBLE_EQ(output[1][0].body[0].confidence, 0.0);
+}
+
+TEST(SkeletonFilter, SmoothsJitter) {
+  SkeletonFilter filter;
+  std::mt19937 rng{7};
+  std::normal_distribution<double> noise{0.0, 0.01};
+
+  std::vector<std::vector<Person3d>> clip;
+  for (int i = 0; i < 200; ++i) {
+    Person3d person = make_person(0, 1.0);
+    for (Point3d& point : person.body) point.x += noise(rng);
+    clip.push_back({person});
+  }
+
+  auto error = [](const std::vector<std::vector<Person3d>>& frames) {
+    double total = 0.0;
+    for (std::size_t i = 50; i < frames.size(); ++i) {
+      total += std::abs(frames[i][0].body[0].x - 1.0);
+    }
+    return total;
+  };
+  std::vector<std::vector<Person3d>> output = run_online(filter, clip);
+  EXPECT_LT(error(output), error(clip) * 0.5);
+}
+
+TEST(SkeletonFilter, TracksPeopleById) {
+  SmoothingOptions options{.lookahead = 2, .min_cutoff = 1e6};
+  SkeletonFilter filter{options};
+
+  std::vector<std::vector<Person3d>> clip;
+  for (int i = 0; i < 5; ++i) {
+    clip.push_back({make_person(0, i * 1.0), make_person(1, 10.0 + i)});
+  }
+  // Person 1 loses a joint while the frame order flips.
+  clip[2] = {make_person(1, 12.0), make_person(0, 2.0)};
+  clip[2][0].body[0].confidence = 0.0;
+  clip[2][0].body[0].x = 0.0;
+
+  std::vector<std::vector<Person3d>> output = run_online(filter, clip);
+  EXPECT_NEAR(output[2][0].body[0].x, 12.0, 1e-3);
+  EXPECT_NEAR(output[2][1].body[0].x, 2.0, 1e-3);
+}
+
+TEST(FilterClip, MatchesOnlineWithinLookahead) {
+  std::mt19937 rng{11};
+  std::normal_distribution<double> noise{0.0, 0.02};
+  std::bernoulli_distribution dropout{0.1};
+
+  std::vector<std::vector<Person3d>> clip;
+  for (int i = 0; i < 100; ++i) {
+    Person3d person = make_person(0, i * 0.01);
+    for (Point3d& point : person.body) {
+      point.x += noise(rng);
+      if (dropout(rng) && i > 0 && i < 99) point.confidence = 0.0;
+    }
+    clip.push_back({person});
+  }
+  // Force the first and last frames confident so both sides can fill.
+  for (Point3d& point : clip.front()[0].body) point.confidence = 0.9;
+  for (Point3d& point : clip.back()[0].body) point.confidence = 0.9;
+
+  SmoothingOptions options{.lookahead = 100};
+  SkeletonFilter filter{options};
+  std::vector<std::vector<Person3d>> online = run_online(filter, clip);
+  filter_clip(clip, options);
+
+  ASSERT_EQ(online.size(), clip.size());
+  for (std::size_t f = 0; f < clip.size(); ++f) {
+    for (int j = 0; j < BODY_POINTS; ++j) {
+      EXPECT_NEAR(online[f][0].body[j].x, clip[f][0].body[j].x, 1e-5)
+        << "Frame " << f << " joint " << j;
+    }
+  }
+}
+
+}
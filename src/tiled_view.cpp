@@ -0,0 +1,258 @@
+#include "src/tiled_view.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/camera_model.h"
+#include "src/skeleton.h"
+#include "src/tracking.h"
+
+namespace {
+
+const cv::Scalar DETECTED_COLOR{0, 200, 255};
+const cv::Scalar PROJECTED_COLOR{0, 0, 255};
+const cv::Scalar LABEL_COLOR{255, 255, 255};
+constexpr double MIN_CONFIDENCE = 0.1;
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+bool is_projected(const cv::Point2d& point) {
+  return std::isfinite(point.x) && std::isfinite(point.y);
+}
+
+/**
+ * Where an image goes in its cell: as large as fits, centered.
+ */
+cv::Rect fit(cv::Size image, const cv::Rect& cell) {
+  const double scale = std::min(
+    static_cast<double>(cell.width) / image.width,
+    static_cast<double>(cell.height) / image.height
+  );
+  const cv::Size size{
+    static_cast<int>(image.width * scale),
+    static_cast<int>(image.height * scale)
+  };
+  return {
+    cell.x + ((cell.width - size.width) / 2),
+    cell.y + ((cell.height - size.height) / 2),
+    size.width,
+    size.height
+  };
+}
+
+void draw_tile(
+  cv::Mat& canvas,
+  const cv::Rect& cell,
+  const CameraTile& tile,
+  double error
+) {
+  canvas(cell).setTo(cv::Scalar::all(0));
+  if (tile.image.empty()) return;
+
+  const cv::Rect area = fit(tile.image.size(), cell);
+  cv::Mat target = canvas(area);
+  if (tile.image.type() == canvas.type()) {
+    cv::resize(tile.image, target, area.size(), 0, 0, cv::INTER_LINEAR);
+  } else {
+    cv::Mat color;
+    cv::cvtColor(tile.image, color, cv::COLOR_GRAY2BGR);
+    cv::resize(color, target, area.size(), 0, 0, cv::INTER_LINEAR);
+  }
+
+  const double scale = static_cast<double>(area.width) / tile.image.cols;
+  const auto to_tile = [&](double x, double y) {
+    return cv::Point{
+      static_cast<int>(x * scale),
+      static_cast<int>(y * scale)
+    };
+  };
+  for (const Person& person : tile.people) {
+    for (const Point& point : person.body) {
+      if (point.confidence < MIN_CONFIDENCE) continue;
+      cv::circle(target, to_tile(point.x, point.y), 2, DETECTED_COLOR, -1);
+    }
+  }
+  for (const std::vector<cv::Point2d>& body : tile.projected) {
+    for (const Bone& bone : BODY_25_BONES) {
+      if (static_cast<std::size_t>(bone.child) >= body.size()) continue;
+      const cv::Point2d& parent = body[bone.parent];
+      const cv::Point2d& child = body[bone.child];
+      if (!is_projected(parent) || !is_projected(child)) continue;
+      cv::line(
+        target,
+        to_tile(parent.x, parent.y),
+        to_tile(child.x, child.y),
+        PROJECTED_COLOR,
+        1,
+        cv::LINE_AA
+      );
+    }
+  }
+
+  std::string label = tile.label;
+  if (!std::isnan(error)) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "  %.1f px", error);
+    label += buffer;
+  }
+  cv::putText(
+    canvas,
+    label,
+    {cell.x + 5, cell.y + 15},
+    cv::FONT_HERSHEY_PLAIN,
+    1,
+    LABEL_COLOR,
+    1,
+    cv::LINE_AA
+  );
+}
+
+}
+
+std::vector<std::vector<cv::Point2d>> project_people(
+  const CameraModel& camera,
+  const std::vector<Person3d>& people,
+  double min_confidence
+) {
+  std::vector<cv::Point3d> points3d;
+  for (const Person3d& person : people) {
+    for (const Point3d& point : person.body) {
+      if (point.confidence < min_confidence) continue;
+      points3d.emplace_back(point.x, point.y, point.z);
+    }
+  }
+  std::vector<cv::Point2d> points2d;
+  if (!points3d.empty()) {
+    cv::projectPoints(
+      points3d,
+      camera.rotation_vector(),
+      camera.translation(),
+      camera.matrix(),
+      camera.distortion(),
+      points2d
+    );
+  }
+
+  std::vector<std::vector<cv::Point2d>> projected;
+  auto next = points2d.begin();
+  for (const Person3d& person : people) {
+    std::vector<cv::Point2d>& body = projected.emplace_back();
+    body.reserve(person.body.size());
+    for (const Point3d& point : person.body) {
+      if (point.confidence < min_confidence) {
+        body.emplace_back(NaN, NaN);
+      } else {
+        body.push_back(*next++);
+      }
+    }
+  }
+  return projected;
+}
+
+double reprojection_error(
+  const std::vector<Person>& people,
+  const std::vector<std::vector<cv::Point2d>>& projected,
+  double min_confidence
+) {
+  double total = 0.0;
+  std::size_t count = 0;
+  for (const std::vector<cv::Point2d>& body : projected) {
+    double best = std::numeric_limits<double>::infinity();
+    for (const Person& person : people) {
+      double distance = 0.0;
+      std::size_t joints = 0;
+      const std::size_t size = std::min(body.size(), person.body.size());
+      for (std::size_t j = 0; j < size; ++j) {
+        const Point& point = person.body[j];
+        if (point.confidence < min_confidence) continue;
+        if (!is_projected(body[j])) continue;
+        const double dx = body[j].x - point.x;
+        const double dy = body[j].y - point.y;
+        distance += std::sqrt((dx * dx) + (dy * dy));
+        ++joints;
+      }
+      if (joints > 0) best = std::min(best, distance / joints);
+    }
+    if (std::isfinite(best)) {
+      total += best;
+      ++count;
+    }
+  }
+  return count > 0 ? total / count : NaN;
+}
+
+cv::Size tile_grid(std::size_t count) {
+  if (count == 0) return {0, 0};
+  const int columns =
+    static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+  const int rows = static_cast<int>((count + columns - 1) / columns);
+  return {columns, rows};
+}
+
+TiledRenderer::TiledRenderer(TiledRendererOptions options):
+  _options{options},
+  _canvas{options.canvas_size, CV_8UC3, cv::Scalar::all(0)}
+{}
+
+const cv::Mat& TiledRenderer::render(const std::vector<CameraTile>& tiles) {
+  _errors.assign(tiles.size(), NaN);
+  const cv::Size grid = tile_grid(tiles.size());
+  if (grid != _grid) {
+    // Margins the new grid does not divide evenly would keep the old tiles.
+    _canvas.setTo(cv::Scalar::all(0));
+    _grid = grid;
+  }
+  if (tiles.empty()) return _canvas;
+  const cv::Size cell_size{
+    _canvas.cols / grid.width,
+    _canvas.rows / grid.height
+  };
+  const auto cell = [&](std::size_t i) {
+    return cv::Rect{
+      static_cast<int>(i % grid.width) * cell_size.width,
+      static_cast<int>(i / grid.width) * cell_size.height,
+      cell_size.width,
+      cell_size.height
+    };
+  };
+
+  // Every tile covers its own part of the canvas, so threads draw without
+  // ever touching the same pixels.
+  const std::size_t thread_count = std::min(
+    tiles.size(),
+    _options.threads > 0
+      ? _options.threads
+      : std::max<std::size_t>(1, std::thread::hardware_concurrency())
+  );
+  std::atomic_size_t next = 0;
+  const auto draw_tiles = [&]() {
+    for (std::size_t i = next++; i < tiles.size(); i = next++) {
+      _errors[i] = reprojection_error(tiles[i].people, tiles[i].projected);
+      draw_tile(_canvas, cell(i), tiles[i], _errors[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(draw_tiles);
+  }
+  draw_tiles();
+  for (std::thread& thread : threads) thread.join();
+
+  // Cells past the last tile, left over from frames with more cameras.
+  const std::size_t cell_count =
+    static_cast<std::size_t>(grid.width) * grid.height;
+  for (std::size_t i = tiles.size(); i < cell_count; ++i) {
+    _canvas(cell(i)).setTo(cv::Scalar::all(0));
+  }
+  return _canvas;
+}
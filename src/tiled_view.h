@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "src/camera_model.h"
+#include "src/tracking.h"
+
+/**
+ * Projects every person's body into the camera's raw pixels with a single
+ * `cv::projectPoints` call for the whole frame. Joints below `min_confidence`
+ * were never really triangulated, so they come out as NaN.
+ */
+std::vector<std::vector<cv::Point2d>> project_people(
+  const CameraModel& camera,
+  const std::vector<Person3d>& people,
+  double min_confidence = 0.1
+);
+
+/**
+ * Mean distance in pixels between the projected 3D bodies and the keypoints
+ * detected in the same camera. Each body is compared with whichever detected
+ * person it lies closest to, over the joints both have. Projected joints
+ * that are NaN are skipped. NaN if there is nothing to compare.
+ */
+double reprojection_error(
+  const std::vector<Person>& people,
+  const std::vector<std::vector<cv::Point2d>>& projected,
+  double min_confidence = 0.1
+);
+
+/**
+ * Everything shown for one camera of a frame.
+ */
+struct CameraTile {
+  std::string label;
+  cv::Mat image;
+
+  // Keypoints detected in `image`.
+  std::vector<Person> people;
+
+  // 3D bodies projected into `image`, as from `project_people`.
+  std::vector<std::vector<cv::Point2d>> projected;
+};
+
+struct TiledRendererOptions {
+  cv::Size canvas_size{1920, 1080};
+
+  // Threads drawing tiles, or 0 for one per core.
+  std::size_t threads = 0;
+};
+
+/**
+ * Columns and rows for `count` tiles, as square as can be.
+ */
+cv::Size tile_grid(std::size_t count);
+
+/**
+ * Draws all cameras of a frame side by side on one canvas. Each tile shows
+ * the camera's image scaled to fit, its detected keypoints, the reprojected
+ * 3D skeletons over them and the reprojection error between the two.
+ *
+ * Tiles are drawn in parallel straight into the canvas, which is allocated
+ * once and reused for every frame.
+ */
+class TiledRenderer {
+public:
+  explicit TiledRenderer(TiledRendererOptions options = {});
+  ~TiledRenderer() = default;
+  TiledRenderer(const TiledRenderer&) = delete;
+  TiledRenderer(TiledRenderer&&) = default;
+  TiledRenderer& operator=(const TiledRenderer&) = delete;
+  TiledRenderer& operator=(TiledRenderer&&) = default;
+
+  /**
+   * Draws the tiles, returning the canvas. It is overwritten by the next call.
+   */
+  const cv::Mat& render(const std::vector<CameraTile>& tiles);
+
+  /**
+   * Each tile's reprojection error from the last `render`.
+   */
+  const std::vector<double>& errors() const { return _errors; }
+
+private:
+  TiledRendererOptions _options;
+  cv::Mat _canvas;
+  cv::Size _grid;
+  std::vector<double> _errors;
+};
@@ -0,0 +1,65 @@
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/tiled_view.h"
+#include "src/tracking.h"
+
+namespace {
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+
+/**
+ * A 1080p frame from each camera with two people detected in it and their
+ * skeletons projected back a few pixels off.
+ */
+std::vector<CameraTile> make_tiles(std::size_t count) {
+  std::vector<CameraTile> tiles;
+  for (std::size_t c = 0; c < count; ++c) {
+    CameraTile& tile = tiles.emplace_back();
+    tile.label = "camera " + std::to_string(c);
+    tile.image = cv::Mat{IMAGE_SIZE, CV_8UC3};
+    cv::randu(tile.image, 0, 255);
+    for (int p = 0; p < 2; ++p) {
+      Person& person = tile.people.emplace_back(Person{.person_id = p});
+      std::vector<cv::Point2d>& body = tile.projected.emplace_back();
+      for (int i = 0; i < 25; ++i) {
+        const double x = 400.0 + (800.0 * p) + (10.0 * i);
+        const double y = 200.0 + (25.0 * i);
+        person.body.push_back(
+          Point{.point_id = i, .x = x, .y = y, .confidence = 0.9}
+        );
+        body.emplace_back(x + 3, y - 2);
+      }
+    }
+  }
+  return tiles;
+}
+
+/**
+ * One frame of every camera on a 1080p canvas, by camera count and threads.
+ * A single thread is the baseline of drawing the tiles one after another.
+ */
+void BM_RenderTiles(benchmark::State& state) {
+  const std::vector<CameraTile> tiles = make_tiles(state.range(0));
+  TiledRenderer renderer{{
+    .canvas_size = IMAGE_SIZE,
+    .threads = static_cast<std::size_t>(state.range(1))
+  }};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(renderer.render(tiles).data);
+  }
+  state.counters["fps"] = benchmark::Counter(
+    static_cast<double>(state.iterations()),
+    benchmark::Counter::kIsRate
+  );
+}
+BENCHMARK(BM_RenderTiles)
+  ->ArgNames({"cameras", "threads"})
+  ->ArgsProduct({{4, 8}, {1, 0}})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+}
@@ -0,0 +1,141 @@
+#include "src/tiled_view.h"
+
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/camera_model.h"
+#include "src/cameras.h"
+#include "src/tracking.h"
+
+namespace {
+
+Person make_person(double x, double y) {
+  Person person{.person_id = 0};
+  for (int i = 0; i < 3; ++i) {
+    person.body.push_back(
+      Point{.point_id = i, .x = x + i, .y = y + i, .confidence = 0.9}
+    );
+  }
+  return person;
+}
+
+std::vector<cv::Point2d> make_body(double x, double y) {
+  return {{x, y}, {x + 1, y + 1}, {x + 2, y + 2}};
+}
+
+TEST(TileGrid, AsSquareAsCanBe) {
+  EXPECT_EQ(tile_grid(0), cv::Size(0, 0));
+  EXPECT_EQ(tile_grid(1), cv::Size(1, 1));
+  EXPECT_EQ(tile_grid(2), cv::Size(2, 1));
+  EXPECT_EQ(tile_grid(4), cv::Size(2, 2));
+  EXPECT_EQ(tile_grid(5), cv::Size(3, 2));
+  EXPECT_EQ(tile_grid(8), cv::Size(3, 3));
+}
+
+TEST(ReprojectionError, ComparesWithClosestPerson) {
+  const std::vector<Person> people = {
+    make_person(100, 100),
+    make_person(10, 10)
+  };
+  EXPECT_DOUBLE_EQ(reprojection_error(people, {make_body(13, 14)}), 5.0);
+  EXPECT_DOUBLE_EQ(
+    reprojection_error(people, {make_body(13, 14), make_body(100, 101)}),
+    3.0
+  );
+}
+
+TEST(ReprojectionError, SkipsUnconfidentJoints) {
+  Person person = make_person(0, 0);
+  person.body[0].x = 1000;
+  person.body[0].confidence = 0.0;
+  EXPECT_DOUBLE_EQ(reprojection_error({person}, {make_body(0, 0)}), 0.0);
+}
+
+TEST(ReprojectionError, NanWithNothingToCompare) {
+  EXPECT_TRUE(std::isnan(reprojection_error({}, {make_body(0, 0)})));
+  EXPECT_TRUE(std::isnan(reprojection_error({make_person(0, 0)}, {})));
+}
+
+CameraModel make_camera() {
+  return CameraModel{CameraParameters{
+    .matrix = (cv::Mat_<double>(3, 3) << 100, 0, 50, 0, 100, 50, 0, 0, 1),
+    .distortion = cv::Mat::zeros(1, 5, CV_64F),
+    .rotation = cv::Mat::zeros(3, 1, CV_64F),
+    .translation = cv::Mat::zeros(3, 1, CV_64F)
+  }};
+}
+
+TEST(ProjectPeople, SplitsBatchByPerson) {
+  const CameraModel camera = make_camera();
+  Person3d first{.person_id = 1};
+  first.body = {{.point_id = 0, .x = 0, .y = 0, .z = 1, .confidence = 1}};
+  Person3d second{.person_id = 2};
+  second.body = {
+    {.point_id = 0, .x = 1, .y = 0, .z = 2, .confidence = 1},
+    {.point_id = 1, .x = 0, .y = -1, .z = 4, .confidence = 1}
+  };
+
+  const auto projected = project_people(camera, {first, second});
+  ASSERT_EQ(projected.size(), 2);
+  ASSERT_EQ(projected[0].size(), 1);
+  ASSERT_EQ(projected[1].size(), 2);
+  EXPECT_NEAR(projected[0][0].x, 50, 1e-9);
+  EXPECT_NEAR(projected[1][0].x, 100, 1e-9);
+  EXPECT_NEAR(projected[1][1].y, 25, 1e-9);
+}
+
+TEST(ProjectPeople, UnconfidentJointsDoNotCount) {
+  const CameraModel camera = make_camera();
+  Person3d person{.person_id = 0};
+  person.body = {
+    {.point_id = 0, .x = 0, .y = 0, .z = 1, .confidence = 1},
+    {.point_id = 1, .x = 0.01, .y = 0.01, .z = 1, .confidence = 1},
+    // Triangulated from an undetected keypoint, far from the one detected.
+    {.point_id = 2, .x = 5, .y = 5, .z = 1, .confidence = 0}
+  };
+
+  const auto projected = project_people(camera, {person});
+  ASSERT_EQ(projected.size(), 1);
+  ASSERT_EQ(projected[0].size(), 3);
+  EXPECT_TRUE(std::isnan(projected[0][2].x));
+  EXPECT_TRUE(std::isnan(projected[0][2].y));
+
+  // Every joint is detected confidently, but only the first two count.
+  EXPECT_DOUBLE_EQ(
+    reprojection_error({make_person(50, 50)}, projected),
+    0.0
+  );
+}
+
+TEST(TiledRenderer, DrawsIntoTheSameCanvas) {
+  TiledRenderer renderer{{.canvas_size = {400, 200}, .threads = 2}};
+  std::vector<CameraTile> tiles;
+  for (int i = 0; i < 4; ++i) {
+    tiles.push_back(CameraTile{
+      .label = "cam",
+      .image = cv::Mat{100, 200, CV_8UC3, cv::Scalar::all(50 * (i + 1))},
+      .people = {make_person(10, 10)},
+      .projected = {make_body(12, 10)}
+    });
+  }
+
+  const cv::Mat& canvas = renderer.render(tiles);
+  const uchar* data = canvas.data;
+  EXPECT_EQ(canvas.size(), cv::Size(400, 200));
+  ASSERT_EQ(renderer.errors().size(), 4);
+  EXPECT_DOUBLE_EQ(renderer.errors()[0], 2.0);
+
+  // Each image is scaled into its own quarter of the canvas.
+  EXPECT_EQ(canvas.at<cv::Vec3b>(90, 190), cv::Vec3b(50, 50, 50));
+  EXPECT_EQ(canvas.at<cv::Vec3b>(90, 390), cv::Vec3b(100, 100, 100));
+  EXPECT_EQ(canvas.at<cv::Vec3b>(190, 190), cv::Vec3b(150, 150, 150));
+  EXPECT_EQ(canvas.at<cv::Vec3b>(190, 390), cv::Vec3b(200, 200, 200));
+
+  tiles.pop_back();
+  EXPECT_EQ(renderer.render(tiles).data, data);
+  EXPECT_EQ(canvas.at<cv::Vec3b>(190, 390), cv::Vec3b(0, 0, 0));
+}
+
+}
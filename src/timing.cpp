@@ -1,14 +1,54 @@
 #include "src/timing.h"
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <sstream>
 #include <string>
+#include <vector>
 
 using std::chrono::duration_cast;
 using std::chrono::hours;
 using std::chrono::minutes;
 using std::chrono::seconds;
 using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+namespace {
+
+// Each power of two is split into 2^7 buckets.
+constexpr int SUB_BUCKET_BITS = 7;
+constexpr std::uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+// Samples from 2^40ns, about 18 minutes, share the last bucket.
+constexpr int MAX_EXPONENT = 40;
+constexpr std::uint64_t MAX_NANOSECONDS =
+  (std::uint64_t{1} << MAX_EXPONENT) - 1;
+constexpr std::size_t BUCKET_COUNT =
+  SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+std::size_t bucket_index(std::uint64_t nanoseconds) {
+  // The first 128 buckets hold a nanosecond each.
+  if (nanoseconds < SUB_BUCKETS) return nanoseconds;
+  const int shift = std::bit_width(nanoseconds) - 1 - SUB_BUCKET_BITS;
+  return SUB_BUCKETS + shift * SUB_BUCKETS +
+    ((nanoseconds >> shift) - SUB_BUCKETS);
+}
+
+/**
+ * Middle of the range of values counted in a bucket.
+ */
+std::uint64_t bucket_value(std::size_t index) {
+  if (index < SUB_BUCKETS) return index;
+  const std::size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+  const std::uint64_t lower =
+    (SUB_BUCKETS + (index - SUB_BUCKETS) % SUB_BUCKETS) << shift;
+  return lower + ((std::uint64_t{1} << shift) >> 1);
+}
+
+}
 
 double to_fps(std::size_t frame_count, const steady_clock::duration& duration) {
   return
@@ -36,3 +76,71 @@ std::string to_hms(steady_clock::duration duration) {
 
   return stream.str();
 }
+
+LatencyHistogram::LatencyHistogram(): _buckets(BUCKET_COUNT, 0) {}
+
+void LatencyHistogram::record(steady_clock::duration latency) {
+  const std::uint64_t value = std::min<std::uint64_t>(
+    std::max<std::int64_t>(duration_cast<nanoseconds>(latency).count(), 0),
+    MAX_NANOSECONDS
+  );
+  ++_buckets[bucket_index(value)];
+  _min_nanoseconds = _count == 0 ? value : std::min(_min_nanoseconds, value);
+  _max_nanoseconds = std::max(_max_nanoseconds, value);
+  _total_nanoseconds += value;
+  ++_count;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  if (other._count == 0) return;
+  for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+    _buckets[i] += other._buckets[i];
+  }
+  _min_nanoseconds = _count == 0
+    ? other._min_nanoseconds
+    : std::min(_min_nanoseconds, other._min_nanoseconds);
+  _max_nanoseconds = std::max(_max_nanoseconds, other._max_nanoseconds);
+  _total_nanoseconds += other._total_nanoseconds;
+  _count += other._count;
+}
+
+void LatencyHistogram::clear() {
+  std::fill(_buckets.begin(), _buckets.end(), 0);
+  _count = 0;
+  _total_nanoseconds = 0;
+  _min_nanoseconds = 0;
+  _max_nanoseconds = 0;
+}
+
+steady_clock::duration LatencyHistogram::min() const {
+  return duration_cast<steady_clock::duration>(nanoseconds{_min_nanoseconds});
+}
+
+steady_clock::duration LatencyHistogram::max() const {
+  return duration_cast<steady_clock::duration>(nanoseconds{_max_nanoseconds});
+}
+
+steady_clock::duration LatencyHistogram::mean() const {
+  if (_count == 0) return steady_clock::duration::zero();
+  return duration_cast<steady_clock::duration>(
+    nanoseconds{_total_nanoseconds / _count}
+  );
+}
+
+steady_clock::duration LatencyHistogram::percentile(double p) const {
+  if (_count == 0) return steady_clock::duration::zero();
+  const std::uint64_t rank = std::min(
+    _count,
+    static_cast<std::uint64_t>(std::max(1.0, std::ceil((p / 100.0) * _count)))
+  );
+  std::uint64_t seen = 0;
+  std::size_t index = 0;
+  for (; index < BUCKET_COUNT; ++index) {
+    seen += _buckets[index];
+    if (seen >= rank) break;
+  }
+  // The extremes are known exactly, so no bucket reaches past them.
+  const std::uint64_t value =
+    std::clamp(bucket_value(index), _min_nanoseconds, _max_nanoseconds);
+  return duration_cast<steady_clock::duration>(nanoseconds{value});
+}
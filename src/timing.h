@@ -1,9 +1,60 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 using steady_clock = std::chrono::steady_clock;
 
 double to_fps(std::size_t frame_count, const steady_clock::duration& duration);
 std::string to_hms(steady_clock::duration duration);
+
+/**
+ * Latency distribution over every sample recorded, in fixed memory.
+ *
+ * Samples are counted in buckets in the manner of HdrHistogram: each power of
+ * two nanoseconds is split into 128 linear buckets, so percentiles are within
+ * 1% of the true value from a nanosecond up to the 18 minute ceiling. Recording
+ * is a couple of shifts and an increment, cheap enough for every frame.
+ */
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+  ~LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram&) = default;
+  LatencyHistogram(LatencyHistogram&&) = default;
+  LatencyHistogram& operator=(const LatencyHistogram&) = default;
+  LatencyHistogram& operator=(LatencyHistogram&&) = default;
+
+  /**
+   * Adds a sample. Negative latencies count as zero and those past the
+   * ceiling as the ceiling.
+   */
+  void record(steady_clock::duration latency);
+
+  /**
+   * Adds every sample of `other`.
+   */
+  void merge(const LatencyHistogram& other);
+
+  void clear();
+
+  std::uint64_t count() const { return _count; }
+  steady_clock::duration min() const;
+  steady_clock::duration max() const;
+
+  /**
+   * Mean and percentiles. Zero when empty.
+   */
+  steady_clock::duration mean() const;
+  steady_clock::duration percentile(double p) const;
+
+private:
+  std::vector<std::uint64_t> _buckets;
+  std::uint64_t _count = 0;
+  std::uint64_t _total_nanoseconds = 0;
+  std::uint64_t _min_nanoseconds = 0;
+  std::uint64_t _max_nanoseconds = 0;
+};
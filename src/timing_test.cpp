@@ -0,0 +1,58 @@
+#include "src/timing.h"
+
+#include <chrono>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using std::chrono::duration;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+TEST(LatencyHistogram, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.count(), 0u);
+  EXPECT_EQ(histogram.mean(), steady_clock::duration::zero());
+  EXPECT_EQ(histogram.percentile(50), steady_clock::duration::zero());
+  EXPECT_EQ(histogram.max(), steady_clock::duration::zero());
+}
+
+TEST(LatencyHistogram, PercentilesWithinOnePercent) {
+  LatencyHistogram histogram;
+  for (int i = 1000; i >= 1; --i) histogram.record(microseconds{i * 37});
+
+  EXPECT_EQ(histogram.count(), 1000u);
+  EXPECT_EQ(histogram.min(), microseconds{37});
+  EXPECT_EQ(histogram.max(), microseconds{37'000});
+  const auto expect_near = [](steady_clock::duration actual, double expected) {
+    const double actual_microseconds =
+      duration<double, std::micro>{actual}.count();
+    EXPECT_NEAR(actual_microseconds, expected, expected * 0.01);
+  };
+  expect_near(histogram.percentile(50), 500 * 37);
+  expect_near(histogram.percentile(99), 990 * 37);
+  expect_near(histogram.mean(), 500.5 * 37);
+  EXPECT_EQ(histogram.percentile(0), microseconds{37});
+  EXPECT_EQ(histogram.percentile(100), microseconds{37'000});
+}
+
+TEST(LatencyHistogram, Merge) {
+  LatencyHistogram fast;
+  LatencyHistogram slow;
+  for (int i = 0; i < 90; ++i) fast.record(milliseconds{1});
+  for (int i = 0; i < 10; ++i) slow.record(milliseconds{100});
+  fast.merge(slow);
+
+  EXPECT_EQ(fast.count(), 100u);
+  EXPECT_EQ(fast.min(), milliseconds{1});
+  EXPECT_EQ(fast.max(), milliseconds{100});
+  EXPECT_LT(fast.percentile(50), milliseconds{2});
+  EXPECT_GT(fast.percentile(95), milliseconds{99});
+
+  fast.clear();
+  EXPECT_EQ(fast.count(), 0u);
+  EXPECT_EQ(fast.max(), steady_clock::duration::zero());
+}
+
+}
@@ -0,0 +1,354 @@
+#include "src/tracing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "src/timing.h"
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace {
+
+std::atomic<std::uint64_t> next_tracer_id = 1;
+
+double to_milliseconds(steady_clock::duration latency) {
+  return duration<double, std::milli>{latency}.count();
+}
+
+void write_json_string(std::ostream& out, std::string_view text) {
+  out << '"';
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+        << static_cast<int>(c) << std::dec << std::setfill(' ');
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+}
+
+struct Tracer::ThreadBuffer {
+  ThreadBuffer(std::size_t size, std::uint32_t id):
+    spans(std::bit_ceil(std::max<std::size_t>(size, 2))),
+    thread_id{id}
+  {}
+
+  std::vector<Span> spans;
+  const std::uint32_t thread_id;
+
+  // Guarded by the tracer's buffers mutex.
+  std::string name;
+
+  // Spans written and read so far. Only the owning thread moves the head and
+  // only the collector moves the tail.
+  std::atomic<std::uint64_t> head = 0;
+  std::atomic<std::uint64_t> tail = 0;
+  std::atomic<std::uint64_t> dropped = 0;
+};
+
+Tracer::Tracer(TracerOptions options):
+  _id{next_tracer_id.fetch_add(1)},
+  _options{options},
+  _epoch{steady_clock::now()}
+{}
+
+Tracer::~Tracer() = default;
+
+void Tracer::enable(TracerOptions options) {
+  std::lock_guard<std::mutex> collect_lock{_collect_mutex};
+  std::lock_guard<std::mutex> buffers_lock{_buffers_mutex};
+  _options = options;
+  _enabled = true;
+}
+
+void Tracer::disable() {
+  _enabled = false;
+}
+
+void Tracer::record(
+  const char* name,
+  steady_clock::time_point start,
+  steady_clock::time_point end
+) {
+  if (!enabled()) return;
+  ThreadBuffer& buffer = _thread_buffer();
+  const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  if (
+    head - buffer.tail.load(std::memory_order_acquire) >= buffer.spans.size()
+  ) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.spans[head & (buffer.spans.size() - 1)] = Span{
+    .name = name,
+    .start_nanoseconds = duration_cast<nanoseconds>(start - _epoch).count(),
+    .duration_nanoseconds = duration_cast<nanoseconds>(end - start).count()
+  };
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::name_thread(std::string name) {
+  if (!enabled()) return;
+  ThreadBuffer& buffer = _thread_buffer();
+  std::lock_guard<std::mutex> lock{_buffers_mutex};
+  buffer.name = std::move(name);
+}
+
+void Tracer::collect() {
+  std::lock_guard<std::mutex> lock{_collect_mutex};
+  _collect();
+}
+
+std::vector<SpanStats> Tracer::take_interval_stats() {
+  std::lock_guard<std::mutex> lock{_collect_mutex};
+  _collect();
+  std::vector<SpanStats> stats;
+  for (auto& [name, latencies] : _latencies) {
+    if (latencies.interval.count() == 0) continue;
+    stats.push_back({.name = name, .latency = latencies.interval});
+    latencies.interval.clear();
+  }
+  return stats;
+}
+
+std::vector<SpanStats> Tracer::total_stats() {
+  std::lock_guard<std::mutex> lock{_collect_mutex};
+  _collect();
+  std::vector<SpanStats> stats;
+  for (const auto& [name, latencies] : _latencies) {
+    stats.push_back({.name = name, .latency = latencies.total});
+  }
+  return stats;
+}
+
+std::uint64_t Tracer::dropped() const {
+  std::lock_guard<std::mutex> lock{_collect_mutex};
+  return _dropped;
+}
+
+void Tracer::write_trace(const std::filesystem::path& path) {
+  std::lock_guard<std::mutex> lock{_collect_mutex};
+  _collect();
+  std::ofstream out{path};
+  if (!out) throw std::runtime_error("Failed to open " + path.string());
+
+  const int pid = static_cast<int>(::getpid());
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  {
+    std::lock_guard<std::mutex> buffers_lock{_buffers_mutex};
+    for (const auto& [id, buffer] : _buffers) {
+      if (buffer->name.empty()) continue;
+      out << (first ? "\n" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":";
+      write_json_string(out, buffer->name);
+      out << "}}";
+      first = false;
+    }
+  }
+  // Microseconds with the nanoseconds kept as decimals.
+  out << std::fixed << std::setprecision(3);
+  for (const KeptSpan& kept : _kept_spans) {
+    out << (first ? "\n" : ",\n") << "{\"name\":";
+    write_json_string(out, kept.span.name);
+    out
+      << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << kept.thread_id
+      << ",\"ts\":" << kept.span.start_nanoseconds / 1000.0
+      << ",\"dur\":" << kept.span.duration_nanoseconds / 1000.0 << "}";
+    first = false;
+  }
+  out << "\n]}\n";
+  if (!out) throw std::runtime_error("Failed to write " + path.string());
+}
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> collect_lock{_collect_mutex};
+  {
+    // Buffers stay registered, since their threads still point at them.
+    std::lock_guard<std::mutex> buffers_lock{_buffers_mutex};
+    for (const auto& [id, buffer] : _buffers) {
+      buffer->tail.store(
+        buffer->head.load(std::memory_order_acquire),
+        std::memory_order_release
+      );
+      buffer->dropped = 0;
+    }
+  }
+  _latencies.clear();
+  _kept_spans.clear();
+  _dropped = 0;
+}
+
+Tracer::ThreadBuffer& Tracer::_thread_buffer() {
+  // The last tracer this thread recorded to, found again without a lock.
+  thread_local std::uint64_t cached_tracer = 0;
+  thread_local ThreadBuffer* cached_buffer = nullptr;
+  if (cached_tracer == _id) return *cached_buffer;
+
+  std::lock_guard<std::mutex> lock{_buffers_mutex};
+  std::shared_ptr<ThreadBuffer>& buffer =
+    _buffers[std::this_thread::get_id()];
+  if (!buffer) {
+    buffer = std::make_shared<ThreadBuffer>(
+      _options.buffer_size,
+      static_cast<std::uint32_t>(_buffers.size())
+    );
+  }
+  cached_tracer = _id;
+  cached_buffer = buffer.get();
+  return *buffer;
+}
+
+void Tracer::_collect() {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock{_buffers_mutex};
+    buffers.reserve(_buffers.size());
+    for (const auto& [id, buffer] : _buffers) buffers.push_back(buffer);
+  }
+
+  for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+    const std::uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+    const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const std::size_t mask = buffer->spans.size() - 1;
+    for (std::uint64_t i = tail; i < head; ++i) {
+      const Span& span = buffer->spans[i & mask];
+      auto itr = _latencies.find(std::string_view{span.name});
+      if (itr == _latencies.end()) {
+        itr = _latencies.emplace(span.name, SpanLatencies{}).first;
+      }
+      const nanoseconds latency{span.duration_nanoseconds};
+      itr->second.interval.record(latency);
+      itr->second.total.record(latency);
+
+      if (!_options.keep_spans) continue;
+      if (_kept_spans.size() < _options.max_kept_spans) {
+        _kept_spans.push_back({.span = span, .thread_id = buffer->thread_id});
+      } else {
+        ++_dropped;
+      }
+    }
+    buffer->tail.store(head, std::memory_order_release);
+    _dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+  }
+}
+
+std::string format_span_stats(const std::vector<SpanStats>& stats) {
+  std::size_t name_width = 4;
+  for (const SpanStats& span : stats) {
+    name_width = std::max(name_width, span.name.size());
+  }
+
+  std::stringstream table;
+  table
+    << std::left << std::setw(name_width) << "span" << std::right
+    << std::setw(10) << "count" << std::setw(11) << "mean ms"
+    << std::setw(11) << "p50 ms" << std::setw(11) << "p99 ms"
+    << std::setw(11) << "max ms" << '\n'
+    << std::fixed << std::setprecision(3);
+  for (const SpanStats& span : stats) {
+    const LatencyHistogram& latency = span.latency;
+    table
+      << std::left << std::setw(name_width) << span.name << std::right
+      << std::setw(10) << latency.count()
+      << std::setw(11) << to_milliseconds(latency.mean())
+      << std::setw(11) << to_milliseconds(latency.percentile(50))
+      << std::setw(11) << to_milliseconds(latency.percentile(99))
+      << std::setw(11) << to_milliseconds(latency.max()) << '\n';
+  }
+  return table.str();
+}
+
+TracingSession::TracingSession(
+  TracingSessionOptions options,
+  Tracer& tracer
+):
+  _options{std::move(options)},
+  _tracer{tracer}
+{
+  TracerOptions tracer_options;
+  tracer_options.keep_spans = !_options.trace_file.empty();
+  _tracer.enable(tracer_options);
+  _thread = std::thread{[this]() { _run(); }};
+}
+
+TracingSession::~TracingSession() {
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _stopping = true;
+  }
+  _stop_signal.notify_all();
+  _thread.join();
+  _tracer.disable();
+
+  std::cout << "Span latencies:\n" << format_span_stats(_tracer.total_stats());
+  if (const std::uint64_t dropped = _tracer.dropped(); dropped > 0) {
+    std::cout << dropped << " spans dropped.\n";
+  }
+  std::cout << std::flush;
+  if (_options.trace_file.empty()) return;
+  try {
+    _tracer.write_trace(_options.trace_file);
+    std::cout << "Trace written to " << _options.trace_file << std::endl;
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << std::endl;
+  }
+}
+
+std::unique_ptr<TracingSession> TracingSession::from_environment() {
+  const char* trace_file = std::getenv("COOKING_AR_TRACE");
+  if (trace_file == nullptr) return nullptr;
+  return std::make_unique<TracingSession>(
+    TracingSessionOptions{.trace_file = trace_file}
+  );
+}
+
+void TracingSession::_run() {
+  steady_clock::time_point last_report = steady_clock::now();
+  std::unique_lock<std::mutex> lock{_mutex};
+  while (!_stop_signal.wait_for(
+    lock,
+    _options.collect_interval,
+    [this]() { return _stopping; }
+  )) {
+    _tracer.collect();
+    const steady_clock::time_point now = steady_clock::now();
+    if (
+      _options.report_interval == steady_clock::duration::zero() ||
+      now - last_report < _options.report_interval
+    ) {
+      continue;
+    }
+    std::cout
+      << "Span latencies over the last " << to_hms(now - last_report) << ":\n"
+      << format_span_stats(_tracer.take_interval_stats()) << std::flush;
+    last_report = now;
+  }
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/timing.h"
+
+struct TracerOptions {
+  // Spans each thread can hold between collections. Spans past that are
+  // dropped and counted. Rounded up to a power of two.
+  std::size_t buffer_size = 1 << 14;
+
+  // Keep every span for a trace file instead of only aggregating them.
+  bool keep_spans = false;
+
+  // Spans kept for the trace file, later ones being dropped.
+  std::size_t max_kept_spans = 1 << 22;
+};
+
+struct SpanStats {
+  std::string name;
+  LatencyHistogram latency;
+};
+
+/**
+ * Collects timed spans from any number of threads.
+ *
+ * Each thread records into a ring buffer of its own, which only that thread
+ * writes and only the collector reads, so recording never takes a lock.
+ * `collect()` drains the rings into a latency histogram per span name and,
+ * when keeping spans, into a trace in the Chrome trace event format that
+ * chrome://tracing and Perfetto open.
+ *
+ * While disabled, spans cost a relaxed atomic load and nothing is recorded.
+ */
+class Tracer {
+public:
+  explicit Tracer(TracerOptions options = {});
+  ~Tracer();
+  Tracer(const Tracer&) = delete;
+  Tracer(Tracer&&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+  Tracer& operator=(Tracer&&) = delete;
+
+  /**
+   * The tracer shared by the whole process, which `TraceSpan` uses.
+   */
+  static Tracer& global() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * Starts recording. Threads that already recorded keep their buffer size.
+   */
+  void enable(TracerOptions options);
+  void enable() { enable(_options); }
+  void disable();
+
+  /**
+   * Records a span on the calling thread. `name` must outlive the tracer,
+   * such as a string literal.
+   */
+  void record(
+    const char* name,
+    steady_clock::time_point start,
+    steady_clock::time_point end
+  );
+
+  /**
+   * Names the calling thread in the trace.
+   */
+  void name_thread(std::string name);
+
+  /**
+   * Moves every thread's recorded spans into the statistics and trace.
+   */
+  void collect();
+
+  /**
+   * Latencies of each span since the previous call, collecting first.
+   */
+  std::vector<SpanStats> take_interval_stats();
+
+  /**
+   * Latencies of each span since tracing was enabled, collecting first.
+   */
+  std::vector<SpanStats> total_stats();
+
+  /**
+   * Spans lost to full buffers or to the kept span limit.
+   */
+  std::uint64_t dropped() const;
+
+  /**
+   * Writes the kept spans as Chrome trace JSON, collecting first.
+   */
+  void write_trace(const std::filesystem::path& path);
+
+  /**
+   * Forgets every recorded span and statistic.
+   */
+  void clear();
+
+private:
+  struct ThreadBuffer;
+  struct Span {
+    const char* name;
+    std::int64_t start_nanoseconds;
+    std::int64_t duration_nanoseconds;
+  };
+  struct KeptSpan {
+    Span span;
+    std::uint32_t thread_id;
+  };
+  struct SpanLatencies {
+    LatencyHistogram interval;
+    LatencyHistogram total;
+  };
+
+  ThreadBuffer& _thread_buffer();
+  void _collect();
+
+  // Tells apart tracers for the per-thread buffer lookup, since a tracer may
+  // be created where an old one was.
+  const std::uint64_t _id;
+  std::atomic_bool _enabled = false;
+  TracerOptions _options;
+  steady_clock::time_point _epoch;
+
+  std::mutex _buffers_mutex;
+  std::map<std::thread::id, std::shared_ptr<ThreadBuffer>> _buffers;
+
+  // Guards everything below, which only the collector touches.
+  mutable std::mutex _collect_mutex;
+  std::map<std::string, SpanLatencies, std::less<>> _latencies;
+  std::vector<KeptSpan> _kept_spans;
+  std::uint64_t _dropped = 0;
+};
+
+/**
+ * Times its own scope as a span of the given name:
+ *
+ *   const TraceSpan span{"detect"};
+ *
+ * `name` must outlive the tracer, such as a string literal.
+ */
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name, Tracer& tracer = Tracer::global()):
+    _name{name},
+    _tracer{tracer.enabled() ? &tracer : nullptr}
+  {
+    if (_tracer) _start = steady_clock::now();
+  }
+  ~TraceSpan() {
+    if (_tracer) _tracer->record(_name, _start, steady_clock::now());
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan(TraceSpan&&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+  TraceSpan& operator=(TraceSpan&&) = delete;
+
+private:
+  const char* _name;
+  Tracer* _tracer;
+  steady_clock::time_point _start;
+};
+
+/**
+ * Table of span latencies, one row per span.
+ */
+std::string format_span_stats(const std::vector<SpanStats>& stats);
+
+struct TracingSessionOptions {
+  // Where to write the Chrome trace when the session ends. Empty to only
+  // report latencies.
+  std::filesystem::path trace_file;
+
+  // How often latencies since the last report are printed. Zero to only
+  // print the totals at the end.
+  steady_clock::duration report_interval = std::chrono::seconds{10};
+
+  // How often spans are drained from the thread buffers.
+  steady_clock::duration collect_interval = std::chrono::milliseconds{100};
+};
+
+/**
+ * Enables tracing for its lifetime, printing latency reports as it goes and
+ * writing the trace when it ends.
+ */
+class TracingSession {
+public:
+  explicit TracingSession(
+    TracingSessionOptions options = {},
+    Tracer& tracer = Tracer::global()
+  );
+  ~TracingSession();
+  TracingSession(const TracingSession&) = delete;
+  TracingSession(TracingSession&&) = delete;
+  TracingSession& operator=(const TracingSession&) = delete;
+  TracingSession& operator=(TracingSession&&) = delete;
+
+  /**
+   * A session when the `COOKING_AR_TRACE` environment variable is set, or
+   * nothing when it is not. A non-empty value is the trace file to write.
+   */
+  static std::unique_ptr<TracingSession> from_environment();
+
+private:
+  void _run();
+
+  TracingSessionOptions _options;
+  Tracer& _tracer;
+  std::mutex _mutex;
+  std::condition_variable _stop_signal;
+  bool _stopping = false;
+  std::thread _thread;
+};
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "src/timing.h"
+#include "src/tracing.h"
+
+namespace {
+
+using std::chrono::microseconds;
+
+/**
+ * Baseline: the loop with nothing timed, as hot paths were before tracing.
+ */
+void BM_Untimed(benchmark::State& state) {
+  int value = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(++value);
+  }
+}
+BENCHMARK(BM_Untimed);
+
+/**
+ * What every span in a tool costs when tracing isn't turned on.
+ */
+void BM_SpanDisabled(benchmark::State& state) {
+  Tracer tracer;
+  int value = 0;
+  for (auto _ : state) {
+    const TraceSpan span{"disabled", tracer};
+    benchmark::DoNotOptimize(++value);
+  }
+}
+BENCHMARK(BM_SpanDisabled);
+
+/**
+ * Spans through the process-wide tracer, as tools use them, while disabled.
+ */
+void BM_GlobalSpanDisabled(benchmark::State& state) {
+  int value = 0;
+  for (auto _ : state) {
+    const TraceSpan span{"disabled"};
+    benchmark::DoNotOptimize(++value);
+  }
+}
+BENCHMARK(BM_GlobalSpanDisabled);
+
+/**
+ * Reading the clock, of which an enabled span does two.
+ */
+void BM_ClockNow(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(steady_clock::now());
+  }
+}
+BENCHMARK(BM_ClockNow);
+
+/**
+ * Recording spans from several threads at once while a collector drains them.
+ */
+void BM_SpanEnabled(benchmark::State& state) {
+  static Tracer tracer;
+  static std::atomic_bool stopping = false;
+  static std::thread collector;
+  if (state.thread_index() == 0) {
+    tracer.enable();
+    stopping = false;
+    collector = std::thread{[]() {
+      while (!stopping) {
+        tracer.collect();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+    }};
+  }
+  int value = 0;
+  for (auto _ : state) {
+    const TraceSpan span{"enabled", tracer};
+    benchmark::DoNotOptimize(++value);
+  }
+  if (state.thread_index() == 0) {
+    stopping = true;
+    collector.join();
+    tracer.disable();
+    state.counters["dropped"] = static_cast<double>(tracer.dropped());
+    tracer.clear();
+  }
+}
+BENCHMARK(BM_SpanEnabled)->Threads(1)->Threads(4);
+
+void BM_HistogramRecord(benchmark::State& state) {
+  LatencyHistogram histogram;
+  steady_clock::duration latency = microseconds{1};
+  for (auto _ : state) {
+    histogram.record(latency);
+    latency += microseconds{7};
+    if (latency > microseconds{100'000}) latency = microseconds{1};
+  }
+  benchmark::DoNotOptimize(histogram.count());
+}
+BENCHMARK(BM_HistogramRecord);
+
+}
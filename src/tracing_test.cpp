@@ -0,0 +1,170 @@
+#include "src/tracing.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/timing.h"
+
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/tracing";
+
+std::string read_file(const path& file) {
+  std::ifstream in{file};
+  std::stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+TEST(Tracer, DisabledSpansRecordNothing) {
+  Tracer tracer;
+  {
+    const TraceSpan span{"idle", tracer};
+  }
+  tracer.record("idle", steady_clock::now(), steady_clock::now());
+  EXPECT_TRUE(tracer.total_stats().empty());
+}
+
+TEST(Tracer, AggregatesByName) {
+  Tracer tracer;
+  tracer.enable();
+  const steady_clock::time_point start = steady_clock::now();
+  for (int i = 1; i <= 3; ++i) {
+    tracer.record("detect", start, start + milliseconds{i});
+  }
+  tracer.record("save", start, start + milliseconds{10});
+  tracer.record("save", start, start + milliseconds{20});
+
+  const std::vector<SpanStats> interval = tracer.take_interval_stats();
+  ASSERT_EQ(interval.size(), 2u);
+  EXPECT_EQ(interval[0].name, "detect");
+  EXPECT_EQ(interval[0].latency.count(), 3u);
+  EXPECT_EQ(interval[0].latency.max(), milliseconds{3});
+  EXPECT_EQ(interval[1].name, "save");
+  EXPECT_EQ(interval[1].latency.count(), 2u);
+  EXPECT_EQ(interval[1].latency.min(), milliseconds{10});
+
+  // The interval starts over while the totals keep going.
+  tracer.record("save", start, start + milliseconds{30});
+  const std::vector<SpanStats> next = tracer.take_interval_stats();
+  ASSERT_EQ(next.size(), 1u);
+  EXPECT_EQ(next[0].name, "save");
+  EXPECT_EQ(next[0].latency.count(), 1u);
+
+  const std::vector<SpanStats> total = tracer.total_stats();
+  ASSERT_EQ(total.size(), 2u);
+  EXPECT_EQ(total[1].latency.count(), 3u);
+  EXPECT_EQ(total[1].latency.max(), milliseconds{30});
+
+  tracer.clear();
+  EXPECT_TRUE(tracer.total_stats().empty());
+}
+
+TEST(Tracer, CountsSpansFromEveryThread) {
+  constexpr int THREAD_COUNT = 4;
+  constexpr int SPAN_COUNT = 1000;
+  Tracer tracer{{.buffer_size = 64}};
+  tracer.enable();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    threads.emplace_back([&tracer]() {
+      for (int j = 0; j < SPAN_COUNT; ++j) {
+        const TraceSpan span{"work", tracer};
+        // Keeps a small buffer from filling faster than it is collected.
+        if (j % 32 == 0) std::this_thread::sleep_for(microseconds{200});
+      }
+    });
+  }
+  // Collecting while the threads record.
+  std::uint64_t collected = 0;
+  while (collected + tracer.dropped() < THREAD_COUNT * SPAN_COUNT) {
+    for (const SpanStats& stats : tracer.take_interval_stats()) {
+      collected += stats.latency.count();
+    }
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  const std::vector<SpanStats> total = tracer.total_stats();
+  ASSERT_EQ(total.size(), 1u);
+  EXPECT_EQ(
+    total[0].latency.count() + tracer.dropped(),
+    THREAD_COUNT * SPAN_COUNT
+  );
+  EXPECT_EQ(total[0].latency.count(), collected);
+}
+
+TEST(Tracer, DropsSpansWhenBufferIsFull) {
+  Tracer tracer{{.buffer_size = 8}};
+  tracer.enable();
+  const steady_clock::time_point start = steady_clock::now();
+  for (int i = 0; i < 20; ++i) tracer.record("frame", start, start);
+
+  const std::vector<SpanStats> total = tracer.total_stats();
+  ASSERT_EQ(total.size(), 1u);
+  EXPECT_EQ(total[0].latency.count(), 8u);
+  EXPECT_EQ(tracer.dropped(), 12u);
+
+  // Collecting made room again.
+  tracer.record("frame", start, start);
+  EXPECT_EQ(tracer.total_stats()[0].latency.count(), 9u);
+}
+
+TEST(Tracer, WritesChromeTrace) {
+  std::filesystem::create_directories(TEST_DIR);
+  const path trace_file = TEST_DIR / "trace.json";
+  Tracer tracer;
+  tracer.enable({.keep_spans = true});
+  tracer.name_thread("main \"thread\"");
+  const steady_clock::time_point start = steady_clock::now();
+  tracer.record("detect", start, start + microseconds{1500});
+  tracer.write_trace(trace_file);
+
+  const std::string trace = read_file(trace_file);
+  EXPECT_TRUE(trace.starts_with("{\"displayTimeUnit\":\"ms\""));
+  EXPECT_NE(trace.find("\"traceEvents\":["), std::string::npos);
+  EXPECT_NE(trace.find("\"ph\":\"M\""), std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"main \\\"thread\\\"\""), std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"detect\",\"ph\":\"X\""), std::string::npos);
+  EXPECT_NE(trace.find("\"dur\":1500.000"), std::string::npos);
+}
+
+TEST(FormatSpanStats, RowPerSpan) {
+  LatencyHistogram latency;
+  latency.record(milliseconds{4});
+  const std::string table = format_span_stats({
+    {.name = "triangulate", .latency = latency}
+  });
+  EXPECT_TRUE(table.starts_with("span"));
+  EXPECT_NE(table.find("triangulate"), std::string::npos);
+  EXPECT_NE(table.find("4.00"), std::string::npos);
+}
+
+TEST(TracingSession, WritesTraceWhenDone) {
+  std::filesystem::create_directories(TEST_DIR);
+  const path trace_file = TEST_DIR / "session.json";
+  std::filesystem::remove(trace_file);
+  Tracer tracer;
+  {
+    TracingSession session{
+      {.trace_file = trace_file, .collect_interval = milliseconds{1}},
+      tracer
+    };
+    EXPECT_TRUE(tracer.enabled());
+    const TraceSpan span{"session", tracer};
+  }
+  EXPECT_FALSE(tracer.enabled());
+  EXPECT_NE(read_file(trace_file).find("\"session\""), std::string::npos);
+}
+
+}
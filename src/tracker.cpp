@@ -0,0 +1,212 @@
+#include "src/tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "src/tracking.h"
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+// Stand-in for impossible pairings. The Hungarian method needs finite costs,
+// so anything unmatchable is made more expensive than every real pairing.
+constexpr double UNMATCHABLE = 1e12;
+
+double joint_distance(const Point& a, const Point& b) {
+  return std::hypot(a.x - b.x, a.y - b.y);
+}
+
+double joint_distance(const Point3d& a, const Point3d& b) {
+  return std::sqrt(
+    ((a.x - b.x) * (a.x - b.x)) +
+    ((a.y - b.y) * (a.y - b.y)) +
+    ((a.z - b.z) * (a.z - b.z))
+  );
+}
+
+/**
+ * Hungarian method with potentials for `rows <= cols`, following the
+ * formulation at https://cp-algorithms.com/graph/hungarian-algorithm.html.
+ *
+ * The solve is O(rows^2 * cols), but for the handful of people in a frame it
+ * is dwarfed by the O(rows * cols * joints) cost matrix, and unlike a greedy
+ * matcher it never trades a globally cheaper assignment for a local one.
+ */
+template <typename CostFn>
+std::vector<int> hungarian(std::size_t rows, std::size_t cols, CostFn cost) {
+  std::vector<double> u(rows + 1, 0.0);
+  std::vector<double> v(cols + 1, 0.0);
+  std::vector<std::size_t> p(cols + 1, 0);
+  std::vector<std::size_t> way(cols + 1, 0);
+  std::vector<double> min_v(cols + 1);
+  std::vector<char> used(cols + 1);
+
+  for (std::size_t i = 1; i <= rows; ++i) {
+    p[0] = i;
+    std::size_t j0 = 0;
+    std::fill(min_v.begin(), min_v.end(), INF);
+    std::fill(used.begin(), used.end(), false);
+    do {
+      used[j0] = true;
+      std::size_t i0 = p[j0];
+      std::size_t j1 = 0;
+      double delta = INF;
+      for (std::size_t j = 1; j <= cols; ++j) {
+        if (used[j]) continue;
+        double current = cost(i0 - 1, j - 1) - u[i0] - v[j];
+        if (current < min_v[j]) {
+          min_v[j] = current;
+          way[j] = j0;
+        }
+        if (min_v[j] < delta) {
+          delta = min_v[j];
+          j1 = j;
+        }
+      }
+      for (std::size_t j = 0; j <= cols; ++j) {
+        if (used[j]) {
+          u[p[j]] += delta;
+          v[j] -= delta;
+        } else {
+          min_v[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (p[j0] != 0);
+    do {
+      std::size_t j1 = way[j0];
+      p[j0] = p[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  std::vector<int> assignment(rows, -1);
+  for (std::size_t j = 1; j <= cols; ++j) {
+    if (p[j] != 0) assignment[p[j] - 1] = static_cast<int>(j - 1);
+  }
+  return assignment;
+}
+
+}
+
+std::vector<int> solve_assignment(
+  const std::vector<double>& costs,
+  std::size_t rows,
+  std::size_t cols
+) {
+  auto finite = [](double cost) {
+    return std::isfinite(cost) ? cost : UNMATCHABLE;
+  };
+  if (rows <= cols) {
+    return hungarian(rows, cols, [&](std::size_t r, std::size_t c) {
+      return finite(costs[(r * cols) + c]);
+    });
+  }
+
+  // More rows than columns, solve the transposed problem instead.
+  std::vector<int> by_col =
+    hungarian(cols, rows, [&](std::size_t c, std::size_t r) {
+      return finite(costs[(r * cols) + c]);
+    });
+  std::vector<int> assignment(rows, -1);
+  for (std::size_t c = 0; c < cols; ++c) {
+    if (by_col[c] >= 0) assignment[by_col[c]] = static_cast<int>(c);
+  }
+  return assignment;
+}
+
+template <typename PersonT>
+double Tracker<PersonT>::_cost(
+  const Track& track,
+  const PersonT& person
+) const {
+  const std::size_t count = std::min(track.body.size(), person.body.size());
+  double total = 0.0;
+  std::size_t shared = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const PointT& a = track.body[i];
+    const PointT& b = person.body[i];
+    if (
+      a.confidence < _options.min_confidence ||
+      b.confidence < _options.min_confidence
+    ) {
+      continue;
+    }
+    total += joint_distance(a, b);
+    ++shared;
+  }
+  if (shared == 0) return INF;
+
+  double cost = total / shared;
+  return cost > _max_cost ? INF : cost;
+}
+
+template <typename PersonT>
+void Tracker<PersonT>::track(std::vector<PersonT>& people) {
+  const std::size_t rows = _tracks.size();
+  const std::size_t cols = people.size();
+
+  std::vector<int> assignment;
+  if (rows > 0 && cols > 0) {
+    _costs.resize(rows * cols);
+    for (std::size_t r = 0; r < rows; ++r) {
+      for (std::size_t c = 0; c < cols; ++c) {
+        _costs[(r * cols) + c] = _cost(_tracks[r], people[c]);
+      }
+    }
+    assignment = solve_assignment(_costs, rows, cols);
+  }
+
+  // Carry IDs over to matched people and age out the unmatched tracks.
+  std::vector<char> matched(cols, false);
+  for (std::size_t r = 0; r < rows; ++r) {
+    Track& track = _tracks[r];
+    int c = r < assignment.size() ? assignment[r] : -1;
+    if (c < 0 || !std::isfinite(_costs[(r * cols) + c])) {
+      ++track.missed_frames;
+      continue;
+    }
+
+    PersonT& person = people[c];
+    person.person_id = track.person_id;
+    matched[c] = true;
+    track.missed_frames = 0;
+
+    // Keep the last confident sighting of each joint so a briefly occluded
+    // joint still contributes to the next frame's cost.
+    track.body.resize(std::max(track.body.size(), person.body.size()));
+    for (std::size_t i = 0; i < person.body.size(); ++i) {
+      if (person.body[i].confidence >= _options.min_confidence) {
+        track.body[i] = person.body[i];
+      }
+    }
+  }
+
+  _tracks.erase(
+    std::remove_if(
+      _tracks.begin(),
+      _tracks.end(),
+      [&](const Track& track) {
+        return track.missed_frames > _options.max_missed_frames;
+      }
+    ),
+    _tracks.end()
+  );
+
+  for (std::size_t c = 0; c < cols; ++c) {
+    if (matched[c]) continue;
+    PersonT& person = people[c];
+    person.person_id = _next_id++;
+    _tracks.push_back(Track{
+      .person_id = person.person_id,
+      .missed_frames = 0,
+      .body = person.body
+    });
+  }
+}
+
+template class Tracker<Person>;
+template class Tracker<Person3d>;
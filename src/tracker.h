@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "src/tracking.h"
+
+// Someone further than this from a track is someone else, even if they are
+// the only person left to match it with.
+constexpr double DEFAULT_MAX_COST_3D = 0.5;
+constexpr double DEFAULT_MAX_COST_2D = 100.0;
+
+struct TrackerOptions {
+  // Joints below this confidence are left out of the matching cost.
+  double min_confidence = 0.1;
+
+  // Largest mean per-joint distance that may still be matched to a track,
+  // in the units of the tracked points. Unset uses the default for them,
+  // `DEFAULT_MAX_COST_3D` meters or `DEFAULT_MAX_COST_2D` pixels.
+  std::optional<double> max_cost;
+
+  // Number of consecutive frames a track may go unmatched before it is
+  // forgotten. Bounds tracker memory to the people seen in this window.
+  std::size_t max_missed_frames = 30;
+};
+
+/**
+ * Solves the rectangular linear assignment problem for the row-major cost
+ * matrix with the given dimensions.
+ *
+ * Returns, for each row, the column it was assigned to or -1 if every column
+ * was taken by a cheaper row.
+ */
+std::vector<int> solve_assignment(
+  const std::vector<double>& costs,
+  std::size_t rows,
+  std::size_t cols
+);
+
+/**
+ * Assigns persistent person IDs across a stream of frames.
+ *
+ * Each frame's people are matched to the tracks from previous frames by the
+ * mean distance between their confident body joints. Matched people inherit
+ * the track's ID, unmatched people start new tracks.
+ */
+template <typename PersonT>
+class Tracker {
+public:
+  explicit Tracker(TrackerOptions options = {}):
+    _options{options},
+    _max_cost{options.max_cost.value_or(
+      std::is_same_v<PersonT, Person3d>
+        ? DEFAULT_MAX_COST_3D
+        : DEFAULT_MAX_COST_2D
+    )}
+  {}
+
+  /**
+   * Rewrites the `person_id` of everyone in the frame to their track ID.
+   */
+  void track(std::vector<PersonT>& people);
+
+  std::size_t active_tracks() const { return _tracks.size(); }
+
+private:
+  using PointT = typename decltype(PersonT::body)::value_type;
+
+  struct Track {
+    int person_id;
+    std::size_t missed_frames;
+    std::vector<PointT> body;
+  };
+
+  double _cost(const Track& track, const PersonT& person) const;
+
+  TrackerOptions _options;
+  double _max_cost;
+  std::vector<Track> _tracks;
+  std::vector<double> _costs;
+  int _next_id = 0;
+};
+
+using PersonTracker = Tracker<Person>;
+using PersonTracker3d = Tracker<Person3d>;
+
+extern template class Tracker<Person>;
+extern template class Tracker<Person3d>;
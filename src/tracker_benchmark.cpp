@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/tracker.h"
+#include "src/tracking.h"
+
+namespace {
+
+constexpr int BODY_POINTS = 25;
+
+/**
+ * Generates a clip of people random-walking around a 1080p frame. The order of
+ * people is shuffled every frame, the way OpenPose reports them.
+ */
+std::vector<std::vector<Person>> make_clip(
+  std::size_t people_count,
+  std::size_t frame_count
+) {
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<double> start{0.0, 1920.0};
+  std::normal_distribution<double> step{0.0, 4.0};
+  std::uniform_real_distribution<double> confidence{0.0, 1.0};
+
+  std::vector<Person> people(people_count);
+  for (std::size_t p = 0; p < people_count; ++p) {
+    double x = start(rng);
+    double y = start(rng) * 0.5625;
+    for (int i = 0; i < BODY_POINTS; ++i) {
+      people[p].body.push_back(Point{
+        .point_id = i,
+        .x = x + (i * 3.0),
+        .y = y + (i * 7.0),
+        .confidence = 1.0
+      });
+    }
+  }
+
+  std::vector<std::vector<Person>> clip;
+  clip.reserve(frame_count);
+  for (std::size_t f = 0; f < frame_count; ++f) {
+    for (Person& person : people) {
+      double dx = step(rng);
+      double dy = step(rng);
+      for (Point& point : person.body) {
+        point.x += dx;
+        point.y += dy;
+        point.confidence = confidence(rng);
+      }
+    }
+    std::vector<Person>& frame = clip.emplace_back(people);
+    std::shuffle(frame.begin(), frame.end(), rng);
+  }
+  return clip;
+}
+
+void BM_PersonTracker(benchmark::State& state) {
+  const std::size_t people_count = state.range(0);
+  const std::size_t frame_count = state.range(1);
+  const std::vector<std::vector<Person>> clip =
+    make_clip(people_count, frame_count);
+
+  std::vector<Person> frame;
+  for (auto _ : state) {
+    PersonTracker tracker;
+    for (const std::vector<Person>& source : clip) {
+      frame = source;
+      tracker.track(frame);
+      benchmark::DoNotOptimize(frame.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * frame_count);
+  state.counters["people"] = people_count;
+}
+BENCHMARK(BM_PersonTracker)
+  ->ArgsProduct({{1, 2, 4, 8, 16}, {18'000}})
+  ->Unit(benchmark::kMillisecond);
+
+}
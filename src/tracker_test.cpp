@@ -0,0 +1,199 @@
+#include "src/tracker.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/tracking.h"
+
+namespace {
+
+Person make_person(int person_id, double x, double y) {
+  Person person{.person_id = person_id};
+  for (int i = 0; i < 25; ++i) {
+    person.body.push_back(
+      Point{.point_id = i, .x = x + i, .y = y + i, .confidence = 0.9}
+    );
+  }
+  return person;
+}
+
+Person3d make_person_3d(int person_id, double x, double y, double z) {
+  Person3d person{.person_id = person_id};
+  for (int i = 0; i < 25; ++i) {
+    person.body.push_back(Point3d{
+      .point_id = i,
+      .x = x + (i * 0.01),
+      .y = y + (i * 0.01),
+      .z = z,
+      .confidence = 0.9
+    });
+  }
+  return person;
+}
+
+TEST(SolveAssignment, Square) {
+  std::vector<double> costs = {
+    4, 1, 3,
+    2, 0, 5,
+    3, 2, 2
+  };
+  std::vector<int> assignment = solve_assignment(costs, 3, 3);
+  EXPECT_EQ(assignment, (std::vector<int>{1, 0, 2}));
+}
+
+TEST(SolveAssignment, MoreColumns) {
+  std::vector<double> costs = {
+    9, 1, 9,
+    1, 9, 9
+  };
+  std::vector<int> assignment = solve_assignment(costs, 2, 3);
+  EXPECT_EQ(assignment, (std::vector<int>{1, 0}));
+}
+
+TEST(SolveAssignment, MoreRows) {
+  std::vector<double> costs = {
+    9, 9,
+    1, 9,
+    9, 1
+  };
+  std::vector<int> assignment = solve_assignment(costs, 3, 2);
+  EXPECT_EQ(assignment, (std::vector<int>{-1, 0, 1}));
+}
+
+TEST(Tracker, KeepsIdsWhenOrderSwaps) {
+  PersonTracker tracker;
+  std::vector<Person> frame = {
+    make_person(0, 100, 100),
+    make_person(1, 800, 100)
+  };
+  tracker.track(frame);
+  const int left_id = frame[0].person_id;
+  const int right_id = frame[1].person_id;
+  EXPECT_NE(left_id, right_id);
+
+  // OpenPose reorders people freely between frames.
+  frame = {make_person(0, 805, 102), make_person(1, 103, 98)};
+  tracker.track(frame);
+  EXPECT_EQ(frame[0].person_id, right_id);
+  EXPECT_EQ(frame[1].person_id, left_id);
+  EXPECT_EQ(tracker.active_tracks(), 2);
+}
+
+TEST(Tracker, NewPersonGetsNewId) {
+  PersonTracker tracker;
+  std::vector<Person> frame = {make_person(0, 100, 100)};
+  tracker.track(frame);
+  const int first_id = frame[0].person_id;
+
+  frame = {make_person(0, 100, 100), make_person(1, 900, 500)};
+  tracker.track(frame);
+  EXPECT_EQ(frame[0].person_id, first_id);
+  EXPECT_NE(frame[1].person_id, first_id);
+}
+
+TEST(Tracker, MaxCostRejectsDistantMatch) {
+  PersonTracker tracker{TrackerOptions{.max_cost = 50}};
+  std::vector<Person> frame = {make_person(0, 100, 100)};
+  tracker.track(frame);
+  const int first_id = frame[0].person_id;
+
+  frame = {make_person(0, 1000, 100)};
+  tracker.track(frame);
+  EXPECT_NE(frame[0].person_id, first_id);
+}
+
+TEST(Tracker, DefaultMaxCostRejectsDistantMatch) {
+  PersonTracker tracker;
+  std::vector<Person> frame = {make_person(0, 100, 100)};
+  tracker.track(frame);
+  const int first_id = frame[0].person_id;
+
+  frame = {make_person(0, 100 + DEFAULT_MAX_COST_2D * 2, 100)};
+  tracker.track(frame);
+  EXPECT_NE(frame[0].person_id, first_id);
+}
+
+TEST(Tracker, ReacquiresAfterShortOcclusion) {
+  PersonTracker tracker{TrackerOptions{.max_missed_frames = 5}};
+  std::vector<Person> frame = {make_person(0, 100, 100)};
+  tracker.track(frame);
+  const int first_id = frame[0].person_id;
+
+  for (int i = 0; i < 5; ++i) {
+    std::vector<Person> empty;
+    tracker.track(empty);
+  }
+  frame = {make_person(0, 102, 101)};
+  tracker.track(frame);
+  EXPECT_EQ(frame[0].person_id, first_id);
+}
+
+TEST(Tracker, ForgetsStaleTracks) {
+  PersonTracker tracker{TrackerOptions{.max_missed_frames = 2}};
+  std::vector<Person> frame = {make_person(0, 100, 100)};
+  tracker.track(frame);
+  EXPECT_EQ(tracker.active_tracks(), 1);
+
+  for (int i = 0; i < 3; ++i) {
+    std::vector<Person> empty;
+    tracker.track(empty);
+  }
+  EXPECT_EQ(tracker.active_tracks(), 0);
+}
+
+TEST(Tracker, IgnoresLowConfidenceJoints) {
+  PersonTracker tracker;
+  std::vector<Person> frame = {
+    make_person(0, 100, 100),
+    make_person(1, 800, 100)
+  };
+  tracker.track(frame);
+  const int left_id = frame[0].person_id;
+
+  // A garbage low-confidence joint far away must not pull the match over.
+  Person left = make_person(0, 101, 100);
+  left.body[3] = Point{.point_id = 3, .x = 800, .y = 100, .confidence = 0.01};
+  frame = {make_person(1, 800, 100), left};
+  tracker.track(frame);
+  EXPECT_EQ(frame[1].person_id, left_id);
+}
+
+TEST(Tracker3d, KeepsIdsWhenOrderSwaps) {
+  PersonTracker3d tracker;
+  std::vector<Person3d> frame = {
+    make_person_3d(0, 0.0, 0.0, 2.0),
+    make_person_3d(1, 1.0, 0.0, 2.0)
+  };
+  tracker.track(frame);
+  const int near_id = frame[0].person_id;
+  const int far_id = frame[1].person_id;
+
+  frame = {make_person_3d(0, 1.01, 0.0, 2.0), make_person_3d(1, 0.02, 0.0, 2.0)};
+  tracker.track(frame);
+  EXPECT_EQ(frame[0].person_id, far_id);
+  EXPECT_EQ(frame[1].person_id, near_id);
+}
+
+TEST(Tracker3d, NewPersonFarAwayGetsNewId) {
+  PersonTracker3d tracker;
+  std::vector<Person3d> frame = {make_person_3d(0, 0.0, 0.0, 2.0)};
+  tracker.track(frame);
+  const int leaving_id = frame[0].person_id;
+
+  // One person leaves the frame as another walks in across the room. Being
+  // the only pairing available must not hand over the ID.
+  frame = {make_person_3d(0, 3.0, 0.0, 4.0)};
+  tracker.track(frame);
+  EXPECT_NE(frame[0].person_id, leaving_id);
+  EXPECT_EQ(tracker.active_tracks(), 2);
+
+  // The person who left is still matched when they come back close by.
+  frame = {
+    make_person_3d(0, 3.02, 0.0, 4.0),
+    make_person_3d(1, 0.05, 0.0, 2.0)
+  };
+  tracker.track(frame);
+  EXPECT_EQ(frame[1].person_id, leaving_id);
+}
+
+}
@@ -0,0 +1,350 @@
+#include "src/triangulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "src/camera_model.h"
+#include "src/tracker.h"
+#include "src/tracking.h"
+#include "src/undistort.h"
+
+namespace {
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+void undistort_points(
+  std::vector<Point>& points,
+  const PointUndistorter& undistorter
+) {
+  std::vector<cv::Point2f> pixels;
+  pixels.reserve(points.size());
+  for (const Point& point : points) {
+    pixels.emplace_back(static_cast<float>(point.x), static_cast<float>(point.y));
+  }
+  std::vector<cv::Point2f> normalized;
+  undistorter.undistort(pixels, normalized);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    points[i].x = normalized[i].x;
+    points[i].y = normalized[i].y;
+  }
+}
+
+cv::Vec3d ray(const CameraModel& camera, const Point& normalized) {
+  return camera.ray({
+    static_cast<float>(normalized.x),
+    static_cast<float>(normalized.y)
+  });
+}
+
+/**
+ * The closest points on the rays through a pair of keypoints.
+ */
+struct RayPair {
+  cv::Vec3d closest_1;
+  cv::Vec3d closest_2;
+
+  cv::Vec3d midpoint() const { return (closest_1 + closest_2) / 2.0; }
+  double gap() const { return cv::norm(closest_2 - closest_1); }
+};
+
+RayPair closest_points(
+  const CameraModel& camera_1,
+  const Point& normalized_1,
+  const CameraModel& camera_2,
+  const Point& normalized_2
+) {
+  // Minimizing |a + t*b - (c + s*d)| over t and s for unit rays b and d,
+  // with w = a - c, gives:
+  //   t = ((b.w) - (b.d)(d.w)) / ((b.d)^2 - 1)
+  //   s = ((b.d)(b.w) - (d.w)) / ((b.d)^2 - 1)
+  const cv::Vec3d& cam_1 = camera_1.world_center(); // a
+  const cv::Vec3d& cam_2 = camera_2.world_center(); // c
+  const cv::Vec3d ray_1 = ray(camera_1, normalized_1); // b
+  const cv::Vec3d ray_2 = ray(camera_2, normalized_2); // d
+  const cv::Vec3d w = cam_1 - cam_2;
+
+  const double b_dot_d = ray_1.dot(ray_2);
+  const double b_dot_w = ray_1.dot(w);
+  const double d_dot_w = ray_2.dot(w);
+  const double denominator = (b_dot_d * b_dot_d) - 1.0;
+
+  // Parallel rays are equally close everywhere, measure from the first
+  // camera.
+  if (std::abs(denominator) < 1e-12) {
+    return {cam_1, cam_2 + (d_dot_w * ray_2)};
+  }
+  const double t = (b_dot_w - (b_dot_d * d_dot_w)) / denominator;
+  const double s = ((b_dot_d * b_dot_w) - d_dot_w) / denominator;
+  return {cam_1 + (t * ray_1), cam_2 + (s * ray_2)};
+}
+
+Point3d make_point(
+  const cv::Vec3d& position,
+  const Point& normalized_1,
+  const Point& normalized_2
+) {
+  // The point is no more certain than the weaker of the views that place it.
+  return Point3d{
+    .point_id = normalized_1.point_id,
+    .x = position[0],
+    .y = position[1],
+    .z = position[2],
+    .confidence = std::min(normalized_1.confidence, normalized_2.confidence)
+  };
+}
+
+/**
+ * Distance in undistorted pixels between a world point projected into the
+ * camera and the keypoint detected there.
+ */
+double pixel_error(
+  const CameraModel& camera,
+  const cv::Vec3d& world,
+  const Point& normalized
+) {
+  const cv::Point2d projected = camera.project(world);
+  const cv::Vec3d detected =
+    camera.matrix() * cv::Vec3d{normalized.x, normalized.y, 1.0};
+  return std::hypot(
+    projected.x - (detected[0] / detected[2]),
+    projected.y - (detected[1] / detected[2])
+  );
+}
+
+/**
+ * Triangulates each pair of keypoints. When given `quality`, the errors of
+ * each point are appended to its last person and added to its summaries.
+ */
+std::vector<Point3d> triangulate_points(
+  const CameraModel& camera_1,
+  const std::vector<Point>& points_1,
+  const CameraModel& camera_2,
+  const std::vector<Point>& points_2,
+  double min_confidence = 0.0,
+  TriangulationQuality* quality = nullptr
+) {
+  std::vector<Point3d> points;
+  points.reserve(std::min(points_1.size(), points_2.size()));
+  for (std::size_t i = 0; i < points_1.size() && i < points_2.size(); ++i) {
+    const Point& point_1 = points_1[i];
+    const Point& point_2 = points_2[i];
+    const RayPair rays = closest_points(camera_1, point_1, camera_2, point_2);
+    const cv::Vec3d midpoint = rays.midpoint();
+    points.push_back(make_point(midpoint, point_1, point_2));
+    if (!quality) continue;
+
+    PointQuality& point_quality = quality->people.back().body.emplace_back(
+      PointQuality{
+        .point_id = point_1.point_id,
+        .ray_gap = NaN,
+        .reprojection_error_1 = NaN,
+        .reprojection_error_2 = NaN
+      }
+    );
+    if (
+      point_1.confidence < min_confidence ||
+      point_2.confidence < min_confidence
+    ) {
+      continue;
+    }
+    point_quality.ray_gap = rays.gap();
+    point_quality.reprojection_error_1 =
+      pixel_error(camera_1, midpoint, point_1);
+    point_quality.reprojection_error_2 =
+      pixel_error(camera_2, midpoint, point_2);
+    quality->ray_gap.add(point_quality.ray_gap);
+    quality->reprojection_error.add(point_quality.reprojection_error_1);
+    quality->reprojection_error.add(point_quality.reprojection_error_2);
+  }
+  return points;
+}
+
+/**
+ * Triangulates every part of a pair of people. Only the body is measured
+ * into `quality`, under its last person.
+ */
+Person3d triangulate_pair(
+  const CameraModel& camera_1,
+  const Person& normalized_1,
+  const CameraModel& camera_2,
+  const Person& normalized_2,
+  double min_confidence = 0.0,
+  TriangulationQuality* quality = nullptr
+) {
+  return Person3d{
+    .person_id = normalized_1.person_id,
+    .body = triangulate_points(
+      camera_1, normalized_1.body,
+      camera_2, normalized_2.body,
+      min_confidence,
+      quality
+    ),
+    .face = triangulate_points(
+      camera_1, normalized_1.face,
+      camera_2, normalized_2.face
+    ),
+    .right_paw = triangulate_points(
+      camera_1, normalized_1.right_paw,
+      camera_2, normalized_2.right_paw
+    ),
+    .left_paw = triangulate_points(
+      camera_1, normalized_1.left_paw,
+      camera_2, normalized_2.left_paw
+    )
+  };
+}
+
+double pairing_cost(
+  const CameraModel& camera_1,
+  const Person& person_1,
+  const CameraModel& camera_2,
+  const Person& person_2,
+  const TriangulationOptions& options
+) {
+  double total = 0.0;
+  std::size_t shared = 0;
+  for (
+    std::size_t i = 0;
+    i < person_1.body.size() && i < person_2.body.size();
+    ++i
+  ) {
+    const Point& point_1 = person_1.body[i];
+    const Point& point_2 = person_2.body[i];
+    if (
+      point_1.confidence < options.min_confidence ||
+      point_2.confidence < options.min_confidence
+    ) {
+      continue;
+    }
+    total += ray_gap(camera_1, point_1, camera_2, point_2);
+    ++shared;
+  }
+  if (shared == 0) return INF;
+
+  double cost = total / shared;
+  return cost > options.max_ray_gap ? INF : cost;
+}
+
+}
+
+void ErrorSummary::add(double error) {
+  ++_count;
+  _sum += error;
+  _sum_of_squares += error * error;
+  _max = std::max(_max, error);
+}
+
+void ErrorSummary::merge(const ErrorSummary& other) {
+  _count += other._count;
+  _sum += other._sum;
+  _sum_of_squares += other._sum_of_squares;
+  _max = std::max(_max, other._max);
+}
+
+double ErrorSummary::mean() const {
+  return _count > 0 ? _sum / _count : NaN;
+}
+
+double ErrorSummary::rms() const {
+  return _count > 0 ? std::sqrt(_sum_of_squares / _count) : NaN;
+}
+
+Person undistort_person(
+  const Person& person,
+  const PointUndistorter& undistorter
+) {
+  Person normalized = person;
+  undistort_points(normalized.body, undistorter);
+  undistort_points(normalized.face, undistorter);
+  undistort_points(normalized.right_paw, undistorter);
+  undistort_points(normalized.left_paw, undistorter);
+  return normalized;
+}
+
+Point3d triangulate_point(
+  const CameraModel& camera_1,
+  const Point& normalized_1,
+  const CameraModel& camera_2,
+  const Point& normalized_2
+) {
+  return make_point(
+    closest_points(camera_1, normalized_1, camera_2, normalized_2).midpoint(),
+    normalized_1,
+    normalized_2
+  );
+}
+
+double ray_gap(
+  const CameraModel& camera_1,
+  const Point& normalized_1,
+  const CameraModel& camera_2,
+  const Point& normalized_2
+) {
+  const cv::Vec3d ray_1 = ray(camera_1, normalized_1);
+  const cv::Vec3d ray_2 = ray(camera_2, normalized_2);
+  const cv::Vec3d baseline = camera_2.world_center() - camera_1.world_center();
+  const cv::Vec3d normal = ray_1.cross(ray_2);
+  const double normal_length = cv::norm(normal);
+
+  // Parallel rays, measure the distance from one ray to the other's origin.
+  if (normal_length < 1e-12) return cv::norm(baseline.cross(ray_1));
+  return std::abs(baseline.dot(normal)) / normal_length;
+}
+
+Person3d triangulate_person(
+  const CameraModel& camera_1,
+  const Person& normalized_1,
+  const CameraModel& camera_2,
+  const Person& normalized_2
+) {
+  return triangulate_pair(camera_1, normalized_1, camera_2, normalized_2);
+}
+
+std::vector<Person3d> triangulate_people(
+  const CameraModel& camera_1,
+  const std::vector<Person>& normalized_1,
+  const CameraModel& camera_2,
+  const std::vector<Person>& normalized_2,
+  const TriangulationOptions& options,
+  TriangulationQuality* quality
+) {
+  if (quality) *quality = {};
+  const std::size_t rows = normalized_1.size();
+  const std::size_t cols = normalized_2.size();
+  if (rows == 0 || cols == 0) return {};
+
+  std::vector<double> costs(rows * cols);
+  for (std::size_t r = 0; r < rows; ++r) {
+    for (std::size_t c = 0; c < cols; ++c) {
+      costs[(r * cols) + c] = pairing_cost(
+        camera_1, normalized_1[r],
+        camera_2, normalized_2[c],
+        options
+      );
+    }
+  }
+  std::vector<int> assignment = solve_assignment(costs, rows, cols);
+
+  std::vector<Person3d> people;
+  for (std::size_t r = 0; r < rows; ++r) {
+    const int c = assignment[r];
+    if (c < 0 || !std::isfinite(costs[(r * cols) + c])) continue;
+    if (quality) {
+      quality->people.push_back(
+        PersonQuality{.person_id = normalized_1[r].person_id}
+      );
+    }
+    people.push_back(triangulate_pair(
+      camera_1, normalized_1[r],
+      camera_2, normalized_2[c],
+      options.min_confidence,
+      quality
+    ));
+  }
+  return people;
+}
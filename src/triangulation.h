@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "src/camera_model.h"
+#include "src/tracking.h"
+#include "src/undistort.h"
+
+struct TriangulationOptions {
+  // Joints below this confidence in either view are left out of the cost
+  // used to pair people between the two views.
+  double min_confidence = 0.1;
+
+  // Largest mean gap between paired rays, in world units, for two detections
+  // to still be considered the same person.
+  double max_ray_gap = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * Count, mean, RMS and maximum of a series of errors, updated one error at a
+ * time so a whole session is summarized without keeping its samples.
+ */
+class ErrorSummary {
+public:
+  ErrorSummary() = default;
+  ~ErrorSummary() = default;
+  ErrorSummary(const ErrorSummary&) = default;
+  ErrorSummary(ErrorSummary&&) = default;
+  ErrorSummary& operator=(const ErrorSummary&) = default;
+  ErrorSummary& operator=(ErrorSummary&&) = default;
+
+  void add(double error);
+
+  /**
+   * Adds every error of `other`.
+   */
+  void merge(const ErrorSummary& other);
+
+  std::uint64_t count() const { return _count; }
+
+  /**
+   * Zero when empty.
+   */
+  double max() const { return _max; }
+
+  /**
+   * NaN when empty.
+   */
+  double mean() const;
+  double rms() const;
+
+private:
+  std::uint64_t _count = 0;
+  double _sum = 0.0;
+  double _sum_of_squares = 0.0;
+  double _max = 0.0;
+};
+
+/**
+ * How well a triangulated joint agrees with the two detections it came from.
+ * Every error is NaN when either detection is below the minimum confidence.
+ */
+struct PointQuality {
+  int point_id;
+
+  // Shortest distance between the two rays, in world units.
+  double ray_gap;
+
+  // Distance in undistorted pixels between the triangulated point projected
+  // into each view and the keypoint detected there.
+  double reprojection_error_1;
+  double reprojection_error_2;
+};
+
+struct PersonQuality {
+  int person_id;
+
+  // Body joints only, in the same order as the triangulated body.
+  std::vector<PointQuality> body;
+};
+
+/**
+ * Quality of one frame's triangulation, measured while triangulating it.
+ */
+struct TriangulationQuality {
+  // One for each person triangulated, in the same order.
+  std::vector<PersonQuality> people;
+
+  // Over every confident body joint of the frame. Reprojection errors count
+  // each view separately.
+  ErrorSummary reprojection_error;
+  ErrorSummary ray_gap;
+};
+
+/**
+ * Replaces the pixel coordinates of every keypoint with undistorted
+ * normalized image coordinates, as `PointUndistorter::undistort` does.
+ */
+Person undistort_person(
+  const Person& person,
+  const PointUndistorter& undistorter
+);
+
+/**
+ * Midpoint of the shortest segment between the rays through the two
+ * normalized keypoints. Its confidence is the lower of the two keypoints'.
+ */
+Point3d triangulate_point(
+  const CameraModel& camera_1,
+  const Point& normalized_1,
+  const CameraModel& camera_2,
+  const Point& normalized_2
+);
+
+/**
+ * Shortest distance between the rays through the two normalized keypoints.
+ */
+double ray_gap(
+  const CameraModel& camera_1,
+  const Point& normalized_1,
+  const CameraModel& camera_2,
+  const Point& normalized_2
+);
+
+/**
+ * Triangulates each part of a person seen in both views. Both people must
+ * already be undistorted with `undistort_person`.
+ */
+Person3d triangulate_person(
+  const CameraModel& camera_1,
+  const Person& normalized_1,
+  const CameraModel& camera_2,
+  const Person& normalized_2
+);
+
+/**
+ * Pairs the people detected in two views by the mean ray gap of their
+ * confident body joints and triangulates each pair. People without a match
+ * in the other view are dropped.
+ *
+ * When given `quality`, it is filled with the ray gap and reprojection errors
+ * of every body joint as they are triangulated, from the same rays.
+ */
+std::vector<Person3d> triangulate_people(
+  const CameraModel& camera_1,
+  const std::vector<Person>& normalized_1,
+  const CameraModel& camera_2,
+  const std::vector<Person>& normalized_2,
+  const TriangulationOptions& options = {},
+  TriangulationQuality* quality = nullptr
+);
@@ -0,0 +1,266 @@
+#include "src/triangulation.h"
+
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/camera_model.h"
+#include "src/cameras.h"
+#include "src/tracking.h"
+#include "src/undistort.h"
+
+namespace {
+
+double camera_matrix[] = {
+  1000.0, 0.0, 960.0,
+  0.0, 1000.0, 540.0,
+  0.0, 0.0, 1.0
+};
+
+/**
+ * Camera looking down +z from `center` with no lens distortion.
+ */
+CameraParameters make_parameters(const cv::Vec3d& center) {
+  return CameraParameters{
+    .matrix = cv::Mat{3, 3, CV_64F, camera_matrix}.clone(),
+    .distortion = cv::Mat::zeros(1, 5, CV_64F),
+    .rotation = cv::Mat::zeros(3, 1, CV_64F),
+    .translation = cv::Mat{-center}.clone()
+  };
+}
+
+Point to_normalized(const CameraModel& camera, const cv::Vec3d& world, int id) {
+  const cv::Vec3d local = (camera.rotation() * world) + camera.translation();
+  return Point{
+    .point_id = id,
+    .x = local[0] / local[2],
+    .y = local[1] / local[2],
+    .confidence = 1.0
+  };
+}
+
+/**
+ * A person standing at `position`, seen normalized by the camera.
+ */
+Person make_person(
+  const CameraModel& camera,
+  const cv::Vec3d& position,
+  int person_id
+) {
+  Person person{.person_id = person_id};
+  for (int i = 0; i < 5; ++i) {
+    const cv::Vec3d joint = position + cv::Vec3d{0.0, -0.2 * i, 0.0};
+    person.body.push_back(to_normalized(camera, joint, i));
+  }
+  return person;
+}
+
+TEST(Triangulation, UndistortPersonNormalizesPixels) {
+  const CameraParameters parameters = make_parameters({0.0, 0.0, 0.0});
+  PointUndistorter undistorter{parameters};
+  Person person{
+    .person_id = 3,
+    .body = {{.point_id = 0, .x = 1460.0, .y = 290.0, .confidence = 0.7}}
+  };
+
+  const Person normalized = undistort_person(person, undistorter);
+  ASSERT_EQ(normalized.body.size(), 1);
+  EXPECT_EQ(normalized.person_id, 3);
+  EXPECT_NEAR(normalized.body[0].x, 0.5, 1e-6);
+  EXPECT_NEAR(normalized.body[0].y, -0.25, 1e-6);
+  EXPECT_DOUBLE_EQ(normalized.body[0].confidence, 0.7);
+}
+
+TEST(Triangulation, TriangulatePointFindsIntersection) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+  const cv::Vec3d world{0.5, 0.2, 3.0};
+  Point point_1 = to_normalized(camera_1, world, 7);
+  Point point_2 = to_normalized(camera_2, world, 7);
+  point_1.confidence = 0.9;
+  point_2.confidence = 0.6;
+
+  const Point3d point = triangulate_point(camera_1, point_1, camera_2, point_2);
+  EXPECT_EQ(point.point_id, 7);
+  EXPECT_NEAR(point.x, world[0], 1e-5);
+  EXPECT_NEAR(point.y, world[1], 1e-5);
+  EXPECT_NEAR(point.z, world[2], 1e-5);
+  EXPECT_DOUBLE_EQ(point.confidence, 0.6);
+}
+
+TEST(Triangulation, RayGapOfIntersectingRays) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+  const cv::Vec3d world{0.5, 0.2, 3.0};
+
+  EXPECT_NEAR(
+    ray_gap(
+      camera_1, to_normalized(camera_1, world, 0),
+      camera_2, to_normalized(camera_2, world, 0)
+    ),
+    0.0,
+    1e-6
+  );
+}
+
+TEST(Triangulation, RayGapOfSkewRays) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+
+  // Both rays run parallel to the x-z plane, 0.1 apart in y.
+  const Point point_1 = to_normalized(camera_1, {0.5, 0.0, 3.0}, 0);
+  const Point point_2 = to_normalized(camera_2, {0.5, 0.1, 3.0}, 0);
+  EXPECT_NEAR(ray_gap(camera_1, point_1, camera_2, point_2), 0.1, 1e-3);
+}
+
+TEST(Triangulation, PairsPeopleAcrossViews) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+  const cv::Vec3d left{-0.5, 0.0, 3.0};
+  const cv::Vec3d right{1.5, 0.0, 3.5};
+
+  // Detection order differs between the two views.
+  std::vector<Person> view_1 = {
+    make_person(camera_1, left, 0),
+    make_person(camera_1, right, 1)
+  };
+  std::vector<Person> view_2 = {
+    make_person(camera_2, right, 0),
+    make_person(camera_2, left, 1)
+  };
+
+  std::vector<Person3d> people =
+    triangulate_people(camera_1, view_1, camera_2, view_2);
+  ASSERT_EQ(people.size(), 2);
+  for (const Person3d& person : people) {
+    const Person& person_1 = view_1[person.person_id];
+    const Person& person_2 = view_2[1 - person.person_id];
+    ASSERT_EQ(person.body.size(), person_1.body.size());
+    for (std::size_t i = 0; i < person.body.size(); ++i) {
+      const Point3d expected = triangulate_point(
+        camera_1, person_1.body[i],
+        camera_2, person_2.body[i]
+      );
+      EXPECT_DOUBLE_EQ(person.body[i].x, expected.x);
+      EXPECT_DOUBLE_EQ(person.body[i].y, expected.y);
+      EXPECT_DOUBLE_EQ(person.body[i].z, expected.z);
+    }
+  }
+}
+
+TEST(Triangulation, DropsPeopleBeyondMaxRayGap) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+
+  std::vector<Person> view_1 = {make_person(camera_1, {0.0, 0.0, 3.0}, 0)};
+  std::vector<Person> view_2 = {make_person(camera_2, {0.0, 0.5, 3.0}, 0)};
+
+  EXPECT_EQ(
+    triangulate_people(camera_1, view_1, camera_2, view_2).size(),
+    1
+  );
+  EXPECT_TRUE(
+    triangulate_people(
+      camera_1, view_1,
+      camera_2, view_2,
+      {.max_ray_gap = 0.1}
+    ).empty()
+  );
+}
+
+TEST(Triangulation, MeasuresQualityOfEachJoint) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+  std::vector<Person> view_1 = {make_person(camera_1, {0.0, 0.0, 3.0}, 4)};
+  std::vector<Person> view_2 = {make_person(camera_2, {0.0, 0.0, 3.0}, 0)};
+  view_2[0].body[3].confidence = 0.05;
+
+  TriangulationQuality quality;
+  const std::vector<Person3d> people = triangulate_people(
+    camera_1, view_1,
+    camera_2, view_2,
+    {},
+    &quality
+  );
+  ASSERT_EQ(people.size(), 1);
+  ASSERT_EQ(quality.people.size(), 1);
+  EXPECT_EQ(quality.people[0].person_id, 4);
+  ASSERT_EQ(quality.people[0].body.size(), people[0].body.size());
+  for (const PointQuality& point : quality.people[0].body) {
+    SCOPED_TRACE("joint " + std::to_string(point.point_id));
+    if (point.point_id == 3) {
+      EXPECT_TRUE(std::isnan(point.ray_gap));
+      EXPECT_TRUE(std::isnan(point.reprojection_error_1));
+      EXPECT_TRUE(std::isnan(point.reprojection_error_2));
+      continue;
+    }
+    EXPECT_NEAR(point.ray_gap, 0.0, 1e-5);
+    EXPECT_NEAR(point.reprojection_error_1, 0.0, 1e-3);
+    EXPECT_NEAR(point.reprojection_error_2, 0.0, 1e-3);
+  }
+  EXPECT_EQ(quality.ray_gap.count(), 4);
+  EXPECT_EQ(quality.reprojection_error.count(), 8);
+}
+
+TEST(Triangulation, ReprojectionErrorIsInPixels) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+
+  // The rays pass 0.1 apart, so the midpoint misses each by about 0.05 at a
+  // depth of 3, or 1000 * 0.05 / 3 pixels.
+  const std::vector<Person> view_1 = {Person{
+    .person_id = 0,
+    .body = {to_normalized(camera_1, {0.0, 0.0, 3.0}, 0)}
+  }};
+  const std::vector<Person> view_2 = {Person{
+    .person_id = 0,
+    .body = {to_normalized(camera_2, {0.0, 0.1, 3.0}, 0)}
+  }};
+
+  TriangulationQuality quality;
+  triangulate_people(camera_1, view_1, camera_2, view_2, {}, &quality);
+  EXPECT_NEAR(quality.ray_gap.mean(), 0.0995, 1e-3);
+  EXPECT_NEAR(quality.reprojection_error.rms(), 16.75, 0.01);
+  EXPECT_NEAR(quality.reprojection_error.max(), 16.75, 0.01);
+}
+
+TEST(Triangulation, QualityIsEmptyWithoutPeople) {
+  const CameraModel camera_1{make_parameters({0.0, 0.0, 0.0})};
+  const CameraModel camera_2{make_parameters({1.0, 0.0, 0.0})};
+
+  TriangulationQuality quality;
+  quality.ray_gap.add(1.0);
+  triangulate_people(camera_1, {}, camera_2, {}, {}, &quality);
+  EXPECT_TRUE(quality.people.empty());
+  EXPECT_EQ(quality.ray_gap.count(), 0);
+  EXPECT_TRUE(std::isnan(quality.reprojection_error.rms()));
+}
+
+TEST(ErrorSummary, SummarizesErrors) {
+  ErrorSummary summary;
+  summary.add(3.0);
+  summary.add(4.0);
+  EXPECT_EQ(summary.count(), 2);
+  EXPECT_DOUBLE_EQ(summary.mean(), 3.5);
+  EXPECT_DOUBLE_EQ(summary.rms(), std::sqrt(12.5));
+  EXPECT_DOUBLE_EQ(summary.max(), 4.0);
+
+  ErrorSummary other;
+  other.add(8.0);
+  summary.merge(other);
+  EXPECT_EQ(summary.count(), 3);
+  EXPECT_DOUBLE_EQ(summary.mean(), 5.0);
+  EXPECT_DOUBLE_EQ(summary.max(), 8.0);
+}
+
+TEST(ErrorSummary, EmptyIsNaN) {
+  const ErrorSummary summary;
+  EXPECT_EQ(summary.count(), 0);
+  EXPECT_TRUE(std::isnan(summary.mean()));
+  EXPECT_TRUE(std::isnan(summary.rms()));
+  EXPECT_EQ(summary.max(), 0.0);
+}
+
+}
@@ -0,0 +1,127 @@
+#include "src/undistort.h"
+
+#include <cmath>
+#include <cstddef>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "src/cameras.h"
+
+namespace {
+
+// The grid is built once, so it can afford a much tighter solve than the
+// default 5 iterations `cv::undistortPoints` uses per call.
+const cv::TermCriteria GRID_CRITERIA{
+  cv::TermCriteria::COUNT | cv::TermCriteria::EPS,
+  100,
+  1e-9
+};
+
+}
+
+PointUndistorter::PointUndistorter(const CameraParameters& parameters):
+  _matrix{parameters.matrix},
+  _distortion{parameters.distortion}
+{}
+
+PointUndistorter::PointUndistorter(
+  const CameraParameters& parameters,
+  cv::Size image_size,
+  int grid_step
+):
+  PointUndistorter{parameters}
+{
+  if (grid_step <= 0) return;
+
+  // Nodes run one step past the last pixel so every in-image point has all
+  // four of its neighbours.
+  _grid_step = grid_step;
+  _grid_cols = ((image_size.width - 1) / grid_step) + 2;
+  _grid_rows = ((image_size.height - 1) / grid_step) + 2;
+
+  std::vector<cv::Point2f> nodes;
+  nodes.reserve(_grid_cols * _grid_rows);
+  for (int row = 0; row < _grid_rows; ++row) {
+    for (int col = 0; col < _grid_cols; ++col) {
+      nodes.emplace_back(
+        static_cast<float>(col * grid_step),
+        static_cast<float>(row * grid_step)
+      );
+    }
+  }
+  cv::undistortPoints(
+    nodes,
+    _grid,
+    _matrix,
+    _distortion,
+    cv::noArray(),
+    cv::noArray(),
+    GRID_CRITERIA
+  );
+}
+
+void PointUndistorter::undistort(
+  const std::vector<cv::Point2f>& pixels,
+  std::vector<cv::Point2f>& normalized
+) const {
+  if (!has_grid()) {
+    _undistort_exact(pixels, normalized);
+    return;
+  }
+
+  normalized.resize(pixels.size());
+  std::vector<std::size_t> outside_idx;
+  std::vector<cv::Point2f> outside;
+  const float inverse_step = 1.0f / _grid_step;
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    const float gx = pixels[i].x * inverse_step;
+    const float gy = pixels[i].y * inverse_step;
+    const int col = static_cast<int>(std::floor(gx));
+    const int row = static_cast<int>(std::floor(gy));
+    if (col < 0 || row < 0 || col >= _grid_cols - 1 || row >= _grid_rows - 1) {
+      outside_idx.push_back(i);
+      outside.push_back(pixels[i]);
+      continue;
+    }
+
+    const float fx = gx - col;
+    const float fy = gy - row;
+    const cv::Point2f* top = &_grid[(row * _grid_cols) + col];
+    const cv::Point2f* bottom = top + _grid_cols;
+    normalized[i] =
+      ((top[0] * (1.0f - fx)) + (top[1] * fx)) * (1.0f - fy) +
+      ((bottom[0] * (1.0f - fx)) + (bottom[1] * fx)) * fy;
+  }
+
+  if (outside.empty()) return;
+  std::vector<cv::Point2f> outside_normalized;
+  _undistort_exact(outside, outside_normalized);
+  for (std::size_t i = 0; i < outside_idx.size(); ++i) {
+    normalized[outside_idx[i]] = outside_normalized[i];
+  }
+}
+
+void PointUndistorter::undistort(
+  const std::vector<cv::Point2f>& pixels,
+  std::vector<cv::Point2f>& undistorted,
+  const cv::Matx33d& new_matrix
+) const {
+  undistort(pixels, undistorted);
+  for (cv::Point2f& point : undistorted) {
+    const cv::Vec3d projected = new_matrix * cv::Vec3d{point.x, point.y, 1.0};
+    point.x = static_cast<float>(projected[0] / projected[2]);
+    point.y = static_cast<float>(projected[1] / projected[2]);
+  }
+}
+
+void PointUndistorter::_undistort_exact(
+  const std::vector<cv::Point2f>& pixels,
+  std::vector<cv::Point2f>& normalized
+) const {
+  if (pixels.empty()) {
+    normalized.clear();
+    return;
+  }
+  cv::undistortPoints(pixels, normalized, _matrix, _distortion);
+}
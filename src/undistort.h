@@ -0,0 +1,65 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "src/cameras.h"
+
+/**
+ * Removes lens distortion from keypoints for a single camera.
+ *
+ * Without a grid every batch goes through one `cv::undistortPoints` call. With
+ * a grid the normalized coordinates are precomputed every `grid_step` pixels
+ * over the image and points are looked up with bilinear interpolation,
+ * falling back to the exact solve for points outside the image.
+ */
+class PointUndistorter {
+public:
+  PointUndistorter() = default;
+  ~PointUndistorter() = default;
+  PointUndistorter(const PointUndistorter&) = default;
+  PointUndistorter(PointUndistorter&&) = default;
+  PointUndistorter& operator=(const PointUndistorter&) = default;
+  PointUndistorter& operator=(PointUndistorter&&) = default;
+
+  explicit PointUndistorter(const CameraParameters& parameters);
+  PointUndistorter(
+    const CameraParameters& parameters,
+    cv::Size image_size,
+    int grid_step
+  );
+
+  bool has_grid() const { return !_grid.empty(); }
+
+  /**
+   * Converts distorted pixel coordinates into undistorted normalized image
+   * coordinates, i.e. the x and y of the ray through each pixel at z = 1.
+   */
+  void undistort(
+    const std::vector<cv::Point2f>& pixels,
+    std::vector<cv::Point2f>& normalized
+  ) const;
+
+  /**
+   * Converts distorted pixel coordinates into undistorted pixel coordinates
+   * for a camera with the given matrix, such as `Rectifier::optimal_matrix()`.
+   */
+  void undistort(
+    const std::vector<cv::Point2f>& pixels,
+    std::vector<cv::Point2f>& undistorted,
+    const cv::Matx33d& new_matrix
+  ) const;
+
+private:
+  void _undistort_exact(
+    const std::vector<cv::Point2f>& pixels,
+    std::vector<cv::Point2f>& normalized
+  ) const;
+
+  cv::Mat _matrix;
+  cv::Mat _distortion;
+  int _grid_step = 0;
+  int _grid_cols = 0;
+  int _grid_rows = 0;
+  std::vector<cv::Point2f> _grid;
+};
@@ -0,0 +1,103 @@
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/cameras.h"
+#include "src/undistort.h"
+
+namespace {
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+
+CameraParameters make_parameters() {
+  return CameraParameters{
+    .matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone(),
+    .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone()
+  };
+}
+
+// One frame's worth of BODY_25 keypoints for a handful of people.
+std::vector<cv::Point2f> random_pixels(std::size_t count) {
+  std::mt19937 rng{5};
+  std::uniform_real_distribution<float> x{0.0f, IMAGE_SIZE.width - 1.0f};
+  std::uniform_real_distribution<float> y{0.0f, IMAGE_SIZE.height - 1.0f};
+  std::vector<cv::Point2f> pixels;
+  for (std::size_t i = 0; i < count; ++i) pixels.emplace_back(x(rng), y(rng));
+  return pixels;
+}
+
+/**
+ * Baseline: one `cv::undistortPoints` call per point, as `to_ray` used to.
+ */
+void BM_UndistortPerPoint(benchmark::State& state) {
+  const CameraParameters parameters = make_parameters();
+  const std::vector<cv::Point2f> pixels = random_pixels(state.range(0));
+  std::vector<cv::Point2f> single(1);
+  std::vector<cv::Point2f> normalized;
+  for (auto _ : state) {
+    for (const cv::Point2f& pixel : pixels) {
+      single[0] = pixel;
+      cv::undistortPoints(
+        single,
+        normalized,
+        parameters.matrix,
+        parameters.distortion
+      );
+      benchmark::DoNotOptimize(normalized.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pixels.size());
+}
+BENCHMARK(BM_UndistortPerPoint)->Arg(25)->Arg(100)->Arg(1'000);
+
+void BM_UndistortBatch(benchmark::State& state) {
+  PointUndistorter undistorter{make_parameters()};
+  const std::vector<cv::Point2f> pixels = random_pixels(state.range(0));
+  std::vector<cv::Point2f> normalized;
+  for (auto _ : state) {
+    undistorter.undistort(pixels, normalized);
+    benchmark::DoNotOptimize(normalized.data());
+  }
+  state.SetItemsProcessed(state.iterations() * pixels.size());
+}
+BENCHMARK(BM_UndistortBatch)->Arg(25)->Arg(100)->Arg(1'000);
+
+void BM_UndistortGrid(benchmark::State& state) {
+  PointUndistorter undistorter{make_parameters(), IMAGE_SIZE, 8};
+  const std::vector<cv::Point2f> pixels = random_pixels(state.range(0));
+  std::vector<cv::Point2f> normalized;
+  for (auto _ : state) {
+    undistorter.undistort(pixels, normalized);
+    benchmark::DoNotOptimize(normalized.data());
+  }
+  state.SetItemsProcessed(state.iterations() * pixels.size());
+}
+BENCHMARK(BM_UndistortGrid)->Arg(25)->Arg(100)->Arg(1'000);
+
+void BM_BuildGrid(benchmark::State& state) {
+  const CameraParameters parameters = make_parameters();
+  for (auto _ : state) {
+    PointUndistorter undistorter{
+      parameters,
+      IMAGE_SIZE,
+      static_cast<int>(state.range(0))
+    };
+    benchmark::DoNotOptimize(undistorter);
+  }
+}
+BENCHMARK(BM_BuildGrid)->Arg(4)->Arg(8)->Arg(16)->Unit(benchmark::kMillisecond);
+
+}
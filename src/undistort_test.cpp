@@ -0,0 +1,112 @@
+#include "src/undistort.h"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/cameras.h"
+
+namespace {
+
+// Intrinsics of a Logitech C920 at 1920x1080.
+double c920_matrix[] = {
+  1.4611308193324010e+03, 0.0, 9.6725501506486341e+02,
+  0.0, 1.4611308193324010e+03, 5.5545825804372771e+02,
+  0.0, 0.0, 1.0
+};
+double c920_distortion[] = {
+  4.2761294057302876e-02, -1.8215867310222439e-01,
+  0.0, 0.0, 1.2308737273214458e-01
+};
+
+const cv::Size IMAGE_SIZE{1920, 1080};
+
+CameraParameters make_parameters() {
+  return CameraParameters{
+    .matrix = cv::Mat{3, 3, CV_64F, c920_matrix}.clone(),
+    .distortion = cv::Mat{1, 5, CV_64F, c920_distortion}.clone()
+  };
+}
+
+std::vector<cv::Point2f> random_pixels(std::size_t count) {
+  std::mt19937 rng{5};
+  std::uniform_real_distribution<float> x{0.0f, IMAGE_SIZE.width - 1.0f};
+  std::uniform_real_distribution<float> y{0.0f, IMAGE_SIZE.height - 1.0f};
+  std::vector<cv::Point2f> pixels;
+  for (std::size_t i = 0; i < count; ++i) pixels.emplace_back(x(rng), y(rng));
+  return pixels;
+}
+
+TEST(PointUndistorter, BatchMatchesPerPoint) {
+  const CameraParameters parameters = make_parameters();
+  PointUndistorter undistorter{parameters};
+  ASSERT_FALSE(undistorter.has_grid());
+
+  std::vector<cv::Point2f> pixels = random_pixels(100);
+  std::vector<cv::Point2f> normalized;
+  undistorter.undistort(pixels, normalized);
+  ASSERT_EQ(normalized.size(), pixels.size());
+
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    std::vector<cv::Point2f> expected;
+    cv::undistortPoints(
+      std::vector<cv::Point2f>{pixels[i]},
+      expected,
+      parameters.matrix,
+      parameters.distortion
+    );
+    EXPECT_FLOAT_EQ(normalized[i].x, expected[0].x);
+    EXPECT_FLOAT_EQ(normalized[i].y, expected[0].y);
+  }
+}
+
+TEST(PointUndistorter, GridIsSubPixelAccurate) {
+  const CameraParameters parameters = make_parameters();
+  PointUndistorter exact{parameters};
+  PointUndistorter grid{parameters, IMAGE_SIZE, 8};
+  ASSERT_TRUE(grid.has_grid());
+
+  std::vector<cv::Point2f> pixels = random_pixels(10'000);
+  std::vector<cv::Point2f> expected;
+  std::vector<cv::Point2f> actual;
+  const cv::Matx33d matrix{c920_matrix};
+  exact.undistort(pixels, expected, matrix);
+  grid.undistort(pixels, actual, matrix);
+
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    EXPECT_LT(cv::norm(expected[i] - actual[i]), 0.1)
+      << "Pixel " << pixels[i];
+  }
+}
+
+TEST(PointUndistorter, GridFallsBackOutsideImage) {
+  const CameraParameters parameters = make_parameters();
+  PointUndistorter exact{parameters};
+  PointUndistorter grid{parameters, IMAGE_SIZE, 16};
+
+  std::vector<cv::Point2f> pixels = {
+    {-20.0f, 500.0f},
+    {960.0f, 540.0f},
+    {2000.0f, 1200.0f}
+  };
+  std::vector<cv::Point2f> expected;
+  std::vector<cv::Point2f> actual;
+  exact.undistort(pixels, expected);
+  grid.undistort(pixels, actual);
+
+  EXPECT_FLOAT_EQ(actual[0].x, expected[0].x);
+  EXPECT_FLOAT_EQ(actual[0].y, expected[0].y);
+  EXPECT_FLOAT_EQ(actual[2].x, expected[2].x);
+  EXPECT_FLOAT_EQ(actual[2].y, expected[2].y);
+}
+
+TEST(PointUndistorter, EmptyBatch) {
+  PointUndistorter undistorter{make_parameters(), IMAGE_SIZE, 8};
+  std::vector<cv::Point2f> normalized = {{1.0f, 1.0f}};
+  undistorter.undistort({}, normalized);
+  EXPECT_TRUE(normalized.empty());
+}
+
+}
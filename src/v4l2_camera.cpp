@@ -0,0 +1,380 @@
+#include "src/v4l2_camera.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/videodev2.h>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+constexpr ::v4l2_buf_type BUF_TYPE = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+int xioctl(int fd, unsigned long request, void* arg) {
+  int res;
+  do {
+    res = ::ioctl(fd, request, arg);
+  } while (res == -1 && errno == EINTR);
+  return res;
+}
+
+[[noreturn]] void throw_errno(const std::string& message) {
+  throw std::runtime_error(message + ": " + ::strerror(errno));
+}
+
+std::vector<std::uint32_t> supported_fourccs(int fd) {
+  std::vector<std::uint32_t> fourccs;
+  ::v4l2_fmtdesc description{};
+  description.type = BUF_TYPE;
+  while (xioctl(fd, VIDIOC_ENUM_FMT, &description) == 0) {
+    fourccs.push_back(description.pixelformat);
+    ++description.index;
+  }
+  return fourccs;
+}
+
+}
+
+struct V4L2Device {
+  struct Buffer {
+    void* data = MAP_FAILED;
+    std::size_t length = 0;
+    int dmabuf_fd = -1;
+  };
+
+  ~V4L2Device() {
+    stop();
+    for (Buffer& buffer : buffers) {
+      if (buffer.dmabuf_fd >= 0) ::close(buffer.dmabuf_fd);
+      if (buffer.data != MAP_FAILED) ::munmap(buffer.data, buffer.length);
+    }
+    if (fd >= 0) ::close(fd);
+  }
+
+  void stop() {
+    if (!streaming.exchange(false)) return;
+    ::v4l2_buf_type type = BUF_TYPE;
+    xioctl(fd, VIDIOC_STREAMOFF, &type);
+  }
+
+  void queue(std::uint32_t index) {
+    ::v4l2_buffer buf{};
+    buf.type = BUF_TYPE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    if (xioctl(fd, VIDIOC_QBUF, &buf) == -1) {
+      throw_errno("Failed to queue capture buffer");
+    }
+  }
+
+  int fd = -1;
+  std::vector<Buffer> buffers;
+  std::atomic_bool streaming = false;
+  std::atomic_bool disconnected = false;
+};
+
+struct V4L2Frame::Lease {
+  ~Lease() {
+    // Once streaming stops the driver has let go of every buffer already.
+    if (!device->streaming) return;
+    try {
+      device->queue(index);
+    } catch (const std::runtime_error&) {
+      // The buffer stays out of rotation, reads will time out sooner.
+    }
+  }
+
+  std::shared_ptr<V4L2Device> device;
+  std::uint32_t index;
+};
+
+std::string to_string(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::MJPEG: return "MJPEG";
+    case PixelFormat::YUYV: return "YUYV";
+  }
+  return "unknown";
+}
+
+std::uint32_t to_fourcc(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::MJPEG: return V4L2_PIX_FMT_MJPEG;
+    case PixelFormat::YUYV: return V4L2_PIX_FMT_YUYV;
+  }
+  throw std::invalid_argument("Unknown pixel format.");
+}
+
+cv::Mat V4L2Frame::decode() const {
+  cv::Mat bgr;
+  if (_image.empty()) return bgr;
+  if (_format == PixelFormat::MJPEG) {
+    bgr = cv::imdecode(_image, cv::IMREAD_COLOR);
+  } else {
+    cv::cvtColor(_image, bgr, cv::COLOR_YUV2BGR_YUYV);
+  }
+  return bgr;
+}
+
+void V4L2Frame::release() {
+  _image.release();
+  _lease.reset();
+  _dmabuf_fd = -1;
+}
+
+V4L2Camera::V4L2Camera(
+  const std::filesystem::path& device_path,
+  V4L2CameraOptions options
+):
+  _device{std::make_shared<V4L2Device>()}
+{
+  V4L2Device& device = *_device;
+  device.fd = ::open(device_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (device.fd == -1) throw_errno("Failed to open " + device_path.string());
+
+  ::v4l2_capability capability{};
+  if (xioctl(device.fd, VIDIOC_QUERYCAP, &capability) == -1) {
+    throw_errno(device_path.string() + " is not a V4L2 device");
+  }
+  const std::uint32_t caps =
+    (capability.capabilities & V4L2_CAP_DEVICE_CAPS)
+      ? capability.device_caps
+      : capability.capabilities;
+  if ((caps & V4L2_CAP_VIDEO_CAPTURE) == 0) {
+    throw std::runtime_error(device_path.string() + " cannot capture video.");
+  }
+  if ((caps & V4L2_CAP_STREAMING) == 0) {
+    throw std::runtime_error(device_path.string() + " cannot stream.");
+  }
+  _driver = reinterpret_cast<const char*>(capability.driver);
+  _card = reinterpret_cast<const char*>(capability.card);
+
+  // Negotiate the first preferred format the device offers.
+  const std::vector<std::uint32_t> fourccs = supported_fourccs(device.fd);
+  auto format_itr = std::find_if(
+    options.formats.begin(),
+    options.formats.end(),
+    [&](PixelFormat format) {
+      return std::count(fourccs.begin(), fourccs.end(), to_fourcc(format));
+    }
+  );
+  if (format_itr == options.formats.end()) {
+    throw std::runtime_error(
+      device_path.string() + " supports none of the requested formats."
+    );
+  }
+
+  ::v4l2_format format{};
+  format.type = BUF_TYPE;
+  format.fmt.pix.width = options.image_size.width;
+  format.fmt.pix.height = options.image_size.height;
+  format.fmt.pix.pixelformat = to_fourcc(*format_itr);
+  format.fmt.pix.field = V4L2_FIELD_NONE;
+  if (xioctl(device.fd, VIDIOC_S_FMT, &format) == -1) {
+    throw_errno("Failed to set video format");
+  }
+  // The driver picks the nearest size it supports and may refuse the format.
+  if (format.fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG) {
+    _format = PixelFormat::MJPEG;
+  } else if (format.fmt.pix.pixelformat == V4L2_PIX_FMT_YUYV) {
+    _format = PixelFormat::YUYV;
+  } else {
+    throw std::runtime_error("Driver switched to an unsupported format.");
+  }
+  _image_size = cv::Size{
+    static_cast<int>(format.fmt.pix.width),
+    static_cast<int>(format.fmt.pix.height)
+  };
+  // Rows may be padded past the image width.
+  if (_format == PixelFormat::YUYV) {
+    _bytes_per_line = format.fmt.pix.bytesperline;
+  }
+
+  ::v4l2_streamparm parameters{};
+  parameters.type = BUF_TYPE;
+  parameters.parm.capture.timeperframe.numerator = 1000;
+  parameters.parm.capture.timeperframe.denominator =
+    static_cast<std::uint32_t>(std::lround(options.fps * 1000));
+  if (xioctl(device.fd, VIDIOC_S_PARM, &parameters) == 0) {
+    const ::v4l2_fract& frame_time = parameters.parm.capture.timeperframe;
+    if (frame_time.numerator > 0) {
+      _fps = static_cast<double>(frame_time.denominator) / frame_time.numerator;
+    }
+  }
+
+  ::v4l2_requestbuffers request{};
+  request.count = options.buffer_count;
+  request.type = BUF_TYPE;
+  request.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(device.fd, VIDIOC_REQBUFS, &request) == -1) {
+    throw_errno("Failed to request capture buffers");
+  }
+  if (request.count < 2) {
+    throw std::runtime_error("Not enough capture buffers available.");
+  }
+
+  device.buffers.resize(request.count);
+  for (std::uint32_t i = 0; i < request.count; ++i) {
+    ::v4l2_buffer buf{};
+    buf.type = BUF_TYPE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+    if (xioctl(device.fd, VIDIOC_QUERYBUF, &buf) == -1) {
+      throw_errno("Failed to query capture buffer");
+    }
+
+    V4L2Device::Buffer& buffer = device.buffers[i];
+    buffer.length = buf.length;
+    buffer.data = ::mmap(
+      nullptr,
+      buf.length,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED,
+      device.fd,
+      buf.m.offset
+    );
+    if (buffer.data == MAP_FAILED) throw_errno("Failed to map capture buffer");
+
+    if (options.export_dmabuf) {
+      ::v4l2_exportbuffer exported{};
+      exported.type = BUF_TYPE;
+      exported.index = i;
+      exported.flags = O_RDONLY | O_CLOEXEC;
+      if (xioctl(device.fd, VIDIOC_EXPBUF, &exported) == -1) {
+        throw_errno("Failed to export capture buffer");
+      }
+      buffer.dmabuf_fd = exported.fd;
+    }
+    device.queue(i);
+  }
+
+  ::v4l2_buf_type type = BUF_TYPE;
+  if (xioctl(device.fd, VIDIOC_STREAMON, &type) == -1) {
+    throw_errno("Failed to start video stream");
+  }
+  device.streaming = true;
+}
+
+V4L2Camera::~V4L2Camera() {
+  // Frames still held keep the buffers mapped until they are released.
+  if (_device) _device->stop();
+}
+
+bool V4L2Camera::disconnected() const {
+  return _device->disconnected;
+}
+
+int V4L2Camera::fd() const {
+  return _device->fd;
+}
+
+std::optional<V4L2Frame> V4L2Camera::read(std::chrono::milliseconds timeout) {
+  if (_device->disconnected) return std::nullopt;
+  ::pollfd poll_fd{.fd = _device->fd, .events = POLLIN};
+  const steady_clock::time_point deadline = steady_clock::now() + timeout;
+  ::v4l2_buffer buf{};
+  while (true) {
+    const auto remaining =
+      duration_cast<std::chrono::milliseconds>(deadline - steady_clock::now());
+    const int res = ::poll(
+      &poll_fd,
+      1,
+      static_cast<int>(std::max<std::int64_t>(remaining.count(), 0))
+    );
+    if (res == -1) {
+      if (errno == EINTR) continue;
+      throw_errno("Failed to poll camera");
+    }
+    if (res == 0) return std::nullopt;
+    if (poll_fd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+      // Unplugged devices fail every request from then on.
+      ::v4l2_capability capability{};
+      if (
+        xioctl(_device->fd, VIDIOC_QUERYCAP, &capability) == -1 &&
+        errno == ENODEV
+      ) {
+        _device->disconnected = true;
+        return std::nullopt;
+      }
+      // Also reported while every buffer is held by the caller.
+      if (steady_clock::now() >= deadline) return std::nullopt;
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      continue;
+    }
+
+    buf = {};
+    buf.type = BUF_TYPE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(_device->fd, VIDIOC_DQBUF, &buf) == -1) {
+      if (errno == ENODEV) {
+        _device->disconnected = true;
+        return std::nullopt;
+      }
+      if (errno != EAGAIN) throw_errno("Failed to dequeue capture buffer");
+      continue;
+    }
+
+    // Corrupt frames go straight back to the driver.
+    if ((buf.flags & V4L2_BUF_FLAG_ERROR) == 0) break;
+    _device->queue(buf.index);
+  }
+
+  V4L2Frame frame;
+  frame._lease = std::make_shared<V4L2Frame::Lease>(
+    V4L2Frame::Lease{.device = _device, .index = buf.index}
+  );
+
+  const V4L2Device::Buffer& buffer = _device->buffers[buf.index];
+  if (_format == PixelFormat::MJPEG) {
+    frame._image = cv::Mat{
+      1,
+      static_cast<int>(buf.bytesused),
+      CV_8U,
+      buffer.data
+    };
+  } else {
+    frame._image =
+      cv::Mat{_image_size, CV_8UC2, buffer.data, _bytes_per_line};
+  }
+  frame._format = _format;
+  frame._image_size = _image_size;
+  frame._sequence = buf.sequence;
+  frame._dmabuf_fd = buffer.dmabuf_fd;
+
+  // Monotonic kernel timestamps share steady_clock's epoch on Linux.
+  if (
+    (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+    V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+  ) {
+    frame._timestamp = steady_clock::time_point{
+      duration_cast<steady_clock::duration>(
+        seconds{buf.timestamp.tv_sec} + microseconds{buf.timestamp.tv_usec}
+      )
+    };
+  } else {
+    frame._timestamp = steady_clock::now();
+  }
+  return frame;
+}
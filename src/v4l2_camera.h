@@ -0,0 +1,167 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class PixelFormat {
+  MJPEG,
+  YUYV
+};
+
+std::string to_string(PixelFormat format);
+
+/**
+ * V4L2 fourcc of the format, such as `V4L2_PIX_FMT_MJPEG`.
+ */
+std::uint32_t to_fourcc(PixelFormat format);
+
+// Open device and its buffers, shared by a camera and its frames.
+struct V4L2Device;
+
+struct V4L2CameraOptions {
+  cv::Size image_size{1920, 1080};
+
+  // Formats to try, most preferred first. MJPEG keeps USB bandwidth low
+  // enough for 1080p at 30 fps, YUYV skips decoding.
+  std::vector<PixelFormat> formats = {PixelFormat::MJPEG, PixelFormat::YUYV};
+
+  double fps = 30.0;
+
+  // Buffers shared with the driver. Frames held by the caller keep their
+  // buffer out of rotation until released.
+  unsigned int buffer_count = 4;
+
+  // Export each buffer as a DMABUF file descriptor so frames can be handed to
+  // other devices without copying.
+  bool export_dmabuf = false;
+};
+
+/**
+ * A captured frame borrowed from the driver.
+ *
+ * `image()` is a view straight into the driver's buffer. The buffer goes back
+ * to the driver once the last copy of the frame is destroyed, so the view
+ * must not outlive the frame; `clone()` or `decode()` it to keep the pixels.
+ */
+class V4L2Frame {
+public:
+  V4L2Frame() = default;
+  ~V4L2Frame() = default;
+  V4L2Frame(const V4L2Frame&) = default;
+  V4L2Frame(V4L2Frame&&) = default;
+  V4L2Frame& operator=(const V4L2Frame&) = default;
+  V4L2Frame& operator=(V4L2Frame&&) = default;
+
+  /**
+   * Raw frame data. YUYV frames are `CV_8UC2` at the image size, MJPEG
+   * frames are a single `CV_8U` row holding the compressed bytes.
+   */
+  const cv::Mat& image() const { return _image; }
+
+  PixelFormat format() const { return _format; }
+  cv::Size image_size() const { return _image_size; }
+
+  /**
+   * Driver frame counter. Gaps mean frames were dropped before dequeue.
+   */
+  std::uint32_t sequence() const { return _sequence; }
+
+  /**
+   * When the driver finished receiving the frame, on the same clock as
+   * `std::chrono::steady_clock`.
+   */
+  std::chrono::steady_clock::time_point timestamp() const { return _timestamp; }
+
+  /**
+   * DMABUF file descriptor of the frame's buffer, or -1 when not exported.
+   * Owned by the camera.
+   */
+  int dmabuf_fd() const { return _dmabuf_fd; }
+
+  /**
+   * Converts the frame to a newly allocated BGR image.
+   */
+  cv::Mat decode() const;
+
+  /**
+   * Returns the buffer to the driver early. The frame is empty afterwards.
+   */
+  void release();
+
+private:
+  friend class V4L2Camera;
+  struct Lease;
+
+  std::shared_ptr<Lease> _lease;
+  cv::Mat _image;
+  PixelFormat _format = PixelFormat::YUYV;
+  cv::Size _image_size;
+  std::uint32_t _sequence = 0;
+  std::chrono::steady_clock::time_point _timestamp;
+  int _dmabuf_fd = -1;
+};
+
+/**
+ * Streams frames from a V4L2 capture device through memory mapped buffers.
+ */
+class V4L2Camera {
+public:
+  V4L2Camera(
+    const std::filesystem::path& device_path,
+    V4L2CameraOptions options = {}
+  );
+  ~V4L2Camera();
+  V4L2Camera(V4L2Camera&&) = default;
+  V4L2Camera& operator=(V4L2Camera&&) = default;
+  V4L2Camera(const V4L2Camera&) = delete;
+  V4L2Camera& operator=(const V4L2Camera&) = delete;
+
+  /**
+   * Waits up to `timeout` for the next frame, skipping any the driver flags
+   * as corrupt. Returns nothing on timeout, including when every buffer is
+   * still held by outstanding frames, and once the device is disconnected.
+   */
+  std::optional<V4L2Frame> read(
+    std::chrono::milliseconds timeout = std::chrono::milliseconds{1000}
+  );
+
+  /**
+   * Format and size agreed with the driver, which may differ from the
+   * requested ones.
+   */
+  PixelFormat format() const { return _format; }
+  cv::Size image_size() const { return _image_size; }
+  double fps() const { return _fps; }
+
+  /**
+   * Whether the device has gone away, such as by being unplugged. Nothing
+   * more will be read from it.
+   */
+  bool disconnected() const;
+
+  /**
+   * Device file descriptor, readable when a frame is ready. For waiting on
+   * several cameras at once with `poll` or `epoll`.
+   */
+  int fd() const;
+
+  const std::string& driver() const { return _driver; }
+  const std::string& card() const { return _card; }
+
+private:
+  std::shared_ptr<V4L2Device> _device;
+  PixelFormat _format = PixelFormat::YUYV;
+  cv::Size _image_size;
+  // Row stride of uncompressed frames, 0 if rows are packed.
+  std::size_t _bytes_per_line = 0;
+  double _fps = 0.0;
+  std::string _driver;
+  std::string _card;
+};
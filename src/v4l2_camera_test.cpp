@@ -0,0 +1,133 @@
+#include "src/v4l2_camera.h"
+
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/videodev2.h>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+
+const cv::Size IMAGE_SIZE{640, 480};
+
+/**
+ * Finds a capture node of the virtual video test driver. Load it with
+ * `sudo modprobe vivid` to run these tests.
+ */
+std::optional<std::filesystem::path> find_vivid_device() {
+  for (const auto& entry : std::filesystem::directory_iterator{"/dev"}) {
+    if (entry.path().filename().string().rfind("video", 0) != 0) continue;
+    const int fd = ::open(entry.path().c_str(), O_RDWR | O_NONBLOCK);
+    if (fd == -1) continue;
+    ::v4l2_capability capability{};
+    const bool is_vivid_capture =
+      ::ioctl(fd, VIDIOC_QUERYCAP, &capability) == 0 &&
+      std::strcmp(reinterpret_cast<const char*>(capability.driver), "vivid")
+        == 0 &&
+      (capability.device_caps & V4L2_CAP_VIDEO_CAPTURE);
+    ::close(fd);
+    if (is_vivid_capture) return entry.path();
+  }
+  return std::nullopt;
+}
+
+class V4L2CameraTest : public testing::Test {
+protected:
+  void SetUp() override {
+    std::optional<std::filesystem::path> device = find_vivid_device();
+    if (!device) GTEST_SKIP() << "vivid driver is not loaded.";
+    _device_path = *device;
+  }
+
+  V4L2Camera open(unsigned int buffer_count = 4) {
+    return V4L2Camera{
+      _device_path,
+      {
+        .image_size = IMAGE_SIZE,
+        .formats = {PixelFormat::YUYV},
+        .buffer_count = buffer_count
+      }
+    };
+  }
+
+  std::filesystem::path _device_path;
+};
+
+TEST(V4L2Camera, RejectsMissingDevice) {
+  EXPECT_THROW(V4L2Camera{"/dev/does-not-exist"}, std::runtime_error);
+}
+
+TEST_F(V4L2CameraTest, NegotiatesFormat) {
+  V4L2Camera camera = open();
+  EXPECT_EQ(camera.driver(), "vivid");
+  EXPECT_EQ(camera.format(), PixelFormat::YUYV);
+  EXPECT_EQ(camera.image_size(), IMAGE_SIZE);
+  EXPECT_GT(camera.fps(), 0.0);
+  EXPECT_GE(camera.fd(), 0);
+}
+
+TEST_F(V4L2CameraTest, ReadsFramesInOrder) {
+  V4L2Camera camera = open();
+  std::optional<V4L2Frame> previous = camera.read();
+  ASSERT_TRUE(previous);
+  for (int i = 0; i < 5; ++i) {
+    std::optional<V4L2Frame> frame = camera.read();
+    ASSERT_TRUE(frame);
+    EXPECT_GT(frame->sequence(), previous->sequence());
+    EXPECT_GT(frame->timestamp(), previous->timestamp());
+    EXPECT_LE(frame->timestamp(), std::chrono::steady_clock::now());
+    previous = std::move(frame);
+  }
+}
+
+TEST_F(V4L2CameraTest, ImageViewsDriverBuffer) {
+  V4L2Camera camera = open();
+  std::optional<V4L2Frame> frame = camera.read();
+  ASSERT_TRUE(frame);
+  EXPECT_EQ(frame->image().type(), CV_8UC2);
+  EXPECT_EQ(frame->image().size(), IMAGE_SIZE);
+  EXPECT_FALSE(frame->image().u) << "Image should not own its pixels.";
+
+  const cv::Mat bgr = frame->decode();
+  EXPECT_EQ(bgr.type(), CV_8UC3);
+  EXPECT_EQ(bgr.size(), IMAGE_SIZE);
+}
+
+TEST_F(V4L2CameraTest, HeldFramesKeepBuffersFromDriver) {
+  V4L2Camera camera = open(2);
+  std::vector<V4L2Frame> held;
+  while (std::optional<V4L2Frame> frame = camera.read(milliseconds{500})) {
+    held.push_back(std::move(*frame));
+    ASSERT_LE(held.size(), 8);
+  }
+  ASSERT_FALSE(held.empty());
+
+  // Handing one back lets capture continue.
+  held.front().release();
+  EXPECT_TRUE(held.front().image().empty());
+  EXPECT_TRUE(camera.read());
+}
+
+TEST_F(V4L2CameraTest, FramesOutliveCamera) {
+  std::optional<V4L2Frame> frame;
+  {
+    V4L2Camera camera = open();
+    frame = camera.read();
+    ASSERT_TRUE(frame);
+  }
+  EXPECT_EQ(frame->decode().size(), IMAGE_SIZE);
+}
+
+}
@@ -0,0 +1,303 @@
+#include "src/video_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+void check_av(int res, const std::string& message) {
+  if (res >= 0) return;
+  char error[AV_ERROR_MAX_STRING_SIZE] = {0};
+  ::av_strerror(res, error, sizeof(error));
+  throw std::runtime_error(message + ": " + error);
+}
+
+double to_fps(::AVRational rate) {
+  return rate.num > 0 && rate.den > 0 ? ::av_q2d(rate) : 0.0;
+}
+
+}
+
+struct VideoDecoder {
+  explicit VideoDecoder(const std::filesystem::path& path) {
+    try {
+      open(path);
+    } catch (...) {
+      reset();
+      throw;
+    }
+  }
+
+  ~VideoDecoder() { reset(); }
+
+  void open(const std::filesystem::path& path) {
+    check_av(
+      ::avformat_open_input(&format, path.c_str(), nullptr, nullptr),
+      "Failed to open " + path.string()
+    );
+    check_av(
+      ::avformat_find_stream_info(format, nullptr),
+      "Failed to read stream info from " + path.string()
+    );
+    const ::AVCodec* av_codec = nullptr;
+    const int stream_index = ::av_find_best_stream(
+      format,
+      AVMEDIA_TYPE_VIDEO,
+      -1,
+      -1,
+      &av_codec,
+      0
+    );
+    check_av(stream_index, "No video stream in " + path.string());
+    stream = format->streams[stream_index];
+
+    codec = ::avcodec_alloc_context3(av_codec);
+    frame = ::av_frame_alloc();
+    packet = ::av_packet_alloc();
+    if (!codec || !frame || !packet) {
+      throw std::runtime_error("Failed to allocate FFmpeg resources.");
+    }
+    check_av(
+      ::avcodec_parameters_to_context(codec, stream->codecpar),
+      "Failed to describe video codec"
+    );
+    // Let the codec use every core, across frames and within them.
+    codec->thread_count = 0;
+    codec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    check_av(
+      ::avcodec_open2(codec, av_codec, nullptr),
+      "Failed to open video codec"
+    );
+  }
+
+  /**
+   * Reads every packet of the video stream, returning its timestamp and
+   * whether it holds a keyframe. Leaves the demuxer at the end of the file.
+   */
+  std::vector<std::pair<std::int64_t, bool>> scan_packets() {
+    std::vector<std::pair<std::int64_t, bool>> packets;
+    while (true) {
+      const int res = ::av_read_frame(format, packet);
+      if (res == AVERROR_EOF) break;
+      check_av(res, "Failed to read video");
+      const std::int64_t pts =
+        packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+      if (packet->stream_index == stream->index && pts != AV_NOPTS_VALUE) {
+        packets.emplace_back(pts, (packet->flags & AV_PKT_FLAG_KEY) != 0);
+      }
+      ::av_packet_unref(packet);
+    }
+    return packets;
+  }
+
+  /**
+   * Decodes the next frame into `frame`. Returns false at the end of the
+   * video.
+   */
+  bool next_frame() {
+    while (true) {
+      int res = ::avcodec_receive_frame(codec, frame);
+      if (res >= 0) return true;
+      if (res == AVERROR_EOF) return false;
+      if (res != AVERROR(EAGAIN)) check_av(res, "Failed to decode frame");
+
+      res = ::av_read_frame(format, packet);
+      if (res == AVERROR_EOF) {
+        // Drain the frames still held by the codec.
+        check_av(
+          ::avcodec_send_packet(codec, nullptr),
+          "Failed to flush decoder"
+        );
+        continue;
+      }
+      check_av(res, "Failed to read video");
+      if (packet->stream_index == stream->index) {
+        res = ::avcodec_send_packet(codec, packet);
+      }
+      ::av_packet_unref(packet);
+      check_av(res, "Failed to decode packet");
+    }
+  }
+
+  std::int64_t frame_pts() const {
+    return frame->best_effort_timestamp != AV_NOPTS_VALUE
+      ? frame->best_effort_timestamp
+      : frame->pts;
+  }
+
+  cv::Mat to_mat() {
+    scaler = ::sws_getCachedContext(
+      scaler,
+      frame->width, frame->height,
+      static_cast<::AVPixelFormat>(frame->format),
+      frame->width, frame->height, AV_PIX_FMT_BGR24,
+      SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    if (!scaler) throw std::runtime_error("Failed to create pixel converter.");
+    cv::Mat image{frame->height, frame->width, CV_8UC3};
+    std::uint8_t* const destination[] = {image.data};
+    const int destination_stride[] = {static_cast<int>(image.step)};
+    ::sws_scale(
+      scaler,
+      frame->data,
+      frame->linesize,
+      0,
+      frame->height,
+      destination,
+      destination_stride
+    );
+    return image;
+  }
+
+  /**
+   * Moves the demuxer to the keyframe at or before `pts`.
+   */
+  void seek(std::int64_t pts) {
+    check_av(
+      ::av_seek_frame(format, stream->index, pts, AVSEEK_FLAG_BACKWARD),
+      "Failed to seek video"
+    );
+    ::avcodec_flush_buffers(codec);
+  }
+
+  void reset() {
+    ::sws_freeContext(scaler);
+    scaler = nullptr;
+    ::av_frame_free(&frame);
+    ::av_packet_free(&packet);
+    ::avcodec_free_context(&codec);
+    ::avformat_close_input(&format);
+  }
+
+  ::AVFormatContext* format = nullptr;
+  ::AVStream* stream = nullptr;
+  ::AVCodecContext* codec = nullptr;
+  ::AVFrame* frame = nullptr;
+  ::AVPacket* packet = nullptr;
+  ::SwsContext* scaler = nullptr;
+};
+
+bool is_video_file(const std::filesystem::path& path) {
+  const std::filesystem::path extension = path.extension();
+  return extension == ".mp4" || extension == ".mkv" || extension == ".avi" ||
+    extension == ".mov";
+}
+
+VideoReader::VideoReader(const std::filesystem::path& path):
+  _decoder{std::make_unique<VideoDecoder>(path)}
+{
+  const ::AVStream* stream = _decoder->stream;
+  _image_size = cv::Size{stream->codecpar->width, stream->codecpar->height};
+  _fps = to_fps(stream->avg_frame_rate);
+  if (_fps == 0.0) _fps = to_fps(stream->r_frame_rate);
+
+  // Frames are numbered in presentation order, which is not the order their
+  // packets are stored in when the codec uses B-frames.
+  const std::vector<std::pair<std::int64_t, bool>> packets =
+    _decoder->scan_packets();
+  for (const auto& [pts, keyframe] : packets) _frame_pts.push_back(pts);
+  std::sort(_frame_pts.begin(), _frame_pts.end());
+  _frame_pts.erase(
+    std::unique(_frame_pts.begin(), _frame_pts.end()),
+    _frame_pts.end()
+  );
+  if (_frame_pts.empty()) {
+    throw std::runtime_error("No frames in " + path.string());
+  }
+
+  // The start of the stream is always decodable, even if its first packet
+  // is not flagged as a keyframe.
+  _keyframes.push_back(0);
+  for (const auto& [pts, keyframe] : packets) {
+    if (!keyframe) continue;
+    _keyframes.push_back(
+      std::lower_bound(_frame_pts.begin(), _frame_pts.end(), pts) -
+      _frame_pts.begin()
+    );
+  }
+  std::sort(_keyframes.begin(), _keyframes.end());
+  _keyframes.erase(
+    std::unique(_keyframes.begin(), _keyframes.end()),
+    _keyframes.end()
+  );
+
+  _decoder->seek(_frame_pts.front());
+}
+
+VideoReader::~VideoReader() = default;
+VideoReader::VideoReader(VideoReader&&) = default;
+VideoReader& VideoReader::operator=(VideoReader&&) = default;
+
+std::optional<cv::Mat> VideoReader::read() {
+  if (_position >= frame_count()) return std::nullopt;
+  if (!_decode_to_position()) {
+    _position = frame_count();
+    return std::nullopt;
+  }
+  ++_position;
+  return _decoder->to_mat();
+}
+
+void VideoReader::seek(std::size_t frame) {
+  frame = std::min(frame, frame_count());
+  if (frame == _position) return;
+
+  // Decoding forward is cheaper than seeking while no keyframe is passed.
+  const auto next_keyframe =
+    std::upper_bound(_keyframes.begin(), _keyframes.end(), _position);
+  if (
+    frame > _position &&
+    (next_keyframe == _keyframes.end() || *next_keyframe > frame)
+  ) {
+    _position = frame;
+    return;
+  }
+
+  if (frame < frame_count()) {
+    const std::size_t keyframe =
+      *std::prev(std::upper_bound(_keyframes.begin(), _keyframes.end(), frame));
+    _decoder->seek(_frame_pts[keyframe]);
+  }
+  _position = frame;
+}
+
+std::chrono::microseconds VideoReader::timestamp(std::size_t frame) const {
+  const ::AVRational time_base = _decoder->stream->time_base;
+  return std::chrono::microseconds{::av_rescale_q(
+    _frame_pts.at(frame) - _frame_pts.front(),
+    time_base,
+    ::AVRational{1, 1'000'000}
+  )};
+}
+
+bool VideoReader::_decode_to_position() {
+  while (_decoder->next_frame()) {
+    const std::size_t index = std::lower_bound(
+      _frame_pts.begin(),
+      _frame_pts.end(),
+      _decoder->frame_pts()
+    ) - _frame_pts.begin();
+    if (index < _position) continue;
+
+    // Frames the decoder could not produce are skipped over.
+    _position = std::min(index, frame_count() - 1);
+    return true;
+  }
+  return false;
+}
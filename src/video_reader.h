@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <vector>
+
+/**
+ * File extensions of the video containers readers are expected to open.
+ */
+bool is_video_file(const std::filesystem::path& path);
+
+// Demuxer, codec and scaler state for an open video.
+struct VideoDecoder;
+
+/**
+ * Decodes a video file frame by frame, with random access.
+ *
+ * Opening the video scans its packets, without decoding them, to index every
+ * frame's timestamp and where the keyframes are. Seeking then jumps straight
+ * to the keyframe before the wanted frame and decodes only the frames between.
+ */
+class VideoReader {
+public:
+  explicit VideoReader(const std::filesystem::path& path);
+  ~VideoReader();
+  VideoReader(VideoReader&&);
+  VideoReader& operator=(VideoReader&&);
+  VideoReader(const VideoReader&) = delete;
+  VideoReader& operator=(const VideoReader&) = delete;
+
+  /**
+   * Decodes the frame at `position()` as an 8-bit BGR image. Returns nothing
+   * past the last frame.
+   */
+  std::optional<cv::Mat> read();
+
+  /**
+   * Makes `frame` the next one `read()` returns.
+   */
+  void seek(std::size_t frame);
+
+  std::size_t position() const { return _position; }
+  std::size_t frame_count() const { return _frame_pts.size(); }
+  cv::Size image_size() const { return _image_size; }
+  double fps() const { return _fps; }
+
+  /**
+   * Indices of the frames that can be decoded without any before them.
+   */
+  const std::vector<std::size_t>& keyframes() const { return _keyframes; }
+
+  /**
+   * Presentation time of the frame since the start of the video.
+   */
+  std::chrono::microseconds timestamp(std::size_t frame) const;
+
+private:
+  /**
+   * Decodes up to the frame at `_position`, skipping pixel conversion for the
+   * frames before it.
+   */
+  bool _decode_to_position();
+
+  std::unique_ptr<VideoDecoder> _decoder;
+  std::vector<std::int64_t> _frame_pts;
+  std::vector<std::size_t> _keyframes;
+  std::size_t _position = 0;
+  cv::Size _image_size;
+  double _fps = 0.0;
+};
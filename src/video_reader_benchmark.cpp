@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <random>
+
+#include "benchmark/benchmark.h"
+#include "src/frame_source.h"
+#include "src/video_reader.h"
+#include "src/video_writer.h"
+
+namespace {
+
+const std::filesystem::path BENCHMARK_DIR = "/tmp/benchmark/ar/video_reader";
+const cv::Size IMAGE_SIZE{1920, 1080};
+constexpr int FRAME_COUNT = 120;
+
+/**
+ * Four seconds of 1080p video with noise and motion, written once per codec.
+ */
+const std::filesystem::path& video_path(VideoCodec codec) {
+  static std::map<VideoCodec, std::filesystem::path> paths;
+  auto itr = paths.find(codec);
+  if (itr != paths.end()) return itr->second;
+
+  std::filesystem::create_directories(BENCHMARK_DIR);
+  const std::filesystem::path path =
+    BENCHMARK_DIR / ("video" + video_extension(codec));
+  VideoWriter writer{path, IMAGE_SIZE, {.codec = codec}};
+  cv::RNG rng{11};
+  cv::Mat base{IMAGE_SIZE, CV_8UC3};
+  rng.fill(base, cv::RNG::UNIFORM, 0, 255);
+  cv::GaussianBlur(base, base, {0, 0}, 8);
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    cv::Mat frame = base.clone();
+    frame.colRange(i * 8, i * 8 + 200).setTo(cv::Scalar{40, 200, 40});
+    writer.write(frame, start + std::chrono::milliseconds{33 * i});
+  }
+  writer.close();
+  return paths.emplace(codec, path).first->second;
+}
+
+void set_counters(benchmark::State& state, std::int64_t frames) {
+  state.counters["fps"] = benchmark::Counter(
+    static_cast<double>(frames),
+    benchmark::Counter::kIsRate
+  );
+  state.counters["pixels"] = benchmark::Counter(
+    static_cast<double>(frames) * IMAGE_SIZE.area(),
+    benchmark::Counter::kIsRate
+  );
+}
+
+void BM_Decode(benchmark::State& state) {
+  const std::filesystem::path& path =
+    video_path(static_cast<VideoCodec>(state.range(0)));
+  std::int64_t frames = 0;
+  for (auto _ : state) {
+    VideoReader reader{path};
+    while (std::optional<cv::Mat> image = reader.read()) {
+      benchmark::DoNotOptimize(image->data);
+      ++frames;
+    }
+  }
+  set_counters(state, frames);
+}
+BENCHMARK(BM_Decode)
+  ->ArgName("codec")
+  ->Arg(static_cast<int>(VideoCodec::H264))
+  ->Arg(static_cast<int>(VideoCodec::FFV1))
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// Decoding on the source's thread overlaps with the consumer's own work,
+// stood in for by a fixed amount of per-frame processing.
+void BM_DecodeAhead(benchmark::State& state) {
+  const std::filesystem::path& path =
+    video_path(static_cast<VideoCodec>(state.range(0)));
+  std::int64_t frames = 0;
+  for (auto _ : state) {
+    VideoFileSource source{path};
+    while (std::optional<Frame> frame = source.read()) {
+      cv::Mat gray;
+      cv::cvtColor(frame->image, gray, cv::COLOR_BGR2GRAY);
+      benchmark::DoNotOptimize(gray.data);
+      ++frames;
+    }
+  }
+  set_counters(state, frames);
+}
+BENCHMARK(BM_DecodeAhead)
+  ->ArgName("codec")
+  ->Arg(static_cast<int>(VideoCodec::H264))
+  ->Arg(static_cast<int>(VideoCodec::FFV1))
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+void BM_RandomSeek(benchmark::State& state) {
+  VideoReader reader{video_path(static_cast<VideoCodec>(state.range(0)))};
+  std::mt19937 rng{3};
+  std::uniform_int_distribution<std::size_t> frame{0, FRAME_COUNT - 1};
+  for (auto _ : state) {
+    reader.seek(frame(rng));
+    benchmark::DoNotOptimize(reader.read());
+  }
+}
+BENCHMARK(BM_RandomSeek)
+  ->ArgName("codec")
+  ->Arg(static_cast<int>(VideoCodec::H264))
+  ->Arg(static_cast<int>(VideoCodec::FFV1))
+  ->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,144 @@
+#include "src/video_reader.h"
+
+#include <chrono>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/frame_source.h"
+#include "src/video_writer.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/video_reader";
+const cv::Size IMAGE_SIZE{160, 120};
+constexpr int FRAME_COUNT = 20;
+constexpr int KEYFRAME_INTERVAL = 5;
+
+/**
+ * Each frame is filled with a shade unique to its index.
+ */
+int shade(int frame) {
+  return frame * 10;
+}
+
+/**
+ * Writes a lossless test video with a keyframe every few frames.
+ */
+path make_video() {
+  std::filesystem::create_directories(TEST_DIR);
+  const path video_path =
+    TEST_DIR / ("video" + video_extension(VideoCodec::FFV1));
+  if (std::filesystem::exists(video_path)) return video_path;
+
+  VideoWriter writer{
+    video_path,
+    IMAGE_SIZE,
+    {
+      .codec = VideoCodec::FFV1,
+      .fps = 30.0,
+      .keyframe_interval = KEYFRAME_INTERVAL
+    }
+  };
+  const steady_clock::time_point start = steady_clock::now();
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    writer.write(
+      cv::Mat{IMAGE_SIZE, CV_8UC3, cv::Scalar::all(shade(i))},
+      start + milliseconds{33 * i}
+    );
+  }
+  writer.close();
+  return video_path;
+}
+
+int shade_of(const cv::Mat& image) {
+  return image.at<cv::Vec3b>(image.rows / 2, image.cols / 2)[0];
+}
+
+TEST(VideoReader, IndexesFramesAndKeyframes) {
+  VideoReader reader{make_video()};
+  EXPECT_EQ(reader.frame_count(), FRAME_COUNT);
+  EXPECT_EQ(reader.image_size(), IMAGE_SIZE);
+  EXPECT_NEAR(reader.fps(), 30.0, 0.5);
+
+  ASSERT_FALSE(reader.keyframes().empty());
+  EXPECT_EQ(reader.keyframes().front(), 0);
+  EXPECT_GE(reader.keyframes().size(), FRAME_COUNT / KEYFRAME_INTERVAL);
+
+  EXPECT_EQ(reader.timestamp(0), milliseconds{0});
+  EXPECT_EQ(reader.timestamp(3), milliseconds{99});
+}
+
+TEST(VideoReader, ReadsFramesInOrder) {
+  VideoReader reader{make_video()};
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    EXPECT_EQ(reader.position(), i);
+    std::optional<cv::Mat> image = reader.read();
+    ASSERT_TRUE(image);
+    EXPECT_EQ(image->size(), IMAGE_SIZE);
+    EXPECT_EQ(image->type(), CV_8UC3);
+    EXPECT_EQ(shade_of(*image), shade(i));
+  }
+  EXPECT_FALSE(reader.read());
+}
+
+TEST(VideoReader, SeeksToAnyFrame) {
+  VideoReader reader{make_video()};
+  for (int frame : {13, 2, 7, 8, 19, 0, 5, 4}) {
+    reader.seek(frame);
+    EXPECT_EQ(reader.position(), frame);
+    std::optional<cv::Mat> image = reader.read();
+    ASSERT_TRUE(image) << "frame " << frame;
+    EXPECT_EQ(shade_of(*image), shade(frame)) << "frame " << frame;
+  }
+
+  reader.seek(FRAME_COUNT);
+  EXPECT_FALSE(reader.read());
+  reader.seek(1);
+  ASSERT_TRUE(reader.read());
+}
+
+TEST(VideoReader, RejectsMissingFile) {
+  EXPECT_THROW(VideoReader{TEST_DIR / "missing.mkv"}, std::runtime_error);
+}
+
+TEST(VideoFileSource, ReadsAheadInOrder) {
+  VideoFileSource source{make_video(), {.read_ahead = 3}};
+  EXPECT_EQ(source.frame_count(), FRAME_COUNT);
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    std::optional<Frame> frame = source.read();
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->frame_id, i);
+    EXPECT_EQ(shade_of(frame->image), shade(i));
+  }
+  EXPECT_FALSE(source.read());
+}
+
+TEST(VideoFileSource, SeeksAndLoops) {
+  VideoFileSource source{make_video(), {.loop = true}};
+  source.seek(FRAME_COUNT - 1);
+  std::optional<Frame> frame = source.read();
+  ASSERT_TRUE(frame);
+  EXPECT_EQ(frame->frame_id, FRAME_COUNT - 1);
+
+  frame = source.read();
+  ASSERT_TRUE(frame);
+  EXPECT_EQ(frame->frame_id, 0);
+  EXPECT_EQ(shade_of(frame->image), shade(0));
+}
+
+TEST(VideoFileSource, KeypointsNamedByFrame) {
+  const Frame frame{.frame_id = 12, .path = TEST_DIR / "video.mkv"};
+  EXPECT_EQ(keypoints_path(frame), TEST_DIR / "12.yml");
+  const Frame image{.frame_id = 0, .path = TEST_DIR / "7.png"};
+  EXPECT_EQ(keypoints_path(image), TEST_DIR / "7.yml");
+}
+
+}
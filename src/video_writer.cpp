@@ -0,0 +1,352 @@
+#include "src/video_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+// Packet timestamps are in milliseconds since the first frame.
+constexpr ::AVRational TIME_BASE{1, 1000};
+
+void check_av(int res, const std::string& message) {
+  if (res >= 0) return;
+  char error[AV_ERROR_MAX_STRING_SIZE] = {0};
+  ::av_strerror(res, error, sizeof(error));
+  throw std::runtime_error(message + ": " + error);
+}
+
+::AVPixelFormat to_input_format(int type) {
+  switch (type) {
+    case CV_8UC1: return AV_PIX_FMT_GRAY8;
+    case CV_8UC2: return AV_PIX_FMT_YUYV422;
+    case CV_8UC3: return AV_PIX_FMT_BGR24;
+  }
+  throw std::invalid_argument("Unsupported image type for video.");
+}
+
+/**
+ * Pixel format to encode in. H.264 players expect 4:2:0, FFV1 keeps the
+ * frames exactly as given.
+ */
+::AVPixelFormat to_codec_format(VideoCodec codec, int type) {
+  if (codec == VideoCodec::H264) return AV_PIX_FMT_YUV420P;
+  switch (type) {
+    case CV_8UC1: return AV_PIX_FMT_GRAY8;
+    case CV_8UC2: return AV_PIX_FMT_YUV422P;
+    default: return AV_PIX_FMT_0RGB32;
+  }
+}
+
+const ::AVCodec* find_codec(VideoCodec codec) {
+  const ::AVCodec* found = nullptr;
+  if (codec == VideoCodec::H264) {
+    found = ::avcodec_find_encoder_by_name("libx264");
+    if (!found) found = ::avcodec_find_encoder(AV_CODEC_ID_H264);
+  } else {
+    found = ::avcodec_find_encoder(AV_CODEC_ID_FFV1);
+  }
+  if (!found) throw std::runtime_error("Video codec is not available.");
+  return found;
+}
+
+}
+
+struct VideoEncoder {
+  VideoEncoder(
+    const std::filesystem::path& path,
+    cv::Size image_size,
+    int image_type,
+    const VideoWriterOptions& options
+  ):
+    input_format{to_input_format(image_type)}
+  {
+    try {
+      open(path, image_size, image_type, options);
+    } catch (...) {
+      reset();
+      throw;
+    }
+  }
+
+  ~VideoEncoder() { reset(); }
+
+  void open(
+    const std::filesystem::path& path,
+    cv::Size image_size,
+    int image_type,
+    const VideoWriterOptions& options
+  ) {
+    check_av(
+      ::avformat_alloc_output_context2(&format, nullptr, nullptr, path.c_str()),
+      "Failed to pick a container for " + path.string()
+    );
+
+    const ::AVCodec* av_codec = find_codec(options.codec);
+    stream = ::avformat_new_stream(format, nullptr);
+    codec = ::avcodec_alloc_context3(av_codec);
+    frame = ::av_frame_alloc();
+    packet = ::av_packet_alloc();
+    if (!stream || !codec || !frame || !packet) {
+      throw std::runtime_error("Failed to allocate FFmpeg resources.");
+    }
+
+    codec->width = image_size.width;
+    codec->height = image_size.height;
+    codec->pix_fmt = to_codec_format(options.codec, image_type);
+    codec->time_base = TIME_BASE;
+    codec->framerate = ::av_d2q(options.fps, 1000);
+    codec->gop_size = options.keyframe_interval;
+    codec->thread_count = options.threads;
+    if (format->oformat->flags & AVFMT_GLOBALHEADER) {
+      codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    if (options.codec == VideoCodec::H264) {
+      ::av_opt_set(codec->priv_data, "preset", options.preset.c_str(), 0);
+      ::av_opt_set_int(codec->priv_data, "crf", options.crf, 0);
+    } else {
+      // Version 3 adds slices, which FFV1 encodes in parallel, and checksums.
+      codec->level = 3;
+      ::av_opt_set_int(codec->priv_data, "slicecrc", 1, 0);
+    }
+    check_av(
+      ::avcodec_open2(codec, av_codec, nullptr),
+      "Failed to open video codec"
+    );
+    check_av(
+      ::avcodec_parameters_from_context(stream->codecpar, codec),
+      "Failed to describe video stream"
+    );
+    stream->time_base = codec->time_base;
+    stream->avg_frame_rate = codec->framerate;
+
+    if (!(format->oformat->flags & AVFMT_NOFILE)) {
+      check_av(
+        ::avio_open(&format->pb, path.c_str(), AVIO_FLAG_WRITE),
+        "Failed to open " + path.string()
+      );
+    }
+    check_av(
+      ::avformat_write_header(format, nullptr),
+      "Failed to write video header"
+    );
+
+    frame->format = codec->pix_fmt;
+    frame->width = codec->width;
+    frame->height = codec->height;
+    check_av(::av_frame_get_buffer(frame, 0), "Failed to allocate frame");
+
+    scaler = ::sws_getContext(
+      image_size.width, image_size.height, input_format,
+      image_size.width, image_size.height, codec->pix_fmt,
+      SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    if (!scaler) throw std::runtime_error("Failed to create pixel converter.");
+  }
+
+  /**
+   * Encodes one frame, returning the number of bytes muxed as a result.
+   */
+  std::size_t encode(const cv::Mat& image, std::int64_t pts) {
+    check_av(::av_frame_make_writable(frame), "Failed to reuse frame");
+    const std::uint8_t* const source[] = {image.data};
+    const int source_stride[] = {static_cast<int>(image.step)};
+    ::sws_scale(
+      scaler,
+      source,
+      source_stride,
+      0,
+      image.rows,
+      frame->data,
+      frame->linesize
+    );
+    frame->pts = pts;
+    check_av(::avcodec_send_frame(codec, frame), "Failed to encode frame");
+    return drain();
+  }
+
+  /**
+   * Flushes frames still buffered in the codec and finishes the file.
+   */
+  std::size_t finish() {
+    check_av(::avcodec_send_frame(codec, nullptr), "Failed to flush encoder");
+    const std::size_t bytes = drain();
+    check_av(::av_write_trailer(format), "Failed to finish video");
+    return bytes;
+  }
+
+  std::size_t drain() {
+    std::size_t bytes = 0;
+    while (true) {
+      const int res = ::avcodec_receive_packet(codec, packet);
+      if (res == AVERROR(EAGAIN) || res == AVERROR_EOF) break;
+      check_av(res, "Failed to encode frame");
+      ::av_packet_rescale_ts(packet, codec->time_base, stream->time_base);
+      packet->stream_index = stream->index;
+      bytes += packet->size;
+      check_av(
+        ::av_interleaved_write_frame(format, packet),
+        "Failed to write video packet"
+      );
+    }
+    return bytes;
+  }
+
+  void reset() {
+    ::sws_freeContext(scaler);
+    scaler = nullptr;
+    ::av_frame_free(&frame);
+    ::av_packet_free(&packet);
+    ::avcodec_free_context(&codec);
+    if (format) {
+      if (format->pb) ::avio_closep(&format->pb);
+      ::avformat_free_context(format);
+      format = nullptr;
+    }
+  }
+
+  ::AVPixelFormat input_format;
+  ::AVFormatContext* format = nullptr;
+  ::AVStream* stream = nullptr;
+  ::AVCodecContext* codec = nullptr;
+  ::AVFrame* frame = nullptr;
+  ::AVPacket* packet = nullptr;
+  ::SwsContext* scaler = nullptr;
+};
+
+std::string video_extension(VideoCodec codec) {
+  return codec == VideoCodec::H264 ? ".mp4" : ".mkv";
+}
+
+VideoWriter::VideoWriter(
+  const std::filesystem::path& path,
+  cv::Size image_size,
+  VideoWriterOptions options
+):
+  _path{path},
+  _image_size{image_size},
+  _options{std::move(options)},
+  _queue{_options.queue_capacity}
+{
+  _thread = std::thread{[this]() { _encode_loop(); }};
+}
+
+VideoWriter::~VideoWriter() {
+  try {
+    close();
+  } catch (const std::exception& err) {
+    std::cerr
+      << "Failed to finish " << _path << ": " << err.what() << std::endl;
+  }
+}
+
+void VideoWriter::write(cv::Mat image, steady_clock::time_point captured_at) {
+  _check(image);
+  _rethrow();
+  // Only refused once the encoder has failed and closed the queue.
+  if (!_queue.push({.image = std::move(image), .captured_at = captured_at})) {
+    _rethrow();
+  }
+}
+
+bool VideoWriter::try_write(
+  cv::Mat image,
+  steady_clock::time_point captured_at
+) {
+  _check(image);
+  _rethrow();
+  if (
+    !_queue.try_push({.image = std::move(image), .captured_at = captured_at})
+  ) {
+    _rethrow();
+    ++_frames_dropped;
+    return false;
+  }
+  return true;
+}
+
+void VideoWriter::close() {
+  _closing = true;
+  _queue.close();
+  if (_thread.joinable()) _thread.join();
+  if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+}
+
+void VideoWriter::_check(const cv::Mat& image) const {
+  if (_closing) throw std::logic_error("Video writer is already closed.");
+  if (image.size() != _image_size) {
+    throw std::invalid_argument("Frame size does not match the video.");
+  }
+  to_input_format(image.type());
+}
+
+void VideoWriter::_rethrow() {
+  if (!_failed) return;
+  if (_thread.joinable()) _thread.join();
+  if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+  throw std::logic_error("Video writer already failed.");
+}
+
+void VideoWriter::_encode_loop() {
+  try {
+    std::optional<steady_clock::time_point> first_capture;
+    std::int64_t last_pts = -1;
+    while (std::optional<Item> item = _queue.pop()) {
+      if (!_encoder) {
+        _encoder = std::make_unique<VideoEncoder>(
+          _path,
+          _image_size,
+          item->image.type(),
+          _options
+        );
+        first_capture = item->captured_at;
+      }
+      if (to_input_format(item->image.type()) != _encoder->input_format) {
+        throw std::invalid_argument("Frame type changed mid-video.");
+      }
+
+      // Timestamps must strictly increase even if two frames share a clock
+      // tick.
+      const std::int64_t pts = std::max(
+        last_pts + 1,
+        static_cast<std::int64_t>(
+          duration_cast<milliseconds>(item->captured_at - *first_capture)
+            .count()
+        )
+      );
+      last_pts = pts;
+      _bytes_written += _encoder->encode(item->image, pts);
+      ++_frames_written;
+    }
+    if (_encoder) _bytes_written += _encoder->finish();
+  } catch (...) {
+    _error = std::current_exception();
+    _failed = true;
+    // Wakes a writer waiting for room so it can rethrow.
+    _queue.close();
+  }
+  _encoder.reset();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+#include <thread>
+
+#include "src/blocking_queue.h"
+
+enum class VideoCodec {
+  // Lossy, small files. Needs FFmpeg built with libx264.
+  H264,
+
+  // Lossless, for frames that will be detected on or calibrated against.
+  FFV1
+};
+
+/**
+ * File extension of the container each codec is written in.
+ */
+std::string video_extension(VideoCodec codec);
+
+// Codec, muxer and scaler state, created once the first frame arrives.
+struct VideoEncoder;
+
+struct VideoWriterOptions {
+  VideoCodec codec = VideoCodec::H264;
+
+  // Nominal rate, used by players. Frames are stamped with their own capture
+  // times so dropped frames do not speed the video up.
+  double fps = 30.0;
+
+  // Frames between keyframes. Shorter intervals make seeking cheaper.
+  int keyframe_interval = 60;
+
+  // H.264 constant rate factor and x264 preset. Lower factors are higher
+  // quality, 18 is close to visually lossless.
+  int crf = 18;
+  std::string preset = "veryfast";
+
+  // Encoder threads, 0 lets the codec decide.
+  int threads = 0;
+
+  // Frames waiting to be encoded.
+  std::size_t queue_capacity = 8;
+};
+
+/**
+ * Encodes frames into a video file on a background thread.
+ *
+ * Frames are 8-bit BGR (`CV_8UC3`), YUYV (`CV_8UC2`) or grayscale (`CV_8UC1`)
+ * and all the same size and type. The writer keeps a reference to each image
+ * instead of copying it, so images must not be written to after being handed
+ * over. Writes are expected from a single thread.
+ */
+class VideoWriter {
+public:
+  VideoWriter(
+    const std::filesystem::path& path,
+    cv::Size image_size,
+    VideoWriterOptions options = {}
+  );
+  ~VideoWriter();
+  VideoWriter(const VideoWriter&) = delete;
+  VideoWriter& operator=(const VideoWriter&) = delete;
+  VideoWriter(VideoWriter&&) = delete;
+  VideoWriter& operator=(VideoWriter&&) = delete;
+
+  /**
+   * Queues the frame, waiting for room if the encoder is behind.
+   */
+  void write(
+    cv::Mat image,
+    std::chrono::steady_clock::time_point captured_at =
+      std::chrono::steady_clock::now()
+  );
+
+  /**
+   * Queues the frame unless the encoder is behind, in which case the frame is
+   * dropped and false returned.
+   */
+  bool try_write(
+    cv::Mat image,
+    std::chrono::steady_clock::time_point captured_at =
+      std::chrono::steady_clock::now()
+  );
+
+  /**
+   * Encodes the queued frames and finishes the file. Rethrows any error the
+   * encoder ran into. Nothing is written if no frames were.
+   */
+  void close();
+
+  std::uint64_t frames_written() const { return _frames_written; }
+  std::uint64_t frames_dropped() const { return _frames_dropped; }
+  std::uint64_t bytes_written() const { return _bytes_written; }
+
+private:
+  struct Item {
+    cv::Mat image;
+    std::chrono::steady_clock::time_point captured_at;
+  };
+
+  void _check(const cv::Mat& image) const;
+  void _rethrow();
+  void _encode_loop();
+
+  std::filesystem::path _path;
+  cv::Size _image_size;
+  VideoWriterOptions _options;
+  std::unique_ptr<VideoEncoder> _encoder;
+  BlockingQueue<Item> _queue;
+  std::atomic_bool _closing = false;
+  std::atomic_bool _failed = false;
+  std::exception_ptr _error;
+  std::atomic_uint64_t _frames_written = 0;
+  std::atomic_uint64_t _frames_dropped = 0;
+  std::atomic_uint64_t _bytes_written = 0;
+  std::thread _thread;
+};
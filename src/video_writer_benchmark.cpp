@@ -0,0 +1,104 @@
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/video_writer.h"
+
+namespace {
+
+const std::filesystem::path BENCHMARK_DIR = "/tmp/benchmark/ar/video_writer";
+const cv::Size IMAGE_SIZE{1920, 1080};
+constexpr int FRAME_COUNT = 60;
+
+/**
+ * A second of camera-like frames: smooth gradients, sensor noise and a
+ * moving edge, so codecs cannot cheat on flat or identical images.
+ */
+std::vector<cv::Mat> make_frames() {
+  cv::Mat base{IMAGE_SIZE, CV_8UC3};
+  for (int y = 0; y < base.rows; ++y) {
+    for (int x = 0; x < base.cols; ++x) {
+      base.at<cv::Vec3b>(y, x) = cv::Vec3b(
+        x * 255 / base.cols,
+        y * 255 / base.rows,
+        128
+      );
+    }
+  }
+  cv::RNG rng{7};
+  std::vector<cv::Mat> frames;
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    cv::Mat noise{IMAGE_SIZE, CV_8UC3};
+    rng.fill(noise, cv::RNG::UNIFORM, 0, 8);
+    cv::Mat frame = base + noise;
+    frame.colRange(i * 16, i * 16 + 200).setTo(cv::Scalar{40, 200, 40});
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+const std::vector<cv::Mat>& frames() {
+  static const std::vector<cv::Mat> frames = make_frames();
+  return frames;
+}
+
+std::filesystem::path output_path(const std::string& name) {
+  std::filesystem::create_directories(BENCHMARK_DIR);
+  return BENCHMARK_DIR / name;
+}
+
+void set_counters(benchmark::State& state, double bytes) {
+  const double frame_count =
+    static_cast<double>(state.iterations()) * FRAME_COUNT;
+  state.counters["fps"] =
+    benchmark::Counter(frame_count, benchmark::Counter::kIsRate);
+  state.counters["bytes_per_frame"] = bytes / frame_count;
+  state.counters["disk_bandwidth"] = benchmark::Counter(
+    bytes,
+    benchmark::Counter::kIsRate,
+    benchmark::Counter::kIs1024
+  );
+}
+
+void BM_Png(benchmark::State& state) {
+  double bytes = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+      const std::filesystem::path path =
+        output_path(std::to_string(i) + ".png");
+      cv::imwrite(path.string(), frames()[i]);
+      bytes += std::filesystem::file_size(path);
+    }
+  }
+  set_counters(state, bytes);
+}
+BENCHMARK(BM_Png)
+  ->Unit(benchmark::kMillisecond)
+  ->MeasureProcessCPUTime()
+  ->UseRealTime();
+
+void BM_Video(benchmark::State& state) {
+  const VideoCodec codec = static_cast<VideoCodec>(state.range(0));
+  const std::filesystem::path path =
+    output_path("video" + video_extension(codec));
+  double bytes = 0;
+  for (auto _ : state) {
+    VideoWriter writer{path, IMAGE_SIZE, {.codec = codec}};
+    for (const cv::Mat& frame : frames()) writer.write(frame);
+    writer.close();
+    bytes += writer.bytes_written();
+  }
+  set_counters(state, bytes);
+}
+BENCHMARK(BM_Video)
+  ->ArgName("codec")
+  ->Arg(static_cast<int>(VideoCodec::H264))
+  ->Arg(static_cast<int>(VideoCodec::FFV1))
+  ->Unit(benchmark::kMillisecond)
+  ->MeasureProcessCPUTime()
+  ->UseRealTime();
+
+}
@@ -0,0 +1,120 @@
+#include "src/video_writer.h"
+
+#include <chrono>
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::filesystem::path;
+
+const path TEST_DIR = "/tmp/testing/ar/src/video_writer";
+const cv::Size IMAGE_SIZE{320, 240};
+
+path test_path(std::string_view extension) {
+  std::filesystem::create_directories(TEST_DIR);
+  const path video_path =
+    TEST_DIR /
+    (std::string{
+      testing::UnitTest::GetInstance()->current_test_info()->name()
+    } + std::string{extension});
+  std::filesystem::remove(video_path);
+  return video_path;
+}
+
+cv::Mat make_image(int type, int i) {
+  cv::Mat image{IMAGE_SIZE, type};
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  image.row(i % IMAGE_SIZE.height).setTo(cv::Scalar::all(255));
+  return image;
+}
+
+void write_frames(VideoWriter& writer, int type, int count) {
+  const steady_clock::time_point start = steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    writer.write(make_image(type, i), start + milliseconds{33 * i});
+  }
+}
+
+TEST(VideoWriter, WritesLosslessVideo) {
+  const path video_path = test_path(video_extension(VideoCodec::FFV1));
+  VideoWriter writer{video_path, IMAGE_SIZE, {.codec = VideoCodec::FFV1}};
+  write_frames(writer, CV_8UC3, 30);
+  writer.close();
+
+  EXPECT_EQ(writer.frames_written(), 30);
+  EXPECT_EQ(writer.frames_dropped(), 0);
+  EXPECT_GT(writer.bytes_written(), 0);
+  ASSERT_TRUE(std::filesystem::exists(video_path));
+  EXPECT_GE(std::filesystem::file_size(video_path), writer.bytes_written());
+}
+
+TEST(VideoWriter, WritesYuyvAndGrayFrames) {
+  for (int type : {CV_8UC2, CV_8UC1}) {
+    const path video_path =
+      test_path(std::to_string(type) + video_extension(VideoCodec::FFV1));
+    VideoWriter writer{video_path, IMAGE_SIZE, {.codec = VideoCodec::FFV1}};
+    write_frames(writer, type, 5);
+    writer.close();
+    EXPECT_EQ(writer.frames_written(), 5);
+    EXPECT_TRUE(std::filesystem::exists(video_path));
+  }
+}
+
+TEST(VideoWriter, RejectsMismatchedFrames) {
+  VideoWriter writer{
+    test_path(video_extension(VideoCodec::FFV1)),
+    IMAGE_SIZE,
+    {.codec = VideoCodec::FFV1}
+  };
+  EXPECT_THROW(
+    writer.write(cv::Mat{cv::Size{64, 64}, CV_8UC3}),
+    std::invalid_argument
+  );
+  EXPECT_THROW(
+    writer.write(cv::Mat{IMAGE_SIZE, CV_32F}),
+    std::invalid_argument
+  );
+}
+
+TEST(VideoWriter, DropsFramesWhenFull) {
+  VideoWriter writer{
+    test_path(video_extension(VideoCodec::FFV1)),
+    IMAGE_SIZE,
+    {.codec = VideoCodec::FFV1, .queue_capacity = 1}
+  };
+  int accepted = 0;
+  for (int i = 0; i < 100; ++i) {
+    if (writer.try_write(make_image(CV_8UC3, i))) ++accepted;
+  }
+  writer.close();
+  EXPECT_EQ(writer.frames_written(), accepted);
+  EXPECT_EQ(writer.frames_dropped(), 100 - accepted);
+}
+
+TEST(VideoWriter, EmptyVideoWritesNothing) {
+  const path video_path = test_path(video_extension(VideoCodec::FFV1));
+  {
+    VideoWriter writer{video_path, IMAGE_SIZE, {.codec = VideoCodec::FFV1}};
+  }
+  EXPECT_FALSE(std::filesystem::exists(video_path));
+}
+
+TEST(VideoWriter, ClosedWriterRejectsFrames) {
+  VideoWriter writer{
+    test_path(video_extension(VideoCodec::FFV1)),
+    IMAGE_SIZE,
+    {.codec = VideoCodec::FFV1}
+  };
+  writer.close();
+  EXPECT_THROW(writer.write(make_image(CV_8UC3, 0)), std::logic_error);
+}
+
+}
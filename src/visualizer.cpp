@@ -1,21 +1,33 @@
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "src/camera_model.h"
+#include "src/camera_registry.h"
 #include "src/cameras.h"
 #include "src/files.h"
+#include "src/frame_cache.h"
+#include "src/frame_source.h"
 #include "src/keys.h"
+#include "src/tiled_view.h"
 #include "src/tracking.h"
+#include "src/undistort.h"
+#include "src/video_reader.h"
 
 using namespace std::chrono_literals;
 using std::filesystem::directory_iterator;
@@ -33,41 +45,41 @@ void draw(cv::Mat& image, cv::Scalar color, Point point) {
   cv::putText(image, std::to_string(point.point_id), center, cv::FONT_HERSHEY_PLAIN, 0.5, color);
 }
 
-void draw(
-  cv::Mat& image,
-  cv::Scalar color,
-  const CameraParameters& camera,
-  const std::vector<Point3d>& points
-) {
-  std::vector<cv::Point3d> points3d;
-  std::vector<cv::Point2d> points2d;
-  for (const Point3d& point : points) {
-    // std::cout << point.x << ',' << point.y << ',' << point.z << std::endl;
-    points3d.emplace_back(point.x, point.y, point.z);
-  }
-  cv::projectPoints(
-    points3d,
-    camera.rotation,
-    camera.translation,
-    camera.matrix,
-    camera.distortion,
-    points2d
-  );
+void draw(cv::Mat& image, const std::vector<cv::Point2d>& body) {
+  const cv::Scalar color{0, 0, 0};
   int point_id = 0;
-  for (const cv::Point2d& point : points2d) {
-    draw(image, color, {.point_id = point_id++, .x = point.x, .y = point.y});
+  for (const cv::Point2d& point : body) {
+    const int id = point_id++;
+    if (!std::isfinite(point.x) || !std::isfinite(point.y)) continue;
+    draw(image, color, {.point_id = id, .x = point.x, .y = point.y});
   }
 }
 
-void draw(
-  cv::Mat& image,
-  const CameraParameters& camera,
-  const Person3d& person
+/**
+ * Moves a person's keypoints from the raw image into the rectified image.
+ */
+Person undistort(
+  const Person& person,
+  const PointUndistorter& undistorter,
+  const cv::Matx33d& matrix
 ) {
-  draw(image, {0, 0, 0}, camera, person.body);
-  // draw(image, {0, 64, 0}, camera, person.face);
-  // draw(image, {0, 128, 0}, camera, person.right_paw);
-  // draw(image, {0, 196, 0}, camera, person.left_paw);
+  Person undistorted = person;
+  for (auto* part : {
+    &undistorted.body, &undistorted.face, &undistorted.right_paw,
+    &undistorted.left_paw
+  }) {
+    std::vector<cv::Point2f> pixels;
+    std::vector<cv::Point2f> rectified;
+    for (const Point& point : *part) {
+      pixels.emplace_back(static_cast<float>(point.x), static_cast<float>(point.y));
+    }
+    undistorter.undistort(pixels, rectified, matrix);
+    for (std::size_t i = 0; i < rectified.size(); ++i) {
+      (*part)[i].x = rectified[i].x;
+      (*part)[i].y = rectified[i].y;
+    }
+  }
+  return undistorted;
 }
 
 void draw(cv::Mat& image, const Person& person) {
@@ -88,43 +100,154 @@ void draw(cv::Mat& image, const Person& person) {
   // }
 }
 
-int main() {
-  auto recordings_iterator =
-    directory_iterator{get_recordings_directory_path()};
-  std::map<std::string, CameraParameters> cameras;
-  std::vector<std::pair<std::string, std::filesystem::path>> image_files;
-  for (const auto& cam_dir : recordings_iterator) {
-    const std::string& cam_name = cam_dir.path().stem().string();
+/**
+ * One frame of one camera's recording, either a PNG or a frame of a video.
+ */
+struct FrameRef {
+  std::string cam_name;
+  std::size_t frame_index;
+  std::filesystem::path path;
+};
+
+/**
+ * Everything read from disk to show a frame, kept in the frame cache.
+ */
+struct LoadedFrame {
+  cv::Mat image;
+  std::vector<Person> people;
+  std::vector<Person3d> people_3d;
+};
+
+/**
+ * An open video, decoded from by one cache thread at a time.
+ */
+struct Video {
+  explicit Video(const std::filesystem::path& path): reader{path} {}
+
+  std::mutex mutex;
+  VideoReader reader;
+};
+
+/**
+ * What is on screen, so a frame is only drawn again when this changes.
+ */
+struct View {
+  std::size_t index;
+  bool use_3d;
+  bool use_undistorted;
+  bool use_tiles;
+
+  bool operator==(const View&) const = default;
+};
+
+int main(int argc, char* argv[]) {
+  // Videos given on the command line, or else every camera directory in the
+  // recordings. Cameras are named after the directory their frames are in.
+  std::vector<std::filesystem::path> recordings;
+  for (int i = 1; i < argc; ++i) recordings.emplace_back(argv[i]);
+  if (recordings.empty()) {
+    auto recordings_iterator =
+      directory_iterator{get_recordings_directory_path()};
+    for (const auto& cam_dir : recordings_iterator) {
+      if (!cam_dir.is_directory()) continue;
+      std::optional<std::filesystem::path> video = find_video(cam_dir.path());
+      recordings.push_back(video ? *video : cam_dir.path());
+    }
+  }
+
+  // Calibrations are parsed once and their maps kept across runs.
+  CameraRegistry& registry = CameraRegistry::global();
+  std::map<std::string, std::filesystem::path> cameras;
+  std::map<std::string, Video> videos;
+  std::vector<FrameRef> image_files;
+  for (const std::filesystem::path& recording : recordings) {
+    const bool is_video = is_video_file(recording);
+    const std::string cam_name = is_video
+      ? recording.parent_path().filename().string()
+      : recording.filename().string();
     if (cameras.count(cam_name) == 0) {
-      cameras[cam_name] = load_camera_parameters(
-        get_calibration_path(cam_name)
-      );
+      cameras[cam_name] = get_calibration_path(cam_name);
+      registry.model(cameras[cam_name]);
+    }
+    if (is_video) {
+      // Stepping through frames out of order relies on the reader's seeks.
+      videos.erase(cam_name);
+      const VideoReader& video =
+        videos.try_emplace(cam_name, recording).first->second.reader;
+      for (std::size_t i = 0; i < video.frame_count(); ++i) {
+        image_files.push_back({
+          .cam_name = cam_name,
+          .frame_index = i,
+          .path = recording
+        });
+      }
+      continue;
     }
-    for (const auto& file : directory_iterator{cam_dir}) {
+    for (const auto& file : directory_iterator{recording}) {
       if (file.path().extension() == ".png") {
-        image_files.emplace_back(cam_name, file.path());
+        image_files.push_back({
+          .cam_name = cam_name,
+          .frame_index = std::stoull(file.path().stem().string(), 0, 10),
+          .path = file.path()
+        });
       }
     }
   }
   std::sort(
     image_files.begin(),
     image_files.end(),
-    [](const auto& a_, const auto& b_) {
-      const auto& [a_cam, a] = a_;
-      const auto& [b_cam, b] = b_;
-      std::uint64_t a_id = std::stoull(a.stem().string(), 0, 10) * 1'000'000'000;
-      std::uint64_t b_id = std::stoull(b.stem().string(), 0, 10) * 1'000'000'000;
-      std::uint64_t a_parent_id = std::stoull(a.parent_path().stem().string(), 0, 10);
-      std::uint64_t b_parent_id = std::stoull(b.parent_path().stem().string(), 0, 10);
-
-      return (a_parent_id + a_id) < (b_parent_id + b_id);
+    [](const FrameRef& a, const FrameRef& b) {
+      return std::tie(a.frame_index, a.cam_name) <
+        std::tie(b.frame_index, b.cam_name);
     }
   );
 
+  // Frames are decoded and their keypoints parsed once, on background threads
+  // ahead of wherever the frames are being stepped through.
+  FrameCache<LoadedFrame> frames{
+    image_files.size(),
+    [&](std::size_t index) {
+      const auto& [cam_name, frame_index, image_file] = image_files[index];
+      LoadedFrame loaded;
+      if (auto video = videos.find(cam_name); video != videos.end()) {
+        std::lock_guard<std::mutex> lock{video->second.mutex};
+        VideoReader& reader = video->second.reader;
+        if (reader.position() != frame_index) reader.seek(frame_index);
+        loaded.image = reader.read().value_or(cv::Mat{});
+      } else {
+        loaded.image = cv::imread(image_file.string());
+      }
+
+      const std::filesystem::path frame_file =
+        keypoints_path({.frame_id = frame_index, .path = image_file});
+      const std::filesystem::path frame_file_3d =
+        get_animation_directory_path() / frame_file.filename();
+      if (std::filesystem::exists(frame_file)) {
+        loaded.people = load_people(frame_file);
+      }
+      if (std::filesystem::exists(frame_file_3d)) {
+        loaded.people_3d = load_people_3d(frame_file_3d);
+      }
+      return loaded;
+    },
+    {.capacity = 32 * std::max<std::size_t>(cameras.size(), 1)}
+  };
+
+  struct Undistortion {
+    const Rectifier* rectifier;
+    PointUndistorter undistorter;
+    CameraModel model;
+  };
+  std::map<std::string, Undistortion> undistortions;
+
   std::size_t i = 0;
+  std::optional<View> shown;
   Key key;
   bool use_3d = false;
-  while (key = wait_key(33ms), key != Key::ESC) {
+  bool use_undistorted = false;
+  bool use_tiles = false;
+  TiledRenderer tiled_renderer;
+  while (key = wait_key(16ms), key != Key::ESC) {
     if (key == Key::ONE) ++i;
     else if (key == Key::TWO) i += cameras.size();
     else if (key == Key::THREE) i += 10 * cameras.size();
@@ -134,24 +257,99 @@ int main() {
     else if (key == Key::E) i -= 10 * cameras.size();
     else if (key == Key::R) i -= 100 * cameras.size();
     else if (key == Key::M) use_3d = !use_3d;
+    else if (key == Key::Z) use_undistorted = !use_undistorted;
+    else if (key == Key::T) use_tiles = !use_tiles;
     i %= image_files.size();
 
+    // The window keeps showing the last frame until something changes.
+    const View view{
+      .index = i,
+      .use_3d = use_3d,
+      .use_undistorted = use_undistorted,
+      .use_tiles = use_tiles
+    };
+    if (shown == view) continue;
+    shown = view;
+
+    if (use_tiles) {
+      // Every camera's image of the frame, which sort next to each other.
+      const std::size_t frame_index = image_files[i].frame_index;
+      std::size_t first = i;
+      while (first > 0 && image_files[first - 1].frame_index == frame_index) {
+        --first;
+      }
+      std::vector<CameraTile> tiles;
+      for (
+        std::size_t index = first;
+        index < image_files.size() &&
+          image_files[index].frame_index == frame_index;
+        ++index
+      ) {
+        const std::string& cam_name = image_files[index].cam_name;
+        const std::shared_ptr<const LoadedFrame> frame = frames.get(index);
+        tiles.push_back(CameraTile{
+          .label = cam_name + " #" + std::to_string(frame_index),
+          .image = frame->image,
+          .people = frame->people,
+          .projected = project_people(
+            registry.model(cameras[cam_name]),
+            frame->people_3d
+          )
+        });
+      }
+      cv::imshow("Visualizer", tiled_renderer.render(tiles));
+      continue;
+    }
+
     // TODO: Add 3d point tweaking to derive points in space
 
-    auto [cam_name, image_file] = image_files[i];
-    cv::Mat image = cv::imread(image_file.string());
-    const auto& frame_file = image_file.replace_extension(".yml");
+    const auto& [cam_name, frame_index, image_file] = image_files[i];
+    const std::shared_ptr<const LoadedFrame> frame = frames.get(i);
+    cv::Mat image = frame->image.clone();
+
+    // Undistortion maps and grids are built once per camera and reused.
+    const CameraModel* camera = &registry.model(cameras[cam_name]);
+    const Undistortion* undistortion = nullptr;
+    if (use_undistorted) {
+      auto itr = undistortions.find(cam_name);
+      if (itr == undistortions.end()) {
+        const std::filesystem::path& calibration = cameras[cam_name];
+        const Rectifier& rectifier =
+          registry.rectifier(calibration, image.size());
+        const cv::Matx33d matrix = rectifier.optimal_matrix();
+        itr = undistortions.emplace(cam_name, Undistortion{
+          .rectifier = &rectifier,
+          .undistorter = PointUndistorter{
+            registry.parameters(calibration),
+            image.size(),
+            4
+          },
+          .model = camera->undistorted(matrix)
+        }).first;
+      }
+      undistortion = &itr->second;
+      image = undistortion->rectifier->rectify(image);
+      camera = &undistortion->model;
+    }
+
     if (use_3d) {
-      std::vector<Person3d> people =
-        load_people_3d(get_animation_directory_path() / frame_file.filename());
-      for (const Person3d& person : people) {
-        draw(image, cameras[cam_name], person);
+      for (const auto& body : project_people(*camera, frame->people_3d)) {
+        draw(image, body);
       }
     } else {
-      std::vector<Person> people = load_people(frame_file);
-      for (const Person& person : people) draw(image, person);
+      for (const Person& person : frame->people) {
+        if (undistortion) {
+          const cv::Matx33d matrix = undistortion->rectifier->optimal_matrix();
+          draw(image, undistort(person, undistortion->undistorter, matrix));
+        } else {
+          draw(image, person);
+        }
+      }
     }
-    cv::putText(image, image_file.string(), {5, 15}, cv::FONT_HERSHEY_PLAIN, 1, {0, 0, 0}, 1, cv::LINE_AA);
+    const std::string label = videos.count(cam_name)
+      ? image_file.string() + " #" + std::to_string(frame_index)
+      : image_file.string();
+    cv::putText(image, label, {5, 15}, cv::FONT_HERSHEY_PLAIN, 1, {0, 0, 0}, 1, cv::LINE_AA);
     cv::imshow("Visualizer", image);
   }
 }